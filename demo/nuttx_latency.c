@@ -0,0 +1,176 @@
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../src/nn_nuttx.h"
+
+/*
+ * Round-trip latency of nn_client_transaction over each transport nn_nuttx
+ * can pick: inproc for a server in the same process, IPC for a server in
+ * another process and TCP for a server on another board (loopback here).
+ *
+ * The remote servers run in a child process forked before nanomsg is used.
+ */
+
+#define LATENCY_ECHO 1
+#define LATENCY_WARMUP 100
+#define LATENCY_SERVICE "nn_nuttx_latency"
+
+static uint64_t nanoseconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static int latency_on_transaction(const void* cookie, const int code, nn_trans_data_t* data)
+{
+    if (code != LATENCY_ECHO || data->in_size == 0) {
+        return 0;
+    }
+
+    data->out = nn_trans_alloc(data->in_size);
+
+    if (data->out == NULL) {
+        return -ENOMEM;
+    }
+
+    memcpy(data->out, data->in, data->in_size);
+    data->out_size = data->in_size;
+    data->out_msg = true;
+    return 0;
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static int measure(const char* label, const char* name, size_t msg_size, int count)
+{
+    void* client;
+    uint8_t* in;
+    uint8_t* out;
+    uint64_t* samples;
+    uint64_t total = 0;
+    int rc = 0;
+    int i;
+
+    client = nn_client_connect(name);
+    in = calloc(1, msg_size + 1);
+    out = calloc(1, msg_size + 1);
+    samples = calloc(count, sizeof(uint64_t));
+
+    if (client == NULL || in == NULL || out == NULL || samples == NULL) {
+        fprintf(stderr, "%s: setup failed\n", label);
+        rc = -1;
+        goto out;
+    }
+
+    memset(in, 'x', msg_size);
+
+    for (i = -LATENCY_WARMUP; i < count && rc == 0; i++) {
+        uint64_t start = nanoseconds();
+        rc = nn_client_transaction(client, LATENCY_ECHO, in, msg_size, out, msg_size);
+
+        if (i >= 0) {
+            samples[i] = nanoseconds() - start;
+            total += samples[i];
+        }
+    }
+
+    if (rc != 0) {
+        fprintf(stderr, "%s: transaction failed, rc=%d\n", label, rc);
+        goto out;
+    }
+
+    qsort(samples, count, sizeof(uint64_t), compare_u64);
+    fprintf(stdout, "%-8s %10zu %10d %10.1f %10.1f %10.1f %10.1f\n", label, msg_size, count,
+            (double)total / count / 1000, (double)samples[count / 2] / 1000,
+            (double)samples[(size_t)count * 99 / 100] / 1000, (double)samples[count - 1] / 1000);
+
+out:
+    nn_client_disconnect(client);
+    free(samples);
+    free(out);
+    free(in);
+    return rc;
+}
+
+int main(int argc, char** argv)
+{
+    size_t msg_size = argc > 1 ? (size_t)atol(argv[1]) : 64;
+    int count = argc > 2 ? atoi(argv[2]) : 10000;
+    int port = argc > 3 ? atoi(argv[3]) : 5599;
+    char tcp_url[64];
+    char c = 0;
+    void* servers[2];
+    void* server;
+    int ready[2];
+    int quit[2];
+    int rc = 0;
+    pid_t pid;
+
+    if (count <= 0) {
+        fprintf(stderr, "Usage: %s [msg_size] [roundtrips] [tcp_port]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    snprintf(tcp_url, sizeof(tcp_url), "tcp://127.0.0.1:%d", port);
+
+    if (pipe(ready) < 0 || pipe(quit) < 0) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    pid = fork();
+
+    if (pid < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pid == 0) {
+        /* Remote side: the IPC and TCP servers. */
+        servers[0] = nn_server_create(LATENCY_SERVICE "_ipc");
+        servers[1] = nn_server_create(tcp_url);
+        nn_server_set_transaction_cb(servers[0], latency_on_transaction, NULL);
+        nn_server_set_transaction_cb(servers[1], latency_on_transaction, NULL);
+        c = (servers[0] != NULL && servers[1] != NULL);
+        write(ready[1], &c, 1);
+        read(quit[0], &c, 1);
+        nn_server_release(servers[0]);
+        nn_server_release(servers[1]);
+        exit(EXIT_SUCCESS);
+    }
+
+    if (read(ready[0], &c, 1) != 1 || !c) {
+        fprintf(stderr, "remote servers failed to start\n");
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(stdout, "%-8s %10s %10s %10s %10s %10s %10s\n", "trans", "size", "count",
+            "avg[us]", "p50[us]", "p99[us]", "max[us]");
+
+    server = nn_server_create(LATENCY_SERVICE "_inproc");
+
+    if (server == NULL) {
+        rc = -1;
+    } else {
+        nn_server_set_transaction_cb(server, latency_on_transaction, NULL);
+        rc |= measure("inproc", LATENCY_SERVICE "_inproc", msg_size, count);
+        nn_server_release(server);
+    }
+
+    rc |= measure("ipc", LATENCY_SERVICE "_ipc", msg_size, count);
+    rc |= measure("tcp", tcp_url, msg_size, count);
+
+    write(quit[1], &c, 1);
+    waitpid(pid, NULL, 0);
+
+    exit(rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
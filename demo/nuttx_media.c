@@ -155,10 +155,10 @@ static int media_server_on_transaction(const void* cookie, const int code, nn_tr
 static int media_player_listener(const void* thiz, const void* topic, const size_t topic_len, const void* content, const size_t content_len) {
     player_t* player = (player_t*)thiz;
     player_info_t* info = (player_info_t*)content;
-    if (strncmp(player->name, (char*)topic, sizeof(player->name) != 0)) {
-        nn_log("%s.player=%s, topic=%s\n", player->name, (char*)topic);
+    if (topic_len != strlen(player->name) || strncmp(player->name, (char*)topic, topic_len) != 0) {
+        nn_log("%s.player=%s, topic=%.*s\n", __func__, player->name, (int)topic_len, (char*)topic);
     } else {
-        nn_log("%s.%s.topic=%s, .cmd=%d, .arg1=%d, .arg2=%d\n", __func__, player->name, (char*)topic, info->cmd, info->arg1, info->arg2);
+        nn_log("%s.%s.topic=%.*s, .cmd=%d, .arg1=%d, .arg2=%d\n", __func__, player->name, (int)topic_len, (char*)topic, info->cmd, info->arg1, info->arg2);
     }
 }
 
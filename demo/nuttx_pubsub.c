@@ -55,7 +55,7 @@ static void* pub_worker(void* arg)
 
 static int local_sub_listener(const void* thiz, const void* topic, const size_t topic_len, const void* content, const size_t content_len) {
     nn_nuttx_sub_test_t* test = (nn_nuttx_sub_test_t*)thiz;
-    fprintf(stderr, "%s.%s.listener.topic=%s\n", __func__, test->name, (char*)topic);
+    fprintf(stderr, "%s.%s.listener.topic=%.*s\n", __func__, test->name, (int)topic_len, (char*)topic);
 }
 
 int client(const char* url, const char* name)
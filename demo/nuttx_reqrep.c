@@ -1,6 +1,7 @@
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 #include "nn_nuttx.h"
 
@@ -36,9 +37,10 @@ static int media_server_on_transaction(const void* cookie, const int code, nn_tr
     case CREATE:
         if (data != NULL) {
             fprintf(stdout, "media_server.create.name=%s\n", (char*)data->in);
-            data->out = malloc(strlen("created"));
+            data->out = nn_trans_alloc(strlen("created"));
             memcpy(data->out, "created", strlen("created"));
             data->out_size = strlen("created");
+            data->out_msg = true;
         }
 
         break;
@@ -88,6 +90,30 @@ static int media_server_on_transaction(const void* cookie, const int code, nn_tr
     return ret;
 }
 
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int outstanding;
+    int failed;
+} client_batch_t;
+
+static void client_on_reply(void* cookie, int ret, const void* out, size_t out_len)
+{
+    client_batch_t* batch = (client_batch_t*)cookie;
+
+    pthread_mutex_lock(&batch->lock);
+
+    if (ret != 0) {
+        batch->failed++;
+    }
+
+    if (--batch->outstanding == 0) {
+        pthread_cond_signal(&batch->cond);
+    }
+
+    pthread_mutex_unlock(&batch->lock);
+}
+
 int client(const char* url, const char* name)
 {
     int rc = 0;
@@ -96,6 +122,7 @@ int client(const char* url, const char* name)
     if (client != NULL) {
         char out[15] = {0};
         int  is_playing = 0;
+        nn_trans_reply_t reply;
         fprintf(stderr, "client connected\n");
         rc = nn_client_transaction(client, CREATE, name, strlen(name), out, sizeof(out));
 
@@ -105,31 +132,40 @@ int client(const char* url, const char* name)
             fprintf(stdout, "player.name=%s, create.out=%s\n", name, out);
         }
 
-        rc = nn_client_transaction(client, SET_DATA_SOURCE, "http://253.mp3", strlen("http://253.mp3"), NULL, 0);
+        // independent commands, all of them in flight at once
+        {
+            client_batch_t batch = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 3, 0};
+            int sent = 0;
 
-        if (rc != 0) {
-            fprintf(stdout, "player.name=%s, set_data_source.error=%d\n", name, rc);
-        }
+            sent += nn_client_transaction_async(client, SET_DATA_SOURCE, "http://253.mp3", strlen("http://253.mp3"), client_on_reply, &batch) == 0;
+            sent += nn_client_transaction_async(client, PREPARE, NULL, 0, client_on_reply, &batch) == 0;
+            sent += nn_client_transaction_async(client, START, NULL, 0, client_on_reply, &batch) == 0;
 
-        rc = nn_client_transaction(client, PREPARE, NULL, 0, NULL, 0);
+            pthread_mutex_lock(&batch.lock);
+            batch.outstanding -= 3 - sent;
 
-        if (rc != 0) {
-            fprintf(stdout, "player.name=%s, prepare.error=%d\n", name, rc);
-        }
+            while (batch.outstanding > 0) {
+                pthread_cond_wait(&batch.cond, &batch.lock);
+            }
 
-        rc = nn_client_transaction(client, START, NULL, 0, NULL, 0);
+            pthread_mutex_unlock(&batch.lock);
+            rc = (sent == 3 && batch.failed == 0) ? 0 : -1;
 
-        if (rc != 0) {
-            fprintf(stdout, "player.name=%s, start.error=%d\n", name, rc);
+            if (rc != 0) {
+                fprintf(stdout, "player.name=%s, sent=%d, failed=%d\n", name, sent, batch.failed);
+            }
         }
 
-        rc = nn_client_transaction(client, ISPLAYING, NULL, 0, &is_playing, sizeof(is_playing));
+        rc = nn_client_transaction_borrow(client, ISPLAYING, NULL, 0, &reply);
 
-        if (rc != 0) {
+        if (rc != 0 || reply.size != sizeof(is_playing)) {
             fprintf(stdout, "player.name=%s, isplaying.error=%d\n", name, rc);
         } else {
+            memcpy(&is_playing, reply.data, sizeof(is_playing));
             fprintf(stdout, "player.name=%s, isplaying=%d\n", name, is_playing);
         }
+
+        nn_trans_reply_free(&reply);
     }
 
     nn_client_disconnect(client);
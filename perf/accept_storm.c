@@ -0,0 +1,234 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+/*  Simulates a reconnection storm: a large number of clients connect to
+    a single bound NN_PULL socket at the same time. Clients are plain TCP
+    sockets speaking the SP protocol header, so that the number of clients
+    is not limited by the number of nanomsg sockets. Reports how long it
+    takes until all the connections are accepted, handshaked and have
+    delivered one message, first with connections accepted one per poller
+    event and then with NN_TCP_ACCEPT_BATCH set. */
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/tcp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#if defined NN_HAVE_WINDOWS
+
+int main ()
+{
+    printf ("accept_storm is not supported on this platform\n");
+    return 0;
+}
+
+#else
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*  SP header of NN_PUSH socket followed by a single message "ABC". */
+static const unsigned char storm_out [] = {
+    0x00, 'S', 'P', 0x00, 0x00, NN_PUSH, 0x00, 0x00,
+    0, 0, 0, 0, 0, 0, 0, 3, 'A', 'B', 'C'
+};
+
+#define STORM_HDR_LEN 8
+
+struct storm_client {
+    int s;
+    size_t sent;
+    size_t rcvd;
+};
+
+static void storm (int port, int nclients, int listeners, int batch)
+{
+    char addr [64];
+    struct sockaddr_in sin;
+    struct storm_client *clients;
+    struct pollfd *pfds;
+    char buf [STORM_HDR_LEN];
+    struct nn_stopwatch sw;
+    uint64_t connected;
+    uint64_t total;
+    int done;
+    int s;
+    int rc;
+    int i;
+    int n;
+
+    s = nn_socket (AF_SP, NN_PULL);
+    nn_assert (s >= 0);
+    rc = nn_setsockopt (s, NN_TCP, NN_TCP_LISTENERS, &listeners,
+        sizeof (listeners));
+    nn_assert (rc == 0);
+    rc = nn_setsockopt (s, NN_TCP, NN_TCP_ACCEPT_BATCH, &batch,
+        sizeof (batch));
+    nn_assert (rc == 0);
+    snprintf (addr, sizeof (addr), "tcp://127.0.0.1:%d", port);
+    rc = nn_bind (s, addr);
+    nn_assert (rc >= 0);
+
+    clients = malloc (sizeof (struct storm_client) * nclients);
+    alloc_assert (clients);
+    pfds = malloc (sizeof (struct pollfd) * nclients);
+    alloc_assert (pfds);
+
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    /*  Fire all the connection attempts at once. */
+    nn_stopwatch_init (&sw);
+    for (i = 0; i != nclients; ++i) {
+        clients [i].s = socket (AF_INET, SOCK_STREAM, 0);
+        errno_assert (clients [i].s >= 0);
+        rc = fcntl (clients [i].s, F_SETFL, O_NONBLOCK);
+        errno_assert (rc == 0);
+        rc = connect (clients [i].s, (struct sockaddr*) &sin, sizeof (sin));
+        errno_assert (rc == 0 || errno == EINPROGRESS);
+        clients [i].sent = 0;
+        clients [i].rcvd = 0;
+    }
+
+    /*  Drive the handshakes. A client is done once it has received the
+        peer's SP header and has sent its own header and the message. */
+    done = 0;
+    while (done != nclients) {
+        n = 0;
+        for (i = 0; i != nclients; ++i) {
+            if (clients [i].sent == sizeof (storm_out) &&
+                  clients [i].rcvd == STORM_HDR_LEN)
+                continue;
+            pfds [n].fd = clients [i].s;
+            pfds [n].events = clients [i].sent < sizeof (storm_out) ?
+                POLLOUT : POLLIN;
+            pfds [n].revents = 0;
+            ++n;
+        }
+        rc = poll (pfds, n, 1000);
+        errno_assert (rc >= 0);
+        for (i = 0, n = 0; i != nclients; ++i) {
+            if (clients [i].sent == sizeof (storm_out) &&
+                  clients [i].rcvd == STORM_HDR_LEN)
+                continue;
+            if (pfds [n++].revents == 0)
+                continue;
+            if (clients [i].sent < sizeof (storm_out)) {
+                rc = (int) send (clients [i].s, storm_out + clients [i].sent,
+                    sizeof (storm_out) - clients [i].sent, 0);
+                if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    continue;
+                errno_assert (rc >= 0);
+                clients [i].sent += rc;
+                continue;
+            }
+            rc = (int) recv (clients [i].s, buf,
+                STORM_HDR_LEN - clients [i].rcvd, 0);
+            if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                continue;
+            errno_assert (rc > 0);
+            clients [i].rcvd += rc;
+            if (clients [i].rcvd == STORM_HDR_LEN)
+                ++done;
+        }
+    }
+    connected = nn_stopwatch_term (&sw);
+
+    /*  Wait for all the messages to arrive. */
+    nn_stopwatch_init (&sw);
+    for (i = 0; i != nclients; ++i) {
+        rc = nn_recv (s, buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+    }
+    total = connected + nn_stopwatch_term (&sw);
+
+    printf ("clients: %d\n", nclients);
+    printf ("listeners: %d\n", listeners);
+    printf ("accept batch: %d\n", batch);
+    printf ("all handshakes done [ms]: %.3f\n", (double) connected / 1000);
+    printf ("all messages received [ms]: %.3f\n", (double) total / 1000);
+    printf ("connections per second: %.0f\n",
+        (double) nclients * 1000000 / (double) connected);
+
+    for (i = 0; i != nclients; ++i)
+        close (clients [i].s);
+    free (pfds);
+    free (clients);
+    rc = nn_close (s);
+    nn_assert (rc == 0);
+}
+
+int main (int argc, char *argv [])
+{
+    int port;
+    int nclients;
+    int listeners;
+    int batch;
+    struct rlimit rl;
+    int rc;
+
+    if (argc < 2 || argc > 5) {
+        printf ("usage: accept_storm <port> [clients] [listeners] [batch]\n");
+        return 1;
+    }
+    port = atoi (argv [1]);
+    nclients = argc > 2 ? atoi (argv [2]) : 20000;
+    listeners = argc > 3 ? atoi (argv [3]) : 1;
+    batch = argc > 4 ? atoi (argv [4]) : 16;
+
+    /*  Both ends of each connection live in this process. */
+    rc = getrlimit (RLIMIT_NOFILE, &rl);
+    errno_assert (rc == 0);
+    if (rl.rlim_cur < (rlim_t) nclients * 2 + 64) {
+        rl.rlim_cur = rl.rlim_max;
+        rc = setrlimit (RLIMIT_NOFILE, &rl);
+        errno_assert (rc == 0);
+        if (rl.rlim_cur < (rlim_t) nclients * 2 + 64) {
+            nclients = (int) (rl.rlim_cur - 64) / 2;
+            printf ("file descriptor limit allows for %d clients only\n",
+                nclients);
+        }
+    }
+
+    /*  Run the storm without batching first, then with it. Each run uses
+        its own port so that the connections of the first one lingering in
+        TIME_WAIT don't get in the way. */
+    storm (port, nclients, listeners, 1);
+    storm (port + 1, nclients, listeners, batch);
+
+    return 0;
+}
+
+#endif
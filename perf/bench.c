@@ -0,0 +1,816 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+/*  Benchmark harness covering all the scalability protocols over all the
+    transports, with both ends of each connection in this process. It is
+    parameterised by protocol, transport, message size, number of
+    connections and number of threads, and prints the throughput and
+    latency percentiles as a line of CSV or a JSON object, so that the
+    results of subsequent runs can be collected in a single file.
+
+    Each message carries the time it was sent in its first 8 bytes. The
+    latency is the time until the message is received, or until the reply
+    is received for the request/reply style protocols. */
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/reqrep.h"
+#include "../src/pubsub.h"
+#include "../src/pipeline.h"
+#include "../src/bus.h"
+#include "../src/survey.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/sleep.c"
+#include "../src/utils/clock.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PAIR 0
+#define BENCH_REQREP 1
+#define BENCH_PUBSUB 2
+#define BENCH_PIPELINE 3
+#define BENCH_BUS 4
+#define BENCH_SURVEY 5
+
+static const char *bench_protocols [] = {
+    "pair", "reqrep", "pubsub", "pipeline", "bus", "survey", NULL
+};
+
+#define BENCH_INPROC 0
+#define BENCH_IPC 1
+#define BENCH_TCP 2
+#define BENCH_WS 3
+
+static const char *bench_transports [] = {
+    "inproc", "ipc", "tcp", "ws", NULL
+};
+
+#define BENCH_CSV 0
+#define BENCH_JSON 1
+
+static const char *bench_formats [] = {
+    "csv", "json", NULL
+};
+
+/*  How long to wait for all the connections to be established. */
+#define BENCH_CONNECT_TIMEOUT 10000
+
+/*  Receivers stop waiting for lost messages after this many milliseconds
+    without receiving anything. */
+#define BENCH_IDLE 1000
+
+/*  Maximum number of latency samples kept by one thread. Beyond that, the
+    samples are thinned out evenly. */
+#define BENCH_MAX_SAMPLES (1 << 22)
+
+/*  Maximum number of threads, including the ones echoing the messages. */
+#define BENCH_MAX_WORKERS 256
+
+struct bench_options {
+    int protocol;
+    int transport;
+    size_t size;
+    int count;
+    int connections;
+    int threads;
+    int port;
+    int format;
+    int header;
+};
+
+struct bench_worker {
+    struct nn_thread thread;
+    nn_thread_routine *routine;
+    int *socks;
+    int nsocks;
+
+    /*  Number of messages the thread is to receive and did receive. */
+    uint64_t expected;
+    uint64_t received;
+
+    /*  Time the last message was received. */
+    uint64_t last;
+
+    /*  Latencies in nanoseconds. Every 'stride'-th message is sampled. */
+    uint64_t *samples;
+    size_t nsamples;
+    size_t maxsamples;
+    uint64_t stride;
+};
+
+static struct bench_options bench;
+static struct bench_worker bench_workers [BENCH_MAX_WORKERS];
+static int bench_nworkers;
+static volatile int bench_stop;
+
+static void bench_stamp (char *buf)
+{
+    uint64_t now;
+
+    now = nn_clock_ns ();
+    memcpy (buf, &now, sizeof (now));
+}
+
+static void bench_sample (struct bench_worker *self, const char *buf)
+{
+    uint64_t sent;
+
+    memcpy (&sent, buf, sizeof (sent));
+    self->last = nn_clock_ns ();
+    if (self->received % self->stride == 0 &&
+          self->nsamples < self->maxsamples)
+        self->samples [self->nsamples++] = self->last - sent;
+    ++self->received;
+}
+
+/*  Receives all the messages available on the socket without blocking. */
+static void bench_drain (struct bench_worker *self, int s, char *buf)
+{
+    int rc;
+
+    while (1) {
+        rc = nn_recv (s, buf, bench.size, NN_DONTWAIT);
+        if (rc < 0 && nn_errno () == EAGAIN)
+            return;
+        errno_assert (rc == (int) bench.size);
+        bench_sample (self, buf);
+    }
+}
+
+/*  Receives on all the sockets until all the expected messages arrive or
+    the senders go quiet. */
+static void bench_sink_loop (struct bench_worker *self, char *buf)
+{
+    int rc;
+    int i;
+    struct nn_pollfd *pfds;
+
+    pfds = malloc (sizeof (struct nn_pollfd) * self->nsocks);
+    alloc_assert (pfds);
+    for (i = 0; i != self->nsocks; ++i) {
+        pfds [i].fd = self->socks [i];
+        pfds [i].events = NN_POLLIN;
+    }
+
+    while (self->received < self->expected) {
+        rc = nn_poll (pfds, self->nsocks, BENCH_IDLE);
+        errno_assert (rc >= 0);
+        if (rc == 0)
+            break;
+        for (i = 0; i != self->nsocks; ++i)
+            if (pfds [i].revents & NN_POLLIN)
+                bench_drain (self, self->socks [i], buf);
+    }
+
+    free (pfds);
+}
+
+/*  Sends a message on each socket and waits for the replies, in lockstep. */
+static void bench_roundtrip (void *arg)
+{
+    struct bench_worker *self;
+    char *buf;
+    int rc;
+    int i;
+    int j;
+
+    self = arg;
+    buf = calloc (1, bench.size);
+    alloc_assert (buf);
+
+    for (i = 0; i != bench.count; ++i) {
+        for (j = 0; j != self->nsocks; ++j) {
+            bench_stamp (buf);
+            rc = nn_send (self->socks [j], buf, bench.size, 0);
+            errno_assert (rc == (int) bench.size);
+        }
+        for (j = 0; j != self->nsocks; ++j) {
+            rc = nn_recv (self->socks [j], buf, bench.size, 0);
+            errno_assert (rc == (int) bench.size);
+            bench_sample (self, buf);
+        }
+    }
+
+    free (buf);
+}
+
+/*  Sends the messages on all the sockets, round robin. */
+static void bench_source (void *arg)
+{
+    struct bench_worker *self;
+    char *buf;
+    int rc;
+    int i;
+    int j;
+
+    self = arg;
+    buf = calloc (1, bench.size);
+    alloc_assert (buf);
+
+    for (i = 0; i != bench.count; ++i) {
+        for (j = 0; j != self->nsocks; ++j) {
+            bench_stamp (buf);
+            rc = nn_send (self->socks [j], buf, bench.size, 0);
+            errno_assert (rc == (int) bench.size);
+        }
+    }
+
+    free (buf);
+}
+
+static void bench_sink (void *arg)
+{
+    struct bench_worker *self;
+    char *buf;
+
+    self = arg;
+    buf = malloc (bench.size);
+    alloc_assert (buf);
+    bench_sink_loop (self, buf);
+    free (buf);
+}
+
+/*  Each node broadcasts its messages while collecting everybody else's. */
+static void bench_bus (void *arg)
+{
+    struct bench_worker *self;
+    char *buf;
+    int rc;
+    int i;
+    int j;
+
+    self = arg;
+    buf = calloc (1, bench.size);
+    alloc_assert (buf);
+
+    for (i = 0; i != bench.count; ++i) {
+        for (j = 0; j != self->nsocks; ++j) {
+            bench_stamp (buf);
+            rc = nn_send (self->socks [j], buf, bench.size, 0);
+            errno_assert (rc == (int) bench.size);
+        }
+        for (j = 0; j != self->nsocks; ++j)
+            bench_drain (self, self->socks [j], buf);
+    }
+    bench_sink_loop (self, buf);
+
+    free (buf);
+}
+
+/*  Sends a survey and collects the responses before sending the next one. */
+static void bench_survey (void *arg)
+{
+    struct bench_worker *self;
+    char *buf;
+    int rc;
+    int i;
+    int j;
+
+    self = arg;
+    buf = calloc (1, bench.size);
+    alloc_assert (buf);
+
+    for (i = 0; i != bench.count; ++i) {
+        bench_stamp (buf);
+        rc = nn_send (self->socks [0], buf, bench.size, 0);
+        errno_assert (rc == (int) bench.size);
+        for (j = 0; j != bench.connections; ++j) {
+            rc = nn_recv (self->socks [0], buf, bench.size, 0);
+            if (rc < 0 && nn_errno () == ETIMEDOUT)
+                break;
+            errno_assert (rc == (int) bench.size);
+            bench_sample (self, buf);
+        }
+    }
+
+    free (buf);
+}
+
+/*  Sends each message back where it came from until the benchmark ends.
+    Raw sockets are used on the replying side of request/reply protocols
+    so that a single socket can serve many requests at once. */
+static void bench_echo (void *arg)
+{
+    struct bench_worker *self;
+    struct nn_pollfd *pfds;
+    struct nn_msghdr hdr;
+    struct nn_iovec iov;
+    void *body;
+    void *control;
+    int rc;
+    int i;
+
+    self = arg;
+    pfds = malloc (sizeof (struct nn_pollfd) * self->nsocks);
+    alloc_assert (pfds);
+    for (i = 0; i != self->nsocks; ++i) {
+        pfds [i].fd = self->socks [i];
+        pfds [i].events = NN_POLLIN;
+    }
+
+    while (!bench_stop) {
+        rc = nn_poll (pfds, self->nsocks, 100);
+        errno_assert (rc >= 0);
+        for (i = 0; rc > 0 && i != self->nsocks; ++i) {
+            if (!(pfds [i].revents & NN_POLLIN))
+                continue;
+            while (1) {
+                iov.iov_base = &body;
+                iov.iov_len = NN_MSG;
+                memset (&hdr, 0, sizeof (hdr));
+                hdr.msg_iov = &iov;
+                hdr.msg_iovlen = 1;
+                hdr.msg_control = &control;
+                hdr.msg_controllen = NN_MSG;
+                rc = nn_recvmsg (self->socks [i], &hdr, NN_DONTWAIT);
+                if (rc < 0 && nn_errno () == EAGAIN)
+                    break;
+                errno_assert (rc >= 0);
+                rc = nn_sendmsg (self->socks [i], &hdr, 0);
+                errno_assert (rc >= 0);
+            }
+            rc = 1;
+        }
+    }
+
+    free (pfds);
+}
+
+/*  Spreads the sockets over up to 'nthreads' threads running 'routine'.
+    Each thread is to receive 'expected' messages per socket. */
+static void bench_spawn (nn_thread_routine *routine, int *socks, int nsocks,
+    int nthreads, uint64_t expected)
+{
+    struct bench_worker *self;
+    int first;
+    int i;
+
+    if (nthreads > nsocks)
+        nthreads = nsocks;
+    first = bench_nworkers;
+    nn_assert (first + nthreads <= BENCH_MAX_WORKERS);
+    for (i = 0; i != nthreads; ++i) {
+        self = &bench_workers [first + i];
+        memset (self, 0, sizeof (*self));
+        self->routine = routine;
+        self->socks = malloc (sizeof (int) * (nsocks / nthreads + 1));
+        alloc_assert (self->socks);
+    }
+    for (i = 0; i != nsocks; ++i) {
+        self = &bench_workers [first + i % nthreads];
+        self->socks [self->nsocks++] = socks [i];
+    }
+    for (i = 0; i != nthreads; ++i) {
+        self = &bench_workers [first + i];
+        self->expected = expected * self->nsocks;
+        self->stride = self->expected / BENCH_MAX_SAMPLES + 1;
+        self->maxsamples = (size_t) (self->expected / self->stride) + 1;
+        if (self->expected) {
+            self->samples = malloc (sizeof (uint64_t) * self->maxsamples);
+            alloc_assert (self->samples);
+        }
+    }
+    bench_nworkers += nthreads;
+}
+
+static void bench_addr (char *addr, size_t len, int i)
+{
+    switch (bench.transport) {
+    case BENCH_INPROC:
+        snprintf (addr, len, "inproc://bench%d", i);
+        break;
+    case BENCH_IPC:
+        snprintf (addr, len, "ipc://bench%d.ipc", i);
+        break;
+    case BENCH_TCP:
+        snprintf (addr, len, "tcp://127.0.0.1:%d", bench.port + i);
+        break;
+    case BENCH_WS:
+        snprintf (addr, len, "ws://127.0.0.1:%d", bench.port + i);
+        break;
+    default:
+        nn_assert (0);
+    }
+}
+
+static int bench_socket (int domain, int protocol)
+{
+    int s;
+
+    s = nn_socket (domain, protocol);
+    errno_assert (s >= 0);
+    return s;
+}
+
+static void bench_bind (int s, int i)
+{
+    int rc;
+    char addr [64];
+
+    bench_addr (addr, sizeof (addr), i);
+    rc = nn_bind (s, addr);
+    if (rc < 0) {
+        fprintf (stderr, "Can't bind to %s: %s\n", addr,
+            nn_strerror (nn_errno ()));
+        exit (1);
+    }
+}
+
+static void bench_connect (int s, int i)
+{
+    int rc;
+    char addr [64];
+
+    bench_addr (addr, sizeof (addr), i);
+    rc = nn_connect (s, addr);
+    errno_assert (rc >= 0);
+}
+
+/*  Waits till 'npipes' connections are attached to the socket. */
+static void bench_wait (int s, int npipes)
+{
+    int rc;
+    int n;
+    int waited;
+
+    for (waited = 0; waited < BENCH_CONNECT_TIMEOUT; waited += 10) {
+        n = 0;
+        rc = nn_get_statistics (s, NULL, NULL, &n);
+        errno_assert (rc == 0);
+        if (n >= npipes)
+            return;
+        nn_sleep (10);
+    }
+    fprintf (stderr, "Connections were not established in time\n");
+    exit (1);
+}
+
+static int bench_compare (const void *a, const void *b)
+{
+    uint64_t x;
+    uint64_t y;
+
+    x = *(const uint64_t*) a;
+    y = *(const uint64_t*) b;
+    return x < y ? -1 : x > y;
+}
+
+/*  Returns the sample at the given percentile using the nearest-rank
+    method, in microseconds. */
+static double bench_percentile (uint64_t *samples, size_t n, double p)
+{
+    size_t rank;
+
+    if (n == 0)
+        return 0.0;
+    rank = (size_t) (p / 100.0 * n + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    if (rank > n)
+        rank = n;
+    return samples [rank - 1] / 1000.0;
+}
+
+static void bench_report (uint64_t start, uint64_t end)
+{
+    uint64_t *samples;
+    size_t nsamples;
+    uint64_t expected;
+    uint64_t received;
+    double sum;
+    double seconds;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+    size_t i;
+    int w;
+
+    nsamples = 0;
+    expected = 0;
+    received = 0;
+    for (w = 0; w != bench_nworkers; ++w) {
+        nsamples += bench_workers [w].nsamples;
+        expected += bench_workers [w].expected;
+        received += bench_workers [w].received;
+    }
+    samples = malloc (sizeof (uint64_t) * (nsamples + 1));
+    alloc_assert (samples);
+    nsamples = 0;
+    for (w = 0; w != bench_nworkers; ++w) {
+        memcpy (samples + nsamples, bench_workers [w].samples,
+            sizeof (uint64_t) * bench_workers [w].nsamples);
+        nsamples += bench_workers [w].nsamples;
+    }
+    qsort (samples, nsamples, sizeof (uint64_t), bench_compare);
+
+    sum = 0.0;
+    for (i = 0; i != nsamples; ++i)
+        sum += (double) samples [i];
+    mean = nsamples ? sum / nsamples / 1000.0 : 0.0;
+    p50 = bench_percentile (samples, nsamples, 50.0);
+    p90 = bench_percentile (samples, nsamples, 90.0);
+    p99 = bench_percentile (samples, nsamples, 99.0);
+    p999 = bench_percentile (samples, nsamples, 99.9);
+    max = nsamples ? samples [nsamples - 1] / 1000.0 : 0.0;
+    seconds = end > start ? (end - start) / 1e9 : 0.0;
+
+    if (bench.format == BENCH_JSON) {
+        printf ("{\"protocol\": \"%s\", \"transport\": \"%s\", "
+            "\"size\": %d, \"connections\": %d, \"threads\": %d, "
+            "\"messages\": %llu, \"lost\": %llu, \"seconds\": %.6f, "
+            "\"msgs_per_sec\": %.0f, \"mb_per_sec\": %.3f, "
+            "\"lat_mean_us\": %.3f, \"lat_p50_us\": %.3f, "
+            "\"lat_p90_us\": %.3f, \"lat_p99_us\": %.3f, "
+            "\"lat_p999_us\": %.3f, \"lat_max_us\": %.3f}\n",
+            bench_protocols [bench.protocol],
+            bench_transports [bench.transport], (int) bench.size,
+            bench.connections, bench.threads,
+            (unsigned long long) received,
+            (unsigned long long) (expected - received), seconds,
+            seconds > 0 ? received / seconds : 0.0,
+            seconds > 0 ? received * bench.size / seconds / 1e6 : 0.0,
+            mean, p50, p90, p99, p999, max);
+    }
+    else {
+        if (bench.header)
+            printf ("protocol,transport,size,connections,threads,"
+                "messages,lost,seconds,msgs_per_sec,mb_per_sec,"
+                "lat_mean_us,lat_p50_us,lat_p90_us,lat_p99_us,"
+                "lat_p999_us,lat_max_us\n");
+        printf ("%s,%s,%d,%d,%d,%llu,%llu,%.6f,%.0f,%.3f,"
+            "%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+            bench_protocols [bench.protocol],
+            bench_transports [bench.transport], (int) bench.size,
+            bench.connections, bench.threads,
+            (unsigned long long) received,
+            (unsigned long long) (expected - received), seconds,
+            seconds > 0 ? received / seconds : 0.0,
+            seconds > 0 ? received * bench.size / seconds / 1e6 : 0.0,
+            mean, p50, p90, p99, p999, max);
+    }
+
+    free (samples);
+}
+
+static void bench_usage (void)
+{
+    printf ("usage: bench [options]\n"
+        "  -p PROTOCOL    pair, reqrep, pubsub, pipeline, bus or survey "
+        "(pair)\n"
+        "  -t TRANSPORT   inproc, ipc, tcp or ws (inproc)\n"
+        "  -s SIZE        message size in bytes, at least 8 (64)\n"
+        "  -n COUNT       messages sent by each sender (10000)\n"
+        "  -c CONNS       number of connections or bus nodes (1)\n"
+        "  -T THREADS     number of threads per side (1)\n"
+        "  -P PORT        first TCP port to use (5560)\n"
+        "  -f FORMAT      csv or json (csv)\n"
+        "  -H             omit the CSV header\n");
+    exit (1);
+}
+
+static int bench_lookup (const char **names, const char *name)
+{
+    int i;
+
+    for (i = 0; names [i]; ++i)
+        if (strcmp (names [i], name) == 0)
+            return i;
+    bench_usage ();
+    return -1;
+}
+
+static void bench_parse (int argc, char *argv [])
+{
+    int i;
+    const char *arg;
+
+    bench.protocol = BENCH_PAIR;
+    bench.transport = BENCH_INPROC;
+    bench.size = 64;
+    bench.count = 10000;
+    bench.connections = 1;
+    bench.threads = 1;
+    bench.port = 5560;
+    bench.format = BENCH_CSV;
+    bench.header = 1;
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp (argv [i], "-H") == 0) {
+            bench.header = 0;
+            continue;
+        }
+        if (argv [i][0] != '-' || strlen (argv [i]) != 2 || i + 1 == argc)
+            bench_usage ();
+        arg = argv [++i];
+        switch (argv [i - 1][1]) {
+        case 'p':
+            bench.protocol = bench_lookup (bench_protocols, arg);
+            break;
+        case 't':
+            bench.transport = bench_lookup (bench_transports, arg);
+            break;
+        case 's':
+            bench.size = (size_t) atoi (arg);
+            break;
+        case 'n':
+            bench.count = atoi (arg);
+            break;
+        case 'c':
+            bench.connections = atoi (arg);
+            break;
+        case 'T':
+            bench.threads = atoi (arg);
+            break;
+        case 'P':
+            bench.port = atoi (arg);
+            break;
+        case 'f':
+            bench.format = bench_lookup (bench_formats, arg);
+            break;
+        default:
+            bench_usage ();
+        }
+    }
+
+    if (bench.size < sizeof (uint64_t) || bench.count < 1 ||
+          bench.connections < 1 || bench.threads < 1 ||
+          bench.threads > BENCH_MAX_WORKERS / 2 - 1)
+        bench_usage ();
+}
+
+int main (int argc, char *argv [])
+{
+    int *servers;
+    int *clients;
+    int nservers;
+    int n;
+    int rc;
+    int i;
+    int j;
+    int deadline;
+    uint64_t start;
+    uint64_t end;
+
+    bench_parse (argc, argv);
+    n = bench.connections;
+    servers = malloc (sizeof (int) * n);
+    alloc_assert (servers);
+    clients = malloc (sizeof (int) * n);
+    alloc_assert (clients);
+    nservers = 0;
+
+    /*  Set up the sockets and decide which threads drive which of them. */
+    switch (bench.protocol) {
+    case BENCH_PAIR:
+        for (i = 0; i != n; ++i) {
+            servers [i] = bench_socket (AF_SP, NN_PAIR);
+            bench_bind (servers [i], i);
+            clients [i] = bench_socket (AF_SP, NN_PAIR);
+            bench_connect (clients [i], i);
+        }
+        nservers = n;
+        for (i = 0; i != n; ++i)
+            bench_wait (servers [i], 1);
+        bench_spawn (bench_echo, servers, n, bench.threads, 0);
+        bench_spawn (bench_roundtrip, clients, n, bench.threads,
+            bench.count);
+        break;
+    case BENCH_REQREP:
+        servers [0] = bench_socket (AF_SP_RAW, NN_REP);
+        bench_bind (servers [0], 0);
+        nservers = 1;
+        for (i = 0; i != n; ++i) {
+            clients [i] = bench_socket (AF_SP, NN_REQ);
+            bench_connect (clients [i], 0);
+        }
+        bench_wait (servers [0], n);
+        bench_spawn (bench_echo, servers, 1, 1, 0);
+        bench_spawn (bench_roundtrip, clients, n, bench.threads,
+            bench.count);
+        break;
+    case BENCH_PUBSUB:
+        servers [0] = bench_socket (AF_SP, NN_PUB);
+        bench_bind (servers [0], 0);
+        nservers = 1;
+        for (i = 0; i != n; ++i) {
+            clients [i] = bench_socket (AF_SP, NN_SUB);
+            rc = nn_setsockopt (clients [i], NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+            errno_assert (rc == 0);
+            bench_connect (clients [i], 0);
+        }
+        bench_wait (servers [0], n);
+        bench_spawn (bench_sink, clients, n, bench.threads, bench.count);
+        bench_spawn (bench_source, servers, 1, 1, 0);
+        break;
+    case BENCH_PIPELINE:
+        servers [0] = bench_socket (AF_SP, NN_PULL);
+        bench_bind (servers [0], 0);
+        nservers = 1;
+        for (i = 0; i != n; ++i) {
+            clients [i] = bench_socket (AF_SP, NN_PUSH);
+            bench_connect (clients [i], 0);
+        }
+        bench_wait (servers [0], n);
+        bench_spawn (bench_sink, servers, 1, 1, (uint64_t) bench.count * n);
+        bench_spawn (bench_source, clients, n, bench.threads, 0);
+        break;
+    case BENCH_BUS:
+        /*  Full mesh. Each node connects to all the nodes created before
+            it. */
+        for (i = 0; i != n; ++i) {
+            clients [i] = bench_socket (AF_SP, NN_BUS);
+            bench_bind (clients [i], i);
+            for (j = 0; j != i; ++j)
+                bench_connect (clients [i], j);
+        }
+        for (i = 0; i != n; ++i)
+            bench_wait (clients [i], n - 1);
+        bench_spawn (bench_bus, clients, n, bench.threads,
+            (uint64_t) bench.count * (n - 1));
+        break;
+    case BENCH_SURVEY:
+        servers [0] = bench_socket (AF_SP, NN_SURVEYOR);
+        deadline = BENCH_IDLE;
+        rc = nn_setsockopt (servers [0], NN_SURVEYOR, NN_SURVEYOR_DEADLINE,
+            &deadline, sizeof (deadline));
+        errno_assert (rc == 0);
+        bench_bind (servers [0], 0);
+        nservers = 1;
+        for (i = 0; i != n; ++i) {
+            clients [i] = bench_socket (AF_SP_RAW, NN_RESPONDENT);
+            bench_connect (clients [i], 0);
+        }
+        bench_wait (servers [0], n);
+        bench_spawn (bench_echo, clients, n, bench.threads, 0);
+        bench_spawn (bench_survey, servers, 1, 1, (uint64_t) bench.count * n);
+        break;
+    default:
+        nn_assert (0);
+    }
+
+    /*  Let the SP handshakes finish on the connecting side as well. */
+    nn_sleep (100);
+
+    start = nn_clock_ns ();
+    for (i = 0; i != bench_nworkers; ++i)
+        nn_thread_init (&bench_workers [i].thread, bench_workers [i].routine,
+            &bench_workers [i]);
+    end = start;
+    for (i = 0; i != bench_nworkers; ++i) {
+        if (bench_workers [i].routine == bench_echo)
+            continue;
+        nn_thread_term (&bench_workers [i].thread);
+        if (bench_workers [i].last > end)
+            end = bench_workers [i].last;
+    }
+    bench_stop = 1;
+    for (i = 0; i != bench_nworkers; ++i)
+        if (bench_workers [i].routine == bench_echo)
+            nn_thread_term (&bench_workers [i].thread);
+
+    bench_report (start, end);
+
+    for (i = 0; i != bench_nworkers; ++i) {
+        free (bench_workers [i].socks);
+        free (bench_workers [i].samples);
+    }
+    for (i = 0; i != nservers; ++i) {
+        rc = nn_close (servers [i]);
+        errno_assert (rc == 0);
+    }
+    for (i = 0; i != n; ++i) {
+        rc = nn_close (clients [i]);
+        errno_assert (rc == 0);
+    }
+    free (clients);
+    free (servers);
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+/*  Measures the throughput of WebSocket payload masking for frames from
+    1 kB to 1 MB and compares it with the byte-by-byte algorithm. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+#include "../src/transports/ws/mask.c"
+
+/*  Amount of data masked for each frame size. */
+#define WS_MASK_TOTAL (1024 * 1024 * 1024)
+
+static void ws_mask_bytewise (uint8_t *data, size_t len, const uint8_t *mask,
+    size_t pos)
+{
+    size_t i;
+
+    for (i = 0; i != len; ++i)
+        data [i] ^= mask [(i + pos) % NN_WS_MASK_SIZE];
+}
+
+int main (int argc, char *argv [])
+{
+    static const uint8_t mask [NN_WS_MASK_SIZE] = {0x37, 0xfa, 0x21, 0x3d};
+    size_t sz;
+    size_t total;
+    size_t count;
+    size_t i;
+    uint8_t *buf;
+    uint8_t *ref;
+    struct nn_stopwatch sw;
+    uint64_t bytewise;
+    uint64_t wide;
+
+    total = argc > 1 ? (size_t) atol (argv [1]) : WS_MASK_TOTAL;
+    if (argc > 2) {
+        printf ("usage: ws_mask [total-bytes]\n");
+        return 1;
+    }
+
+    /*  One extra byte to measure unaligned buffers too. */
+    buf = malloc (1024 * 1024 + 1);
+    alloc_assert (buf);
+    ref = malloc (1024 * 1024 + 1);
+    alloc_assert (ref);
+
+    printf ("%10s %17s %17s\n", "frame [B]", "bytewise [MB/s]",
+        "nn_ws_mask [MB/s]");
+    for (sz = 1024; sz <= 1024 * 1024; sz *= 4) {
+
+        /*  Check the results match, with all alignments and mask positions. */
+        for (i = 0; i != sz + 1; ++i)
+            buf [i] = ref [i] = (uint8_t) (i * 7);
+        for (i = 0; i != 8; ++i) {
+            ws_mask_bytewise (ref + 1, sz - i, mask, i);
+            nn_assert (nn_ws_mask (buf + 1, sz - i, mask, i) ==
+                sz % NN_WS_MASK_SIZE);
+            nn_assert (memcmp (buf, ref, sz + 1) == 0);
+        }
+
+        count = total / sz;
+        if (count == 0)
+            count = 1;
+
+        nn_stopwatch_init (&sw);
+        for (i = 0; i != count; ++i)
+            ws_mask_bytewise (ref, sz, mask, i);
+        bytewise = nn_stopwatch_term (&sw);
+
+        nn_stopwatch_init (&sw);
+        for (i = 0; i != count; ++i)
+            nn_ws_mask (buf, sz, mask, i);
+        wide = nn_stopwatch_term (&sw);
+
+        nn_assert (memcmp (buf, ref, sz) == 0);
+        printf ("%10lu %17.0f %17.0f\n", (unsigned long) sz,
+            (double) sz * count / (bytewise ? bytewise : 1),
+            (double) sz * count / (wide ? wide : 1));
+    }
+
+    free (ref);
+    free (buf);
+    return 0;
+}
@@ -23,9 +23,11 @@
 
 #include "fsm.h"
 #include "ctx.h"
+#include "profile.h"
 
 #include "../utils/err.h"
 #include "../utils/attr.h"
+#include "../utils/clock.h"
 
 #include <stddef.h>
 
@@ -33,6 +35,9 @@
 #define NN_FSM_STATE_ACTIVE 2
 #define NN_FSM_STATE_STOPPING 3
 
+static void nn_fsm_dispatch (struct nn_fsm *self, int src, int type,
+    void *srcptr);
+
 void nn_fsm_event_init (struct nn_fsm_event *self)
 {
     self->fsm = NULL;
@@ -78,6 +83,28 @@ void nn_fsm_event_process (struct nn_fsm_event *self)
 }
 
 void nn_fsm_feed (struct nn_fsm *self, int src, int type, void *srcptr)
+{
+    struct nn_profile_type *profile;
+    uint64_t start;
+
+    if (nn_profile_on ()) {
+        if (nn_slow (!self->profile))
+            self->profile = nn_profile_type (self->name);
+
+        /*  The handler may deallocate the state machine, so it must not
+            be touched once the handler returns. */
+        profile = self->profile;
+        start = nn_clock_ns ();
+        nn_fsm_dispatch (self, src, type, srcptr);
+        nn_profile_account (profile, nn_clock_ns () - start);
+        return;
+    }
+
+    nn_fsm_dispatch (self, src, type, srcptr);
+}
+
+static void nn_fsm_dispatch (struct nn_fsm *self, int src, int type,
+    void *srcptr)
 {
     if (nn_slow (self->state != NN_FSM_STATE_STOPPING)) {
         self->fn (self, src, type, srcptr);
@@ -86,8 +113,8 @@ void nn_fsm_feed (struct nn_fsm *self, int src, int type, void *srcptr)
     }
 }
 
-void nn_fsm_init_root (struct nn_fsm *self, nn_fsm_fn fn,
-    nn_fsm_fn shutdown_fn, struct nn_ctx *ctx)
+void nn_fsm_init_root_named (struct nn_fsm *self, nn_fsm_fn fn,
+    nn_fsm_fn shutdown_fn, struct nn_ctx *ctx, const char *name)
 {
     self->fn = fn;
     self->shutdown_fn = shutdown_fn;
@@ -97,10 +124,13 @@ void nn_fsm_init_root (struct nn_fsm *self, nn_fsm_fn fn,
     self->owner = NULL;
     self->ctx = ctx;
     nn_fsm_event_init (&self->stopped);
+    self->name = name;
+    self->profile = NULL;
 }
 
-void nn_fsm_init (struct nn_fsm *self, nn_fsm_fn fn,
-    nn_fsm_fn shutdown_fn, int src, void *srcptr, struct nn_fsm *owner)
+void nn_fsm_init_named (struct nn_fsm *self, nn_fsm_fn fn,
+    nn_fsm_fn shutdown_fn, int src, void *srcptr, struct nn_fsm *owner,
+    const char *name)
 {
     self->fn = fn;
     self->shutdown_fn = shutdown_fn;
@@ -110,6 +140,8 @@ void nn_fsm_init (struct nn_fsm *self, nn_fsm_fn fn,
     self->owner = owner;
     self->ctx = owner->ctx;
     nn_fsm_event_init (&self->stopped);
+    self->name = name;
+    self->profile = NULL;
 }
 
 void nn_fsm_term (struct nn_fsm *self)
@@ -175,7 +207,9 @@ struct nn_worker *nn_fsm_choose_worker (struct nn_fsm *self)
 void nn_fsm_action (struct nn_fsm *self, int type)
 {
     nn_assert (type > 0);
-    nn_fsm_feed (self, NN_FSM_ACTION, type, NULL);
+
+    /*  Actions are accounted to the event being handled when profiling. */
+    nn_fsm_dispatch (self, NN_FSM_ACTION, type, NULL);
 }
 
 void nn_fsm_raise_from_src (struct nn_fsm *self, struct nn_fsm_event *event, 
@@ -30,6 +30,7 @@
 struct nn_ctx;
 struct nn_fsm;
 struct nn_worker;
+struct nn_profile_type;
 
 struct nn_fsm_event {
     struct nn_fsm *fsm;
@@ -72,13 +73,25 @@ struct nn_fsm {
     struct nn_fsm *owner;
     struct nn_ctx *ctx;
     struct nn_fsm_event stopped;
+
+    /*  Name of the handler function, used to tell the types of state
+        machines apart when profiling. The profile entry is looked up when
+        the first event is delivered while profiling is on. */
+    const char *name;
+    struct nn_profile_type *profile;
 };
 
-void nn_fsm_init_root (struct nn_fsm *self, nn_fsm_fn fn,
-    nn_fsm_fn shutdown_fn, struct nn_ctx *ctx);
-void nn_fsm_init (struct nn_fsm *self, nn_fsm_fn fn,
+/*  The state machine is named after its handler function. */
+#define nn_fsm_init_root(self, fn, shutdown_fn, ctx) \
+    nn_fsm_init_root_named (self, fn, shutdown_fn, ctx, #fn)
+#define nn_fsm_init(self, fn, shutdown_fn, src, srcptr, owner) \
+    nn_fsm_init_named (self, fn, shutdown_fn, src, srcptr, owner, #fn)
+
+void nn_fsm_init_root_named (struct nn_fsm *self, nn_fsm_fn fn,
+    nn_fsm_fn shutdown_fn, struct nn_ctx *ctx, const char *name);
+void nn_fsm_init_named (struct nn_fsm *self, nn_fsm_fn fn,
     nn_fsm_fn shutdown_fn,
-    int src, void *srcptr, struct nn_fsm *owner);
+    int src, void *srcptr, struct nn_fsm *owner, const char *name);
 void nn_fsm_term (struct nn_fsm *self);
 
 int nn_fsm_isidle (struct nn_fsm *self);
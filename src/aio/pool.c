@@ -22,20 +22,56 @@
 
 #include "pool.h"
 
-/*  TODO: The dummy implementation of a thread pool. As for now there's only
-    one worker thread created. */
+#include "../utils/alloc.h"
+#include "../utils/err.h"
 
-int nn_pool_init (struct nn_pool *self)
+/*  Simple pool of worker threads. Objects are assigned to the workers in
+    round-robin manner when they are created and stay with them for their
+    lifetime. */
+
+int nn_pool_init (struct nn_pool *self, int nworkers)
 {
-    return nn_worker_init (&self->worker);
+    int rc;
+    int i;
+
+    if (nworkers < 1)
+        nworkers = 1;
+    if (nworkers > NN_POOL_MAX_WORKERS)
+        nworkers = NN_POOL_MAX_WORKERS;
+
+    self->workers = nn_alloc (sizeof (struct nn_worker) * nworkers,
+        "worker pool");
+    alloc_assert (self->workers);
+    for (i = 0; i != nworkers; ++i) {
+        rc = nn_worker_init (&self->workers [i]);
+        if (nn_slow (rc < 0)) {
+            while (i > 0)
+                nn_worker_term (&self->workers [--i]);
+            nn_free (self->workers);
+            self->workers = NULL;
+            return rc;
+        }
+    }
+    self->nworkers = nworkers;
+    nn_atomic_init (&self->next, 0);
+
+    return 0;
 }
 
 void nn_pool_term (struct nn_pool *self)
 {
-    nn_worker_term (&self->worker);
+    int i;
+
+    nn_atomic_term (&self->next);
+    for (i = 0; i != self->nworkers; ++i)
+        nn_worker_term (&self->workers [i]);
+    nn_free (self->workers);
 }
 
 struct nn_worker *nn_pool_choose_worker (struct nn_pool *self)
 {
-    return &self->worker;
+    if (nn_fast (self->nworkers == 1))
+        return &self->workers [0];
+    return &self->workers [nn_atomic_inc (&self->next, 1) %
+        (uint32_t) self->nworkers];
 }
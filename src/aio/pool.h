@@ -25,14 +25,30 @@
 
 #include "worker.h"
 
+#include "../utils/atomic.h"
+
 /*  Worker thread pool. */
 
+/*  Maximum number of worker threads in the pool. */
+#define NN_POOL_MAX_WORKERS 64
+
 struct nn_pool {
-    struct nn_worker worker;
+
+    /*  Array of worker threads. */
+    struct nn_worker *workers;
+    int nworkers;
+
+    /*  Used to hand out the workers in round-robin manner. */
+    struct nn_atomic next;
 };
 
-int nn_pool_init (struct nn_pool *self);
+/*  Starts 'nworkers' worker threads. The value is clamped to
+    1..NN_POOL_MAX_WORKERS. */
+int nn_pool_init (struct nn_pool *self, int nworkers);
 void nn_pool_term (struct nn_pool *self);
+
+/*  Returns the workers in round-robin order. Consecutive calls return
+    distinct workers, unless the pool wraps around. */
 struct nn_worker *nn_pool_choose_worker (struct nn_pool *self);
 
 #endif
@@ -0,0 +1,182 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "profile.h"
+
+#include "../utils/mutex.h"
+#include "../utils/once.h"
+#include "../utils/clock.h"
+
+#include <string.h>
+
+volatile int nn_profile_enabled = 0;
+
+static struct nn_profile_type nn_profile_fsms [NN_PROFILE_MAX_FSMS];
+static int nn_profile_nfsms = 0;
+
+/*  Guards creation of new entries in the table of types. */
+static nn_mutex_t nn_profile_sync;
+static nn_once_t nn_profile_once = NN_ONCE_INITIALIZER;
+
+static void nn_profile_lib_init (void)
+{
+    nn_mutex_init (&nn_profile_sync);
+}
+
+/*  Turns the name of a handler function, such as "nn_stcp_handler", into
+    the name of the state machine type, such as "stcp". */
+static void nn_profile_name (char *name, const char *fn)
+{
+    size_t len;
+
+    if (strncmp (fn, "nn_", 3) == 0)
+        fn += 3;
+    len = strlen (fn);
+    if (len > 8 && strcmp (fn + len - 8, "_handler") == 0)
+        len -= 8;
+    if (len > NN_PROFILE_NAME_MAX - 1)
+        len = NN_PROFILE_NAME_MAX - 1;
+    memcpy (name, fn, len);
+    name [len] = 0;
+}
+
+void nn_profile_enable (int enable)
+{
+    int i;
+
+    nn_do_once (&nn_profile_once, nn_profile_lib_init);
+    nn_mutex_lock (&nn_profile_sync);
+    if (enable) {
+        for (i = 0; i != nn_profile_nfsms; ++i) {
+            nn_counter_set (&nn_profile_fsms [i].events, 0);
+            nn_counter_set (&nn_profile_fsms [i].time, 0);
+        }
+    }
+    nn_profile_enabled = enable ? 1 : 0;
+    nn_mutex_unlock (&nn_profile_sync);
+}
+
+struct nn_profile_type *nn_profile_type (const char *fn)
+{
+    char name [NN_PROFILE_NAME_MAX];
+    struct nn_profile_type *self;
+    int i;
+
+    nn_profile_name (name, fn);
+
+    nn_do_once (&nn_profile_once, nn_profile_lib_init);
+    nn_mutex_lock (&nn_profile_sync);
+    for (i = 0; i != nn_profile_nfsms; ++i) {
+        if (strcmp (nn_profile_fsms [i].name, name) == 0)
+            break;
+    }
+    if (i == nn_profile_nfsms) {
+        if (i == NN_PROFILE_MAX_FSMS) {
+            /*  The table is full. The last entry collects the rest. */
+            i = NN_PROFILE_MAX_FSMS - 1;
+        }
+        else {
+            if (i == NN_PROFILE_MAX_FSMS - 1)
+                strcpy (name, "other");
+            memcpy (nn_profile_fsms [i].name, name, sizeof (name));
+            ++nn_profile_nfsms;
+        }
+    }
+    self = &nn_profile_fsms [i];
+    nn_mutex_unlock (&nn_profile_sync);
+
+    return self;
+}
+
+void nn_profile_account (struct nn_profile_type *self, uint64_t time)
+{
+    nn_counter_add (&self->events, 1);
+    nn_counter_add (&self->time, (int64_t) time);
+}
+
+void nn_profile_read (struct nn_profile_fsm *fsms, int *nfsms)
+{
+    int i;
+
+    nn_do_once (&nn_profile_once, nn_profile_lib_init);
+    nn_mutex_lock (&nn_profile_sync);
+    for (i = 0; i != nn_profile_nfsms && i < *nfsms; ++i) {
+        fsms [i].name = nn_profile_fsms [i].name;
+        fsms [i].events = nn_counter_get (&nn_profile_fsms [i].events);
+        fsms [i].time = nn_counter_get (&nn_profile_fsms [i].time);
+    }
+    *nfsms = nn_profile_nfsms;
+    nn_mutex_unlock (&nn_profile_sync);
+}
+
+void nn_profile_loop_init (struct nn_profile_loop *self)
+{
+    nn_profile_loop_reset (self);
+    self->mark = 0;
+}
+
+void nn_profile_loop_reset (struct nn_profile_loop *self)
+{
+    nn_counter_set (&self->iterations, 0);
+    nn_counter_set (&self->wait, 0);
+    nn_counter_set (&self->busy, 0);
+}
+
+void nn_profile_loop_wait (struct nn_profile_loop *self)
+{
+    uint64_t now;
+
+    if (!nn_profile_on ()) {
+        self->mark = 0;
+        return;
+    }
+
+    now = nn_clock_ns ();
+    if (self->mark)
+        nn_counter_add (&self->busy, (int64_t) (now - self->mark));
+    nn_counter_add (&self->iterations, 1);
+    self->mark = now;
+}
+
+void nn_profile_loop_wake (struct nn_profile_loop *self)
+{
+    uint64_t now;
+
+    if (!nn_profile_on ()) {
+        self->mark = 0;
+        return;
+    }
+
+    now = nn_clock_ns ();
+    if (self->mark)
+        nn_counter_add (&self->wait, (int64_t) (now - self->mark));
+    self->mark = now;
+}
+
+void nn_profile_loop_read (struct nn_profile_loop *self,
+    struct nn_profile_worker *res)
+{
+    res->iterations = nn_counter_get (&self->iterations);
+    res->wait = nn_counter_get (&self->wait);
+    res->busy = nn_counter_get (&self->busy);
+}
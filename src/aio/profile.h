@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_PROFILE_INCLUDED
+#define NN_PROFILE_INCLUDED
+
+#include "../nn.h"
+
+#include "../utils/counter.h"
+#include "../utils/fast.h"
+
+#include <stdint.h>
+
+/*  Profiling of the worker threads and of the state machines they drive.
+    While profiling is off, each event costs a single well-predicted branch. */
+
+/*  Maximum number of state machine types tracked separately. Any further
+    types are accounted together under the last entry. */
+#define NN_PROFILE_MAX_FSMS 64
+
+/*  Maximum length of a state machine type name, including the terminator. */
+#define NN_PROFILE_NAME_MAX 32
+
+/*  Events delivered to one type of state machine and the time spent in its
+    handler. Once created, the entries are never deallocated, so state
+    machines can keep pointers to them. */
+struct nn_profile_type {
+    char name [NN_PROFILE_NAME_MAX];
+    struct nn_counter events;
+    struct nn_counter time;
+};
+
+/*  Statistics of the event loop of one worker thread. */
+struct nn_profile_loop {
+    struct nn_counter iterations;
+    struct nn_counter wait;
+    struct nn_counter busy;
+
+    /*  Time of the last transition between waiting and being busy. It is
+        accessed only by the worker thread itself. Zero means unknown. */
+    uint64_t mark;
+};
+
+extern volatile int nn_profile_enabled;
+
+#define nn_profile_on() nn_slow (nn_profile_enabled)
+
+/*  Switches profiling on or off. Switching it on resets the statistics of
+    all the state machine types; loops are reset by nn_profile_loop_reset. */
+void nn_profile_enable (int enable);
+
+/*  Returns the entry for the state machine type with handler 'fn', creating
+    it if needed. 'fn' is the name of the handler function. */
+struct nn_profile_type *nn_profile_type (const char *fn);
+
+/*  Accounts one event that took 'time' nanoseconds to handle. */
+void nn_profile_account (struct nn_profile_type *self, uint64_t time);
+
+/*  Copies at most *nfsms entries to 'fsms' and stores the number of known
+    state machine types to *nfsms. */
+void nn_profile_read (struct nn_profile_fsm *fsms, int *nfsms);
+
+void nn_profile_loop_init (struct nn_profile_loop *self);
+void nn_profile_loop_reset (struct nn_profile_loop *self);
+
+/*  To be called by the worker thread right before it blocks waiting for
+    events and right after it wakes up. */
+void nn_profile_loop_wait (struct nn_profile_loop *self);
+void nn_profile_loop_wake (struct nn_profile_loop *self);
+
+void nn_profile_loop_read (struct nn_profile_loop *self,
+    struct nn_profile_worker *res);
+
+#endif
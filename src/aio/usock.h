@@ -45,6 +45,10 @@
     performance optimal make sure that this value is larger than network MTU. */
 #define NN_USOCK_BATCH_SIZE 2048
 
+/*  Maximum number of connections accepted in one go when the listening
+    socket becomes readable, see nn_usock_accept_batch. */
+#define NN_USOCK_ACCEPT_BATCH 16
+
 #if defined NN_HAVE_WINDOWS
 #include "usock_win.h"
 #else
@@ -69,6 +73,13 @@ int nn_usock_bind (struct nn_usock *self, const struct sockaddr *addr,
     size_t addrlen);
 int nn_usock_listen (struct nn_usock *self, int backlog);
 
+/*  Sets the number of connections, at most NN_USOCK_ACCEPT_BATCH, that
+    the listening socket accepts in one go when it becomes readable. The
+    connections beyond the first one are handed out by subsequent
+    nn_usock_accept calls without touching the kernel. Default is 1. Has no
+    effect on platforms that don't poll the listening socket. */
+void nn_usock_accept_batch (struct nn_usock *self, int batch);
+
 /*  Accept a new connection from a listener. When done, NN_USOCK_ACCEPTED
     event will be delivered to the accepted socket. To cancel the operation,
     stop the socket being accepted. Listening socket should not be stopped
@@ -90,6 +90,16 @@ struct nn_usock {
         In BEING_ACCEPTED state points to the listener socket. */
     struct nn_usock *asock;
 
+    /*  Connections accepted in advance by the listener socket, while
+        draining the listen backlog. Those in [accepted_pos, accepted_len)
+        are yet to be handed out. */
+    int accepted [NN_USOCK_ACCEPT_BATCH - 1];
+    int accepted_pos;
+    int accepted_len;
+
+    /*  Number of connections to accept in one go, see nn_usock_accept_batch. */
+    int accept_batch;
+
     /*  Errno remembered in NN_USOCK_ERROR state  */
     int errnum;
 };
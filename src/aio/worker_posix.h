@@ -27,6 +27,7 @@
 #include "../utils/efd.h"
 
 #include "poller.h"
+#include "profile.h"
 
 #define NN_WORKER_FD_IN NN_POLLER_IN
 #define NN_WORKER_FD_OUT NN_POLLER_OUT
@@ -57,6 +58,7 @@ struct nn_worker {
     struct nn_poller_hndl efd_hndl;
     struct nn_timerset timerset;
     struct nn_thread thread;
+    struct nn_profile_loop profile;
 };
 
 void nn_worker_add_fd (struct nn_worker *self, int s, struct nn_worker_fd *fd);
@@ -24,6 +24,7 @@
 
 #include "fsm.h"
 #include "timerset.h"
+#include "profile.h"
 
 #include "../utils/win.h"
 #include "../utils/thread.h"
@@ -66,6 +67,7 @@ struct nn_worker {
     HANDLE cp;
     struct nn_timerset timerset;
     struct nn_thread thread;
+    struct nn_profile_loop profile;
 };
 
 HANDLE nn_worker_getcp (struct nn_worker *self);
@@ -31,6 +31,8 @@ extern "C" {
 
 #define NN_BUS (NN_PROTO_BUS * 16 + 0)
 
+#define NN_BUS_DEDUP 1
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,7 @@
 
 #include "../aio/pool.h"
 #include "../aio/timer.h"
+#include "../aio/profile.h"
 
 #include "../utils/err.h"
 #include "../utils/alloc.h"
@@ -44,6 +45,8 @@
 #include "../utils/chunk.h"
 #include "../utils/msg.h"
 #include "../utils/attr.h"
+#include "../utils/clock.h"
+#include "../utils/histogram.h"
 
 #include "../pubsub.h"
 #include "../pipeline.h"
@@ -282,7 +285,8 @@ static void nn_global_init (void)
     }
 
     /*  Start the worker threads. */
-    nn_pool_init (&self.pool);
+    envvar = getenv ("NN_WORKERS");
+    nn_pool_init (&self.pool, envvar ? atoi (envvar) : 1);
 }
 
 static void nn_global_term (void)
@@ -844,6 +848,7 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
     }
 
     /*  Send it further down the stack. */
+    msg.stamp = nn_clock_us ();
     rc = nn_sock_send (sock, &msg, flags);
     if (nn_slow (rc < 0)) {
 
@@ -987,6 +992,7 @@ int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
         }
     }
 
+    nn_sock_stat_latency (sock, &msg);
     nn_msg_term (&msg);
 
     /*  Adjust the statistics. */
@@ -1004,6 +1010,61 @@ fail:
     return -1;
 }
 
+int nn_global_splice (int from, int to, struct nn_msg *msg, int *pending,
+    int batch)
+{
+    int rc;
+    int n;
+    size_t sz;
+    struct nn_sock *src;
+    struct nn_sock *dst;
+
+    rc = nn_global_hold_socket (&src, from);
+    if (nn_slow (rc < 0))
+        return rc;
+    rc = nn_global_hold_socket (&dst, to);
+    if (nn_slow (rc < 0)) {
+        nn_global_rele_socket (src);
+        return rc;
+    }
+
+    for (n = 0; n != batch; ++n) {
+
+        /*  Get a new message unless there's one still waiting to be sent. */
+        if (!*pending) {
+            rc = nn_sock_recv (src, msg, NN_DONTWAIT);
+            if (rc == -EAGAIN)
+                break;
+            if (nn_slow (rc < 0))
+                goto fail;
+            *pending = 1;
+            nn_sock_stat_increment (src, NN_STAT_MESSAGES_RECEIVED, 1);
+            nn_sock_stat_increment (src, NN_STAT_BYTES_RECEIVED,
+                nn_chunkref_size (&msg->body));
+        }
+
+        /*  Pass the message object to the other socket as is. The body
+            and the SP header are handed over without copying them. */
+        sz = nn_chunkref_size (&msg->body);
+        rc = nn_sock_send (dst, msg, NN_DONTWAIT);
+        if (rc == -EAGAIN)
+            break;
+        if (nn_slow (rc < 0))
+            goto fail;
+        *pending = 0;
+        nn_sock_stat_increment (dst, NN_STAT_MESSAGES_SENT, 1);
+        nn_sock_stat_increment (dst, NN_STAT_BYTES_SENT, sz);
+        nn_sock_stat_increment (src, NN_STAT_MESSAGES_FORWARDED, 1);
+        nn_sock_stat_increment (src, NN_STAT_BYTES_FORWARDED, sz);
+    }
+    rc = n;
+
+fail:
+    nn_global_rele_socket (dst);
+    nn_global_rele_socket (src);
+    return rc;
+}
+
 uint64_t nn_get_statistic (int s, int statistic)
 {
     int rc;
@@ -1016,62 +1077,113 @@ uint64_t nn_get_statistic (int s, int statistic)
         return (uint64_t)-1;
     }
 
-    switch (statistic) {
-    case NN_STAT_ESTABLISHED_CONNECTIONS:
-        val = sock->statistics.established_connections;
-        break;
-    case NN_STAT_ACCEPTED_CONNECTIONS:
-        val = sock->statistics.accepted_connections;
-        break;
-    case NN_STAT_DROPPED_CONNECTIONS:
-        val = sock->statistics.dropped_connections;
-        break;
-    case NN_STAT_BROKEN_CONNECTIONS:
-        val = sock->statistics.broken_connections;
-        break;
-    case NN_STAT_CONNECT_ERRORS:
-        val = sock->statistics.connect_errors;
-        break;
-    case NN_STAT_BIND_ERRORS:
-        val = sock->statistics.bind_errors;
-        break;
-    case NN_STAT_ACCEPT_ERRORS:
-        val = sock->statistics.bind_errors;
-        break;
-    case NN_STAT_MESSAGES_SENT:
-        val = sock->statistics.messages_sent;
-        break;
-    case NN_STAT_MESSAGES_RECEIVED:
-        val = sock->statistics.messages_received;
-        break;
-    case NN_STAT_BYTES_SENT:
-        val = sock->statistics.bytes_sent;
-        break;
-    case NN_STAT_BYTES_RECEIVED:
-        val = sock->statistics.bytes_received;
-        break;
-    case NN_STAT_CURRENT_CONNECTIONS:
-        val = sock->statistics.current_connections;
-        break;
-    case NN_STAT_INPROGRESS_CONNECTIONS:
-        val = sock->statistics.inprogress_connections;
-        break;
-    case NN_STAT_CURRENT_SND_PRIORITY:
-        val = sock->statistics.current_snd_priority;
-        break;
-    case NN_STAT_CURRENT_EP_ERRORS:
-        val = sock->statistics.current_ep_errors;
-        break;
-    default:
+    rc = nn_sock_stat_get (sock, statistic, &val);
+    if (nn_slow (rc < 0)) {
         val = (uint64_t)-1;
-        errno = EINVAL;
-        break;
+        errno = -rc;
     }
 
     nn_global_rele_socket (sock);
     return val;
 }
 
+int nn_get_statistics (int s, struct nn_statistics *stats,
+    struct nn_pipe_statistics *pipes, int *npipes)
+{
+    int rc;
+    struct nn_sock *sock;
+
+    if (nn_slow (npipes && *npipes < 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    rc = nn_global_hold_socket (&sock, s);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+
+    nn_sock_stats (sock, stats, pipes, npipes);
+
+    nn_global_rele_socket (sock);
+    return 0;
+}
+
+uint64_t nn_stat_latency (const struct nn_statistics *stats,
+    double percentile)
+{
+    int i;
+    uint64_t rank;
+    uint64_t seen;
+    uint64_t val;
+
+    if (stats->latency_count == 0)
+        return 0;
+    if (percentile >= 100.0)
+        return stats->latency_max;
+    if (percentile < 0.0)
+        percentile = 0.0;
+
+    /*  Find the bucket holding the value of the requested rank and report
+        its upper bound, which is the way HdrHistogram does it. */
+    rank = (uint64_t) (percentile / 100.0 * stats->latency_count) + 1;
+    seen = 0;
+    for (i = 0; i != NN_STAT_LATENCY_BUCKETS; ++i) {
+        seen += stats->latency [i];
+        if (seen >= rank)
+            break;
+    }
+    if (i == NN_STAT_LATENCY_BUCKETS)
+        return stats->latency_max;
+    val = nn_histogram_bucket_max (i);
+    return val < stats->latency_max ? val : stats->latency_max;
+}
+
+int nn_profile (int enable)
+{
+    int i;
+
+    nn_do_once (&once, nn_lib_init);
+    nn_mutex_lock (&self.lock);
+
+    /*  Reset the counters before the workers start to fill them in. */
+    if (enable && self.socks) {
+        for (i = 0; i != self.pool.nworkers; ++i)
+            nn_profile_loop_reset (&self.pool.workers [i].profile);
+    }
+    nn_profile_enable (enable);
+
+    nn_mutex_unlock (&self.lock);
+    return 0;
+}
+
+int nn_get_profile (struct nn_profile_worker *workers, int *nworkers,
+    struct nn_profile_fsm *fsms, int *nfsms)
+{
+    int i;
+    int n;
+
+    if (nn_slow (!nworkers || *nworkers < 0 || !nfsms || *nfsms < 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    nn_do_once (&once, nn_lib_init);
+    nn_mutex_lock (&self.lock);
+
+    /*  The worker threads exist only while there are open sockets. */
+    n = self.socks ? self.pool.nworkers : 0;
+    for (i = 0; i != n && i < *nworkers; ++i)
+        nn_profile_loop_read (&self.pool.workers [i].profile, &workers [i]);
+    *nworkers = n;
+
+    nn_mutex_unlock (&self.lock);
+
+    nn_profile_read (fsms, nfsms);
+    return 0;
+}
+
 static int nn_global_create_ep (struct nn_sock *sock, const char *addr,
     int bind)
 {
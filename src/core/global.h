@@ -24,6 +24,8 @@
 #ifndef NN_GLOBAL_INCLUDED
 #define NN_GLOBAL_INCLUDED
 
+struct nn_msg;
+
 /*  Provides access to the list of available transports. */
 const struct nn_transport *nn_global_transport (int id);
 
@@ -31,4 +33,13 @@ const struct nn_transport *nn_global_transport (int id);
 struct nn_pool *nn_global_getpool ();
 int nn_global_print_errors();
 
+/*  Moves up to 'batch' messages from socket 'from' to socket 'to' without
+    copying them, as used by devices. 'msg' holds a message that was received
+    but not yet sent; '*pending' tells whether it is valid. Never blocks.
+    Returns the number of messages sent or a negative error code. If
+    '*pending' is set on return, 'to' can't accept more messages at the
+    moment, otherwise there's nothing more to receive from 'from'. */
+int nn_global_splice (int from, int to, struct nn_msg *msg, int *pending,
+    int batch);
+
 #endif
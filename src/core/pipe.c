@@ -29,6 +29,8 @@
 
 #include "../utils/err.h"
 #include "../utils/fast.h"
+#include "../utils/clock.h"
+#include "../utils/trace.h"
 
 /*  Internal pipe states. */
 #define NN_PIPEBASE_STATE_IDLE 1
@@ -47,6 +49,18 @@
 #define NN_PIPEBASE_OUTSTATE_SENT 3
 #define NN_PIPEBASE_OUTSTATE_ASYNC 4
 
+/*  Backlog of a pipe is halved each time this many milliseconds pass
+    without anything being sent to it. */
+#define NN_PIPEBASE_BACKLOG_HALFLIFE 100
+
+/*  Sends taking longer than this many microseconds count as this long. */
+#define NN_PIPEBASE_BACKLOG_MAX 10000000
+
+static void nn_pipebase_decay_backlog (struct nn_pipebase *self,
+    uint64_t now);
+static void nn_pipebase_sample_backlog (struct nn_pipebase *self,
+    uint64_t now, uint64_t elapsed);
+
 void nn_pipebase_init (struct nn_pipebase *self,
     const struct nn_pipebase_vfptr *vfptr, struct nn_ep *ep)
 {
@@ -61,12 +75,25 @@ void nn_pipebase_init (struct nn_pipebase *self,
     memcpy (&self->options, &ep->options, sizeof (struct nn_ep_options));
     nn_fsm_event_init (&self->in);
     nn_fsm_event_init (&self->out);
+    self->sent = 0;
+    self->received = 0;
+    self->outstanding = 0;
+    self->backlog = 0;
+    self->backlog_stamp = 0;
+    self->send_stamp = 0;
+    self->eid = ep->eid;
+    self->bytes_sent = 0;
+    self->bytes_received = 0;
+    self->queued = 0;
+    self->in_stamp = 0;
+    nn_list_item_init (&self->item);
 }
 
 void nn_pipebase_term (struct nn_pipebase *self)
 {
     nn_assert_state (self, NN_PIPEBASE_STATE_IDLE);
 
+    nn_list_item_term (&self->item);
     nn_fsm_event_term (&self->out);
     nn_fsm_event_term (&self->in);
     nn_fsm_term (&self->fsm);
@@ -100,6 +127,7 @@ void nn_pipebase_stop (struct nn_pipebase *self)
 
 void nn_pipebase_received (struct nn_pipebase *self)
 {
+    self->in_stamp = nn_clock_us ();
     if (nn_fast (self->instate == NN_PIPEBASE_INSTATE_RECEIVING)) {
         self->instate = NN_PIPEBASE_INSTATE_RECEIVED;
         return;
@@ -111,12 +139,19 @@ void nn_pipebase_received (struct nn_pipebase *self)
 
 void nn_pipebase_sent (struct nn_pipebase *self)
 {
+    uint64_t now;
+
     if (nn_fast (self->outstate == NN_PIPEBASE_OUTSTATE_SENDING)) {
         self->outstate = NN_PIPEBASE_OUTSTATE_SENT;
         return;
     }
     nn_assert (self->outstate == NN_PIPEBASE_OUTSTATE_ASYNC);
     self->outstate = NN_PIPEBASE_OUTSTATE_IDLE;
+
+    /*  The time the transport took to take the message over is what tells
+        whether it is pushing back. */
+    now = nn_clock_us ();
+    nn_pipebase_sample_backlog (self, now, now - self->send_stamp);
     nn_fsm_raise (&self->fsm, &self->out, NN_PIPE_OUT);
 }
 
@@ -139,6 +174,9 @@ void nn_pipebase_getopt (struct nn_pipebase *self, int level, int option,
         case NN_IPV4ONLY:
             intval = self->options.ipv4only;
             break;
+        case NN_RCVQUANTUM:
+            intval = self->options.rcvquantum;
+            break;
 
         /*  Fallback to socket options  */
         default:
@@ -164,6 +202,11 @@ int nn_pipebase_ispeer (struct nn_pipebase *self, int socktype)
     return nn_sock_ispeer (self->sock, socktype);
 }
 
+int nn_pipebase_socket (struct nn_pipebase *self)
+{
+    return self->sock->fd;
+}
+
 void nn_pipe_setdata (struct nn_pipe *self, void *data)
 {
     ((struct nn_pipebase*) self)->data = data;
@@ -182,10 +225,17 @@ int nn_pipe_send (struct nn_pipe *self, struct nn_msg *msg)
     pipebase = (struct nn_pipebase*) self;
     nn_assert (pipebase->outstate == NN_PIPEBASE_OUTSTATE_IDLE);
     pipebase->outstate = NN_PIPEBASE_OUTSTATE_SENDING;
+    pipebase->bytes_sent += nn_chunkref_size (&msg->body);
+    nn_tracepoint (NN_TRACE_PIPE_SEND, pipebase->sock->fd, self,
+        nn_chunkref_size (&msg->body), msg->stamp);
+    pipebase->send_stamp = nn_clock_us ();
     rc = pipebase->vfptr->send (pipebase, msg);
     errnum_assert (rc >= 0, -rc);
+    ++pipebase->sent;
     if (nn_fast (pipebase->outstate == NN_PIPEBASE_OUTSTATE_SENT)) {
         pipebase->outstate = NN_PIPEBASE_OUTSTATE_IDLE;
+        if (pipebase->backlog)
+            nn_pipebase_sample_backlog (pipebase, pipebase->send_stamp, 0);
         return rc;
     }
     nn_assert (pipebase->outstate == NN_PIPEBASE_OUTSTATE_SENDING);
@@ -196,13 +246,22 @@ int nn_pipe_send (struct nn_pipe *self, struct nn_msg *msg)
 int nn_pipe_recv (struct nn_pipe *self, struct nn_msg *msg)
 {
     int rc;
+    uint64_t stamp;
     struct nn_pipebase *pipebase;
 
     pipebase = (struct nn_pipebase*) self;
     nn_assert (pipebase->instate == NN_PIPEBASE_INSTATE_IDLE);
     pipebase->instate = NN_PIPEBASE_INSTATE_RECEIVING;
+
+    /*  The transport may report the next message as soon as this one is
+        taken, so pick the arrival time up beforehand. */
+    stamp = pipebase->in_stamp;
     rc = pipebase->vfptr->recv (pipebase, msg);
     errnum_assert (rc >= 0, -rc);
+    ++pipebase->received;
+    pipebase->bytes_received += nn_chunkref_size (&msg->body);
+    if (msg->stamp == 0)
+        msg->stamp = stamp;
 
     if (nn_fast (pipebase->instate == NN_PIPEBASE_INSTATE_RECEIVED)) {
         pipebase->instate = NN_PIPEBASE_INSTATE_IDLE;
@@ -222,3 +281,49 @@ void nn_pipe_getopt (struct nn_pipe *self, int level, int option,
     pipebase = (struct nn_pipebase*) self;
     nn_pipebase_getopt (pipebase, level, option, optval, optvallen);
 }
+
+int nn_pipe_outstanding (struct nn_pipe *self)
+{
+    return ((struct nn_pipebase*) self)->outstanding;
+}
+
+void nn_pipe_track (struct nn_pipe *self, int delta)
+{
+    struct nn_pipebase *pipebase;
+
+    pipebase = (struct nn_pipebase*) self;
+    pipebase->outstanding += delta;
+    nn_assert (pipebase->outstanding >= 0);
+}
+
+int nn_pipe_backlog (struct nn_pipe *self)
+{
+    struct nn_pipebase *pipebase;
+
+    pipebase = (struct nn_pipebase*) self;
+    if (pipebase->backlog == 0)
+        return 0;
+    nn_pipebase_decay_backlog (pipebase, nn_clock_ms ());
+    return pipebase->backlog;
+}
+
+static void nn_pipebase_decay_backlog (struct nn_pipebase *self,
+    uint64_t now)
+{
+    uint64_t halflives;
+
+    halflives = (now - self->backlog_stamp) / NN_PIPEBASE_BACKLOG_HALFLIFE;
+    if (halflives == 0)
+        return;
+    self->backlog = halflives >= 31 ? 0 : self->backlog >> halflives;
+    self->backlog_stamp = now;
+}
+
+static void nn_pipebase_sample_backlog (struct nn_pipebase *self,
+    uint64_t now, uint64_t elapsed)
+{
+    nn_pipebase_decay_backlog (self, now / 1000);
+    if (elapsed > NN_PIPEBASE_BACKLOG_MAX)
+        elapsed = NN_PIPEBASE_BACKLOG_MAX;
+    self->backlog = (int) ((7 * (uint64_t) self->backlog + elapsed) / 8);
+}
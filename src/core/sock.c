@@ -36,6 +36,7 @@
 #include "../utils/fast.h"
 #include "../utils/alloc.h"
 #include "../utils/msg.h"
+#include "../utils/trace.h"
 
 #include <limits.h>
 
@@ -117,10 +118,12 @@ int nn_sock_init (struct nn_sock *self, const struct nn_socktype *socktype,
         return rc;
     }
 
+    self->fd = fd;
     self->holds = 1;   /*  Callers hold. */
     self->flags = 0;
     nn_list_init (&self->eps);
     nn_list_init (&self->sdeps);
+    nn_list_init (&self->pipes);
     self->eid = 1;
 
     /*  Default values for NN_SOL_SOCKET options. */
@@ -132,9 +135,11 @@ int nn_sock_init (struct nn_sock *self, const struct nn_socktype *socktype,
     self->reconnect_ivl = 100;
     self->reconnect_ivl_max = 0;
     self->maxttl = 8;
+    self->lbstrategy = NN_LB_ROUND_ROBIN;
     self->ep_template.sndprio = 8;
     self->ep_template.rcvprio = 8;
     self->ep_template.ipv4only = 1;
+    self->ep_template.rcvquantum = 0;
 
     /* Clear statistic entries */
     memset(&self->statistics, 0, sizeof (self->statistics));
@@ -236,6 +241,7 @@ int nn_sock_term (struct nn_sock *self)
     nn_fsm_term (&self->fsm);
     nn_sem_term (&self->termsem);
     nn_sem_term (&self->relesem);
+    nn_list_term (&self->pipes);
     nn_list_term (&self->sdeps);
     nn_list_term (&self->eps);
     nn_ctx_term (&self->ctx);
@@ -366,11 +372,28 @@ static int nn_sock_setopt_inner (struct nn_sock *self, int level,
             return -EINVAL;
         self->ep_template.ipv4only = val;
         return 0;
+    case NN_RCVQUANTUM:
+        if (val < 0)
+            return -EINVAL;
+        self->ep_template.rcvquantum = val;
+        return 0;
     case NN_MAXTTL:
         if (val < 1 || val > 255)
             return -EINVAL;
         self->maxttl = val;
         return 0;
+    case NN_LB_STRATEGY:
+        if (val != NN_LB_ROUND_ROBIN && val != NN_LB_LEAST_OUTSTANDING &&
+              val != NN_LB_POWER_OF_TWO)
+            return -EINVAL;
+        self->lbstrategy = val;
+
+        /*  Socket types that load-balance keep a copy of the strategy so
+            that they don't have to look it up on each send. */
+        if (self->sockbase->vfptr->setopt)
+            self->sockbase->vfptr->setopt (self->sockbase, level, option,
+                optval, optvallen);
+        return 0;
     case NN_LINGER:
 	/*  Ignored, retained for compatibility. */
         return 0;
@@ -458,9 +481,15 @@ int nn_sock_getopt_inner (struct nn_sock *self, int level,
     case NN_IPV4ONLY:
         intval = self->ep_template.ipv4only;
         break;
+    case NN_RCVQUANTUM:
+        intval = self->ep_template.rcvquantum;
+        break;
     case NN_MAXTTL:
         intval = self->maxttl;
         break;
+    case NN_LB_STRATEGY:
+        intval = self->lbstrategy;
+        break;
     case NN_SNDFD:
         if (self->socktype->flags & NN_SOCKTYPE_FLAG_NOSEND)
             return -ENOPROTOOPT;
@@ -573,6 +602,9 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
     if (nn_slow (self->socktype->flags & NN_SOCKTYPE_FLAG_NOSEND))
         return -ENOTSUP;
 
+    nn_tracepoint (NN_TRACE_SOCK_SEND, self->fd, NULL,
+        nn_chunkref_size (&msg->body), msg->stamp);
+
     nn_ctx_enter (&self->ctx);
 
     /*  Compute the deadline for SNDTIMEO timer. */
@@ -701,6 +733,8 @@ int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
         rc = self->sockbase->vfptr->recv (self->sockbase, msg);
         if (nn_fast (rc == 0)) {
             nn_ctx_leave (&self->ctx);
+            nn_tracepoint (NN_TRACE_SOCK_RECV, self->fd, NULL,
+                nn_chunkref_size (&msg->body), msg->stamp);
             return 0;
         }
         nn_assert (rc < 0);
@@ -750,8 +784,13 @@ int nn_sock_add (struct nn_sock *self, struct nn_pipe *pipe)
 {
     int rc;
 
+    struct nn_pipebase *pipebase;
+
     rc = self->sockbase->vfptr->add (self->sockbase, pipe);
     if (nn_slow (rc >= 0)) {
+        pipebase = (struct nn_pipebase*) pipe;
+        nn_list_insert (&self->pipes, &pipebase->item,
+            nn_list_end (&self->pipes));
         nn_sock_stat_increment (self, NN_STAT_CURRENT_CONNECTIONS, 1);
     }
     return rc;
@@ -759,7 +798,11 @@ int nn_sock_add (struct nn_sock *self, struct nn_pipe *pipe)
 
 void nn_sock_rm (struct nn_sock *self, struct nn_pipe *pipe)
 {
+    struct nn_pipebase *pipebase;
+
     self->sockbase->vfptr->rm (self->sockbase, pipe);
+    pipebase = (struct nn_pipebase*) pipe;
+    nn_list_erase (&self->pipes, &pipebase->item);
     nn_sock_stat_increment (self, NN_STAT_CURRENT_CONNECTIONS, -1);
 }
 
@@ -1032,75 +1075,227 @@ void nn_sock_stat_increment (struct nn_sock *self, int name, int64_t increment)
     switch (name) {
         case NN_STAT_ESTABLISHED_CONNECTIONS:
             nn_assert (increment > 0);
-            self->statistics.established_connections += increment;
+            nn_counter_add (&self->statistics.established_connections,
+                increment);
             break;
         case NN_STAT_ACCEPTED_CONNECTIONS:
             nn_assert (increment > 0);
-            self->statistics.accepted_connections += increment;
+            nn_counter_add (&self->statistics.accepted_connections, increment);
             break;
         case NN_STAT_DROPPED_CONNECTIONS:
             nn_assert (increment > 0);
-            self->statistics.dropped_connections += increment;
+            nn_counter_add (&self->statistics.dropped_connections, increment);
             break;
         case NN_STAT_BROKEN_CONNECTIONS:
             nn_assert (increment > 0);
-            self->statistics.broken_connections += increment;
+            nn_counter_add (&self->statistics.broken_connections, increment);
             break;
         case NN_STAT_CONNECT_ERRORS:
             nn_assert (increment > 0);
-            self->statistics.connect_errors += increment;
+            nn_counter_add (&self->statistics.connect_errors, increment);
             break;
         case NN_STAT_BIND_ERRORS:
             nn_assert (increment > 0);
-            self->statistics.bind_errors += increment;
+            nn_counter_add (&self->statistics.bind_errors, increment);
             break;
         case NN_STAT_ACCEPT_ERRORS:
             nn_assert (increment > 0);
-            self->statistics.accept_errors += increment;
+            nn_counter_add (&self->statistics.accept_errors, increment);
             break;
         case NN_STAT_MESSAGES_SENT:
             nn_assert (increment > 0);
-            self->statistics.messages_sent += increment;
+            nn_counter_add (&self->statistics.messages_sent, increment);
             break;
         case NN_STAT_MESSAGES_RECEIVED:
             nn_assert (increment > 0);
-            self->statistics.messages_received += increment;
+            nn_counter_add (&self->statistics.messages_received, increment);
             break;
         case NN_STAT_BYTES_SENT:
             nn_assert (increment >= 0);
-            self->statistics.bytes_sent += increment;
+            nn_counter_add (&self->statistics.bytes_sent, increment);
             break;
         case NN_STAT_BYTES_RECEIVED:
             nn_assert (increment >= 0);
-            self->statistics.bytes_received += increment;
+            nn_counter_add (&self->statistics.bytes_received, increment);
+            break;
+        case NN_STAT_MESSAGES_FORWARDED:
+            nn_assert (increment > 0);
+            nn_counter_add (&self->statistics.messages_forwarded, increment);
+            break;
+        case NN_STAT_BYTES_FORWARDED:
+            nn_assert (increment >= 0);
+            nn_counter_add (&self->statistics.bytes_forwarded, increment);
             break;
 
+        /*  Level-style values are only ever changed from within the socket,
+            so the checks below don't race with other updates. */
         case NN_STAT_CURRENT_CONNECTIONS:
-            nn_assert (increment > 0 ||
-                self->statistics.current_connections >= -increment);
+            nn_assert (increment > 0 || (int64_t) nn_counter_get (
+                &self->statistics.current_connections) >= -increment);
             nn_assert(increment < INT_MAX && increment > -INT_MAX);
-            self->statistics.current_connections += (int) increment;
+            nn_counter_add (&self->statistics.current_connections, increment);
             break;
         case NN_STAT_INPROGRESS_CONNECTIONS:
-            nn_assert (increment > 0 ||
-                self->statistics.inprogress_connections >= -increment);
+            nn_assert (increment > 0 || (int64_t) nn_counter_get (
+                &self->statistics.inprogress_connections) >= -increment);
             nn_assert(increment < INT_MAX && increment > -INT_MAX);
-            self->statistics.inprogress_connections += (int) increment;
+            nn_counter_add (&self->statistics.inprogress_connections,
+                increment);
             break;
         case NN_STAT_CURRENT_SND_PRIORITY:
             /*  This is an exception, we don't want to increment priority  */
             nn_assert((increment > 0 && increment <= 16) || increment == -1);
-            self->statistics.current_snd_priority = (int) increment;
+            nn_counter_set (&self->statistics.current_snd_priority,
+                (uint64_t) increment);
             break;
         case NN_STAT_CURRENT_EP_ERRORS:
-            nn_assert (increment > 0 ||
-                self->statistics.current_ep_errors >= -increment);
+            nn_assert (increment > 0 || (int64_t) nn_counter_get (
+                &self->statistics.current_ep_errors) >= -increment);
             nn_assert(increment < INT_MAX && increment > -INT_MAX);
-            self->statistics.current_ep_errors += (int) increment;
+            nn_counter_add (&self->statistics.current_ep_errors, increment);
             break;
     }
 }
 
+void nn_sock_stat_latency (struct nn_sock *self, struct nn_msg *msg)
+{
+    uint64_t now;
+
+    if (msg->stamp == 0)
+        return;
+    now = nn_clock_us ();
+    nn_histogram_record (&self->statistics.latency,
+        now > msg->stamp ? now - msg->stamp : 0);
+}
+
+static struct nn_counter *nn_sock_stat_counter (struct nn_sock *self,
+    int name)
+{
+    switch (name) {
+    case NN_STAT_ESTABLISHED_CONNECTIONS:
+        return &self->statistics.established_connections;
+    case NN_STAT_ACCEPTED_CONNECTIONS:
+        return &self->statistics.accepted_connections;
+    case NN_STAT_DROPPED_CONNECTIONS:
+        return &self->statistics.dropped_connections;
+    case NN_STAT_BROKEN_CONNECTIONS:
+        return &self->statistics.broken_connections;
+    case NN_STAT_CONNECT_ERRORS:
+        return &self->statistics.connect_errors;
+    case NN_STAT_BIND_ERRORS:
+        return &self->statistics.bind_errors;
+    case NN_STAT_ACCEPT_ERRORS:
+        return &self->statistics.accept_errors;
+    case NN_STAT_MESSAGES_SENT:
+        return &self->statistics.messages_sent;
+    case NN_STAT_MESSAGES_RECEIVED:
+        return &self->statistics.messages_received;
+    case NN_STAT_BYTES_SENT:
+        return &self->statistics.bytes_sent;
+    case NN_STAT_BYTES_RECEIVED:
+        return &self->statistics.bytes_received;
+    case NN_STAT_MESSAGES_FORWARDED:
+        return &self->statistics.messages_forwarded;
+    case NN_STAT_BYTES_FORWARDED:
+        return &self->statistics.bytes_forwarded;
+    case NN_STAT_CURRENT_CONNECTIONS:
+        return &self->statistics.current_connections;
+    case NN_STAT_INPROGRESS_CONNECTIONS:
+        return &self->statistics.inprogress_connections;
+    case NN_STAT_CURRENT_SND_PRIORITY:
+        return &self->statistics.current_snd_priority;
+    case NN_STAT_CURRENT_EP_ERRORS:
+        return &self->statistics.current_ep_errors;
+    default:
+        return NULL;
+    }
+}
+
+int nn_sock_stat_get (struct nn_sock *self, int name, uint64_t *value)
+{
+    struct nn_counter *counter;
+
+    counter = nn_sock_stat_counter (self, name);
+    if (nn_slow (!counter))
+        return -EINVAL;
+    *value = nn_counter_get (counter);
+    return 0;
+}
+
+void nn_sock_stats (struct nn_sock *self, struct nn_statistics *stats,
+    struct nn_pipe_statistics *pipes, int *npipes)
+{
+    int n;
+    struct nn_list_item *it;
+    struct nn_pipebase *pipebase;
+    struct nn_pipe_statistics *ps;
+
+    if (stats) {
+        stats->established_connections =
+            nn_counter_get (&self->statistics.established_connections);
+        stats->accepted_connections =
+            nn_counter_get (&self->statistics.accepted_connections);
+        stats->dropped_connections =
+            nn_counter_get (&self->statistics.dropped_connections);
+        stats->broken_connections =
+            nn_counter_get (&self->statistics.broken_connections);
+        stats->connect_errors =
+            nn_counter_get (&self->statistics.connect_errors);
+        stats->bind_errors = nn_counter_get (&self->statistics.bind_errors);
+        stats->accept_errors = nn_counter_get (&self->statistics.accept_errors);
+        stats->messages_sent = nn_counter_get (&self->statistics.messages_sent);
+        stats->messages_received =
+            nn_counter_get (&self->statistics.messages_received);
+        stats->bytes_sent = nn_counter_get (&self->statistics.bytes_sent);
+        stats->bytes_received =
+            nn_counter_get (&self->statistics.bytes_received);
+        stats->messages_forwarded =
+            nn_counter_get (&self->statistics.messages_forwarded);
+        stats->bytes_forwarded =
+            nn_counter_get (&self->statistics.bytes_forwarded);
+        stats->current_connections =
+            nn_counter_get (&self->statistics.current_connections);
+        stats->inprogress_connections =
+            nn_counter_get (&self->statistics.inprogress_connections);
+        stats->current_snd_priority =
+            nn_counter_get (&self->statistics.current_snd_priority);
+        stats->current_ep_errors =
+            nn_counter_get (&self->statistics.current_ep_errors);
+
+        stats->latency_count =
+            nn_counter_get (&self->statistics.latency.count);
+        stats->latency_sum = nn_counter_get (&self->statistics.latency.sum);
+        stats->latency_max = nn_counter_get (&self->statistics.latency.max);
+        nn_histogram_read (&self->statistics.latency, stats->latency);
+    }
+
+    if (!npipes)
+        return;
+
+    /*  Per-pipe statistics are only touched from within the socket, so the
+        lock has to be held while reading them. */
+    nn_ctx_enter (&self->ctx);
+    n = 0;
+    for (it = nn_list_begin (&self->pipes); it != nn_list_end (&self->pipes);
+          it = nn_list_next (&self->pipes, it)) {
+        pipebase = nn_cont (it, struct nn_pipebase, item);
+        if (pipes && n < *npipes) {
+            ps = &pipes [n];
+            ps->endpoint = pipebase->eid;
+            ps->messages_sent = pipebase->sent;
+            ps->messages_received = pipebase->received;
+            ps->bytes_sent = pipebase->bytes_sent;
+            ps->bytes_received = pipebase->bytes_received;
+            ps->queued = pipebase->queued;
+            ps->outstanding = nn_pipe_outstanding ((struct nn_pipe*) pipebase);
+            ps->backlog = nn_pipe_backlog ((struct nn_pipe*) pipebase);
+        }
+        ++n;
+    }
+    nn_ctx_leave (&self->ctx);
+    *npipes = n;
+}
+
 int nn_sock_hold (struct nn_sock *self)
 {
     switch (self->state) {
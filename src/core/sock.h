@@ -33,6 +33,8 @@
 #include "../utils/efd.h"
 #include "../utils/sem.h"
 #include "../utils/list.h"
+#include "../utils/counter.h"
+#include "../utils/histogram.h"
 
 struct nn_pipe;
 
@@ -53,6 +55,9 @@ struct nn_sock
 
     int flags;
 
+    /*  The socket number, as returned by nn_socket(). */
+    int fd;
+
     struct nn_ctx ctx;
     struct nn_efd sndfd;
     struct nn_efd rcvfd;
@@ -65,6 +70,9 @@ struct nn_sock
     /*  List of all endpoint being in the process of shutting down. */
     struct nn_list sdeps;
 
+    /*  List of all pipes attached to the socket. */
+    struct nn_list pipes;
+
     /*  Next endpoint ID to assign to a new endpoint. */
     int eid;
 
@@ -80,6 +88,7 @@ struct nn_sock
     int reconnect_ivl;
     int reconnect_ivl_max;
     int maxttl;
+    int lbstrategy;
 
     /*  Endpoint-specific options.  */
     struct nn_ep_options ep_template;
@@ -87,44 +96,55 @@ struct nn_sock
     /*  Transport-specific socket options. */
     struct nn_optset *optsets [NN_MAX_TRANSPORT];
 
+    /*  Statistics are updated without holding the socket lock, so they
+        are kept in relaxed atomic counters. */
     struct {
 
         /*****  The ever-incrementing counters  *****/
 
         /*  Successfully established nn_connect() connections  */
-        uint64_t established_connections;
+        struct nn_counter established_connections;
         /*  Successfully accepted connections  */
-        uint64_t accepted_connections;
+        struct nn_counter accepted_connections;
         /*  Forcedly closed connections  */
-        uint64_t dropped_connections;
+        struct nn_counter dropped_connections;
         /*  Connections closed by peer  */
-        uint64_t broken_connections;
+        struct nn_counter broken_connections;
         /*  Errors trying to establish active connection  */
-        uint64_t connect_errors;
+        struct nn_counter connect_errors;
         /*  Errors binding to specified port  */
-        uint64_t bind_errors;
+        struct nn_counter bind_errors;
         /*  Errors accepting connections at nn_bind()'ed endpoint  */
-        uint64_t accept_errors;
+        struct nn_counter accept_errors;
 
         /*  Messages sent  */
-        uint64_t messages_sent;
+        struct nn_counter messages_sent;
         /*  Messages received  */
-        uint64_t messages_received;
+        struct nn_counter messages_received;
         /*  Bytes sent (sum length of data in messages sent)  */
-        uint64_t bytes_sent;
+        struct nn_counter bytes_sent;
         /*  Bytes recevied (sum length of data in messages received)  */
-        uint64_t bytes_received;
+        struct nn_counter bytes_received;
+        /*  Messages received and forwarded to the peer socket by a device  */
+        struct nn_counter messages_forwarded;
+        /*  Bytes forwarded to the peer socket by a device  */
+        struct nn_counter bytes_forwarded;
 
         /*****  Level-style values *****/
 
         /*  Number of currently established connections  */
-        int current_connections;
+        struct nn_counter current_connections;
         /*  Number of connections currently in progress  */
-        int inprogress_connections;
+        struct nn_counter inprogress_connections;
         /*  The currently set priority for sending data  */
-        int current_snd_priority;
+        struct nn_counter current_snd_priority;
         /*  Number of endpoints having last_errno set to non-zero value  */
-        int current_ep_errors;
+        struct nn_counter current_ep_errors;
+
+        /*****  Histograms  *****/
+
+        /*  Send-to-delivery latency of received messages (microseconds)  */
+        struct nn_histogram latency;
 
     } statistics;
 
@@ -194,6 +214,17 @@ void nn_sock_rm (struct nn_sock *self, struct nn_pipe *pipe);
 void nn_sock_report_error(struct nn_sock *self, struct nn_ep *ep,  int errnum);
 void nn_sock_stat_increment(struct nn_sock *self, int name, int64_t increment);
 
+/*  Records the send-to-delivery latency of a message handed to the user. */
+void nn_sock_stat_latency (struct nn_sock *self, struct nn_msg *msg);
+
+/*  Returns the value of a single statistic, or -EINVAL if unknown. */
+int nn_sock_stat_get (struct nn_sock *self, int name, uint64_t *value);
+
+/*  Takes a snapshot of all the statistics, including up to '*npipes' pipes.
+    '*npipes' is set to the number of pipes attached to the socket. */
+void nn_sock_stats (struct nn_sock *self, struct nn_statistics *stats,
+    struct nn_pipe_statistics *pipes, int *npipes);
+
 /*  Holds and releases. */
 int nn_sock_hold (struct nn_sock *self);
 void nn_sock_rele (struct nn_sock *self);
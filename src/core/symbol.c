@@ -115,15 +115,32 @@ static const struct nn_symbol_properties sym_value_names [] = {
     NN_SYM(NN_IPV4ONLY, SOCKET_OPTION, INT, BOOLEAN),
     NN_SYM(NN_SOCKET_NAME, SOCKET_OPTION, STR, NONE),
     NN_SYM(NN_MAXTTL, SOCKET_OPTION, INT, NONE),
+    NN_SYM(NN_LB_STRATEGY, SOCKET_OPTION, INT, NONE),
+    NN_SYM(NN_RCVQUANTUM, SOCKET_OPTION, INT, BYTES),
 
     NN_SYM(NN_SUB_SUBSCRIBE, TRANSPORT_OPTION, STR, NONE),
     NN_SYM(NN_SUB_UNSUBSCRIBE, TRANSPORT_OPTION, STR, NONE),
     NN_SYM(NN_REQ_RESEND_IVL, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_REQ_RESEND_ADAPTIVE, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_REQ_RTT, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_REP_CONTEXT, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_BUS_DEDUP, TRANSPORT_OPTION, INT, BOOLEAN),
     NN_SYM(NN_SURVEYOR_DEADLINE, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_SURVEYOR_QUORUM, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_SURVEYOR_MAXSURVEYS, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_SURVEYOR_SURVEYID, TRANSPORT_OPTION, INT, NONE),
     NN_SYM(NN_TCP_NODELAY, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_TCP_LISTENERS, TRANSPORT_OPTION, INT, NONE),
     NN_SYM(NN_WS_MSG_TYPE, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_WS_DEFLATE, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_WS_DEFLATE_LEVEL, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_WS_DEFLATE_MIN_SIZE, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_WS_DEFLATE_NO_CONTEXT_TAKEOVER, TRANSPORT_OPTION, INT, BOOLEAN),
 
     NN_SYM(NN_DONTWAIT, FLAG, NONE, NONE),
+    NN_SYM(NN_LB_ROUND_ROBIN, FLAG, NONE, NONE),
+    NN_SYM(NN_LB_LEAST_OUTSTANDING, FLAG, NONE, NONE),
+    NN_SYM(NN_LB_POWER_OF_TWO, FLAG, NONE, NONE),
     NN_SYM(NN_WS_MSG_TYPE_TEXT, FLAG, NONE, NONE),
     NN_SYM(NN_WS_MSG_TYPE_BINARY, FLAG, NONE, NONE),
 
@@ -174,6 +191,8 @@ static const struct nn_symbol_properties sym_value_names [] = {
     NN_SYM(NN_STAT_MESSAGES_RECEIVED, STATISTIC, INT, MESSAGES),
     NN_SYM(NN_STAT_BYTES_SENT, STATISTIC, INT, BYTES),
     NN_SYM(NN_STAT_BYTES_RECEIVED, STATISTIC, INT, BYTES),
+    NN_SYM(NN_STAT_MESSAGES_FORWARDED, STATISTIC, INT, MESSAGES),
+    NN_SYM(NN_STAT_BYTES_FORWARDED, STATISTIC, INT, BYTES),
     NN_SYM(NN_STAT_CURRENT_CONNECTIONS, STATISTIC, INT, NONE),
     NN_SYM(NN_STAT_INPROGRESS_CONNECTIONS, STATISTIC, INT, NONE),
     NN_SYM(NN_STAT_CURRENT_SND_PRIORITY, STATISTIC, INT, PRIORITY),
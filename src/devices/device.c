@@ -24,20 +24,125 @@
 #include "../nn.h"
 
 #include "../utils/err.h"
+#include "../utils/alloc.h"
+#include "../utils/cont.h"
+#include "../utils/closefd.h"
 #include "../utils/fast.h"
 #include "../utils/fd.h"
 #include "../utils/attr.h"
 #include "../utils/thread.h"
+#include "../utils/msg.h"
+#include "../core/global.h"
 #include "device.h"
 
 #include <string.h>
 
+#if !defined NN_HAVE_WINDOWS
+#include "../aio/poller.h"
+#include <unistd.h>
+#endif
+
 #ifndef NN_HAVE_WINDOWS
 #define NN_BAD_FD	-1
 #else
 #define	NN_BAD_FD	INVALID_SOCKET
 #endif
 
+/*  Ways in which messages can flow through a device. */
+#define NN_DEVICE_LOOPBACK 1
+#define NN_DEVICE_TWOWAY 2
+#define NN_DEVICE_ONEWAY 3
+#define NN_DEVICE_ONEWAY_REVERSE 4
+
+/*  Maximum number of messages moved in one direction before the device
+    gives the other direction a chance to run. */
+#define NN_DEVICE_BATCH 64
+
+/*  One direction of a natively spliced device. */
+struct nn_device_splice {
+    int from;
+    int to;
+
+    /*  Message received from 'from' that 'to' wasn't able to accept yet. */
+    int pending;
+    struct nn_msg msg;
+};
+
+/*  Returns 1 if the recipe doesn't need to see individual messages, in which
+    case they can be forwarded without leaving the library. */
+static int nn_device_isnative (struct nn_device_recipe *device)
+{
+    return device->nn_device_mvmsg == nn_device_mvmsg &&
+        device->nn_device_rewritemsg == nn_device_rewritemsg;
+}
+
+/*  Forwards messages in 'ndirs' directions from a single thread. Messages
+    are moved between the sockets in batches, without being converted to
+    NN_MSG chunks and back. */
+static int nn_device_splice (struct nn_device_splice *dirs, int ndirs)
+{
+    int rc;
+    int i;
+    int busy;
+    struct nn_pollfd pfd [2];
+
+    for (;;) {
+
+        /*  Move whatever can be moved without blocking. */
+        busy = 0;
+        for (i = 0; i != ndirs; ++i) {
+            rc = nn_global_splice (dirs [i].from, dirs [i].to,
+                &dirs [i].msg, &dirs [i].pending, NN_DEVICE_BATCH);
+            if (nn_slow (rc < 0)) {
+                errno = -rc;
+                return -1;
+            }
+            if (rc == NN_DEVICE_BATCH)
+                busy = 1;
+        }
+        if (busy)
+            continue;
+
+        /*  Wait till either there's a new message to forward or the socket
+            that was full is able to accept the pending one. */
+        for (i = 0; i != ndirs; ++i) {
+            if (dirs [i].pending) {
+                pfd [i].fd = dirs [i].to;
+                pfd [i].events = NN_POLLOUT;
+            }
+            else {
+                pfd [i].fd = dirs [i].from;
+                pfd [i].events = NN_POLLIN;
+            }
+            pfd [i].revents = 0;
+        }
+        rc = nn_poll (pfd, ndirs, -1);
+        if (nn_slow (rc < 0))
+            return -1;
+    }
+}
+
+static int nn_device_native (int s1, int s2, int ndirs)
+{
+    int rc;
+    int i;
+    struct nn_device_splice dirs [2];
+
+    dirs [0].from = s1;
+    dirs [0].to = s2;
+    dirs [0].pending = 0;
+    dirs [1].from = s2;
+    dirs [1].to = s1;
+    dirs [1].pending = 0;
+
+    rc = nn_device_splice (dirs, ndirs);
+
+    for (i = 0; i != ndirs; ++i)
+        if (dirs [i].pending)
+            nn_msg_term (&dirs [i].msg);
+    return rc;
+}
+
 int nn_custom_device(struct nn_device_recipe *device, int s1, int s2,
     int flags)
 {
@@ -49,8 +154,10 @@ int nn_device (int s1, int s2)
     return nn_custom_device (&nn_ordinary_device, s1, s2, 0);
 }
 
-int nn_device_entry (struct nn_device_recipe *device, int s1, int s2,
-    NN_UNUSED int flags)
+/*  Validates the sockets according to the checks required by the recipe
+    and finds out in which direction(s) the messages are going to flow. */
+static int nn_device_classify (struct nn_device_recipe *device,
+    int s1, int s2, int *kind)
 {
     int rc;
     int op1;
@@ -71,10 +178,10 @@ int nn_device_entry (struct nn_device_recipe *device, int s1, int s2,
 
     /*  Handle the case when there's only one socket in the device. */
     if (device->required_checks & NN_CHECK_ALLOW_LOOPBACK) {
-        if (s2 < 0)
-            return nn_device_loopback (device, s1);
-        if (s1 < 0)
-            return nn_device_loopback (device, s2);
+        if (s1 < 0 || s2 < 0) {
+            *kind = NN_DEVICE_LOOPBACK;
+            return 0;
+        }
     }
 
     /*  Check whether both sockets are "raw" sockets. */
@@ -177,33 +284,63 @@ int nn_device_entry (struct nn_device_recipe *device, int s1, int s2,
     /*  Two-directional device. */
     if (device->required_checks & NN_CHECK_ALLOW_BIDIRECTIONAL) {
         if (s1rcv != NN_BAD_FD && s1snd != NN_BAD_FD &&
-            s2rcv != NN_BAD_FD && s2snd != NN_BAD_FD)
-            return nn_device_twoway (device, s1, s2);
+            s2rcv != NN_BAD_FD && s2snd != NN_BAD_FD) {
+            *kind = NN_DEVICE_TWOWAY;
+            return 0;
+        }
     }
 
     if (device->required_checks & NN_CHECK_ALLOW_UNIDIRECTIONAL) {
         /*  Single-directional device passing messages from s1 to s2. */
         if (s1rcv != NN_BAD_FD && s1snd == NN_BAD_FD &&
-            s2rcv == NN_BAD_FD && s2snd != NN_BAD_FD)
-            return nn_device_oneway (device, s1, s2);
+            s2rcv == NN_BAD_FD && s2snd != NN_BAD_FD) {
+            *kind = NN_DEVICE_ONEWAY;
+            return 0;
+        }
 
         /*  Single-directional device passing messages from s2 to s1. */
         if (s1rcv == NN_BAD_FD && s1snd != NN_BAD_FD &&
-            s2rcv != NN_BAD_FD && s2snd == NN_BAD_FD)
-            return nn_device_oneway (device, s2, s1);
+            s2rcv != NN_BAD_FD && s2snd == NN_BAD_FD) {
+            *kind = NN_DEVICE_ONEWAY_REVERSE;
+            return 0;
+        }
     }
 
     /*  This should never happen. */
     nn_assert (0);
 }
 
-int nn_device_loopback (struct nn_device_recipe *device, int s)
+int nn_device_entry (struct nn_device_recipe *device, int s1, int s2,
+    NN_UNUSED int flags)
+{
+    int rc;
+    int kind;
+
+    rc = nn_device_classify (device, s1, s2, &kind);
+    if (nn_slow (rc < 0))
+        return -1;
+
+    switch (kind) {
+    case NN_DEVICE_LOOPBACK:
+        return nn_device_loopback (device, s2 < 0 ? s1 : s2);
+    case NN_DEVICE_TWOWAY:
+        return nn_device_twoway (device, s1, s2);
+    case NN_DEVICE_ONEWAY:
+        return nn_device_oneway (device, s1, s2);
+    case NN_DEVICE_ONEWAY_REVERSE:
+        return nn_device_oneway (device, s2, s1);
+    default:
+        nn_assert (0);
+    }
+}
+
+/*  Returns 0 if the socket is a "raw" socket, -1 and sets errno otherwise. */
+static int nn_device_israw (int s)
 {
     int rc;
     int op;
     size_t opsz;
 
-    /*  Check whether the socket is a "raw" socket. */
     opsz = sizeof (op);
     rc = nn_getsockopt (s, NN_SOL_SOCKET, NN_DOMAIN, &op, &opsz);
     if (nn_slow (rc != 0))
@@ -213,6 +350,19 @@ int nn_device_loopback (struct nn_device_recipe *device, int s)
         errno = EINVAL;
         return -1;
     }
+    return 0;
+}
+
+int nn_device_loopback (struct nn_device_recipe *device, int s)
+{
+    int rc;
+
+    /*  Check whether the socket is a "raw" socket. */
+    if (nn_slow (nn_device_israw (s) < 0))
+        return -1;
+
+    if (nn_device_isnative (device))
+        return nn_device_native (s, s, 1);
 
     for (;;) {
         rc = nn_device_mvmsg (device, s, s, 0);
@@ -248,6 +398,10 @@ int nn_device_twoway (struct nn_device_recipe *device, int s1, int s2)
     struct nn_device_forwarder_args a1;
     struct nn_device_forwarder_args a2;
 
+    /*  Without a message hook both directions are served by this thread. */
+    if (nn_device_isnative (device))
+        return nn_device_native (s1, s2, 2);
+
     a1.device = device;
     a1.s1 = s1;
     a1.s2 = s2;
@@ -274,6 +428,9 @@ int nn_device_oneway (struct nn_device_recipe *device, int s1, int s2)
 {
     int rc;
 
+    if (nn_device_isnative (device))
+        return nn_device_native (s1, s2, 1);
+
     while (1) {
         rc = nn_device_mvmsg (device, s1, s2, 0);
         if (nn_slow (rc < 0))
@@ -324,3 +481,289 @@ int nn_device_rewritemsg (NN_UNUSED struct nn_device_recipe *device,
 {
     return 1; /* always forward */
 }
+
+#if !defined NN_HAVE_WINDOWS
+
+/*  Readiness of a socket as seen by a device group. The group polls its own
+    duplicate of the socket's NN_RCVFD or NN_SNDFD descriptor so that it
+    doesn't have to hold the socket open: once the socket is closed the
+    duplicate keeps signalling and the group finds out about it. */
+struct nn_device_group_hndl {
+    struct nn_poller_hndl hndl;
+    int fd;
+    struct nn_device_group_dir *dir;
+};
+
+#endif
+
+/*  One direction of a device within a device group. */
+struct nn_device_group_dir {
+    struct nn_device_splice splice;
+    int device;
+#if !defined NN_HAVE_WINDOWS
+    struct nn_device_group_hndl in;
+    struct nn_device_group_hndl out;
+#endif
+};
+
+struct nn_device_group {
+    struct nn_device_group_dir *dirs;
+    int ndirs;
+
+    /*  Number of devices that are still running. */
+    int nactive;
+
+    /*  Error that stopped the most recently stopped device. */
+    int err;
+#if !defined NN_HAVE_WINDOWS
+    struct nn_poller poller;
+#endif
+};
+
+#if !defined NN_HAVE_WINDOWS
+
+static int nn_device_group_hndl_init (struct nn_device_group_hndl *self,
+    struct nn_device_group_dir *dir, int s, int option)
+{
+    int rc;
+    nn_fd fd;
+    size_t sz;
+
+    sz = sizeof (fd);
+    rc = nn_getsockopt (s, NN_SOL_SOCKET, option, &fd, &sz);
+    if (nn_slow (rc < 0))
+        return -1;
+    nn_assert (sz == sizeof (fd));
+    self->fd = dup (fd);
+    if (nn_slow (self->fd < 0))
+        return -1;
+    self->dir = dir;
+    return 0;
+}
+
+static void nn_device_group_wait (struct nn_device_group *self,
+    struct nn_device_group_dir *dir)
+{
+    if (dir->splice.pending) {
+        nn_poller_reset_in (&self->poller, &dir->in.hndl);
+        nn_poller_set_in (&self->poller, &dir->out.hndl);
+    }
+    else {
+        nn_poller_reset_in (&self->poller, &dir->out.hndl);
+        nn_poller_set_in (&self->poller, &dir->in.hndl);
+    }
+}
+
+#endif
+
+/*  Stops all the directions of the specified device. */
+static void nn_device_group_stop (struct nn_device_group *self, int device,
+    int err)
+{
+    int i;
+    struct nn_device_group_dir *dir;
+
+    for (i = 0; i != self->ndirs; ++i) {
+        dir = &self->dirs [i];
+        if (dir->device != device)
+            continue;
+        if (dir->splice.pending)
+            nn_msg_term (&dir->splice.msg);
+#if !defined NN_HAVE_WINDOWS
+        nn_poller_rm (&self->poller, &dir->in.hndl);
+        nn_poller_rm (&self->poller, &dir->out.hndl);
+        nn_closefd (dir->in.fd);
+        nn_closefd (dir->out.fd);
+#endif
+        dir->device = -1;
+    }
+    --self->nactive;
+    self->err = err;
+}
+
+/*  Moves messages in one direction. If that fails, the whole device
+    is stopped. */
+static void nn_device_group_step (struct nn_device_group *self,
+    struct nn_device_group_dir *dir)
+{
+    int rc;
+
+    rc = nn_global_splice (dir->splice.from, dir->splice.to,
+        &dir->splice.msg, &dir->splice.pending, NN_DEVICE_BATCH);
+    if (nn_slow (rc < 0)) {
+        nn_device_group_stop (self, dir->device, -rc);
+        return;
+    }
+#if !defined NN_HAVE_WINDOWS
+    nn_device_group_wait (self, dir);
+#endif
+}
+
+static int nn_device_group_add (struct nn_device_group *self, int device,
+    int from, int to)
+{
+    struct nn_device_group_dir *dir;
+
+    dir = &self->dirs [self->ndirs];
+    dir->splice.from = from;
+    dir->splice.to = to;
+    dir->splice.pending = 0;
+    dir->device = device;
+#if !defined NN_HAVE_WINDOWS
+    if (nn_slow (nn_device_group_hndl_init (&dir->in, dir, from,
+          NN_RCVFD) < 0))
+        return -1;
+    if (nn_slow (nn_device_group_hndl_init (&dir->out, dir, to,
+          NN_SNDFD) < 0)) {
+        nn_closefd (dir->in.fd);
+        return -1;
+    }
+    nn_poller_add (&self->poller, dir->in.fd, &dir->in.hndl);
+    nn_poller_add (&self->poller, dir->out.fd, &dir->out.hndl);
+    nn_poller_set_in (&self->poller, &dir->in.hndl);
+#endif
+    ++self->ndirs;
+    return 0;
+}
+
+static void nn_device_group_run (struct nn_device_group *self)
+{
+#if !defined NN_HAVE_WINDOWS
+    int rc;
+    int event;
+    struct nn_poller_hndl *hndl;
+    struct nn_device_group_dir *dir;
+
+    while (self->nactive) {
+        rc = nn_poller_wait (&self->poller, -1);
+        errnum_assert (rc == 0, -rc);
+        while (1) {
+            rc = nn_poller_event (&self->poller, &event, &hndl);
+            if (rc == -EAGAIN)
+                break;
+            errnum_assert (rc == 0, -rc);
+            dir = nn_cont (hndl, struct nn_device_group_hndl, hndl)->dir;
+            if (dir->device >= 0)
+                nn_device_group_step (self, dir);
+        }
+    }
+#else
+    int i;
+    int n;
+    struct nn_pollfd *pfd;
+
+    pfd = nn_alloc (sizeof (struct nn_pollfd) * self->ndirs,
+        "device group pollset");
+    alloc_assert (pfd);
+
+    while (self->nactive) {
+        for (i = 0; i != self->ndirs; ++i)
+            if (self->dirs [i].device >= 0)
+                nn_device_group_step (self, &self->dirs [i]);
+
+        /*  If any of the sockets was closed, polling fails. The device
+            it belongs to is stopped during the next step. */
+        for (i = 0, n = 0; i != self->ndirs; ++i) {
+            if (self->dirs [i].device < 0)
+                continue;
+            if (self->dirs [i].splice.pending) {
+                pfd [n].fd = self->dirs [i].splice.to;
+                pfd [n].events = NN_POLLOUT;
+            }
+            else {
+                pfd [n].fd = self->dirs [i].splice.from;
+                pfd [n].events = NN_POLLIN;
+            }
+            pfd [n].revents = 0;
+            ++n;
+        }
+        if (n)
+            (void) nn_poll (pfd, n, -1);
+    }
+
+    nn_free (pfd);
+#endif
+}
+
+int nn_device_group (const int *s, int ndevices)
+{
+    int rc;
+    int i;
+    int kind;
+    int s1;
+    int s2;
+    struct nn_device_group self;
+
+    if (nn_slow (!s || ndevices <= 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /*  Check all the devices before starting any of them. */
+    for (i = 0; i != ndevices; ++i) {
+        s1 = s [i * 2];
+        s2 = s [i * 2 + 1];
+        rc = nn_device_classify (&nn_ordinary_device, s1, s2, &kind);
+        if (nn_slow (rc < 0))
+            return -1;
+        if (kind == NN_DEVICE_LOOPBACK &&
+              nn_slow (nn_device_israw (s2 < 0 ? s1 : s2) < 0))
+            return -1;
+    }
+
+    self.dirs = nn_alloc (sizeof (struct nn_device_group_dir) * ndevices * 2,
+        "device group");
+    alloc_assert (self.dirs);
+    self.ndirs = 0;
+    self.nactive = 0;
+    self.err = EBADF;
+#if !defined NN_HAVE_WINDOWS
+    rc = nn_poller_init (&self.poller);
+    if (nn_slow (rc < 0)) {
+        nn_free (self.dirs);
+        errno = -rc;
+        return -1;
+    }
+#endif
+
+    for (i = 0; i != ndevices; ++i) {
+        s1 = s [i * 2];
+        s2 = s [i * 2 + 1];
+        rc = nn_device_classify (&nn_ordinary_device, s1, s2, &kind);
+        if (rc == 0) {
+            switch (kind) {
+            case NN_DEVICE_LOOPBACK:
+                s1 = s2 < 0 ? s1 : s2;
+                rc = nn_device_group_add (&self, i, s1, s1);
+                break;
+            case NN_DEVICE_TWOWAY:
+                rc = nn_device_group_add (&self, i, s1, s2);
+                if (rc == 0)
+                    rc = nn_device_group_add (&self, i, s2, s1);
+                break;
+            case NN_DEVICE_ONEWAY:
+                rc = nn_device_group_add (&self, i, s1, s2);
+                break;
+            case NN_DEVICE_ONEWAY_REVERSE:
+                rc = nn_device_group_add (&self, i, s2, s1);
+                break;
+            default:
+                nn_assert (0);
+            }
+        }
+        ++self.nactive;
+
+        /*  A socket was closed in the meantime. */
+        if (nn_slow (rc < 0))
+            nn_device_group_stop (&self, i, nn_errno ());
+    }
+
+    nn_device_group_run (&self);
+
+#if !defined NN_HAVE_WINDOWS
+    nn_poller_term (&self.poller);
+#endif
+    nn_free (self.dirs);
+    errno = self.err;
+    return -1;
+}
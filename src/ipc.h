@@ -33,6 +33,7 @@ extern "C" {
 #define NN_IPC_SEC_ATTR 1
 #define NN_IPC_OUTBUFSZ 2
 #define NN_IPC_INBUFSZ 3
+#define NN_IPC_ACCEPT_BATCH 4
 
 #ifdef __cplusplus
 }
@@ -335,6 +335,13 @@ NN_EXPORT  struct nn_cmsghdr *nn_cmsg_nxthdr_ (
 #define NN_SOCKET_NAME 15
 #define NN_RCVMAXSIZE 16
 #define NN_MAXTTL 17
+#define NN_LB_STRATEGY 18
+#define NN_RCVQUANTUM 19
+
+/*  Load-balancing strategies (values of NN_LB_STRATEGY option).              */
+#define NN_LB_ROUND_ROBIN 0
+#define NN_LB_LEAST_OUTSTANDING 1
+#define NN_LB_POWER_OF_TWO 2
 
 /*  Send/recv options.                                                        */
 #define NN_DONTWAIT 1
@@ -377,6 +384,7 @@ NN_EXPORT int nn_poll (struct nn_pollfd *fds, int nfds, int timeout);
 /******************************************************************************/
 
 NN_EXPORT int nn_device (int s1, int s2);
+NN_EXPORT int nn_device_group (const int *s, int ndevices);
 
 /******************************************************************************/
 /*  Statistics.                                                               */
@@ -400,11 +408,111 @@ NN_EXPORT int nn_device (int s1, int s2);
 #define NN_STAT_MESSAGES_RECEIVED       302
 #define NN_STAT_BYTES_SENT              303
 #define NN_STAT_BYTES_RECEIVED          304
+#define NN_STAT_MESSAGES_FORWARDED      305
+#define NN_STAT_BYTES_FORWARDED         306
 /*  Protocol statistics  */
 #define	NN_STAT_CURRENT_SND_PRIORITY    401
 
 NN_EXPORT uint64_t nn_get_statistic (int s, int stat);
 
+/*  Number of buckets in the latency histogram. Each power of two is split
+    into 8 linear buckets, covering latencies up to 2^32 microseconds.  */
+#define NN_STAT_LATENCY_BUCKETS 240
+
+/*  Snapshot of all the statistics of a socket.  */
+struct nn_statistics {
+    uint64_t established_connections;
+    uint64_t accepted_connections;
+    uint64_t dropped_connections;
+    uint64_t broken_connections;
+    uint64_t connect_errors;
+    uint64_t bind_errors;
+    uint64_t accept_errors;
+    uint64_t messages_sent;
+    uint64_t messages_received;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t messages_forwarded;
+    uint64_t bytes_forwarded;
+    uint64_t current_connections;
+    uint64_t inprogress_connections;
+    uint64_t current_snd_priority;
+    uint64_t current_ep_errors;
+
+    /*  Send-to-delivery latency of received messages, in microseconds.  */
+    uint64_t latency_count;
+    uint64_t latency_sum;
+    uint64_t latency_max;
+    uint64_t latency [NN_STAT_LATENCY_BUCKETS];
+};
+
+/*  Snapshot of the statistics of a single connection.  */
+struct nn_pipe_statistics {
+    int endpoint;
+    uint64_t messages_sent;
+    uint64_t messages_received;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t queued;
+    uint64_t outstanding;
+    uint64_t backlog;
+};
+
+NN_EXPORT int nn_get_statistics (int s, struct nn_statistics *stats,
+    struct nn_pipe_statistics *pipes, int *npipes);
+NN_EXPORT uint64_t nn_stat_latency (const struct nn_statistics *stats,
+    double percentile);
+
+/******************************************************************************/
+/*  Tracing.                                                                  */
+/******************************************************************************/
+
+/*  Tracepoints  */
+#define NN_TRACE_SOCK_SEND              1
+#define NN_TRACE_PIPE_SEND              2
+#define NN_TRACE_USOCK_SENT             3
+#define NN_TRACE_USOCK_RECEIVED         4
+#define NN_TRACE_SOCK_RECV              5
+
+/*  Tracing flags  */
+#define NN_TRACE_TIMESTAMP              1
+
+struct nn_trace_event {
+    int point;
+    int socket;
+    const void *object;
+    size_t size;
+    uint64_t stamp;
+    uint64_t time;
+};
+
+typedef void (*nn_trace_fn) (const struct nn_trace_event *event, void *arg);
+
+NN_EXPORT int nn_trace_hook (int point, nn_trace_fn fn, void *arg, int flags);
+
+/******************************************************************************/
+/*  Profiling of the worker threads.                                          */
+/******************************************************************************/
+
+/*  Loop statistics of a single worker thread. Times are in nanoseconds.  */
+struct nn_profile_worker {
+    uint64_t iterations;
+    uint64_t wait;
+    uint64_t busy;
+};
+
+/*  Events handled by one type of state machine and the time spent doing so,
+    in nanoseconds.  */
+struct nn_profile_fsm {
+    const char *name;
+    uint64_t events;
+    uint64_t time;
+};
+
+NN_EXPORT int nn_profile (int enable);
+NN_EXPORT int nn_get_profile (struct nn_profile_worker *workers, int *nworkers,
+    struct nn_profile_fsm *fsms, int *nfsms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,8 @@
 #include <sys/time.h>
 #include <pthread.h>
 #include <sys/prctl.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include "nn.h"
 #include "reqrep.h"
@@ -25,7 +27,12 @@
 
 #include "nn_nuttx.h"
 
-#define NN_NUTTX_TOPIC_NAME_LEN 15
+/* Topic messages carry the topic first, so that subscriptions are plain
+ * prefix matches in the pubsub trie, then the content and finally the
+ * length of the topic, 2 bytes in network order. The trie can match into
+ * the content, so subscribers check the topic itself once more. */
+#define NN_NUTTX_TOPIC_LEN_SIZE 2
+#define NN_NUTTX_TOPIC_LEN_MAX  0xffff
 
 typedef struct nn_trans_hdr {
     int seq;
@@ -50,18 +57,72 @@ typedef enum {
     NN_NUTTX_TRANS_TYPE_MAX
 } nn_nuttx_trans_type_t;
 
+typedef struct nn_server_job {
+    uint8_t* body;
+    void* control;
+    struct nn_server_job* next;
+} nn_server_job_t;
+
+typedef struct nn_server_thread {
+    struct nn_server_ctx* ctx;
+    pthread_t tid;
+
+    /* requests assigned to this thread, used with op_ordered only */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    nn_server_job_t* head;
+    nn_server_job_t* tail;
+    bool closed;
+} nn_server_thread_t;
+
 typedef struct nn_server_ctx {
     char* name;
     int fd;
+    int rcvfd;
     on_transaction on_trans_cb;
     pthread_t tid;
     bool actived;
     void* priv;
+
+    /* dispatcher threads, all of them receive from fd unless op_ordered,
+     * in which case tid receives and hands requests over by op_code */
+    int workers;
+    bool op_ordered;
+    nn_server_thread_t* threads;
+
+    /* written once by nn_server_release to make all of them return, the
+     * socket is closed only after that */
+    int wakefd[2];
+
+    /* set if served by the shared loop, there are no threads then */
+    struct nn_nuttx_source* source;
 } nn_server_ctx_t;
 
+typedef struct nn_client_pending {
+    uint32_t seq;
+    on_transaction_reply cb;
+    void* cookie;
+    struct nn_client_pending* next;
+} nn_client_pending_t;
+
 typedef struct nn_client_ctx {
     char* name;
     int fd;
+
+    /* raw REQ socket used by nn_client_transaction_async, opened on first
+     * use along with the thread receiving its replies */
+    int async_fd;
+    pthread_t async_tid;
+
+    /* set if nn_client_disconnect was called from a reply callback, the
+     * thread receiving the replies disconnects once the callback returns */
+    bool closing;
+    pthread_mutex_t lock;
+    uint32_t seq;
+
+    /* requests in flight, oldest first */
+    nn_client_pending_t* pending;
+    nn_client_pending_t* pending_tail;
 } nn_client_ctx_t;
 
 typedef struct nn_pub_ctx {
@@ -69,6 +130,12 @@ typedef struct nn_pub_ctx {
     int fd;
 } nn_pub_ctx_t;
 
+typedef struct nn_sub_topic {
+    struct nn_sub_topic* next;
+    size_t len;
+    uint8_t data[];
+} nn_sub_topic_t;
+
 typedef struct nn_sub_ctx {
     char* name;
     int fd;
@@ -76,18 +143,72 @@ typedef struct nn_sub_ctx {
     pthread_t tid;
     bool actived;
     void* priv;
-} nn_sub_ctx_t;
 
-typedef struct nn_nuttx_topic {
-    uint8_t topic[NN_NUTTX_TOPIC_NAME_LEN + 1];
-    size_t content_len;
-    uint8_t content[];
-} nn_nuttx_topic_t;
+    /* set if served by the shared loop instead of tid */
+    struct nn_nuttx_source* source;
+
+    /* registered topics, one entry per nn_sub_register_topic call */
+    pthread_mutex_t lock;
+    nn_sub_topic_t* topics;
+} nn_sub_ctx_t;
 
 const char* const nn_nuttx_trans_prefix_str[] = {
     "inproc://", "ipc://", "tcp://"
 };
 
+/* Maximum number of messages received from one socket per poll when the
+ * callbacks run on the loop thread, so that a busy socket can't starve
+ * the others. */
+#define NN_NUTTX_LOOP_BATCH 16
+
+typedef void (*nn_nuttx_handler)(void* ctx, uint8_t* body, int len, void* control);
+
+/* A socket served by the shared loop. */
+typedef struct nn_nuttx_source {
+    int fd;
+    int rcvfd;
+    void* ctx;
+    nn_nuttx_handler handle;
+
+    /* a message of this socket is being handled in the pool, the socket
+     * is not polled until it's done, which keeps its messages in order */
+    bool busy;
+    uint8_t* body;
+    void* control;
+    int len;
+
+    struct nn_nuttx_source* next;
+    struct nn_nuttx_source* job_next;
+} nn_nuttx_source_t;
+
+static struct nn_nuttx_loop {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t tid;
+    int wakefd[2];
+    bool running;
+    bool stopping;
+
+    /* registered sockets, gen is bumped on each change and gen_seen is
+     * the last generation the loop thread is polling */
+    nn_nuttx_source_t* sources;
+    int nsources;
+    unsigned gen;
+    unsigned gen_seen;
+
+    /* optional pool of threads running callbacks that may block */
+    int pool_size;
+    pthread_t* pool;
+    pthread_cond_t pool_cond;
+    nn_nuttx_source_t* jobs;
+    nn_nuttx_source_t* jobs_tail;
+} nn_nuttx_loop = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .pool_cond = PTHREAD_COND_INITIALIZER,
+    .wakefd = {-1, -1},
+};
+
 static int nn_socket_bind(int* fd, const char* name, int af, int protocol)
 {
     *fd = nn_socket(af, protocol);
@@ -118,117 +239,869 @@ static int nn_socket_connect(int* fd, const char* name, int af, int protocol)
     return 0;
 }
 
-static void* nn_server_worker(void* arg)
+/* Directory of IPC endpoints of services named without a scheme. */
+#ifndef NN_NUTTX_IPC_DIR
+#define NN_NUTTX_IPC_DIR "/tmp"
+#endif
+
+/* Services bound in this process, by inproc URL. */
+typedef struct nn_nuttx_local {
+    char* url;
+    struct nn_nuttx_local* next;
+} nn_nuttx_local_t;
+
+static pthread_mutex_t nn_nuttx_local_lock = PTHREAD_MUTEX_INITIALIZER;
+static nn_nuttx_local_t* nn_nuttx_locals;
+
+static char* nn_nuttx_url(const char* name, nn_nuttx_trans_type_t trans_type)
 {
-    nn_trans_hdr_t* trans_hdr;
-    nn_trans_data_t trans_data;
-    nn_server_ctx_t* ctx = (nn_server_ctx_t*)arg;
-    pthread_detach(pthread_self());
+    size_t len = strlen(nn_nuttx_trans_prefix_str[trans_type]) + strlen(NN_NUTTX_IPC_DIR) + strlen(name) + 2;
+    char* url = malloc(len);
 
-    if (NULL == ctx) {
+    if (url == NULL) {
         return NULL;
     }
 
-    prctl(PR_SET_NAME, strstr(ctx->name, "//") + 2, NULL, NULL, NULL);
+    if (trans_type == NN_NUTTX_TRANS_TYPE_IPC) {
+        snprintf(url, len, "%s%s/%s", nn_nuttx_trans_prefix_str[trans_type], NN_NUTTX_IPC_DIR, name);
+    } else {
+        snprintf(url, len, "%s%s", nn_nuttx_trans_prefix_str[trans_type], name);
+    }
+
+    return url;
+}
+
+static bool nn_nuttx_is_local(const char* url)
+{
+    nn_nuttx_local_t* it;
+
+    pthread_mutex_lock(&nn_nuttx_local_lock);
+
+    for (it = nn_nuttx_locals; it != NULL; it = it->next) {
+        if (strcmp(it->url, url) == 0) {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&nn_nuttx_local_lock);
+
+    return it != NULL;
+}
+
+static void nn_nuttx_local_add(const char* url)
+{
+    nn_nuttx_local_t* local = malloc(sizeof(nn_nuttx_local_t));
+
+    if (local == NULL || (local->url = strdup(url)) == NULL) {
+        free(local);
+        return;   /* peers will use IPC then */
+    }
+
+    pthread_mutex_lock(&nn_nuttx_local_lock);
+    local->next = nn_nuttx_locals;
+    nn_nuttx_locals = local;
+    pthread_mutex_unlock(&nn_nuttx_local_lock);
+}
+
+static void nn_nuttx_local_del(const char* url)
+{
+    nn_nuttx_local_t** it;
+    nn_nuttx_local_t* local;
+
+    pthread_mutex_lock(&nn_nuttx_local_lock);
+
+    for (it = &nn_nuttx_locals; *it != NULL; it = &(*it)->next) {
+        if (strcmp((*it)->url, url) == 0) {
+            local = *it;
+            *it = local->next;
+            free(local->url);
+            free(local);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&nn_nuttx_local_lock);
+}
+
+/* Binds the service. A name with a scheme, like "tcp://0.0.0.0:5555", is used
+ * as is. A plain name is bound to both inproc and IPC, so that peers in
+ * this process and in others can reach it. Returns the primary URL in
+ * url, to be released with nn_nuttx_unbind. */
+static int nn_nuttx_bind(int* fd, char** url, const char* name, int af, int protocol)
+{
+    char* ipc_url;
+    int ret;
+
+    *fd = -1;
+
+    if (strstr(name, "://") != NULL) {
+        *url = strdup(name);
+        return *url == NULL ? -ENOMEM : -nn_socket_bind(fd, *url, af, protocol);
+    }
+
+    *url = nn_nuttx_url(name, NN_NUTTX_TRANS_TYPE_INPROC);
+    ipc_url = nn_nuttx_url(name, NN_NUTTX_TRANS_TYPE_IPC);
+
+    if (*url == NULL || ipc_url == NULL) {
+        free(ipc_url);
+        return -ENOMEM;
+    }
+
+    ret = -nn_socket_bind(fd, *url, af, protocol);
+
+    if (ret == 0) {
+        if (nn_bind(*fd, ipc_url) < 0) {
+            fprintf(stderr, "%s.%s: %s\n", __func__, ipc_url, nn_strerror(nn_errno()));
+        }
+
+        nn_nuttx_local_add(*url);
+    }
+
+    free(ipc_url);
+
+    return ret;
+}
+
+static void nn_nuttx_unbind(const char* url)
+{
+    if (url != NULL && strncmp(url, nn_nuttx_trans_prefix_str[NN_NUTTX_TRANS_TYPE_INPROC],
+            strlen(nn_nuttx_trans_prefix_str[NN_NUTTX_TRANS_TYPE_INPROC])) == 0) {
+        nn_nuttx_local_del(url);
+    }
+}
+
+/* Picks the URL to connect to: a name with a scheme is used as is, a plain
+ * name is reached over inproc if the service lives in this process and
+ * over IPC otherwise. */
+static char* nn_nuttx_connect_url(const char* name)
+{
+    char* url;
+
+    if (strstr(name, "://") != NULL) {
+        return strdup(name);
+    }
+
+    url = nn_nuttx_url(name, NN_NUTTX_TRANS_TYPE_INPROC);
+
+    if (url != NULL && !nn_nuttx_is_local(url)) {
+        free(url);
+        url = nn_nuttx_url(name, NN_NUTTX_TRANS_TYPE_IPC);
+    }
+
+    return url;
+}
+
+static void nn_nuttx_loop_wakeup(void)
+{
+    char c = 0;
+
+    /* A full pipe is a pending wakeup already. */
+    (void)write(nn_nuttx_loop.wakefd[1], &c, 1);
+}
+
+static void* nn_nuttx_loop_pool_worker(void* arg)
+{
+    nn_nuttx_source_t* src;
+
+    (void)arg;
+    prctl(PR_SET_NAME, "nn_nuttx_pool", NULL, NULL, NULL);
 
     while (1) {
-        int rc;
-        uint8_t* body;
-        void* control = NULL;
-        struct nn_iovec iov;
-        struct nn_msghdr hdr;
+        pthread_mutex_lock(&nn_nuttx_loop.lock);
 
-        memset(&hdr, 0, sizeof(hdr));
-        iov.iov_base = &body;
-        iov.iov_len = NN_MSG;
-        hdr.msg_iov = &iov;
-        hdr.msg_iovlen = 1;
-        hdr.msg_control = &control;
-        hdr.msg_controllen = NN_MSG;
-        rc = nn_recvmsg(ctx->fd, &hdr, 0);
+        while (nn_nuttx_loop.jobs == NULL && !nn_nuttx_loop.stopping) {
+            pthread_cond_wait(&nn_nuttx_loop.pool_cond, &nn_nuttx_loop.lock);
+        }
 
-        if (rc < 0) {
-            fprintf(stderr, "%s: %s\n", __func__, nn_strerror(nn_errno()));
+        src = nn_nuttx_loop.jobs;
 
-            if (nn_errno() == EBADF) {
-                break;   /* Socket closed by another thread. */
-            } else {
-                //TODO timeout or others
-                break;
+        if (src != NULL) {
+            nn_nuttx_loop.jobs = src->job_next;
+
+            if (nn_nuttx_loop.jobs == NULL) {
+                nn_nuttx_loop.jobs_tail = NULL;
             }
         }
 
-        trans_hdr = (nn_trans_hdr_t*)body;
+        pthread_mutex_unlock(&nn_nuttx_loop.lock);
 
-        if (trans_hdr->len + sizeof(nn_trans_hdr_t) != rc) {
-            nn_freemsg(body);
-            nn_freemsg(control);
-            continue;
-        } else {
-            if (ctx->on_trans_cb != NULL) {
-                trans_data.in = (nn_trans_data_t*)(body + sizeof(nn_trans_hdr_t));
-                trans_data.in_size = trans_hdr->len;
-                trans_hdr->op_code = ctx->on_trans_cb(ctx->priv, trans_hdr->op_code, &trans_data);
-            } else {
-                trans_hdr->op_code = 0;
+        if (src == NULL) {
+            break;
+        }
+
+        src->handle(src->ctx, src->body, src->len, src->control);
+
+        pthread_mutex_lock(&nn_nuttx_loop.lock);
+        src->busy = false;
+        pthread_cond_broadcast(&nn_nuttx_loop.cond);
+        pthread_mutex_unlock(&nn_nuttx_loop.lock);
+        nn_nuttx_loop_wakeup();
+    }
+
+    return NULL;
+}
+
+static void* nn_nuttx_loop_worker(void* arg)
+{
+    struct pollfd* pfds = NULL;
+    nn_nuttx_source_t** srcs = NULL;
+    nn_nuttx_source_t* src;
+    int capacity = 0;
+    char drain[16];
+    int n;
+    int i;
+    int j;
+
+    (void)arg;
+    prctl(PR_SET_NAME, "nn_nuttx_loop", NULL, NULL, NULL);
+
+    while (1) {
+        pthread_mutex_lock(&nn_nuttx_loop.lock);
+
+        if (nn_nuttx_loop.stopping) {
+            pthread_mutex_unlock(&nn_nuttx_loop.lock);
+            break;
+        }
+
+        if (capacity < nn_nuttx_loop.nsources + 1) {
+            capacity = nn_nuttx_loop.nsources + 1;
+            pfds = realloc(pfds, capacity * sizeof(struct pollfd));
+            srcs = realloc(srcs, capacity * sizeof(nn_nuttx_source_t*));
+
+            if (pfds == NULL || srcs == NULL) {
+                fprintf(stderr, "%s: %s\n", __func__, strerror(ENOMEM));
+                abort();
             }
+        }
 
-            trans_hdr->len = 0;
+        pfds[0].fd = nn_nuttx_loop.wakefd[0];
+        pfds[0].events = POLLIN;
+        n = 1;
+
+        for (src = nn_nuttx_loop.sources; src != NULL; src = src->next) {
+            if (!src->busy) {
+                pfds[n].fd = src->rcvfd;
+                pfds[n].events = POLLIN;
+                srcs[n] = src;
+                n++;
+            }
         }
 
-        // send response
-        {
-            nn_trans_hdr_t* send_hdr = trans_hdr;
-            void* send_data = NULL;
+        /* Sources removed before this point are not touched any more. */
+        nn_nuttx_loop.gen_seen = nn_nuttx_loop.gen;
+        pthread_cond_broadcast(&nn_nuttx_loop.cond);
+        pthread_mutex_unlock(&nn_nuttx_loop.lock);
+
+        if (poll(pfds, n, -1) < 0) {
+            continue;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            while (read(nn_nuttx_loop.wakefd[0], drain, sizeof(drain)) == sizeof(drain));
+            continue;   /* registry changed, rebuild the poll set */
+        }
+
+        for (i = 1; i < n; i++) {
+            if (!(pfds[i].revents & POLLIN)) {
+                continue;
+            }
+
+            src = srcs[i];
+
+            for (j = 0; j < NN_NUTTX_LOOP_BATCH; j++) {
+                uint8_t* body;
+                void* control = NULL;
+                struct nn_iovec iov;
+                struct nn_msghdr hdr;
+                int rc;
+
+                memset(&hdr, 0, sizeof(hdr));
+                iov.iov_base = &body;
+                iov.iov_len = NN_MSG;
+                hdr.msg_iov = &iov;
+                hdr.msg_iovlen = 1;
+                hdr.msg_control = &control;
+                hdr.msg_controllen = NN_MSG;
+                rc = nn_recvmsg(src->fd, &hdr, NN_DONTWAIT);
+
+                if (rc < 0) {
+                    break;
+                }
+
+                if (nn_nuttx_loop.pool_size == 0) {
+                    src->handle(src->ctx, body, rc, control);
+                    continue;
+                }
+
+                src->body = body;
+                src->control = control;
+                src->len = rc;
+                src->job_next = NULL;
 
-            if (trans_data.out_size > 0 && trans_data.out != NULL) {
-                send_data = calloc(1, sizeof(nn_trans_hdr_t) + trans_data.out_size);
+                pthread_mutex_lock(&nn_nuttx_loop.lock);
+                src->busy = true;
 
-                if (send_data == NULL) {
-                    send_hdr->op_code = -ENOMEM;
-                    send_hdr->len = 0;
+                if (nn_nuttx_loop.jobs_tail == NULL) {
+                    nn_nuttx_loop.jobs = src;
                 } else {
-                    send_hdr = (nn_trans_hdr_t*)send_data;
-                    send_hdr->seq = trans_hdr->seq;
-                    send_hdr->op_code = trans_hdr->op_code;
-                    send_hdr->len = trans_data.out_size;
-                    memcpy(send_data + sizeof(nn_trans_hdr_t), trans_data.out, trans_data.out_size);
+                    nn_nuttx_loop.jobs_tail->job_next = src;
                 }
+
+                nn_nuttx_loop.jobs_tail = src;
+                pthread_cond_signal(&nn_nuttx_loop.pool_cond);
+                pthread_mutex_unlock(&nn_nuttx_loop.lock);
+                break;
             }
+        }
+    }
 
-            iov.iov_base = send_hdr;
-            iov.iov_len = sizeof(nn_trans_hdr_t) + send_hdr->len;
-            hdr.msg_iov = &iov;
-            hdr.msg_iovlen = 1;
-            rc = nn_sendmsg(ctx->fd, &hdr, 0);
+    free(pfds);
+    free(srcs);
 
-            if (rc < 0) {
-                fprintf(stderr, "%s: %s\n", __func__, nn_strerror(nn_errno()));
-                nn_freemsg(control);
+    return NULL;
+}
+
+int nn_nuttx_loop_start(int pool_size)
+{
+    int ret = 0;
+    int i;
+
+    if (pool_size < 0) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&nn_nuttx_loop.lock);
+
+    if (nn_nuttx_loop.running) {
+        ret = -EALREADY;
+        goto out;
+    }
+
+    if (pipe(nn_nuttx_loop.wakefd) < 0) {
+        ret = -errno;
+        goto out;
+    }
+
+    fcntl(nn_nuttx_loop.wakefd[0], F_SETFL, O_NONBLOCK);
+    fcntl(nn_nuttx_loop.wakefd[1], F_SETFL, O_NONBLOCK);
+    nn_nuttx_loop.stopping = false;
+    nn_nuttx_loop.pool_size = 0;
+
+    if (pool_size > 0) {
+        nn_nuttx_loop.pool = calloc(pool_size, sizeof(pthread_t));
+
+        if (nn_nuttx_loop.pool == NULL) {
+            ret = -ENOMEM;
+            goto err;
+        }
+
+        for (i = 0; i < pool_size; i++) {
+            ret = -pthread_create(&nn_nuttx_loop.pool[i], NULL, nn_nuttx_loop_pool_worker, NULL);
+
+            if (ret != 0) {
+                goto err;
             }
 
-            if (trans_data.out != NULL) {
-                free(trans_data.out);
-                trans_data.out = NULL;
-                trans_data.out_size = 0;
+            nn_nuttx_loop.pool_size++;
+        }
+    }
+
+    ret = -pthread_create(&nn_nuttx_loop.tid, NULL, nn_nuttx_loop_worker, NULL);
+
+    if (ret == 0) {
+        nn_nuttx_loop.running = true;
+        goto out;
+    }
+
+err:
+    nn_nuttx_loop.stopping = true;
+    pthread_cond_broadcast(&nn_nuttx_loop.pool_cond);
+    pthread_mutex_unlock(&nn_nuttx_loop.lock);
+
+    for (i = 0; i < nn_nuttx_loop.pool_size; i++) {
+        pthread_join(nn_nuttx_loop.pool[i], NULL);
+    }
+
+    pthread_mutex_lock(&nn_nuttx_loop.lock);
+    free(nn_nuttx_loop.pool);
+    nn_nuttx_loop.pool = NULL;
+    nn_nuttx_loop.pool_size = 0;
+    close(nn_nuttx_loop.wakefd[0]);
+    close(nn_nuttx_loop.wakefd[1]);
+    nn_nuttx_loop.wakefd[0] = nn_nuttx_loop.wakefd[1] = -1;
+out:
+    pthread_mutex_unlock(&nn_nuttx_loop.lock);
+
+    return ret;
+}
+
+int nn_nuttx_loop_stop(void)
+{
+    int i;
+
+    pthread_mutex_lock(&nn_nuttx_loop.lock);
+
+    if (!nn_nuttx_loop.running) {
+        pthread_mutex_unlock(&nn_nuttx_loop.lock);
+        return -EINVAL;
+    }
+
+    if (nn_nuttx_loop.nsources > 0) {
+        pthread_mutex_unlock(&nn_nuttx_loop.lock);
+        return -EBUSY;
+    }
+
+    nn_nuttx_loop.running = false;
+    nn_nuttx_loop.stopping = true;
+    pthread_cond_broadcast(&nn_nuttx_loop.pool_cond);
+    pthread_mutex_unlock(&nn_nuttx_loop.lock);
+
+    nn_nuttx_loop_wakeup();
+    pthread_join(nn_nuttx_loop.tid, NULL);
+
+    for (i = 0; i < nn_nuttx_loop.pool_size; i++) {
+        pthread_join(nn_nuttx_loop.pool[i], NULL);
+    }
+
+    free(nn_nuttx_loop.pool);
+    nn_nuttx_loop.pool = NULL;
+    nn_nuttx_loop.pool_size = 0;
+    close(nn_nuttx_loop.wakefd[0]);
+    close(nn_nuttx_loop.wakefd[1]);
+    nn_nuttx_loop.wakefd[0] = nn_nuttx_loop.wakefd[1] = -1;
+
+    return 0;
+}
+
+/* Hands the socket over to the shared loop. Returns NULL if the loop is
+ * not running, the caller then serves the socket on its own thread. */
+static nn_nuttx_source_t* nn_nuttx_loop_add(int fd, void* ctx, nn_nuttx_handler handle)
+{
+    nn_nuttx_source_t* src;
+    size_t sz = sizeof(int);
+
+    pthread_mutex_lock(&nn_nuttx_loop.lock);
+
+    if (!nn_nuttx_loop.running) {
+        pthread_mutex_unlock(&nn_nuttx_loop.lock);
+        return NULL;
+    }
+
+    src = calloc(1, sizeof(nn_nuttx_source_t));
+
+    if (src == NULL || nn_getsockopt(fd, NN_SOL_SOCKET, NN_RCVFD, &src->rcvfd, &sz) < 0) {
+        pthread_mutex_unlock(&nn_nuttx_loop.lock);
+        free(src);
+        return NULL;
+    }
+
+    src->fd = fd;
+    src->ctx = ctx;
+    src->handle = handle;
+    src->next = nn_nuttx_loop.sources;
+    nn_nuttx_loop.sources = src;
+    nn_nuttx_loop.nsources++;
+    nn_nuttx_loop.gen++;
+    pthread_mutex_unlock(&nn_nuttx_loop.lock);
+    nn_nuttx_loop_wakeup();
+
+    return src;
+}
+
+/* Waits until the loop and the pool are done with the socket. Must not
+ * be called from a callback. */
+static void nn_nuttx_loop_remove(nn_nuttx_source_t* src)
+{
+    nn_nuttx_source_t** it;
+    unsigned gen;
+
+    pthread_mutex_lock(&nn_nuttx_loop.lock);
+
+    for (it = &nn_nuttx_loop.sources; *it != NULL; it = &(*it)->next) {
+        if (*it == src) {
+            *it = src->next;
+            break;
+        }
+    }
+
+    nn_nuttx_loop.nsources--;
+    gen = ++nn_nuttx_loop.gen;
+    nn_nuttx_loop_wakeup();
+
+    while ((int)(nn_nuttx_loop.gen_seen - gen) < 0 || src->busy) {
+        pthread_cond_wait(&nn_nuttx_loop.cond, &nn_nuttx_loop.lock);
+    }
+
+    pthread_mutex_unlock(&nn_nuttx_loop.lock);
+    free(src);
+}
+
+void* nn_trans_alloc(size_t size)
+{
+    uint8_t* msg = nn_allocmsg(sizeof(nn_trans_hdr_t) + size, 0);
+
+    if (msg == NULL) {
+        return NULL;
+    }
+
+    return msg + sizeof(nn_trans_hdr_t);
+}
+
+void nn_trans_free(void* buf)
+{
+    if (buf != NULL) {
+        nn_freemsg((uint8_t*)buf - sizeof(nn_trans_hdr_t));
+    }
+}
+
+/* Turns the request message into the reply message. The payload of the
+ * reply is never copied more than once: an empty reply reuses the request
+ * chunk, an nn_trans_alloc() buffer is sent as is. */
+static void* nn_server_reply_msg(uint8_t* body, nn_trans_data_t* data, int op_code)
+{
+    nn_trans_hdr_t* req_hdr = (nn_trans_hdr_t*)body;
+    nn_trans_hdr_t* rep_hdr;
+    uint8_t* reply = NULL;
+
+    if (data->out != NULL && data->out_size > 0) {
+        if (data->out_msg) {
+            reply = (uint8_t*)data->out - sizeof(nn_trans_hdr_t);
+            reply = nn_reallocmsg(reply, sizeof(nn_trans_hdr_t) + data->out_size);
+
+            /* The message is left untouched if it can't be resized. */
+            if (reply == NULL) {
+                nn_trans_free(data->out);
             }
+        } else {
+            reply = nn_allocmsg(sizeof(nn_trans_hdr_t) + data->out_size, 0);
 
-            if (send_data != NULL) {
-                free(send_data);
+            if (reply != NULL) {
+                memcpy(reply + sizeof(nn_trans_hdr_t), data->out, data->out_size);
             }
+
+            free(data->out);
+        }
+
+        if (reply == NULL) {
+            op_code = -ENOMEM;
+        }
+    } else if (data->out != NULL) {
+        if (data->out_msg) {
+            nn_trans_free(data->out);
+        } else {
+            free(data->out);
+        }
+    }
+
+    data->out = NULL;
+
+    if (reply == NULL) {
+        /* Shrinking the chunk keeps it in place. */
+        reply = nn_reallocmsg(body, sizeof(nn_trans_hdr_t));
+        rep_hdr = (nn_trans_hdr_t*)reply;
+        rep_hdr->op_code = op_code;
+        rep_hdr->len = 0;
+        return reply;
+    }
+
+    rep_hdr = (nn_trans_hdr_t*)reply;
+    rep_hdr->seq = req_hdr->seq;
+    rep_hdr->op_code = op_code;
+    rep_hdr->len = data->out_size;
+    nn_freemsg(body);
+    return reply;
+}
+
+/* Waits for the next request. Returns -1 once nn_server_release wants
+ * the threads gone, or on error. */
+static int nn_server_recv(nn_server_ctx_t* ctx, uint8_t** body, void** control)
+{
+    int rc;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct pollfd pfds[2];
+
+    pfds[0].fd = ctx->wakefd[0];
+    pfds[0].events = POLLIN;
+    pfds[1].fd = ctx->rcvfd;
+    pfds[1].events = POLLIN;
+
+    while (1) {
+        if (poll(pfds, 2, -1) < 0) {
+            continue;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            return -1;
+        }
+
+        if (!(pfds[1].revents & POLLIN)) {
+            continue;
+        }
+
+        *control = NULL;
+        memset(&hdr, 0, sizeof(hdr));
+        iov.iov_base = body;
+        iov.iov_len = NN_MSG;
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = control;
+        hdr.msg_controllen = NN_MSG;
+        rc = nn_recvmsg(ctx->fd, &hdr, NN_DONTWAIT);
+
+        if (rc >= 0) {
+            break;
         }
+
+        /* Another thread may have taken the request. */
+        if (nn_errno() != EAGAIN) {
+            fprintf(stderr, "%s: %s\n", __func__, nn_strerror(nn_errno()));
+            return rc;
+        }
+    }
+
+    if (rc < (int)sizeof(nn_trans_hdr_t) || ((nn_trans_hdr_t*)*body)->len + sizeof(nn_trans_hdr_t) != (size_t)rc) {
+        nn_freemsg(*body);
+        nn_freemsg(*control);
+        *body = NULL;
+    }
+
+    return rc;
+}
+
+/* Runs the callback on a valid request and sends the reply. The request
+ * and its control data are consumed. */
+static void nn_server_handle(nn_server_ctx_t* ctx, uint8_t* body, void* control)
+{
+    int rc;
+    int op_code;
+    void* reply;
+    nn_trans_hdr_t* trans_hdr = (nn_trans_hdr_t*)body;
+    nn_trans_data_t trans_data;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+
+    memset(&trans_data, 0, sizeof(trans_data));
+
+    if (ctx->on_trans_cb != NULL) {
+        trans_data.in = body + sizeof(nn_trans_hdr_t);
+        trans_data.in_size = trans_hdr->len;
+        op_code = ctx->on_trans_cb(ctx->priv, trans_hdr->op_code, &trans_data);
+    } else {
+        op_code = 0;
+    }
+
+    // send response, the message is handed over to nanomsg as is
+    reply = nn_server_reply_msg(body, &trans_data, op_code);
+    memset(&hdr, 0, sizeof(hdr));
+    iov.iov_base = &reply;
+    iov.iov_len = NN_MSG;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = &control;
+    hdr.msg_controllen = NN_MSG;
+    rc = nn_sendmsg(ctx->fd, &hdr, 0);
+
+    if (rc < 0) {
+        fprintf(stderr, "%s: %s\n", __func__, nn_strerror(nn_errno()));
+        nn_freemsg(reply);
+        nn_freemsg(control);
+    }
+}
+
+static void nn_server_loop_handle(void* arg, uint8_t* body, int len, void* control)
+{
+    if (len < (int)sizeof(nn_trans_hdr_t) || ((nn_trans_hdr_t*)body)->len + sizeof(nn_trans_hdr_t) != (size_t)len) {
         nn_freemsg(body);
+        nn_freemsg(control);
+        return;
+    }
+
+    nn_server_handle((nn_server_ctx_t*)arg, body, control);
+}
+
+static void* nn_server_worker(void* arg)
+{
+    nn_server_thread_t* thread = (nn_server_thread_t*)arg;
+    nn_server_ctx_t* ctx = thread->ctx;
+
+    prctl(PR_SET_NAME, strstr(ctx->name, "//") + 2, NULL, NULL, NULL);
+
+    while (1) {
+        uint8_t* body;
+        void* control;
+
+        if (nn_server_recv(ctx, &body, &control) < 0) {
+            break;
+        }
+
+        if (body != NULL) {
+            nn_server_handle(ctx, body, control);
+        }
+    }
+
+    return NULL;
+}
+
+static void* nn_server_ordered_worker(void* arg)
+{
+    nn_server_thread_t* thread = (nn_server_thread_t*)arg;
+    nn_server_job_t* job;
+
+    prctl(PR_SET_NAME, strstr(thread->ctx->name, "//") + 2, NULL, NULL, NULL);
+
+    while (1) {
+        pthread_mutex_lock(&thread->lock);
+
+        while (thread->head == NULL && !thread->closed) {
+            pthread_cond_wait(&thread->cond, &thread->lock);
+        }
+
+        job = thread->head;
+
+        if (job != NULL) {
+            thread->head = job->next;
+
+            if (thread->head == NULL) {
+                thread->tail = NULL;
+            }
+        }
+
+        pthread_mutex_unlock(&thread->lock);
+
+        if (job == NULL) {
+            break;
+        }
+
+        nn_server_handle(thread->ctx, job->body, job->control);
+        free(job);
     }
 
     return NULL;
 }
 
+/* Receives requests for all the ordered workers. Requests with the same
+ * op_code always go to the same worker, which handles them one by one. */
+static void* nn_server_dispatcher(void* arg)
+{
+    nn_server_ctx_t* ctx = (nn_server_ctx_t*)arg;
+    nn_server_thread_t* thread;
+    nn_server_job_t* job;
+
+    prctl(PR_SET_NAME, strstr(ctx->name, "//") + 2, NULL, NULL, NULL);
+
+    while (1) {
+        uint8_t* body;
+        void* control;
+
+        if (nn_server_recv(ctx, &body, &control) < 0) {
+            break;
+        }
+
+        if (body == NULL) {
+            continue;
+        }
+
+        job = malloc(sizeof(nn_server_job_t));
+
+        if (job == NULL) {
+            nn_freemsg(body);
+            nn_freemsg(control);
+            continue;
+        }
+
+        job->body = body;
+        job->control = control;
+        job->next = NULL;
+        thread = &ctx->threads[(unsigned)((nn_trans_hdr_t*)body)->op_code % ctx->workers];
+
+        pthread_mutex_lock(&thread->lock);
+
+        if (thread->tail == NULL) {
+            thread->head = job;
+        } else {
+            thread->tail->next = job;
+        }
+
+        thread->tail = job;
+        pthread_cond_signal(&thread->cond);
+        pthread_mutex_unlock(&thread->lock);
+    }
+
+    return NULL;
+}
+
+/* Stops receiving, drops the requests not handled yet and waits for the
+ * callbacks in progress. The socket is closed last, as the workers reply
+ * through it until they return. */
+static void nn_server_stop(nn_server_ctx_t* ctx, int started)
+{
+    nn_server_thread_t* thread;
+    nn_server_job_t* job;
+    char c = 0;
+    int i;
+
+    if (ctx->wakefd[1] >= 0) {
+        (void)write(ctx->wakefd[1], &c, 1);
+    }
+
+    if (ctx->op_ordered) {
+        pthread_join(ctx->tid, NULL);
+    }
+
+    for (i = 0; i < ctx->workers; i++) {
+        thread = &ctx->threads[i];
+        pthread_mutex_lock(&thread->lock);
+
+        while (thread->head != NULL) {
+            job = thread->head;
+            thread->head = job->next;
+            nn_freemsg(job->body);
+            nn_freemsg(job->control);
+            free(job);
+        }
+
+        thread->tail = NULL;
+        thread->closed = true;
+        pthread_cond_signal(&thread->cond);
+        pthread_mutex_unlock(&thread->lock);
+    }
+
+    for (i = 0; i < started; i++) {
+        pthread_join(ctx->threads[i].tid, NULL);
+    }
+
+    for (i = 0; i < ctx->workers; i++) {
+        pthread_mutex_destroy(&ctx->threads[i].lock);
+        pthread_cond_destroy(&ctx->threads[i].cond);
+    }
+
+    if (ctx->fd >= 0) {
+        nn_close(ctx->fd);
+        ctx->fd = -1;
+    }
+
+    if (ctx->wakefd[0] >= 0) {
+        close(ctx->wakefd[0]);
+        close(ctx->wakefd[1]);
+        ctx->wakefd[0] = ctx->wakefd[1] = -1;
+    }
+}
+
 void* nn_server_create(const char* name)
+{
+    return nn_server_create_ex(name, NULL);
+}
+
+void* nn_server_create_ex(const char* name, const nn_server_attr_t* attr)
 {
     nn_server_ctx_t* ctx = NULL;
-    const nn_nuttx_trans_type_t trans_type = NN_NUTTX_TRANS_TYPE_INPROC;
     int name_len = strlen(name);
+    int workers = attr != NULL && attr->workers > 0 ? attr->workers : 1;
     int ret = 0;
+    size_t sz;
+    int started;
+    int i;
 
     if (name_len <= 0) {
         ret = -EINVAL;
@@ -243,41 +1116,97 @@ void* nn_server_create(const char* name)
     }
 
     ctx->fd = -1;
-    ctx->name = calloc(1, strlen(nn_nuttx_trans_prefix_str[trans_type]) + name_len + 1);
+    ctx->wakefd[0] = ctx->wakefd[1] = -1;
+    ctx->threads = calloc(workers, sizeof(nn_server_thread_t));
 
-    if (ctx->name == NULL) {
+    if (ctx->threads == NULL) {
         ret = -ENOMEM;
         goto err;
     }
 
-    strcpy(ctx->name, nn_nuttx_trans_prefix_str[trans_type]);
-    strcat(ctx->name, name);
+    ret = nn_nuttx_bind(&ctx->fd, &ctx->name, name, AF_SP_RAW, NN_REP);
 
-    ret = nn_socket_bind(&ctx->fd, ctx->name, AF_SP_RAW, NN_REP);
+    if (ret != 0) {
+        goto err;
+    }
+
+    /* A single worker may as well be the shared loop, if it's running. */
+    if (workers == 1) {
+        ctx->source = nn_nuttx_loop_add(ctx->fd, ctx, nn_server_loop_handle);
+
+        if (ctx->source != NULL) {
+            ctx->actived = true;
+            return ctx;
+        }
+    }
+
+    if (pipe(ctx->wakefd) < 0) {
+        ret = -errno;
+        goto err;
+    }
+
+    fcntl(ctx->wakefd[1], F_SETFL, O_NONBLOCK);
+    sz = sizeof(ctx->rcvfd);
+    ret = nn_getsockopt(ctx->fd, NN_SOL_SOCKET, NN_RCVFD, &ctx->rcvfd, &sz);
 
     if (ret < 0) {
+        ret = -nn_errno();
         goto err;
     }
 
+    /* With a single worker requests are handled in order anyway. */
+    ctx->workers = workers;
+    ctx->op_ordered = attr != NULL && attr->op_ordered && workers > 1;
     ctx->actived = true;
-    ret = pthread_create(&ctx->tid, NULL, nn_server_worker, (void*)ctx);
+
+    for (i = 0; i < workers; i++) {
+        ctx->threads[i].ctx = ctx;
+        pthread_mutex_init(&ctx->threads[i].lock, NULL);
+        pthread_cond_init(&ctx->threads[i].cond, NULL);
+    }
+
+    for (i = 0; i < workers; i++) {
+        ret = -pthread_create(&ctx->threads[i].tid, NULL,
+                ctx->op_ordered ? nn_server_ordered_worker : nn_server_worker, &ctx->threads[i]);
+
+        if (ret != 0) {
+            break;
+        }
+    }
+
+    started = i;
+
+    if (ret == 0 && ctx->op_ordered) {
+        ret = -pthread_create(&ctx->tid, NULL, nn_server_dispatcher, (void*)ctx);
+    }
 
     if (0 == ret) {
         return ctx;
     }
 
+    /* There's no dispatcher to join. */
+    ctx->op_ordered = false;
+    nn_server_stop(ctx, started);
+
 err:
-    fprintf(stderr, "%s.ret=%d(%s)\n", __func__, ret, nn_strerror(ret));
+    fprintf(stderr, "%s.ret=%d(%s)\n", __func__, ret, nn_strerror(-ret));
 
     if (ctx != NULL) {
-        if (ctx->fd != 0) {
+        if (ctx->fd >= 0) {
             nn_close(ctx->fd);
         }
 
+        if (ctx->wakefd[0] >= 0) {
+            close(ctx->wakefd[0]);
+            close(ctx->wakefd[1]);
+        }
+
         if (ctx->name != NULL) {
+            nn_nuttx_unbind(ctx->name);
             free(ctx->name);
         }
 
+        free(ctx->threads);
         free(ctx);
     }
 
@@ -299,20 +1228,25 @@ int nn_server_release(void* nn_server_ctx)
         nn_server_ctx_t* ctx = (nn_server_ctx_t*)nn_server_ctx;
         ctx->actived = false;
 
-        if (ctx->fd >= 0) {
-            nn_close(ctx->fd);
-            ctx->fd = -1;
+        if (ctx->source != NULL) {
+            nn_nuttx_loop_remove(ctx->source);
+            ctx->source = NULL;
         }
 
-        pthread_join(ctx->tid, NULL);
+        nn_server_stop(ctx, ctx->workers);
 
         if (ctx->name != NULL) {
+            nn_nuttx_unbind(ctx->name);
             free(ctx->name);
             ctx->name = NULL;
         }
 
+        free(ctx->threads);
         free(ctx);
+        return 0;
     }
+
+    return -EINVAL;
 }
 
 
@@ -321,31 +1255,30 @@ void* nn_client_connect(const char* server_name)
     int ret = 0;
     nn_client_ctx_t* ctx = NULL;
     int name_len = strlen(server_name);
-    const nn_nuttx_trans_type_t trans_type = NN_NUTTX_TRANS_TYPE_INPROC;
 
     if (name_len <= 0) {
         ret = -EINVAL;
         goto err;
     }
 
-    ctx = calloc(1, sizeof(nn_server_ctx_t));
+    ctx = calloc(1, sizeof(nn_client_ctx_t));
 
     if (ctx == NULL) {
         ret = -ENOMEM;
         goto err;
     }
 
-    ctx->name = calloc(1, strlen(nn_nuttx_trans_prefix_str[trans_type]) + name_len + 1);
+    ctx->fd = -1;
+    ctx->async_fd = -1;
+    pthread_mutex_init(&ctx->lock, NULL);
+    ctx->name = nn_nuttx_connect_url(server_name);
 
     if (ctx->name == NULL) {
         ret = -ENOMEM;
         goto err;
     }
 
-    strcpy(ctx->name, nn_nuttx_trans_prefix_str[trans_type]);
-    strcat(ctx->name, server_name);
-
-    ret = nn_socket_connect(&ctx->fd, ctx->name, AF_SP, NN_REQ);
+    ret = -nn_socket_connect(&ctx->fd, ctx->name, AF_SP, NN_REQ);
 
     if (ret < 0) {
         goto err;
@@ -357,7 +1290,7 @@ err:
     fprintf(stderr, "%s.ret=%d(%s)\n", __func__, ret, nn_strerror(ret));
 
     if (ctx != NULL) {
-        if (ctx->fd != 0) {
+        if (ctx->fd >= 0) {
             nn_close(ctx->fd);
         }
 
@@ -365,107 +1298,362 @@ err:
             free(ctx->name);
         }
 
+        pthread_mutex_destroy(&ctx->lock);
         free(ctx);
     }
 
     return NULL;
 }
 
+static nn_client_pending_t* nn_client_pending_take(nn_client_ctx_t* ctx, uint32_t seq)
+{
+    nn_client_pending_t* prev = NULL;
+    nn_client_pending_t* it;
+
+    pthread_mutex_lock(&ctx->lock);
+
+    for (it = ctx->pending; it != NULL; prev = it, it = it->next) {
+        if (it->seq == seq) {
+            if (prev == NULL) {
+                ctx->pending = it->next;
+            } else {
+                prev->next = it->next;
+            }
+
+            if (ctx->pending_tail == it) {
+                ctx->pending_tail = prev;
+            }
+
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&ctx->lock);
+
+    return it;
+}
+
+static void nn_client_free(nn_client_ctx_t* ctx);
+
+static void* nn_client_async_worker(void* arg)
+{
+    nn_client_ctx_t* ctx = (nn_client_ctx_t*)arg;
+    nn_client_pending_t* pending;
+    nn_trans_hdr_t* trans_hdr;
+
+    prctl(PR_SET_NAME, strstr(ctx->name, "//") + 2, NULL, NULL, NULL);
+
+    while (1) {
+        int rc;
+        uint8_t* body;
+
+        rc = nn_recv(ctx->async_fd, &body, NN_MSG, 0);
+
+        if (rc < 0) {
+            if (nn_errno() != EBADF) {
+                fprintf(stderr, "%s: %s\n", __func__, nn_strerror(nn_errno()));
+            }
+
+            break;   /* Socket closed by nn_client_disconnect. */
+        }
+
+        trans_hdr = (nn_trans_hdr_t*)body;
+
+        if (rc < (int)sizeof(nn_trans_hdr_t) || trans_hdr->len + sizeof(nn_trans_hdr_t) != (size_t)rc) {
+            nn_freemsg(body);
+            continue;
+        }
+
+        pending = nn_client_pending_take(ctx, (uint32_t)trans_hdr->seq);
+
+        if (pending != NULL) {
+            pending->cb(pending->cookie, trans_hdr->op_code, body + sizeof(nn_trans_hdr_t), trans_hdr->len);
+            free(pending);
+        }
+
+        nn_freemsg(body);
+
+        if (ctx->closing) {
+            /* Nobody is going to join this thread. */
+            pthread_detach(pthread_self());
+            nn_close(ctx->async_fd);
+            ctx->async_fd = -1;
+            nn_client_free(ctx);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static int nn_client_async_open(nn_client_ctx_t* ctx)
+{
+    int ret;
+
+    if (ctx->async_fd >= 0) {
+        return 0;
+    }
+
+    /* Raw REQ socket leaves request IDs to us, so that any number of
+     * requests can be in flight. */
+    ret = nn_socket_connect(&ctx->async_fd, ctx->name, AF_SP_RAW, NN_REQ);
+
+    if (ret == 0) {
+        ret = pthread_create(&ctx->async_tid, NULL, nn_client_async_worker, (void*)ctx);
+
+        if (ret == 0) {
+            return 0;
+        }
+    }
+
+    if (ctx->async_fd >= 0) {
+        nn_close(ctx->async_fd);
+        ctx->async_fd = -1;
+    }
+
+    return -ret;
+}
+
+/* Releases the client once the thread receiving async replies is gone,
+ * or is the caller. */
+static void nn_client_free(nn_client_ctx_t* ctx)
+{
+    nn_client_pending_t* pending;
+
+    /* Requests left without reply are completed with an error. */
+    while (ctx->pending != NULL) {
+        pending = ctx->pending;
+        ctx->pending = pending->next;
+        pending->cb(pending->cookie, -ECANCELED, NULL, 0);
+        free(pending);
+    }
+
+    if (ctx->name != NULL) {
+        free(ctx->name);
+        ctx->name = NULL;
+    }
+
+    if (ctx->fd >= 0) {
+        nn_close(ctx->fd);
+        ctx->fd = -1;
+    }
+
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
+}
+
 int nn_client_disconnect(void* nn_client_ctx)
 {
     if (nn_client_ctx != NULL) {
         nn_client_ctx_t* ctx = (nn_client_ctx_t*)nn_client_ctx;
 
-        if (ctx->name != NULL) {
-            free(ctx->name);
-            ctx->name = NULL;
-        }
+        if (ctx->async_fd >= 0) {
+            /* The thread can't join itself, it disconnects once the reply
+             * callback calling us returns. */
+            if (pthread_equal(pthread_self(), ctx->async_tid)) {
+                ctx->closing = true;
+                return 0;
+            }
 
-        if (ctx->fd > 0) {
-            nn_close(ctx->fd);
-            ctx->fd = -1;
+            nn_close(ctx->async_fd);
+            pthread_join(ctx->async_tid, NULL);
+            ctx->async_fd = -1;
         }
 
-        free(ctx);
+        nn_client_free(ctx);
     }
+
+    return 0;
 }
 
-int nn_client_transaction(const void* nn_client_ctx, int op_code, const void* in, int in_len, void* out, int out_len)
+static int nn_client_send_request(int fd, uint32_t seq, int op_code, const void* in, int in_len, bool raw)
 {
-    int ret = 0;
     nn_trans_hdr_t* trans_hdr;
-    int data_len = sizeof(nn_trans_hdr_t) + in_len;
-    nn_client_ctx_t* ctx = (nn_client_ctx_t*)nn_client_ctx;
-    uint8_t* body = NULL;
-    void* control = NULL;
+    uint8_t* msg;
+    int ret;
     struct nn_iovec iov;
     struct nn_msghdr hdr;
-    void* data;
+    struct nn_cmsghdr* cmsg;
+    uint8_t control[NN_CMSG_SPACE(sizeof(size_t) + sizeof(uint32_t))];
 
-    if (NULL == ctx) {
-        ret = -EINVAL;
-        goto out;
+    if (in_len < 0 || (in == NULL && in_len > 0)) {
+        return -EINVAL;
     }
 
-    data = calloc(1, data_len);
+    /* Build the request in place, nn_send takes the chunk over. */
+    msg = nn_allocmsg(sizeof(nn_trans_hdr_t) + in_len, 0);
 
-    if (data == NULL) {
-        ret = -ENOMEM;
-        goto out;
+    if (msg == NULL) {
+        return -ENOMEM;
     }
 
-    trans_hdr = (nn_trans_hdr_t*)data;
-    trans_hdr->len = in_len;
+    trans_hdr = (nn_trans_hdr_t*)msg;
+    trans_hdr->seq = (int)seq;
     trans_hdr->op_code = op_code;
+    trans_hdr->len = in_len;
 
-    if (in != NULL && in_len > 0) {
-        memcpy(data + sizeof(nn_trans_hdr_t), in, in_len);
-    }
-
-    ret = nn_send(ctx->fd, data, data_len, 0);
-
-    if (ret < 0) {
-        fprintf(stderr, "%s: %s\n", __func__, nn_strerror(nn_errno()));
-        goto out;
+    if (in_len > 0) {
+        memcpy(msg + sizeof(nn_trans_hdr_t), in, in_len);
     }
 
     memset(&hdr, 0, sizeof(hdr));
-    iov.iov_base = &body;
+    iov.iov_base = &msg;
     iov.iov_len = NN_MSG;
     hdr.msg_iov = &iov;
     hdr.msg_iovlen = 1;
-    hdr.msg_control = &control;
-    hdr.msg_controllen = NN_MSG;
 
-    ret = nn_recvmsg(ctx->fd, &hdr, 0);
+    if (raw) {
+        /* SP header of a raw request is just the request ID, with the top
+         * bit set to mark the end of the backtrace. */
+        size_t sp_len = sizeof(uint32_t);
+        uint32_t id = seq | 0x80000000;
+
+        memset(control, 0, sizeof(control));
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof(control);
+        cmsg = NN_CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = PROTO_SP;
+        cmsg->cmsg_type = SP_HDR;
+        cmsg->cmsg_len = NN_CMSG_LEN(sizeof(size_t) + sizeof(uint32_t));
+        memcpy(NN_CMSG_DATA(cmsg), &sp_len, sizeof(size_t));
+        NN_CMSG_DATA(cmsg)[sizeof(size_t)] = (uint8_t)(id >> 24);
+        NN_CMSG_DATA(cmsg)[sizeof(size_t) + 1] = (uint8_t)(id >> 16);
+        NN_CMSG_DATA(cmsg)[sizeof(size_t) + 2] = (uint8_t)(id >> 8);
+        NN_CMSG_DATA(cmsg)[sizeof(size_t) + 3] = (uint8_t)id;
+    }
+
+    ret = nn_sendmsg(fd, &hdr, 0);
 
     if (ret < 0) {
-        fprintf(stderr, "client_recv: %s\n", nn_strerror(nn_errno()));
-        goto out;
+        ret = -nn_errno();
+        fprintf(stderr, "%s: %s\n", __func__, nn_strerror(-ret));
+        nn_freemsg(msg);
+        return ret;
     }
 
+    return 0;
+}
 
-    if (ret < sizeof(nn_trans_hdr_t)) {
-        ret = -EINVAL;
+int nn_client_transaction_borrow(const void* nn_client_ctx, int op_code, const void* in, int in_len, nn_trans_reply_t* reply)
+{
+    int ret;
+    nn_trans_hdr_t* trans_hdr;
+    nn_client_ctx_t* ctx = (nn_client_ctx_t*)nn_client_ctx;
+    uint8_t* body = NULL;
+
+    if (NULL == reply) {
+        return -EINVAL;
+    }
+
+    memset(reply, 0, sizeof(*reply));
+
+    if (NULL == ctx) {
+        return -EINVAL;
+    }
+
+    ret = nn_client_send_request(ctx->fd, 0, op_code, in, in_len, false);
+
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = nn_recv(ctx->fd, &body, NN_MSG, 0);
+
+    if (ret < 0) {
+        ret = -nn_errno();
+        fprintf(stderr, "client_recv: %s\n", nn_strerror(-ret));
+        return ret;
+    }
+
+    trans_hdr = (nn_trans_hdr_t*)body;
+
+    if (ret < (int)sizeof(nn_trans_hdr_t) || trans_hdr->len + sizeof(nn_trans_hdr_t) != (size_t)ret) {
+        nn_freemsg(body);
+        return -EINVAL;
+    }
+
+    reply->data = body + sizeof(nn_trans_hdr_t);
+    reply->size = trans_hdr->len;
+    reply->msg = body;
+
+    return trans_hdr->op_code;
+}
+
+int nn_client_transaction_async(void* nn_client_ctx, int op_code, const void* in, int in_len, on_transaction_reply cb, void* cookie)
+{
+    int ret;
+    nn_client_ctx_t* ctx = (nn_client_ctx_t*)nn_client_ctx;
+    nn_client_pending_t* pending;
+    uint32_t seq;
+
+    if (NULL == ctx || NULL == cb) {
+        return -EINVAL;
+    }
+
+    pending = calloc(1, sizeof(nn_client_pending_t));
+
+    if (pending == NULL) {
+        return -ENOMEM;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    ret = nn_client_async_open(ctx);
+
+    if (ret < 0) {
+        pthread_mutex_unlock(&ctx->lock);
+        free(pending);
+        return ret;
+    }
+
+    /* Register the request before sending it, the reply may arrive before
+     * nn_sendmsg returns. */
+    seq = ctx->seq++ & 0x7fffffff;
+    pending->seq = seq;
+    pending->cb = cb;
+    pending->cookie = cookie;
+
+    if (ctx->pending_tail == NULL) {
+        ctx->pending = pending;
     } else {
-        trans_hdr = (nn_trans_hdr_t*)body;
+        ctx->pending_tail->next = pending;
+    }
 
-        if (out != NULL && out_len > 0 && ret > sizeof(nn_trans_hdr_t)) {
-            memcpy(out, body + sizeof(nn_trans_hdr_t), out_len > trans_hdr->len ? trans_hdr->len : out_len);
-        }
+    ctx->pending_tail = pending;
+    pthread_mutex_unlock(&ctx->lock);
+
+    ret = nn_client_send_request(ctx->async_fd, seq, op_code, in, in_len, true);
 
-        ret = trans_hdr->op_code;
+    if (ret < 0 && nn_client_pending_take(ctx, seq) == pending) {
+        free(pending);
     }
 
-out:
+    return ret;
+}
 
-    if (data != NULL) {
-        free(data);
+void nn_trans_reply_free(nn_trans_reply_t* reply)
+{
+    if (reply != NULL && reply->msg != NULL) {
+        nn_freemsg(reply->msg);
+        memset(reply, 0, sizeof(*reply));
     }
-    if (control != NULL) {
-        nn_freemsg(control);
+}
+
+int nn_client_transaction(const void* nn_client_ctx, int op_code, const void* in, int in_len, void* out, int out_len)
+{
+    int ret;
+    nn_trans_reply_t reply;
+
+    ret = nn_client_transaction_borrow(nn_client_ctx, op_code, in, in_len, &reply);
+
+    if (reply.msg == NULL) {
+        return ret;
     }
-    nn_freemsg(body);
+
+    if (out != NULL && out_len > 0 && reply.size > 0) {
+        memcpy(out, reply.data, (size_t)out_len > reply.size ? reply.size : (size_t)out_len);
+    }
+
+    nn_trans_reply_free(&reply);
 
     return ret;
 }
@@ -475,14 +1663,13 @@ void* nn_pub_create(const char* name)
     int ret = 0;
     nn_pub_ctx_t* ctx = NULL;
     int name_len = strlen(name);
-    const nn_nuttx_trans_type_t trans_type = NN_NUTTX_TRANS_TYPE_INPROC;
 
     if (name_len <= 0) {
         ret = -EINVAL;
         goto err;
     }
 
-    ctx = calloc(1, sizeof(nn_server_ctx_t));
+    ctx = calloc(1, sizeof(nn_pub_ctx_t));
 
     if (ctx == NULL) {
         ret = -ENOMEM;
@@ -490,17 +1677,7 @@ void* nn_pub_create(const char* name)
     }
 
     ctx->fd = -1;
-    ctx->name = calloc(1, strlen(nn_nuttx_trans_prefix_str[trans_type]) + name_len + 1);
-
-    if (ctx->name == NULL) {
-        ret = -ENOMEM;
-        goto err;
-    }
-
-    strcpy(ctx->name, nn_nuttx_trans_prefix_str[trans_type]);
-    strcat(ctx->name, name);
-
-    ret = nn_socket_bind(&ctx->fd, ctx->name, AF_SP, NN_PUB);
+    ret = nn_nuttx_bind(&ctx->fd, &ctx->name, name, AF_SP, NN_PUB);
 
     if (ret < 0) {
         goto err;
@@ -511,11 +1688,12 @@ err:
     fprintf(stderr, "%s.ret=%d(%s)\n", __func__, ret, nn_strerror(ret));
 
     if (ctx != NULL) {
-        if (ctx->fd != 0) {
+        if (ctx->fd >= 0) {
             nn_close(ctx->fd);
         }
 
         if (ctx->name != NULL) {
+            nn_nuttx_unbind(ctx->name);
             free(ctx->name);
         }
 
@@ -536,12 +1714,16 @@ int nn_pub_release(void* nn_pub_ctx)
         }
 
         if (ctx->name != NULL) {
+            nn_nuttx_unbind(ctx->name);
             free(ctx->name);
             ctx->name = NULL;
         }
 
         free(ctx);
+        return 0;
     }
+
+    return -EINVAL;
 }
 
 
@@ -549,39 +1731,90 @@ int nn_pub_release(void* nn_pub_ctx)
 int nn_pub_topic_msg(void* nn_pub_ctx, const void* topic, size_t topic_len, const void* content, size_t content_len)
 {
     int ret = 0;
-    int send_len = 0;
+    size_t send_len = 0;
     nn_pub_ctx_t* ctx = (nn_pub_ctx_t*)nn_pub_ctx;
-    nn_nuttx_topic_t* topic_data;
+    uint8_t* msg;
 
     if(topic == NULL || ctx == NULL || ctx->fd < 0 /*|| ctx->proto != NN_PUB*/) {
         return -EINVAL;
     }
 
-    send_len = sizeof(nn_nuttx_topic_t) + content_len;
-    topic_data = (nn_nuttx_topic_t*)calloc(1, send_len);
-    if (topic_data == NULL) {
+    if (topic_len > NN_NUTTX_TOPIC_LEN_MAX || (content == NULL && content_len > 0)) {
+        return -EINVAL;
+    }
+
+    send_len = topic_len + content_len + NN_NUTTX_TOPIC_LEN_SIZE;
+    msg = nn_allocmsg(send_len, 0);
+
+    if (msg == NULL) {
         return -ENOMEM;
     }
-    memcpy(topic_data->topic, topic, topic_len > NN_NUTTX_TOPIC_NAME_LEN? NN_NUTTX_TOPIC_NAME_LEN : topic_len);
-    topic_data->content_len = content_len;
-    memcpy(topic_data->content, content, content_len);
 
-    ret = nn_send(ctx->fd, topic_data, send_len, 0);
-    free(topic_data);
+    memcpy(msg, topic, topic_len);
+
+    if (content_len > 0) {
+        memcpy(msg + topic_len, content, content_len);
+    }
+
+    msg[send_len - 2] = (uint8_t)(topic_len >> 8);
+    msg[send_len - 1] = (uint8_t)topic_len;
 
-    if (ret != send_len) {
-        fprintf(stderr, "%s.ret=%d, send_len=%d\n", __func__, ret, send_len);
+    ret = nn_send(ctx->fd, &msg, NN_MSG, 0);
+
+    if (ret < 0) {
+        fprintf(stderr, "%s.ret=%d, send_len=%zu\n", __func__, ret, send_len);
+        nn_freemsg(msg);
         return -1;
     }
 
     return 0;
 }
 
+/* Whether a registered topic is a prefix of the topic of a message. The
+ * socket only checked it against the topic followed by the content. */
+static bool nn_sub_match(nn_sub_ctx_t* ctx, const uint8_t* topic, size_t topic_len)
+{
+    nn_sub_topic_t* it;
+    bool match = false;
+
+    pthread_mutex_lock(&ctx->lock);
+
+    for (it = ctx->topics; it != NULL; it = it->next) {
+        if (it->len <= topic_len && memcmp(it->data, topic, it->len) == 0) {
+            match = true;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&ctx->lock);
+    return match;
+}
+
+static void nn_sub_handle(void* arg, uint8_t* body, int len, void* control)
+{
+    nn_sub_ctx_t* ctx = (nn_sub_ctx_t*)arg;
+    size_t topic_len;
+
+    if (len < NN_NUTTX_TOPIC_LEN_SIZE) {
+        fprintf(stderr, "%s.len=%d\n", __func__, len);
+    } else {
+        topic_len = ((size_t)body[len - 2] << 8) | body[len - 1];
+
+        if (topic_len > (size_t)len - NN_NUTTX_TOPIC_LEN_SIZE) {
+            fprintf(stderr, "%s.topic_len=%zu, len=%d\n", __func__, topic_len, len);
+        } else if (ctx->listener != NULL && nn_sub_match(ctx, body, topic_len)) {
+            ctx->listener(ctx->priv, body, topic_len, body + topic_len,
+                    len - NN_NUTTX_TOPIC_LEN_SIZE - topic_len);
+        }
+    }
+
+    nn_freemsg(body);
+    nn_freemsg(control);
+}
+
 static void* nn_sub_worker(void* arg)
 {
-    nn_nuttx_topic_t* topic;
     nn_sub_ctx_t* ctx = (nn_sub_ctx_t*)arg;
-    pthread_detach(pthread_self());
 
     if (NULL == ctx) {
         return NULL;
@@ -606,28 +1839,14 @@ static void* nn_sub_worker(void* arg)
         rc = nn_recvmsg(ctx->fd, &hdr, 0);
 
         if (rc < 0) {
-            fprintf(stderr, "%s: %s\n", __func__, nn_strerror(nn_errno()));
-
-            if (nn_errno() == EBADF) {
-                break;   /* Socket closed by another thread. */
-            } else {
-                //TODO timeout or others
-                break;
+            if (nn_errno() != EBADF) {
+                fprintf(stderr, "%s: %s\n", __func__, nn_strerror(nn_errno()));
             }
-        }
-
-        topic = (nn_nuttx_topic_t*)body;
 
-        if (sizeof(nn_nuttx_topic_t) + topic->content_len != rc) {
-            fprintf(stderr, "%s.content_len=%lu, rc=%d\n", __func__, topic->content_len, rc);
-        } else {
-            if (ctx->listener != NULL) {
-                void* content = body + sizeof(nn_nuttx_topic_t);
-                ctx->listener(ctx->priv, topic->topic, NN_NUTTX_TOPIC_NAME_LEN, content, topic->content_len);
-            }
+            break;   /* Socket closed by nn_sub_disconnect, or other error. */
         }
-        nn_freemsg(body);
-        nn_freemsg(control);
+
+        nn_sub_handle(ctx, body, rc, control);
     }
 
     return NULL;
@@ -638,7 +1857,6 @@ void* nn_sub_connect(const char* name, on_topic_listener listener, void* listene
     int ret = 0;
     nn_sub_ctx_t* ctx = NULL;
     int name_len = strlen(name);
-    const nn_nuttx_trans_type_t trans_type = NN_NUTTX_TRANS_TYPE_INPROC;
 
     if (name_len <= 0) {
         ret = -EINVAL;
@@ -652,17 +1870,16 @@ void* nn_sub_connect(const char* name, on_topic_listener listener, void* listene
         goto err;
     }
 
-    ctx->name = calloc(1, strlen(nn_nuttx_trans_prefix_str[trans_type]) + name_len + 1);
+    ctx->fd = -1;
+    pthread_mutex_init(&ctx->lock, NULL);
+    ctx->name = nn_nuttx_connect_url(name);
 
     if (ctx->name == NULL) {
         ret = -ENOMEM;
         goto err;
     }
 
-    strcpy(ctx->name, nn_nuttx_trans_prefix_str[trans_type]);
-    strcat(ctx->name, name);
-
-    ret = nn_socket_connect(&ctx->fd, ctx->name, AF_SP, NN_SUB);
+    ret = -nn_socket_connect(&ctx->fd, ctx->name, AF_SP, NN_SUB);
 
     if (ret < 0) {
         goto err;
@@ -671,6 +1888,12 @@ void* nn_sub_connect(const char* name, on_topic_listener listener, void* listene
     ctx->listener = listener;
     ctx->priv = listener_priv;
 
+    ctx->source = nn_nuttx_loop_add(ctx->fd, ctx, nn_sub_handle);
+
+    if (ctx->source != NULL) {
+        return ctx;
+    }
+
     ret = pthread_create(&ctx->tid, NULL, nn_sub_worker, (void*)ctx);
 
     if (0 == ret) {
@@ -681,7 +1904,7 @@ err:
     fprintf(stderr, "%s.ret=%d(%s)\n", __func__, ret, nn_strerror(ret));
 
     if (ctx != NULL) {
-        if (ctx->fd != 0) {
+        if (ctx->fd >= 0) {
             nn_close(ctx->fd);
         }
 
@@ -689,6 +1912,7 @@ err:
             free(ctx->name);
         }
 
+        pthread_mutex_destroy(&ctx->lock);
         free(ctx);
     }
 
@@ -701,18 +1925,33 @@ void nn_sub_disconnect(void* nn_sub_ctx)
         nn_sub_ctx_t* ctx = (nn_sub_ctx_t*)nn_sub_ctx;
         ctx->actived = false;
 
+        if (ctx->source != NULL) {
+            nn_nuttx_loop_remove(ctx->source);
+        }
+
         if (ctx->fd >= 0) {
             nn_close(ctx->fd);
             ctx->fd = -1;
         }
 
-        pthread_join(ctx->tid, NULL);
+        if (ctx->source == NULL) {
+            pthread_join(ctx->tid, NULL);
+        }
+
+        ctx->source = NULL;
 
         if (ctx->name != NULL) {
             free(ctx->name);
             ctx->name = NULL;
         }
 
+        while (ctx->topics != NULL) {
+            nn_sub_topic_t* topic = ctx->topics;
+            ctx->topics = topic->next;
+            free(topic);
+        }
+
+        pthread_mutex_destroy(&ctx->lock);
         free(ctx);
     }
 }
@@ -722,21 +1961,38 @@ int nn_sub_register_topic(void* nn_sub_ctx, const void* topic, size_t topic_len)
 {
     int ret = 0;
     nn_sub_ctx_t* ctx = (nn_sub_ctx_t*)nn_sub_ctx;
+    nn_sub_topic_t* entry;
 
     if (topic == NULL || ctx == NULL || ctx->fd < 0 /* || ctx->proto != NN_SUB*/) {
         return -EINVAL;
     }
 
-    if (topic_len > NN_NUTTX_TOPIC_NAME_LEN) {
-        fprintf(stderr, "%s.topic len(%lu) > max(%d)\n", __func__, topic_len, NN_NUTTX_TOPIC_NAME_LEN);
-        topic_len = NN_NUTTX_TOPIC_NAME_LEN;
+    if (topic_len > NN_NUTTX_TOPIC_LEN_MAX) {
+        fprintf(stderr, "%s.topic len(%zu) > max(%d)\n", __func__, topic_len, NN_NUTTX_TOPIC_LEN_MAX);
+        return -EINVAL;
+    }
+
+    entry = malloc(sizeof(nn_sub_topic_t) + topic_len);
+
+    if (entry == NULL) {
+        return -ENOMEM;
     }
 
+    entry->len = topic_len;
+    memcpy(entry->data, topic, topic_len);
+
     ret = nn_setsockopt(ctx->fd, NN_SUB, NN_SUB_SUBSCRIBE, topic, topic_len);
     if (ret < 0) {
         fprintf(stderr, "%s.ret=%d(%s)\n", __func__, ret, nn_strerror(ret));
+        free(entry);
+        return ret;
     }
 
+    pthread_mutex_lock(&ctx->lock);
+    entry->next = ctx->topics;
+    ctx->topics = entry;
+    pthread_mutex_unlock(&ctx->lock);
+
     return ret;
 }
 
@@ -744,21 +2000,36 @@ int nn_sub_unregister_topic(void* nn_sub_ctx, const void* topic, size_t topic_le
 {
     int ret = 0;
     nn_sub_ctx_t* ctx = (nn_sub_ctx_t*)nn_sub_ctx;
+    nn_sub_topic_t** prev;
 
     if (topic == NULL || ctx == NULL || ctx->fd < 0 /* || ctx->proto != NN_SUB*/) {
         return -EINVAL;
     }
 
-    if (topic_len > NN_NUTTX_TOPIC_NAME_LEN) {
-        fprintf(stderr, "%s.topic len(%lu) > max(%d)\n", __func__, topic_len, NN_NUTTX_TOPIC_NAME_LEN);
-        topic_len = NN_NUTTX_TOPIC_NAME_LEN;
+    if (topic_len > NN_NUTTX_TOPIC_LEN_MAX) {
+        fprintf(stderr, "%s.topic len(%zu) > max(%d)\n", __func__, topic_len, NN_NUTTX_TOPIC_LEN_MAX);
+        return -EINVAL;
     }
 
     ret = nn_setsockopt(ctx->fd, NN_SUB, NN_SUB_UNSUBSCRIBE, topic, topic_len);
     if (ret < 0) {
         fprintf(stderr, "%s.ret=%d(%s)\n", __func__, ret, nn_strerror(ret));
+        return ret;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+
+    for (prev = &ctx->topics; *prev != NULL; prev = &(*prev)->next) {
+        if ((*prev)->len == topic_len && memcmp((*prev)->data, topic, topic_len) == 0) {
+            nn_sub_topic_t* entry = *prev;
+            *prev = entry->next;
+            free(entry);
+            break;
+        }
     }
 
+    pthread_mutex_unlock(&ctx->lock);
+
     return ret;
 }
 
@@ -28,10 +28,22 @@ extern "C" {
 typedef struct nn_trans_data {
     const void* in;
     size_t      in_size;
-    void*       out;  // out = malloc/calloc(), nn_nuttx responsible for free.
+    void*       out;  // out = malloc/calloc() or nn_trans_alloc(), nn_nuttx responsible for free.
     size_t      out_size;
+    bool        out_msg;  // true if out = nn_trans_alloc(), then it is sent without copying.
 } nn_trans_data_t;
 
+typedef struct nn_trans_reply {
+    const void* data; // points into msg, valid until nn_trans_reply_free()
+    size_t      size;
+    void*       msg;
+} nn_trans_reply_t;
+
+
+typedef struct nn_server_attr {
+    int  workers;     // number of threads running on_transaction, 0 means 1
+    bool op_ordered;  // requests with the same op_code are handled one by one, in order
+} nn_server_attr_t;
 
 /**
  * @brief: server endpoint callback which impl of operation
@@ -44,11 +56,22 @@ typedef struct nn_trans_data {
  */
 typedef int (*on_transaction)(const void* cookie, const int code, nn_trans_data_t* data);
 
+/**
+ * @brief: completion callback of nn_client_transaction_async
+ *
+ * @param cookie, see: nn_client_transaction_async
+ * @param ret, op_code returned by server, or negative error code,
+ *        -ECANCELED if the client disconnected before the reply arrived
+ * @param out, reply data, valid only during the callback
+ * @param out_len
+ */
+typedef void (*on_transaction_reply)(void* cookie, int ret, const void* out, size_t out_len);
+
 /**
  * @brief: subscriber listener
  *
  * @param  cookie, see nn_sub_connect
- * @param topic, bytes array
+ * @param topic, bytes array, not NUL terminated
  * @param topic_len
  * @param content, private message
  * @param content_len
@@ -59,15 +82,57 @@ typedef int (*on_topic_listener)(const void* cookie, const void* topic, const si
         const void* content, const size_t content_len);
 
 
+/*
+ * Services and publishers are addressed by name. A plain name, alpha numeric
+ * underline, is reachable from this process over inproc and from other
+ * processes over IPC (NN_NUTTX_IPC_DIR/name): clients and subscribers use
+ * inproc when the name is bound in their own process, and IPC otherwise.
+ * A name with a scheme, e.g. "tcp://192.168.1.2:5555" for peers on another
+ * board, is used as is on both sides.
+ */
+
+/**
+ * @brief:nn_nuttx_loop_start, start the shared loop. Servers with a single
+ * worker and subscribers created afterwards are served by it, instead of
+ * each having its own thread. Release them before stopping the loop.
+ *
+ * @param pool_size, 0 to run callbacks on the loop thread itself, which is
+ * fine as long as they don't block, otherwise number of threads to run them.
+ * Callbacks of one server or subscriber never run concurrently.
+ *
+ * @return 0 if success, otherwise error code
+ */
+int nn_nuttx_loop_start(int pool_size);
+
+/**
+ * @brief:nn_nuttx_loop_stop
+ *
+ * @return 0 if success, -EBUSY if any server or subscriber still uses the loop
+ */
+int nn_nuttx_loop_stop(void);
+
 /**
  * @brief:nn_server_create
  *
- * @param name, alpha numeric underline
+ * @param name, alpha numeric underline, or URL with a scheme
  *
  * @return 0 if error, otherwise server handle
  */
 void* nn_server_create(const char* name);
 
+/**
+ * @brief:nn_server_create_ex, same as nn_server_create, but on_transaction
+ * may run on several threads at once, so that a slow request does not hold
+ * up the others. Unless op_ordered is set, requests are handled in no
+ * particular order.
+ *
+ * @param name, alpha numeric underline
+ * @param attr, NULL for defaults
+ *
+ * @return 0 if error, otherwise server handle
+ */
+void* nn_server_create_ex(const char* name, const nn_server_attr_t* attr);
+
 /**
  * @brief:nn_server_set_transaction_cb
  *
@@ -78,25 +143,28 @@ void* nn_server_create(const char* name);
 void nn_server_set_transaction_cb(void* nn_server_ctx, on_transaction cb, void* cb_priv);
 
 /**
- * @brief:nn_server_release
+ * @brief:nn_server_release, requests not handled yet are dropped, the
+ * ones being handled are replied to before it returns.
  *
  * @param nn_server_ctx
  *
- * @return
+ * @return 0 if suscess, -EINVAL if nn_server_ctx is NULL
  */
 int nn_server_release(void* nn_server_ctx);
 
 /**
  * @brief:nn_client_connect
  *
- * @param server_name
+ * @param server_name, as passed to nn_server_create
  *
  * @return NULL if error, otherwise client handle
  */
 void* nn_client_connect(const char* server_name);
 
 /**
- * @brief:nn_client_disconnect
+ * @brief:nn_client_disconnect, requests still waiting for reply complete
+ * with -ECANCELED. May be called from an on_transaction_reply callback, the
+ * client is then released once the callback returns.
  *
  * @param nn_client_ctx
  *
@@ -118,6 +186,65 @@ int nn_client_disconnect(void* nn_client_ctx);
  */
 int nn_client_transaction(const void* nn_client_ctx, int op_code, const void* in, int in_len, void* out, int out_len);
 
+/**
+ * @brief:nn_client_transaction_async, send the request and return without
+ * waiting for the reply. Any number of requests may be in flight, replies
+ * are matched by sequence number and cb is called from a thread owned by
+ * the client. Replies may complete in any order, nor are they ordered with
+ * respect to nn_client_transaction calls on the same client.
+ *
+ * @param nn_client_ctx
+ * @param op_code
+ * @param in
+ * @param in_len
+ * @param cb
+ * @param cookie passed to cb
+ *
+ * @return 0 if the request was sent, otherwise error code, cb is not called then
+ */
+int nn_client_transaction_async(void* nn_client_ctx, int op_code, const void* in, int in_len, on_transaction_reply cb, void* cookie);
+
+/**
+ * @brief:nn_client_transaction_borrow, same as nn_client_transaction, but the
+ * reply is not copied: reply->data points into the received message, which
+ * the caller has to release with nn_trans_reply_free.
+ *
+ * @param nn_client_ctx
+ * @param op_code
+ * @param in
+ * @param in_len
+ * @param reply
+ *
+ * @return op_code returned by server, or negative error code
+ */
+int nn_client_transaction_borrow(const void* nn_client_ctx, int op_code, const void* in, int in_len, nn_trans_reply_t* reply);
+
+/**
+ * @brief:nn_trans_reply_free
+ *
+ * @param reply filled in by nn_client_transaction_borrow
+ */
+void nn_trans_reply_free(nn_trans_reply_t* reply);
+
+/**
+ * @brief:nn_trans_alloc, allocate the out buffer of on_transaction inside
+ * a message, so that the reply is sent without copying. Set out_msg
+ * in nn_trans_data_t when using it.
+ *
+ * @param size
+ *
+ * @return NULL if error, otherwise buffer of size bytes
+ */
+void* nn_trans_alloc(size_t size);
+
+/**
+ * @brief:nn_trans_free, release a buffer from nn_trans_alloc which was not
+ * handed over to nn_nuttx
+ *
+ * @param buf
+ */
+void nn_trans_free(void* buf);
+
 /**
  * @brief:create publisher
  *
@@ -132,7 +259,7 @@ void* nn_pub_create(const char* name);
  *
  * @param nn_pub_ctx
  *
- * @return
+ * @return 0 if suscess, -EINVAL if nn_pub_ctx is NULL
  */
 int nn_pub_release(void* nn_pub_ctx);
 
@@ -140,7 +267,8 @@ int nn_pub_release(void* nn_pub_ctx);
  * @brief:nn_pub_topic_msg
  *
  * @param nn_pub_ctx
- * @param topic
+ * @param topic, up to 65535 bytes, hierarchical names like "media.player1"
+ *        allow subscribing to a whole group by prefix
  * @param topic_len
  * @param content
  * @param content_len
@@ -168,7 +296,9 @@ void* nn_sub_connect(const char* name, on_topic_listener listener, void* listene
 void nn_sub_disconnect(void* nn_sub_ctx);
 
 /**
- * @brief:nn_sub_register_topic
+ * @brief:nn_sub_register_topic, subscribe to all topics starting with
+ * topic, e.g. "media." receives both "media.player1" and "media.player2"
+ * but not "media" whatever its content starts with
  *
  * @param nn_sub_ctx
  * @param topic
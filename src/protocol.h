@@ -74,6 +74,20 @@ int nn_pipe_recv (struct nn_pipe *self, struct nn_msg *msg);
 void nn_pipe_getopt (struct nn_pipe *self, int level, int option,
     void *optval, size_t *optvallen);
 
+/*  Returns number of requests sent to the pipe that are still waiting for
+    a reply. Protocols that keep track of their requests maintain it using
+    nn_pipe_track, for the others it's always zero. */
+int nn_pipe_outstanding (struct nn_pipe *self);
+
+/*  Adds 'delta' to the number of outstanding requests of the pipe. */
+void nn_pipe_track (struct nn_pipe *self, int delta);
+
+/*  Returns how long, in microseconds, the transport recently took to
+    complete a send to the pipe. It's a moving average that stays at zero
+    while the transport accepts messages at once and that decays over time
+    when the pipe is not used. */
+int nn_pipe_backlog (struct nn_pipe *self);
+
 
 /******************************************************************************/
 /*  Base class for all socket types.                                          */
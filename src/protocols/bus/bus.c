@@ -53,8 +53,8 @@ static const struct nn_sockbase_vfptr nn_bus_sockbase_vfptr = {
     nn_xbus_events,
     nn_bus_send,
     nn_bus_recv,
-    NULL,
-    NULL
+    nn_xbus_setopt,
+    nn_xbus_getopt
 };
 
 static void nn_bus_init (struct nn_bus *self,
@@ -108,7 +108,7 @@ static int nn_bus_recv (struct nn_sockbase *self, struct nn_msg *msg)
     if (nn_slow (rc == -EAGAIN))
         return -EAGAIN;
     errnum_assert (rc == 0, -rc);
-    nn_assert (nn_chunkref_size (&msg->sphdr) == sizeof (uint64_t));
+    nn_assert (nn_chunkref_size (&msg->sphdr) >= sizeof (uint64_t));
 
     /*  Discard the header. */
     nn_chunkref_term (&msg->sphdr);
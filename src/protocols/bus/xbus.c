@@ -31,6 +31,8 @@
 #include "../../utils/fast.h"
 #include "../../utils/alloc.h"
 #include "../../utils/attr.h"
+#include "../../utils/random.h"
+#include "../../utils/wire.h"
 
 #include <stddef.h>
 #include <string.h>
@@ -40,6 +42,13 @@
     neccessary for the pointer to fit in 64-bit ID. */
 CT_ASSERT (sizeof (uint64_t) >= sizeof (struct nn_pipe*));
 
+/*  With duplicate suppression on, each message is prefixed by 32-bit origin
+    ID and 32-bit sequence number. */
+#define NN_XBUS_ORIGIN_SIZE (2 * sizeof (uint32_t))
+
+/*  Private functions. */
+static int nn_xbus_seen (struct nn_xbus *self, uint32_t origin, uint32_t seq);
+
 /*  Implementation of nn_sockbase's virtual functions. */
 static void nn_xbus_destroy (struct nn_sockbase *self);
 static const struct nn_sockbase_vfptr nn_xbus_sockbase_vfptr = {
@@ -52,8 +61,8 @@ static const struct nn_sockbase_vfptr nn_xbus_sockbase_vfptr = {
     nn_xbus_events,
     nn_xbus_send,
     nn_xbus_recv,
-    NULL,
-    NULL
+    nn_xbus_setopt,
+    nn_xbus_getopt
 };
 
 void nn_xbus_init (struct nn_xbus *self,
@@ -62,6 +71,12 @@ void nn_xbus_init (struct nn_xbus *self,
     nn_sockbase_init (&self->sockbase, vfptr, hint);
     nn_dist_init (&self->outpipes);
     nn_fq_init (&self->inpipes);
+    self->dedup = 0;
+
+    /*  Origin IDs are random so that they don't clash among the nodes. */
+    nn_random_generate (&self->origin, sizeof (self->origin));
+    self->seq = 0;
+    memset (self->origins, 0, sizeof (self->origins));
 }
 
 void nn_xbus_term (struct nn_xbus *self)
@@ -148,22 +163,47 @@ int nn_xbus_events (struct nn_sockbase *self)
 
 int nn_xbus_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
+    struct nn_xbus *xbus;
     size_t hdrsz;
     struct nn_pipe *exclude;
+    uint8_t origin [NN_XBUS_ORIGIN_SIZE];
+
+    xbus = nn_cont (self, struct nn_xbus, sockbase);
 
     hdrsz = nn_chunkref_size (&msg->sphdr);
     if (hdrsz == 0)
         exclude = NULL;
-    else if (hdrsz == sizeof (uint64_t)) {
+    else if (hdrsz == sizeof (uint64_t) || (xbus->dedup &&
+          hdrsz == sizeof (uint64_t) + NN_XBUS_ORIGIN_SIZE)) {
         memcpy (&exclude, nn_chunkref_data (&msg->sphdr), sizeof (exclude));
+        if (hdrsz > sizeof (uint64_t)) {
+
+            /*  Message being forwarded. Keep its origin. */
+            memcpy (origin, ((uint8_t*) nn_chunkref_data (&msg->sphdr)) +
+                sizeof (uint64_t), NN_XBUS_ORIGIN_SIZE);
+            nn_chunkref_term (&msg->sphdr);
+            nn_chunkref_init (&msg->sphdr, NN_XBUS_ORIGIN_SIZE);
+            memcpy (nn_chunkref_data (&msg->sphdr), origin,
+                NN_XBUS_ORIGIN_SIZE);
+            return nn_dist_send (&xbus->outpipes, msg, exclude);
+        }
         nn_chunkref_term (&msg->sphdr);
         nn_chunkref_init (&msg->sphdr, 0);
     }
     else
         return -EINVAL;
 
-    return nn_dist_send (&nn_cont (self, struct nn_xbus, sockbase)->outpipes,
-        msg, exclude);
+    /*  Message originating at this node. Stamp it. */
+    if (xbus->dedup) {
+        nn_chunkref_term (&msg->sphdr);
+        nn_chunkref_init (&msg->sphdr, NN_XBUS_ORIGIN_SIZE);
+        nn_putl (nn_chunkref_data (&msg->sphdr), xbus->origin);
+        nn_putl (((uint8_t*) nn_chunkref_data (&msg->sphdr)) +
+            sizeof (uint32_t), xbus->seq);
+        ++xbus->seq;
+    }
+
+    return nn_dist_send (&xbus->outpipes, msg, exclude);
 }
 
 int nn_xbus_recv (struct nn_sockbase *self, struct nn_msg *msg)
@@ -171,6 +211,8 @@ int nn_xbus_recv (struct nn_sockbase *self, struct nn_msg *msg)
     int rc;
     struct nn_xbus *xbus;
     struct nn_pipe *pipe;
+    uint8_t *hdr;
+    struct nn_chunkref ref;
 
     xbus = nn_cont (self, struct nn_xbus, sockbase);
 
@@ -182,20 +224,156 @@ int nn_xbus_recv (struct nn_sockbase *self, struct nn_msg *msg)
             return rc;
 
         /*  The message should have no header. Drop malformed messages. */
-        if (nn_chunkref_size (&msg->sphdr) == 0)
-            break;
-        nn_msg_term (msg);
+        if (!xbus->dedup) {
+            if (nn_chunkref_size (&msg->sphdr) == 0)
+                break;
+            nn_msg_term (msg);
+            continue;
+        }
+
+        /*  Split the origin header from the body. */
+        if (!(rc & NN_PIPE_PARSED)) {
+            if (nn_slow (nn_chunkref_size (&msg->sphdr) != 0 ||
+                  nn_chunkref_size (&msg->body) < NN_XBUS_ORIGIN_SIZE)) {
+                nn_msg_term (msg);
+                continue;
+            }
+            nn_chunkref_term (&msg->sphdr);
+            nn_chunkref_init (&msg->sphdr, NN_XBUS_ORIGIN_SIZE);
+            memcpy (nn_chunkref_data (&msg->sphdr),
+                nn_chunkref_data (&msg->body), NN_XBUS_ORIGIN_SIZE);
+            nn_chunkref_trim (&msg->body, NN_XBUS_ORIGIN_SIZE);
+        }
+        if (nn_slow (nn_chunkref_size (&msg->sphdr) != NN_XBUS_ORIGIN_SIZE)) {
+            nn_msg_term (msg);
+            continue;
+        }
+
+        /*  Drop the messages we've already seen, including our own ones
+            coming back to us. */
+        hdr = nn_chunkref_data (&msg->sphdr);
+        if (nn_xbus_seen (xbus, nn_getl (hdr),
+              nn_getl (hdr + sizeof (uint32_t)))) {
+            nn_msg_term (msg);
+            continue;
+        }
+        break;
     }
 
-    /*  Add pipe ID to the message header. */
+    /*  Prepend the header by the pipe ID. */
+    nn_chunkref_init (&ref, sizeof (uint64_t) +
+        nn_chunkref_size (&msg->sphdr));
+    memset (nn_chunkref_data (&ref), 0, sizeof (uint64_t));
+    memcpy (nn_chunkref_data (&ref), &pipe, sizeof (pipe));
+    memcpy (((uint8_t*) nn_chunkref_data (&ref)) + sizeof (uint64_t),
+        nn_chunkref_data (&msg->sphdr), nn_chunkref_size (&msg->sphdr));
     nn_chunkref_term (&msg->sphdr);
-    nn_chunkref_init (&msg->sphdr, sizeof (uint64_t));
-    memset (nn_chunkref_data (&msg->sphdr), 0, sizeof (uint64_t));
-    memcpy (nn_chunkref_data (&msg->sphdr), &pipe, sizeof (pipe));
+    nn_chunkref_mv (&msg->sphdr, &ref);
 
     return 0;
 }
 
+int nn_xbus_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen)
+{
+    struct nn_xbus *xbus;
+    int val;
+
+    xbus = nn_cont (self, struct nn_xbus, sockbase);
+
+    if (level != NN_BUS)
+        return -ENOPROTOOPT;
+
+    if (option == NN_BUS_DEDUP) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        val = *(int*) optval;
+        if (nn_slow (val != 0 && val != 1))
+            return -EINVAL;
+        xbus->dedup = val;
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+int nn_xbus_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen)
+{
+    struct nn_xbus *xbus;
+
+    xbus = nn_cont (self, struct nn_xbus, sockbase);
+
+    if (level != NN_BUS)
+        return -ENOPROTOOPT;
+
+    if (option == NN_BUS_DEDUP) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xbus->dedup;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+/*  Returns 1 if the message was already seen, otherwise records it and
+    returns 0. */
+static int nn_xbus_seen (struct nn_xbus *self, uint32_t origin, uint32_t seq)
+{
+    struct nn_xbus_origin *set;
+    struct nn_xbus_origin o;
+    int32_t diff;
+    int i;
+    int rc;
+
+    if (origin == self->origin)
+        return 1;
+
+    /*  Look the origin up in its set. If it's not there, the last entry,
+        which is either unused or the least recently seen one, is reused. */
+    set = self->origins [(origin * 2654435761u) >>
+        (32 - NN_XBUS_DEDUP_SET_BITS)];
+    for (i = 0; i != NN_XBUS_DEDUP_WAYS - 1; ++i)
+        if (set [i].seen != 0 && set [i].id == origin)
+            break;
+    o = set [i];
+
+    if (o.seen == 0 || o.id != origin) {
+        o.id = origin;
+        o.seq = seq;
+        o.seen = 1;
+        rc = 0;
+    }
+    else {
+        diff = (int32_t) (seq - o.seq);
+        if (diff > 0) {
+
+            /*  Newer than anything seen so far. Slide the window. */
+            o.seen = diff < NN_XBUS_DEDUP_WINDOW ? (o.seen << diff) | 1 : 1;
+            o.seq = seq;
+            rc = 0;
+        }
+        else if (-diff >= NN_XBUS_DEDUP_WINDOW ||
+              (o.seen & ((uint64_t) 1 << -diff))) {
+
+            /*  Older than the window, or within the window and already
+                seen. */
+            rc = 1;
+        }
+        else {
+            o.seen |= (uint64_t) 1 << -diff;
+            rc = 0;
+        }
+    }
+
+    /*  Move the origin to the front of the set. */
+    memmove (set + 1, set, i * sizeof (struct nn_xbus_origin));
+    set [0] = o;
+    return rc;
+}
+
 static int nn_xbus_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_xbus *self;
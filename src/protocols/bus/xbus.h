@@ -34,10 +34,47 @@ struct nn_xbus_data {
     struct nn_fq_data initem;
 };
 
+/*  Origins duplicate suppression keeps track of are hashed by their ID
+    into one of the sets. Each set holds several origins, the least recently
+    seen one is evicted to make space for a new one. */
+#define NN_XBUS_DEDUP_SET_BITS 6
+#define NN_XBUS_DEDUP_SETS (1 << NN_XBUS_DEDUP_SET_BITS)
+#define NN_XBUS_DEDUP_WAYS 4
+
+/*  Size of the sliding window of sequence numbers remembered per origin.
+    Messages older than the window are dropped as duplicates. */
+#define NN_XBUS_DEDUP_WINDOW 64
+
+struct nn_xbus_origin {
+
+    /*  ID of the node the messages originate from. */
+    uint32_t id;
+
+    /*  The highest sequence number seen so far. */
+    uint32_t seq;
+
+    /*  Bit N is set if message 'seq - N' was seen. Zero if the slot is
+        unused. */
+    uint64_t seen;
+};
+
 struct nn_xbus {
     struct nn_sockbase sockbase;
     struct nn_dist outpipes;
     struct nn_fq inpipes;
+
+    /*  If set, messages carry origin ID and sequence number and those
+        already seen are dropped on receive. */
+    int dedup;
+
+    /*  ID of this node and the sequence number of the next message
+        originated here. */
+    uint32_t origin;
+    uint32_t seq;
+
+    /*  Sliding windows of recently seen messages. Each set is ordered from
+        the most to the least recently seen origin. */
+    struct nn_xbus_origin origins [NN_XBUS_DEDUP_SETS][NN_XBUS_DEDUP_WAYS];
 };
 
 void nn_xbus_init (struct nn_xbus *self,
@@ -51,6 +88,10 @@ void nn_xbus_out (struct nn_sockbase *self, struct nn_pipe *pipe);
 int nn_xbus_events (struct nn_sockbase *self);
 int nn_xbus_send (struct nn_sockbase *self, struct nn_msg *msg);
 int nn_xbus_recv (struct nn_sockbase *self, struct nn_msg *msg);
+int nn_xbus_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen);
+int nn_xbus_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen);
 
 int nn_xbus_ispeer (int socktype);
 
@@ -56,6 +56,8 @@ static void nn_xpush_in (struct nn_sockbase *self, struct nn_pipe *pipe);
 static void nn_xpush_out (struct nn_sockbase *self, struct nn_pipe *pipe);
 static int nn_xpush_events (struct nn_sockbase *self);
 static int nn_xpush_send (struct nn_sockbase *self, struct nn_msg *msg);
+static int nn_xpush_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen);
 static const struct nn_sockbase_vfptr nn_xpush_sockbase_vfptr = {
     NULL,
     nn_xpush_destroy,
@@ -66,7 +68,7 @@ static const struct nn_sockbase_vfptr nn_xpush_sockbase_vfptr = {
     nn_xpush_events,
     nn_xpush_send,
     NULL,
-    NULL,
+    nn_xpush_setopt,
     NULL
 };
 
@@ -160,6 +162,19 @@ static int nn_xpush_send (struct nn_sockbase *self, struct nn_msg *msg)
         msg, NULL);
 }
 
+static int nn_xpush_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, NN_UNUSED size_t optvallen)
+{
+    /*  The socket has validated the value already. */
+    if (level == NN_SOL_SOCKET && option == NN_LB_STRATEGY) {
+        nn_lb_set_strategy (&nn_cont (self, struct nn_xpush, sockbase)->lb,
+            *(int*) optval);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
 int nn_xpush_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_xpush *self;
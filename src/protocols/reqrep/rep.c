@@ -47,8 +47,8 @@ static const struct nn_sockbase_vfptr nn_rep_sockbase_vfptr = {
     nn_rep_events,
     nn_rep_send,
     nn_rep_recv,
-    NULL,
-    NULL
+    nn_rep_setopt,
+    nn_rep_getopt
 };
 
 void nn_rep_init (struct nn_rep *self,
@@ -56,6 +56,7 @@ void nn_rep_init (struct nn_rep *self,
 {
     nn_xrep_init (&self->xrep, vfptr, hint);
     self->flags = 0;
+    self->context = 0;
 }
 
 void nn_rep_term (struct nn_rep *self)
@@ -82,7 +83,7 @@ int nn_rep_events (struct nn_sockbase *self)
 
     rep = nn_cont (self, struct nn_rep, xrep.sockbase);
     events = nn_xrep_events (&rep->xrep.sockbase);
-    if (!(rep->flags & NN_REP_INPROGRESS))
+    if (!rep->context && !(rep->flags & NN_REP_INPROGRESS))
         events &= ~NN_SOCKBASE_EVENT_OUT;
     return events;
 }
@@ -94,6 +95,16 @@ int nn_rep_send (struct nn_sockbase *self, struct nn_msg *msg)
 
     rep = nn_cont (self, struct nn_rep, xrep.sockbase);
 
+    /*  In context mode the backtrace travels with the reply itself, so any
+        number of requests can be outstanding at the same time. */
+    if (rep->context) {
+        if (nn_slow (nn_chunkref_size (&msg->sphdr) == 0))
+            return -EFSM;
+        rc = nn_xrep_send (&rep->xrep.sockbase, msg);
+        errnum_assert (rc == 0 || rc == -EAGAIN, -rc);
+        return 0;
+    }
+
     /*  If no request was received, there's nowhere to send the reply to. */
     if (nn_slow (!(rep->flags & NN_REP_INPROGRESS)))
         return -EFSM;
@@ -131,6 +142,11 @@ int nn_rep_recv (struct nn_sockbase *self, struct nn_msg *msg)
         return -EAGAIN;
     errnum_assert (rc == 0, -rc);
 
+    /*  In context mode the backtrace is handed to the user as SP header
+        of the request. It has to be passed back when sending the reply. */
+    if (rep->context)
+        return 0;
+
     /*  Store the backtrace. */
     nn_chunkref_mv (&rep->backtrace, &msg->sphdr);
     nn_chunkref_init (&msg->sphdr, 0);
@@ -139,6 +155,57 @@ int nn_rep_recv (struct nn_sockbase *self, struct nn_msg *msg)
     return 0;
 }
 
+int nn_rep_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen)
+{
+    struct nn_rep *rep;
+    int val;
+
+    rep = nn_cont (self, struct nn_rep, xrep.sockbase);
+
+    if (level != NN_REP)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REP_CONTEXT) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        val = *(int*) optval;
+        if (nn_slow (val != 0 && val != 1))
+            return -EINVAL;
+
+        /*  Switching the mode cancels the request being processed, if any. */
+        if (rep->flags & NN_REP_INPROGRESS) {
+            nn_chunkref_term (&rep->backtrace);
+            rep->flags &= ~NN_REP_INPROGRESS;
+        }
+        rep->context = val;
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+int nn_rep_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen)
+{
+    struct nn_rep *rep;
+
+    rep = nn_cont (self, struct nn_rep, xrep.sockbase);
+
+    if (level != NN_REP)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REP_CONTEXT) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = rep->context;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
 static int nn_rep_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_rep *self;
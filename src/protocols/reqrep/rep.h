@@ -30,6 +30,9 @@ struct nn_rep {
     struct nn_xrep xrep;
     uint32_t flags;
     struct nn_chunkref backtrace;
+
+    /*  Protocol-specific socket options. */
+    int context;
 };
 
 /*  Some users may want to extend the REP protocol similar to how REP extends XREP.
@@ -43,5 +46,9 @@ void nn_rep_destroy (struct nn_sockbase *self);
 int nn_rep_events (struct nn_sockbase *self);
 int nn_rep_send (struct nn_sockbase *self, struct nn_msg *msg);
 int nn_rep_recv (struct nn_sockbase *self, struct nn_msg *msg);
+int nn_rep_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen);
+int nn_rep_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen);
 
 #endif
@@ -34,6 +34,7 @@
 #include "../../utils/cont.h"
 #include "../../utils/alloc.h"
 #include "../../utils/random.h"
+#include "../../utils/clock.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
 
@@ -43,6 +44,9 @@
 /*  Default re-send interval is 1 minute. */
 #define NN_REQ_DEFAULT_RESEND_IVL 60000
 
+/*  In adaptive mode, the re-send interval is never shorter than this. */
+#define NN_REQ_MIN_RESEND_IVL 100
+
 #define NN_REQ_STATE_IDLE 1
 #define NN_REQ_STATE_PASSIVE 2
 #define NN_REQ_STATE_DELAYED 3
@@ -62,6 +66,11 @@
 
 #define NN_REQ_SRC_RESEND_TIMER 1
 
+/*  Private functions. */
+static int nn_req_resend_ivl (struct nn_req *self);
+static void nn_req_rtt_sample (struct nn_req *self, uint64_t rtt);
+static void nn_req_track (struct nn_req *self, struct nn_pipe *pipe);
+
 static const struct nn_sockbase_vfptr nn_req_sockbase_vfptr = {
     nn_req_stop,
     nn_req_destroy,
@@ -89,11 +98,15 @@ void nn_req_init (struct nn_req *self,
     nn_random_generate (&self->lastid, sizeof (self->lastid));
 
     self->task.sent_to = NULL;
+    self->tracked = NULL;
 
     nn_msg_init (&self->task.request, 0);
     nn_msg_init (&self->task.reply, 0);
     nn_timer_init (&self->task.timer, NN_REQ_SRC_RESEND_TIMER, &self->fsm);
     self->resend_ivl = NN_REQ_DEFAULT_RESEND_IVL;
+    self->resend_adaptive = 0;
+    self->srtt = 0;
+    self->rttvar = 0;
 
     nn_task_init (&self->task, self->lastid);
 
@@ -245,6 +258,7 @@ int nn_req_csend (struct nn_sockbase *self, struct nn_msg *msg)
     /*  Store the message so that it can be re-sent if there's no reply. */
     nn_msg_term (&req->task.request);
     nn_msg_mv (&req->task.request, msg);
+    req->task.resends = 0;
 
     /*  Notify the state machine. */
     nn_fsm_action (&req->fsm, NN_REQ_ACTION_SENT);
@@ -283,6 +297,9 @@ int nn_req_setopt (struct nn_sockbase *self, int level, int option,
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
+    if (level == NN_SOL_SOCKET)
+        return nn_xreq_setopt (self, level, option, optval, optvallen);
+
     if (level != NN_REQ)
         return -ENOPROTOOPT;
 
@@ -293,6 +310,15 @@ int nn_req_setopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
+    if (option == NN_REQ_RESEND_ADAPTIVE) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval != 0 && *(int*) optval != 1))
+            return -EINVAL;
+        req->resend_adaptive = *(int*) optval;
+        return 0;
+    }
+
     return -ENOPROTOOPT;
 }
 
@@ -314,6 +340,22 @@ int nn_req_getopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
+    if (option == NN_REQ_RESEND_ADAPTIVE) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = req->resend_adaptive;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_REQ_RTT) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = (int) (req->srtt / 8);
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
     return -ENOPROTOOPT;
 }
 
@@ -425,9 +467,15 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_REQ_ACTION_IN:
 
-                /*  Reply arrived. */
+                /*  Reply arrived. Unless the request was re-sent, in which
+                    case we can't tell which copy the reply belongs to,
+                    update the RTT estimate. */
+                if (req->task.resends == 0)
+                    nn_req_rtt_sample (req,
+                        nn_clock_ms () - req->task.sent_at);
                 nn_timer_stop (&req->task.timer);
                 req->task.sent_to = NULL;
+                nn_req_track (req, NULL);
                 req->state = NN_REQ_STATE_STOPPING_TIMER;
                 return;
 
@@ -478,6 +526,7 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
         case NN_REQ_SRC_RESEND_TIMER:
             switch (type) {
             case NN_TIMER_STOPPED:
+                ++req->task.resends;
                 nn_req_action_send (req, 1);
                 return;
             default:
@@ -623,9 +672,11 @@ void nn_req_action_send (struct nn_req *self, int allow_delay)
         in case the request gets lost somewhere further out
         in the topology. */
     if (nn_fast (rc == 0)) {
-        nn_timer_start (&self->task.timer, self->resend_ivl);
+        self->task.sent_at = nn_clock_ms ();
+        nn_timer_start (&self->task.timer, nn_req_resend_ivl (self));
         nn_assert (to);
         self->task.sent_to = to;
+        nn_req_track (self, to);
         self->state = NN_REQ_STATE_ACTIVE;
         return;
     }
@@ -634,6 +685,67 @@ void nn_req_action_send (struct nn_req *self, int allow_delay)
     errnum_assert (0, -rc);
 }
 
+static int nn_req_resend_ivl (struct nn_req *self)
+{
+    uint64_t ivl;
+    uint32_t jitter;
+    int i;
+
+    /*  Without adaptive mode, or before first RTT sample is available,
+        use the fixed interval set by the user. */
+    if (!self->resend_adaptive || self->srtt == 0)
+        return self->resend_ivl;
+
+    /*  Compute the timeout the same way TCP computes its RTO. */
+    ivl = (self->srtt + 4 * self->rttvar) / 8;
+    if (ivl < NN_REQ_MIN_RESEND_IVL)
+        ivl = NN_REQ_MIN_RESEND_IVL;
+
+    /*  Back off exponentially with each re-send of the same request. */
+    for (i = 0; i != self->task.resends && ivl < (uint64_t) self->resend_ivl;
+          ++i)
+        ivl *= 2;
+
+    /*  Add jitter of +/- 12.5% so that clients that timed out at the same
+        moment don't re-send in lockstep. */
+    nn_random_generate (&jitter, sizeof (jitter));
+    ivl = ivl - ivl / 8 + jitter % (ivl / 4 + 1);
+
+    /*  User-specified interval serves as an upper bound. */
+    if (ivl > (uint64_t) self->resend_ivl)
+        ivl = self->resend_ivl;
+
+    return (int) ivl;
+}
+
+static void nn_req_rtt_sample (struct nn_req *self, uint64_t rtt)
+{
+    uint64_t delta;
+
+    /*  Update the estimate as specified in RFC 6298. The values are kept
+        scaled by 8 to retain some precision for sub-millisecond RTTs. */
+    rtt *= 8;
+    if (rtt == 0)
+        rtt = 1;
+    if (self->srtt == 0) {
+        self->srtt = rtt;
+        self->rttvar = rtt / 2;
+        return;
+    }
+    delta = rtt > self->srtt ? rtt - self->srtt : self->srtt - rtt;
+    self->rttvar = self->rttvar - self->rttvar / 4 + delta / 4;
+    self->srtt = self->srtt - self->srtt / 8 + rtt / 8;
+}
+
+static void nn_req_track (struct nn_req *self, struct nn_pipe *pipe)
+{
+    if (pipe)
+        nn_pipe_track (pipe, 1);
+    if (self->tracked)
+        nn_pipe_track (self->tracked, -1);
+    self->tracked = pipe;
+}
+
 static int nn_req_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_req *self;
@@ -652,6 +764,8 @@ void nn_req_rm (struct nn_sockbase *self, struct nn_pipe *pipe) {
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
     nn_xreq_rm (self, pipe);
+    if (nn_slow (pipe == req->tracked))
+        req->tracked = NULL;
     if (nn_slow (pipe == req->task.sent_to)) {
         nn_fsm_action (&req->fsm, NN_REQ_ACTION_PIPE_RM);
     }
@@ -44,9 +44,20 @@ struct nn_req {
 
     /*  Protocol-specific socket options. */
     int resend_ivl;
+    int resend_adaptive;
+
+    /*  Smoothed round-trip time and its variance, both in milliseconds
+        scaled by 8, as in TCP. Zero 'srtt' means there's no sample yet. */
+    uint64_t srtt;
+    uint64_t rttvar;
 
     /*  The request being processed. */
     struct nn_task task;
+
+    /*  Pipe counted as having the request outstanding. When the request is
+        re-sent or replaced, the pipe is released only after the new copy is
+        sent, so that the peer that didn't answer is not picked again. */
+    struct nn_pipe *tracked;
 };
 
 /*  Some users may want to extend the REQ protocol similar to how REQ extends XREQ.
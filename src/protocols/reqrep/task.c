@@ -27,6 +27,8 @@
 void nn_task_init (struct nn_task *self, uint32_t id)
 {
     self->id = id;
+    self->sent_at = 0;
+    self->resends = 0;
 }
 
 void nn_task_term (NN_UNUSED struct nn_task *self)
@@ -48,6 +48,11 @@ struct nn_task {
     /*  Pipe the current request has been sent to. This is an optimisation so
         that request can be re-sent immediately if the pipe disappears.  */
     struct nn_pipe *sent_to;
+
+    /*  Time the request was last sent at and number of times it was re-sent
+        so far. Used for RTT estimation and resend backoff. */
+    uint64_t sent_at;
+    int resends;
 };
 
 void nn_task_init (struct nn_task *self, uint32_t id);
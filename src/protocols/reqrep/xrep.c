@@ -38,6 +38,7 @@
 
 /*  Private functions. */
 static void nn_xrep_destroy (struct nn_sockbase *self);
+static void nn_xrep_send_pipe (struct nn_xrep_data *data, struct nn_msg *msg);
 
 static const struct nn_sockbase_vfptr nn_xrep_sockbase_vfptr = {
     NULL,
@@ -88,6 +89,7 @@ int nn_xrep_add (struct nn_sockbase *self, struct nn_pipe *pipe)
     struct nn_xrep *xrep;
     struct nn_xrep_data *data;
     int rcvprio;
+    int sndbuf;
     size_t sz;
 
     xrep = nn_cont (self, struct nn_xrep, sockbase);
@@ -97,11 +99,18 @@ int nn_xrep_add (struct nn_sockbase *self, struct nn_pipe *pipe)
     nn_assert (sz == sizeof (rcvprio));
     nn_assert (rcvprio >= 1 && rcvprio <= 16);
 
+    sz = sizeof (sndbuf);
+    nn_pipe_getopt (pipe, NN_SOL_SOCKET, NN_SNDBUF, &sndbuf, &sz);
+    nn_assert (sz == sizeof (sndbuf));
+
     data = nn_alloc (sizeof (struct nn_xrep_data), "pipe data (xrep)");
     alloc_assert (data);
     data->pipe = pipe;
     nn_hash_item_init (&data->outitem);
     data->flags = 0;
+    nn_list_init (&data->deferred);
+    data->deferred_mem = 0;
+    data->sndbuf = (size_t) sndbuf;
     nn_hash_insert (&xrep->outpipes, xrep->next_key & 0x7fffffff,
         &data->outitem);
     ++xrep->next_key;
@@ -115,10 +124,21 @@ void nn_xrep_rm (struct nn_sockbase *self, struct nn_pipe *pipe)
 {
     struct nn_xrep *xrep;
     struct nn_xrep_data *data;
+    struct nn_xrep_deferred *deferred;
 
     xrep = nn_cont (self, struct nn_xrep, sockbase);
     data = nn_pipe_getdata (pipe);
 
+    while (!nn_list_empty (&data->deferred)) {
+        deferred = nn_cont (nn_list_begin (&data->deferred),
+            struct nn_xrep_deferred, item);
+        nn_list_erase (&data->deferred, &deferred->item);
+        nn_list_item_term (&deferred->item);
+        nn_msg_term (&deferred->msg);
+        nn_free (deferred);
+    }
+    nn_list_term (&data->deferred);
+
     nn_fq_rm (&xrep->inpipes, &data->initem);
     nn_hash_erase (&xrep->outpipes, &data->outitem);
     nn_hash_item_term (&data->outitem);
@@ -140,9 +160,22 @@ void nn_xrep_in (struct nn_sockbase *self, struct nn_pipe *pipe)
 void nn_xrep_out (NN_UNUSED struct nn_sockbase *self, struct nn_pipe *pipe)
 {
     struct nn_xrep_data *data;
+    struct nn_xrep_deferred *deferred;
 
     data = nn_pipe_getdata (pipe);
     data->flags |= NN_XREP_OUT;
+
+    /*  Send the replies that piled up while the pipe was busy. */
+    while ((data->flags & NN_XREP_OUT) && !nn_list_empty (&data->deferred)) {
+        deferred = nn_cont (nn_list_begin (&data->deferred),
+            struct nn_xrep_deferred, item);
+        nn_list_erase (&data->deferred, &deferred->item);
+        nn_list_item_term (&deferred->item);
+        data->deferred_mem -= nn_chunkref_size (&deferred->msg.sphdr) +
+            nn_chunkref_size (&deferred->msg.body);
+        nn_xrep_send_pipe (data, &deferred->msg);
+        nn_free (deferred);
+    }
 }
 
 int nn_xrep_events (struct nn_sockbase *self)
@@ -153,10 +186,11 @@ int nn_xrep_events (struct nn_sockbase *self)
 
 int nn_xrep_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
-    int rc;
     uint32_t key;
+    size_t sz;
     struct nn_xrep *xrep;
     struct nn_xrep_data *data;
+    struct nn_xrep_deferred *deferred;
 
     xrep = nn_cont (self, struct nn_xrep, sockbase);
 
@@ -171,21 +205,47 @@ int nn_xrep_send (struct nn_sockbase *self, struct nn_msg *msg)
     nn_chunkref_trim (&msg->sphdr, 4);
 
     /*  Find the appropriate pipe to send the message to. If there's none,
-        or if it's not ready for sending, silently drop the message. */
+        silently drop the message. */
     data = nn_cont (nn_hash_get (&xrep->outpipes, key), struct nn_xrep_data,
         outitem);
-    if (!data || !(data->flags & NN_XREP_OUT)) {
+    if (!data) {
         nn_msg_term (msg);
         return 0;
     }
 
-    /*  Send the message. */
+    /*  If the pipe is still sending the previous message, which happens when
+        several threads reply on the same raw socket, keep the reply until
+        it's done. Drop it only if the peer isn't reading the replies. */
+    if (!(data->flags & NN_XREP_OUT)) {
+        sz = nn_chunkref_size (&msg->sphdr) + nn_chunkref_size (&msg->body);
+        if (nn_slow (data->deferred_mem + sz > data->sndbuf)) {
+            nn_msg_term (msg);
+            return 0;
+        }
+        deferred = nn_alloc (sizeof (struct nn_xrep_deferred),
+            "deferred reply (xrep)");
+        alloc_assert (deferred);
+        nn_msg_mv (&deferred->msg, msg);
+        nn_list_item_init (&deferred->item);
+        nn_list_insert (&data->deferred, &deferred->item,
+            nn_list_end (&data->deferred));
+        data->deferred_mem += sz;
+        return 0;
+    }
+
+    nn_xrep_send_pipe (data, msg);
+
+    return 0;
+}
+
+static void nn_xrep_send_pipe (struct nn_xrep_data *data, struct nn_msg *msg)
+{
+    int rc;
+
     rc = nn_pipe_send (data->pipe, msg);
     errnum_assert (rc >= 0, -rc);
     if (rc & NN_PIPE_RELEASE)
         data->flags &= ~NN_XREP_OUT;
-
-    return 0;
 }
 
 int nn_xrep_recv (struct nn_sockbase *self, struct nn_msg *msg)
@@ -26,6 +26,8 @@
 #include "../../protocol.h"
 
 #include "../../utils/hash.h"
+#include "../../utils/list.h"
+#include "../../utils/msg.h"
 
 #include "../utils/fq.h"
 
@@ -33,11 +35,24 @@
 
 #define NN_XREP_OUT 1
 
+/*  Reply waiting for the pipe to finish sending the previous one. */
+struct nn_xrep_deferred {
+    struct nn_msg msg;
+    struct nn_list_item item;
+};
+
 struct nn_xrep_data {
     struct nn_pipe *pipe;
     struct nn_hash_item outitem;
     struct nn_fq_data initem;
     uint32_t flags;
+
+    /*  Replies sent while the pipe was busy, oldest first. They go out as
+        soon as the pipe is writable again. Once they take more than sndbuf
+        bytes, headers included, further replies are dropped. */
+    struct nn_list deferred;
+    size_t deferred_mem;
+    size_t sndbuf;
 };
 
 struct nn_xrep {
@@ -50,7 +50,7 @@ static const struct nn_sockbase_vfptr nn_xreq_sockbase_vfptr = {
     nn_xreq_events,
     nn_xreq_send,
     nn_xreq_recv,
-    NULL,
+    nn_xreq_setopt,
     NULL
 };
 
@@ -175,6 +175,19 @@ int nn_xreq_send_to (struct nn_sockbase *self, struct nn_msg *msg,
     return 0;
 }
 
+int nn_xreq_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, NN_UNUSED size_t optvallen)
+{
+    /*  The socket has validated the value already. */
+    if (level == NN_SOL_SOCKET && option == NN_LB_STRATEGY) {
+        nn_lb_set_strategy (&nn_cont (self, struct nn_xreq, sockbase)->lb,
+            *(int*) optval);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
 int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg)
 {
     int rc;
@@ -48,6 +48,8 @@ int nn_xreq_send (struct nn_sockbase *self, struct nn_msg *msg);
 int nn_xreq_send_to (struct nn_sockbase *self, struct nn_msg *msg,
     struct nn_pipe **to);
 int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg);
+int nn_xreq_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen);
 
 int nn_xreq_ispeer (int socktype);
 
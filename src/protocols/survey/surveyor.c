@@ -36,25 +36,46 @@
 #include "../../utils/alloc.h"
 #include "../../utils/random.h"
 #include "../../utils/attr.h"
+#include "../../utils/clock.h"
 
 #include <string.h>
 
 #define NN_SURVEYOR_DEFAULT_DEADLINE 1000
 
+/*  Maximum number of surveys that can be in progress at the same time. */
+#define NN_SURVEYOR_MAX_SURVEYS 64
+
 #define NN_SURVEYOR_STATE_IDLE 1
 #define NN_SURVEYOR_STATE_PASSIVE 2
 #define NN_SURVEYOR_STATE_ACTIVE 3
 #define NN_SURVEYOR_STATE_CANCELLING 4
 #define NN_SURVEYOR_STATE_STOPPING_TIMER 5
 #define NN_SURVEYOR_STATE_STOPPING 6
+#define NN_SURVEYOR_STATE_RESCHEDULING 7
 
 #define NN_SURVEYOR_ACTION_START 1
 #define NN_SURVEYOR_ACTION_CANCEL 2
+#define NN_SURVEYOR_ACTION_COMPLETE 3
 
 #define NN_SURVEYOR_SRC_DEADLINE_TIMER 1
 
 #define NN_SURVEYOR_TIMEDOUT 1
 
+/*  A survey in progress, used when there can be more than one. */
+struct nn_surveyor_survey {
+
+    /*  Survey ID as sent on the wire. */
+    uint32_t id;
+
+    /*  Point in time when the survey expires. */
+    uint64_t deadline;
+
+    /*  Number of respondents the survey was sent to and number of responses
+        received so far. */
+    int expected;
+    int responses;
+};
+
 struct nn_surveyor {
 
     /*  The underlying raw SP socket. */
@@ -73,8 +94,22 @@ struct nn_surveyor {
     /*  When starting the survey, the message is temporarily stored here. */
     struct nn_msg tosend;
 
+    /*  Number of respondents the current survey was sent to and number of
+        responses received so far. */
+    int expected;
+    int responses;
+
+    /*  Surveys in progress when maxsurveys is greater than 1, oldest
+        first. All of them share the timer which is set to expire at
+        'armed', the earliest of the deadlines. */
+    struct nn_surveyor_survey surveys [NN_SURVEYOR_MAX_SURVEYS];
+    int nsurveys;
+    uint64_t armed;
+
     /*  Protocol-specific socket options. */
     int deadline;
+    int quorum;
+    int maxsurveys;
 
     /*  Flag if surveyor has timed out */
     int timedout;
@@ -89,6 +124,16 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
 static void nn_surveyor_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static int nn_surveyor_inprogress (struct nn_surveyor *self);
+static int nn_surveyor_complete (struct nn_surveyor *self);
+static int nn_surveyor_survey_complete (struct nn_surveyor *self,
+    struct nn_surveyor_survey *survey);
+static int nn_surveyor_enough (struct nn_surveyor *self, int responses,
+    int expected);
+static int nn_surveyor_send_concurrent (struct nn_surveyor *self,
+    struct nn_msg *msg);
+static int nn_surveyor_recv_concurrent (struct nn_surveyor *self,
+    struct nn_msg *msg);
+static void nn_surveyor_reschedule (struct nn_surveyor *self);
 static void nn_surveyor_resend (struct nn_surveyor *self);
 
 /*  Implementation of nn_sockbase's virtual functions. */
@@ -129,7 +174,13 @@ static void nn_surveyor_init (struct nn_surveyor *self,
 
     nn_timer_init (&self->timer, NN_SURVEYOR_SRC_DEADLINE_TIMER, &self->fsm);
     nn_msg_init (&self->tosend, 0);
+    self->expected = 0;
+    self->responses = 0;
     self->deadline = NN_SURVEYOR_DEFAULT_DEADLINE;
+    self->quorum = 0;
+    self->maxsurveys = 1;
+    self->nsurveys = 0;
+    self->armed = 0;
     self->timedout = 0;
 
     /*  Start the state machine. */
@@ -166,11 +217,40 @@ void nn_surveyor_destroy (struct nn_sockbase *self)
 static int nn_surveyor_inprogress (struct nn_surveyor *self)
 {
     /*  Return 1 if there's a survey going on. 0 otherwise. */
+    if (self->maxsurveys > 1)
+        return self->nsurveys > 0 ? 1 : 0;
     return self->state == NN_SURVEYOR_STATE_IDLE ||
         self->state == NN_SURVEYOR_STATE_PASSIVE ||
         self->state == NN_SURVEYOR_STATE_STOPPING ? 0 : 1;
 }
 
+static int nn_surveyor_complete (struct nn_surveyor *self)
+{
+    /*  Return 1 if the survey got all the responses it was waiting for and
+        thus there's no need to wait for the deadline. 0 otherwise. */
+    if (self->maxsurveys > 1 || self->state != NN_SURVEYOR_STATE_ACTIVE)
+        return 0;
+    return nn_surveyor_enough (self, self->responses, self->expected);
+}
+
+static int nn_surveyor_survey_complete (struct nn_surveyor *self,
+    struct nn_surveyor_survey *survey)
+{
+    return nn_surveyor_enough (self, survey->responses, survey->expected);
+}
+
+static int nn_surveyor_enough (struct nn_surveyor *self, int responses,
+    int expected)
+{
+    /*  Early completion is opt-in. The number of attached pipes is only
+        the number of respondents if there are no devices in between. */
+    if (self->quorum == NN_SURVEYOR_QUORUM_ALL)
+        return responses >= expected ? 1 : 0;
+    if (self->quorum > 0)
+        return responses >= self->quorum ? 1 : 0;
+    return 0;
+}
+
 static int nn_surveyor_events (struct nn_sockbase *self)
 {
     int rc;
@@ -182,8 +262,11 @@ static int nn_surveyor_events (struct nn_sockbase *self)
     rc = nn_xsurveyor_events (&surveyor->xsurveyor.sockbase);
 
     /*  If there's no survey going on we'll signal IN to interrupt polling
-        when the survey expires. nn_recv() will return -EFSM afterwards. */
-    if (!nn_surveyor_inprogress (surveyor))
+        when the survey expires or completes. nn_recv() will return
+        -ETIMEDOUT or -EFSM afterwards. */
+    if (!nn_surveyor_inprogress (surveyor) ||
+          surveyor->state == NN_SURVEYOR_STATE_STOPPING_TIMER ||
+          nn_surveyor_complete (surveyor))
         rc |= NN_SOCKBASE_EVENT_IN;
 
     return rc;
@@ -195,6 +278,12 @@ static int nn_surveyor_send (struct nn_sockbase *self, struct nn_msg *msg)
 
     surveyor = nn_cont (self, struct nn_surveyor, xsurveyor.sockbase);
 
+    if (surveyor->maxsurveys > 1)
+        return nn_surveyor_send_concurrent (surveyor, msg);
+
+    /*  Any unreported outcome of the previous survey is void now. */
+    surveyor->timedout = 0;
+
     /*  Generate new survey ID. */
     ++surveyor->surveyid;
     surveyor->surveyid |= 0x80000000;
@@ -238,8 +327,12 @@ static int nn_surveyor_recv (struct nn_sockbase *self, struct nn_msg *msg)
 
     surveyor = nn_cont (self, struct nn_surveyor, xsurveyor.sockbase);
 
+    if (surveyor->maxsurveys > 1)
+        return nn_surveyor_recv_concurrent (surveyor, msg);
+
     /*  If no survey is going on return EFSM error. */
-    if (nn_slow (!nn_surveyor_inprogress (surveyor))) {
+    if (nn_slow (!nn_surveyor_inprogress (surveyor) ||
+          surveyor->state == NN_SURVEYOR_STATE_STOPPING_TIMER)) {
         if (surveyor->timedout == NN_SURVEYOR_TIMEDOUT) {
             surveyor->timedout = 0;
             return -ETIMEDOUT;
@@ -247,6 +340,13 @@ static int nn_surveyor_recv (struct nn_sockbase *self, struct nn_msg *msg)
             return -EFSM;
     }
 
+    /*  All the expected responses were received. Finish the survey without
+        waiting for the deadline. */
+    if (nn_surveyor_complete (surveyor)) {
+        nn_fsm_action (&surveyor->fsm, NN_SURVEYOR_ACTION_COMPLETE);
+        return -ETIMEDOUT;
+    }
+
     while (1) {
 
         /*  Get next response. */
@@ -266,6 +366,7 @@ static int nn_surveyor_recv (struct nn_sockbase *self, struct nn_msg *msg)
         /*  Discard the header and return the message to the user. */
         nn_chunkref_term (&msg->sphdr);
         nn_chunkref_init (&msg->sphdr, 0);
+        ++surveyor->responses;
         break;
     }
 
@@ -289,6 +390,30 @@ static int nn_surveyor_setopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
+    if (option == NN_SURVEYOR_QUORUM) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval < NN_SURVEYOR_QUORUM_ALL))
+            return -EINVAL;
+        surveyor->quorum = *(int*) optval;
+        return 0;
+    }
+
+    if (option == NN_SURVEYOR_MAXSURVEYS) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval < 1 ||
+              *(int*) optval > NN_SURVEYOR_MAX_SURVEYS))
+            return -EINVAL;
+
+        /*  The mode can't be switched while a survey is in progress. */
+        if (nn_slow (surveyor->state != NN_SURVEYOR_STATE_PASSIVE ||
+              surveyor->nsurveys > 0))
+            return -EINVAL;
+        surveyor->maxsurveys = *(int*) optval;
+        return 0;
+    }
+
     return -ENOPROTOOPT;
 }
 
@@ -310,6 +435,30 @@ static int nn_surveyor_getopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
+    if (option == NN_SURVEYOR_QUORUM) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = surveyor->quorum;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_SURVEYOR_MAXSURVEYS) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = surveyor->maxsurveys;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_SURVEYOR_SURVEYID) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = (int) surveyor->surveyid;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
     return -ENOPROTOOPT;
 }
 
@@ -375,6 +524,10 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
         case NN_FSM_ACTION:
             switch (type) {
             case NN_SURVEYOR_ACTION_START:
+                if (surveyor->maxsurveys > 1) {
+                    nn_surveyor_reschedule (surveyor);
+                    return;
+                }
                 nn_surveyor_resend (surveyor);
                 nn_timer_start (&surveyor->timer, surveyor->deadline);
                 surveyor->state = NN_SURVEYOR_STATE_ACTIVE;
@@ -401,6 +554,23 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
                 nn_timer_stop (&surveyor->timer);
                 surveyor->state = NN_SURVEYOR_STATE_CANCELLING;
                 return;
+            case NN_SURVEYOR_ACTION_START:
+
+                /*  New concurrent survey. Re-arm the timer if it expires
+                    sooner than the one the timer is waiting for. */
+                nn_assert (surveyor->nsurveys > 0);
+                if (surveyor->surveys [surveyor->nsurveys - 1].deadline <
+                      surveyor->armed) {
+                    nn_timer_stop (&surveyor->timer);
+                    surveyor->state = NN_SURVEYOR_STATE_RESCHEDULING;
+                }
+                return;
+            case NN_SURVEYOR_ACTION_COMPLETE:
+
+                /*  The completion is reported to the user straight away. */
+                nn_timer_stop (&surveyor->timer);
+                surveyor->state = NN_SURVEYOR_STATE_STOPPING_TIMER;
+                return;
             default:
                 nn_fsm_bad_action (surveyor->state, src, type);
             }
@@ -409,6 +579,10 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_TIMER_TIMEOUT:
                 nn_timer_stop (&surveyor->timer);
+                if (surveyor->maxsurveys > 1) {
+                    surveyor->state = NN_SURVEYOR_STATE_RESCHEDULING;
+                    return;
+                }
                 surveyor->state = NN_SURVEYOR_STATE_STOPPING_TIMER;
                 surveyor->timedout = NN_SURVEYOR_TIMEDOUT;
                 return;
@@ -480,6 +654,35 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
             nn_fsm_bad_source (surveyor->state, src, type);
         }
 
+/******************************************************************************/
+/*  RESCHEDULING state.                                                       */
+/*  Concurrent surveys only. The timer is being stopped, either because it    */
+/*  expired or because it has to be re-armed for an earlier deadline.         */
+/******************************************************************************/
+    case NN_SURVEYOR_STATE_RESCHEDULING:
+        switch (src) {
+
+        case NN_FSM_ACTION:
+            switch (type) {
+            case NN_SURVEYOR_ACTION_START:
+                return;
+            default:
+                nn_fsm_bad_action (surveyor->state, src, type);
+            }
+
+        case NN_SURVEYOR_SRC_DEADLINE_TIMER:
+            switch (type) {
+            case NN_TIMER_STOPPED:
+                nn_surveyor_reschedule (surveyor);
+                return;
+            default:
+                nn_fsm_bad_action (surveyor->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (surveyor->state, src, type);
+        }
+
 /******************************************************************************/
 /*  Invalid state.                                                            */
 /******************************************************************************/
@@ -488,11 +691,138 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
     }
 }
 
+/*  Drops the expired surveys and arms the timer for the earliest of the
+    remaining deadlines. The timer must not be running. */
+static void nn_surveyor_reschedule (struct nn_surveyor *self)
+{
+    uint64_t now;
+    int i;
+    int j;
+
+    now = nn_clock_ms ();
+    self->armed = 0;
+    for (i = 0, j = 0; i != self->nsurveys; ++i) {
+        if (self->surveys [i].deadline <= now) {
+            self->timedout = NN_SURVEYOR_TIMEDOUT;
+            continue;
+        }
+        if (self->armed == 0 || self->surveys [i].deadline < self->armed)
+            self->armed = self->surveys [i].deadline;
+        self->surveys [j++] = self->surveys [i];
+    }
+    self->nsurveys = j;
+
+    if (self->nsurveys == 0) {
+        self->state = NN_SURVEYOR_STATE_PASSIVE;
+        return;
+    }
+    nn_timer_start (&self->timer, (int) (self->armed - now));
+    self->state = NN_SURVEYOR_STATE_ACTIVE;
+}
+
+static int nn_surveyor_send_concurrent (struct nn_surveyor *self,
+    struct nn_msg *msg)
+{
+    int rc;
+    struct nn_surveyor_survey *survey;
+
+    /*  Generate new survey ID and tag the survey body with it. */
+    ++self->surveyid;
+    self->surveyid |= 0x80000000;
+    nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
+    nn_chunkref_term (&msg->sphdr);
+    nn_chunkref_init (&msg->sphdr, 4);
+    nn_putl (nn_chunkref_data (&msg->sphdr), self->surveyid);
+
+    /*  If there are too many surveys in progress, forget the oldest one. */
+    if (self->nsurveys == self->maxsurveys) {
+        memmove (&self->surveys [0], &self->surveys [1],
+            sizeof (struct nn_surveyor_survey) * (self->nsurveys - 1));
+        --self->nsurveys;
+    }
+    survey = &self->surveys [self->nsurveys++];
+    survey->id = self->surveyid;
+    survey->deadline = nn_clock_ms () + self->deadline;
+    survey->expected = (int) self->xsurveyor.outpipes.count;
+    survey->responses = 0;
+    self->timedout = 0;
+
+    rc = nn_xsurveyor_send (&self->xsurveyor.sockbase, msg);
+    errnum_assert (rc == 0, -rc);
+
+    nn_fsm_action (&self->fsm, NN_SURVEYOR_ACTION_START);
+
+    return 0;
+}
+
+static int nn_surveyor_recv_concurrent (struct nn_surveyor *self,
+    struct nn_msg *msg)
+{
+    int rc;
+    uint32_t surveyid;
+    int i;
+
+    /*  If no survey is going on return ETIMEDOUT once the last one has
+        finished, EFSM afterwards. */
+    if (nn_slow (self->nsurveys == 0)) {
+        if (self->timedout == NN_SURVEYOR_TIMEDOUT) {
+            self->timedout = 0;
+            return -ETIMEDOUT;
+        }
+        return -EFSM;
+    }
+
+    while (1) {
+
+        /*  Get next response. */
+        rc = nn_xsurveyor_recv (&self->xsurveyor.sockbase, msg);
+        if (nn_slow (rc == -EAGAIN))
+            return -EAGAIN;
+        errnum_assert (rc == 0, -rc);
+
+        /*  Find the survey the response belongs to. Ignore stale ones. */
+        if (nn_slow (nn_chunkref_size (&msg->sphdr) != sizeof (uint32_t))) {
+            nn_msg_term (msg);
+            continue;
+        }
+        surveyid = nn_getl (nn_chunkref_data (&msg->sphdr));
+        for (i = 0; i != self->nsurveys; ++i)
+            if (self->surveys [i].id == surveyid)
+                break;
+        if (nn_slow (i == self->nsurveys)) {
+            nn_msg_term (msg);
+            continue;
+        }
+
+        /*  Forget the survey once it got all the responses. Its timer
+            deadline is left as is, the timer will simply find nothing to
+            expire. */
+        ++self->surveys [i].responses;
+        if (nn_surveyor_survey_complete (self, &self->surveys [i])) {
+            memmove (&self->surveys [i], &self->surveys [i + 1],
+                sizeof (struct nn_surveyor_survey) *
+                (self->nsurveys - i - 1));
+            --self->nsurveys;
+            self->timedout = NN_SURVEYOR_TIMEDOUT;
+        }
+
+        /*  The survey ID is left in the header for the user to match
+            the response with the survey. */
+        break;
+    }
+
+    return 0;
+}
+
 static void nn_surveyor_resend (struct nn_surveyor *self)
 {
     int rc;
     struct nn_msg msg;
 
+    /*  The survey goes to all the respondents that are ready to receive. */
+    self->expected = (int) self->xsurveyor.outpipes.count;
+    self->responses = 0;
+
     nn_msg_cp (&msg, &self->tosend);
     rc = nn_xsurveyor_send (&self->xsurveyor.sockbase, &msg);
     errnum_assert (rc == 0, -rc);
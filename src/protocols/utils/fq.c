@@ -22,14 +22,21 @@
 
 #include "fq.h"
 
+#include "../../nn.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 
 #include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+
+static void nn_fq_refill (struct nn_fq *self, struct nn_fq_data *first);
 
 void nn_fq_init (struct nn_fq *self)
 {
     nn_priolist_init (&self->priolist);
+    self->turn = NULL;
 }
 
 void nn_fq_term (struct nn_fq *self)
@@ -40,11 +47,19 @@ void nn_fq_term (struct nn_fq *self)
 void nn_fq_add (struct nn_fq *self, struct nn_fq_data *data,
     struct nn_pipe *pipe, int priority)
 {
+    size_t sz;
+
+    sz = sizeof (data->quantum);
+    nn_pipe_getopt (pipe, NN_SOL_SOCKET, NN_RCVQUANTUM, &data->quantum, &sz);
+    nn_assert (sz == sizeof (data->quantum));
+    data->deficit = 0;
     nn_priolist_add (&self->priolist, &data->priodata, pipe, priority);
 }
 
 void nn_fq_rm (struct nn_fq *self, struct nn_fq_data *data)
 {
+    if (self->turn == data)
+        self->turn = NULL;
     nn_priolist_rm (&self->priolist, &data->priodata);
 }
 
@@ -61,24 +76,100 @@ int nn_fq_can_recv (struct nn_fq *self)
 int nn_fq_recv (struct nn_fq *self, struct nn_msg *msg, struct nn_pipe **pipe)
 {
     int rc;
-    struct nn_pipe *p;
-
-    /*  Pipe is NULL only when there are no avialable pipes. */
-    p = nn_priolist_getpipe (&self->priolist);
-    if (nn_slow (!p))
-        return -EAGAIN;
+    struct nn_priolist_data *pd;
+    struct nn_fq_data *data;
+    size_t sz;
+
+    while (1) {
+
+        /*  Data is NULL only when there are no avialable pipes. */
+        pd = nn_priolist_getdata (&self->priolist);
+        if (nn_slow (!pd))
+            return -EAGAIN;
+        data = nn_cont (pd, struct nn_fq_data, priodata);
+
+        /*  Plain round-robin. */
+        if (nn_fast (data->quantum == 0))
+            break;
+
+        /*  New deficit round-robin turn begins. Pipes still in debt are
+            skipped. */
+        if (self->turn != data) {
+            self->turn = data;
+            if (data->deficit + data->quantum <= 0)
+                nn_fq_refill (self, data);
+            data->deficit += data->quantum;
+            if (data->deficit <= 0) {
+                self->turn = NULL;
+                nn_priolist_advance (&self->priolist, 0);
+                continue;
+            }
+        }
+        break;
+    }
 
     /*  Receive the messsage. */
-    rc = nn_pipe_recv (p, msg);
+    rc = nn_pipe_recv (pd->pipe, msg);
     errnum_assert (rc >= 0, -rc);
 
     /*  Return the pipe data to the user, if required. */
     if (pipe)
-        *pipe = p;
-
-    /*  Move to the next pipe. */
-    nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
+        *pipe = pd->pipe;
+
+    if (data->quantum == 0) {
+
+        /*  Move to the next pipe. */
+        nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
+        return rc & ~NN_PIPE_RELEASE;
+    }
+
+    /*  Charge the message to the pipe's deficit. The pipe keeps its turn
+        until the deficit is exhausted. Idle pipes don't accumulate credit,
+        but keep their debt. */
+    sz = nn_chunkref_size (&msg->sphdr) + nn_chunkref_size (&msg->body);
+    data->deficit -= sz > INT_MAX ? INT_MAX : (int) sz;
+    if (rc & NN_PIPE_RELEASE) {
+        if (data->deficit > 0)
+            data->deficit = 0;
+        self->turn = NULL;
+        nn_priolist_advance (&self->priolist, 1);
+    }
+    else if (data->deficit <= 0) {
+        self->turn = NULL;
+        nn_priolist_advance (&self->priolist, 0);
+    }
 
     return rc & ~NN_PIPE_RELEASE;
 }
 
+/*  If none of the pipes on the priority level would get its turn in the
+    coming round because of the debts, skips the rounds it would take for
+    the first of them to repay its debt at once, rather than going through
+    them one by one. */
+static void nn_fq_refill (struct nn_fq *self, struct nn_fq_data *first)
+{
+    struct nn_fq_data *data;
+    int64_t rounds;
+    int64_t r;
+
+    rounds = INT64_MAX;
+    data = first;
+    do {
+        if (data->quantum == 0 || data->deficit + data->quantum > 0)
+            return;
+        r = ((int64_t) data->quantum - data->deficit) / data->quantum;
+        if (r < rounds)
+            rounds = r;
+        data = nn_cont (nn_priolist_next (&self->priolist, &data->priodata),
+            struct nn_fq_data, priodata);
+    } while (data != first);
+
+    /*  Every pipe needs at least two more quanta to get out of debt. Add all
+        but the last one, which the pipes get on their turns as usual. */
+    nn_assert (rounds >= 2);
+    do {
+        data->deficit += (int) ((rounds - 1) * data->quantum);
+        data = nn_cont (nn_priolist_next (&self->priolist, &data->priodata),
+            struct nn_fq_data, priodata);
+    } while (data != first);
+}
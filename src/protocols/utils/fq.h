@@ -28,14 +28,29 @@
 #include "priolist.h"
 
 /*  Fair-queuer. Retrieves messages from a set of pipes in round-robin
-    manner. */
+    manner. Pipes with non-zero NN_RCVQUANTUM are served using byte-based
+    deficit round-robin instead: a pipe keeps its turn until it has consumed
+    its quantum of bytes, and a pipe that overdrew its deficit with a large
+    message sits out the following rounds until the debt is repaid. */
 
 struct nn_fq_data {
     struct nn_priolist_data priodata;
+
+    /*  Number of bytes added to the deficit on each turn. Zero means that
+        the pipe is served one message per turn. */
+    int quantum;
+
+    /*  Number of bytes the pipe can still receive in the current turn.
+        Negative value is a debt left by an oversized message. */
+    int deficit;
 };
 
 struct nn_fq {
     struct nn_priolist priolist;
+
+    /*  The pipe whose deficit round-robin turn is in progress, NULL if
+        there's none. */
+    struct nn_fq_data *turn;
 };
 
 void nn_fq_init (struct nn_fq *self);
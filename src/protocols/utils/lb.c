@@ -22,6 +22,8 @@
 
 #include "lb.h"
 
+#include "../../nn.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 
@@ -30,6 +32,7 @@
 void nn_lb_init (struct nn_lb *self)
 {
     nn_priolist_init (&self->priolist);
+    self->strategy = NN_LB_ROUND_ROBIN;
 }
 
 void nn_lb_term (struct nn_lb *self)
@@ -63,6 +66,11 @@ int nn_lb_get_priority (struct nn_lb *self)
     return nn_priolist_get_priority (&self->priolist);
 }
 
+void nn_lb_set_strategy (struct nn_lb *self, int strategy)
+{
+    self->strategy = strategy;
+}
+
 int nn_lb_send (struct nn_lb *self, struct nn_msg *msg, struct nn_pipe **to)
 {
     int rc;
@@ -73,6 +81,16 @@ int nn_lb_send (struct nn_lb *self, struct nn_msg *msg, struct nn_pipe **to)
     if (nn_slow (!pipe))
         return -EAGAIN;
 
+    /*  Unless plain round-robin is used, re-consider the choice based on
+        the load of the pipes. */
+    if (nn_slow (self->strategy != NN_LB_ROUND_ROBIN)) {
+        if (self->strategy == NN_LB_LEAST_OUTSTANDING)
+            nn_priolist_pick_least (&self->priolist, nn_pipe_outstanding);
+        else
+            nn_priolist_pick_two (&self->priolist, nn_pipe_backlog);
+        pipe = nn_priolist_getpipe (&self->priolist);
+    }
+
     /*  Send the messsage. */
     rc = nn_pipe_send (pipe, msg);
     errnum_assert (rc >= 0, -rc);
@@ -27,7 +27,9 @@
 
 #include "priolist.h"
 
-/*  A load balancer. Round-robins messages to a set of pipes. */
+/*  A load balancer. By default, round-robins messages to a set of pipes.
+    Alternatively, it can pick the pipe with the least outstanding requests
+    or the less backlogged of two pipes (see NN_LB_STRATEGY option). */
 
 struct nn_lb_data {
     struct nn_priolist_data priodata;
@@ -35,6 +37,9 @@ struct nn_lb_data {
 
 struct nn_lb {
     struct nn_priolist priolist;
+
+    /*  One of NN_LB_* strategies. */
+    int strategy;
 };
 
 void nn_lb_init (struct nn_lb *self);
@@ -45,6 +50,7 @@ void nn_lb_rm (struct nn_lb *self, struct nn_lb_data *data);
 void nn_lb_out (struct nn_lb *self, struct nn_lb_data *data);
 int nn_lb_can_send (struct nn_lb *self);
 int nn_lb_get_priority (struct nn_lb *self);
+void nn_lb_set_strategy (struct nn_lb *self, int strategy);
 int nn_lb_send (struct nn_lb *self, struct nn_msg *msg, struct nn_pipe **to);
 
 #endif
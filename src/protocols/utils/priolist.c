@@ -27,6 +27,7 @@
 #include "../../utils/fast.h"
 #include "../../utils/err.h"
 #include "../../utils/attr.h"
+#include "../../utils/random.h"
 
 #include <stddef.h>
 
@@ -37,6 +38,7 @@ void nn_priolist_init (struct nn_priolist *self)
     for (i = 0; i != NN_PRIOLIST_SLOTS; ++i) {
         nn_list_init (&self->slots [i].pipes);
         self->slots [i].current = NULL;
+        self->slots [i].count = 0;
     }
     self->current = -1;
 }
@@ -71,6 +73,7 @@ void nn_priolist_rm (struct nn_priolist *self, struct nn_priolist_data *data)
     /*  If the pipe being removed is not current, we can simply erase it
         from the list. */
     slot = &self->slots [data->priority - 1];
+    --slot->count;
     if (slot->current != data) {
         nn_list_erase (&slot->pipes, &data->item);
         nn_list_item_term (&data->item);
@@ -107,6 +110,7 @@ void nn_priolist_activate (struct nn_priolist *self,
     struct nn_priolist_slot *slot;
 
     slot = &self->slots [data->priority - 1];
+    ++slot->count;
 
     /*  If there are already some elements in this slot, current pipe is not
         going to change. */
@@ -146,6 +150,13 @@ struct nn_pipe *nn_priolist_getpipe (struct nn_priolist *self)
     return self->slots [self->current - 1].current->pipe;
 }
 
+struct nn_priolist_data *nn_priolist_getdata (struct nn_priolist *self)
+{
+    if (nn_slow (self->current == -1))
+        return NULL;
+    return self->slots [self->current - 1].current;
+}
+
 void nn_priolist_advance (struct nn_priolist *self, int release)
 {
     struct nn_priolist_slot *slot;
@@ -155,8 +166,10 @@ void nn_priolist_advance (struct nn_priolist *self, int release)
     slot = &self->slots [self->current - 1];
 
     /*  Move slot's current pointer to the next pipe. */
-    if (release)
+    if (release) {
         it = nn_list_erase (&slot->pipes, &slot->current->item);
+        --slot->count;
+    }
     else
         it = nn_list_next (&slot->pipes, &slot->current->item);
     if (!it)
@@ -175,6 +188,80 @@ void nn_priolist_advance (struct nn_priolist *self, int release)
     }
 }
 
+struct nn_priolist_data *nn_priolist_next (struct nn_priolist *self,
+    struct nn_priolist_data *data)
+{
+    struct nn_priolist_slot *slot;
+    struct nn_list_item *it;
+
+    slot = &self->slots [data->priority - 1];
+    it = nn_list_next (&slot->pipes, &data->item);
+    if (!it)
+        it = nn_list_begin (&slot->pipes);
+    return nn_cont (it, struct nn_priolist_data, item);
+}
+
+void nn_priolist_pick_least (struct nn_priolist *self,
+    int (*load) (struct nn_pipe *pipe))
+{
+    struct nn_priolist_slot *slot;
+    struct nn_list_item *it;
+    struct nn_priolist_data *data;
+    struct nn_priolist_data *best;
+    int bestload;
+    int l;
+
+    nn_assert (self->current > 0);
+    slot = &self->slots [self->current - 1];
+
+    /*  Walk the whole level, starting with the current pipe. */
+    best = slot->current;
+    bestload = load (best->pipe);
+    it = &best->item;
+    while (bestload > 0) {
+        it = nn_list_next (&slot->pipes, it);
+        if (!it)
+            it = nn_list_begin (&slot->pipes);
+        data = nn_cont (it, struct nn_priolist_data, item);
+        if (data == slot->current)
+            break;
+        l = load (data->pipe);
+        if (l < bestload) {
+            best = data;
+            bestload = l;
+        }
+    }
+    slot->current = best;
+}
+
+void nn_priolist_pick_two (struct nn_priolist *self,
+    int (*load) (struct nn_pipe *pipe))
+{
+    struct nn_priolist_slot *slot;
+    struct nn_list_item *it;
+    struct nn_priolist_data *other;
+    uint32_t i;
+
+    nn_assert (self->current > 0);
+    slot = &self->slots [self->current - 1];
+    if (slot->count < 2)
+        return;
+
+    /*  Choose the other candidate randomly among the remaining pipes. */
+    nn_random_generate (&i, sizeof (i));
+    i = i % (slot->count - 1) + 1;
+    it = &slot->current->item;
+    while (i--) {
+        it = nn_list_next (&slot->pipes, it);
+        if (!it)
+            it = nn_list_begin (&slot->pipes);
+    }
+    other = nn_cont (it, struct nn_priolist_data, item);
+
+    if (load (other->pipe) < load (slot->current->pipe))
+        slot->current = other;
+}
+
 int nn_priolist_get_priority (struct nn_priolist *self) {
     return self->current;
 }
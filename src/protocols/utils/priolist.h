@@ -52,6 +52,9 @@ struct nn_priolist_slot {
     /*  Pointer to the current pipe within the priority level. If there's no
         pipe available, the field is set to NULL. */
     struct nn_priolist_data *current;
+
+    /*  Number of pipes in the 'pipes' list. */
+    int count;
 };
 
 struct nn_priolist {
@@ -91,11 +94,31 @@ int nn_priolist_is_active (struct nn_priolist *self);
     NULL is returned. */
 struct nn_pipe *nn_priolist_getpipe (struct nn_priolist *self);
 
+/*  Get the pointer to the data of the current pipe. If there's no pipe in
+    the list, NULL is returned. */
+struct nn_priolist_data *nn_priolist_getdata (struct nn_priolist *self);
+
 /*  Moves to the next pipe in the list. If 'release' is set to 1, the current
     pipe is removed from the list. To re-insert it into the list use
     nn_priolist_activate function. */
 void nn_priolist_advance (struct nn_priolist *self, int release);
 
+/*  Returns the data of the active pipe following the one specified on the
+    same priority level, wrapping over at the end of the level. */
+struct nn_priolist_data *nn_priolist_next (struct nn_priolist *self,
+    struct nn_priolist_data *data);
+
+/*  Makes the pipe with the lowest load on the current priority level the
+    current pipe. Ties are resolved in favour of the pipe that would be
+    current in round-robin order. */
+void nn_priolist_pick_least (struct nn_priolist *self,
+    int (*load) (struct nn_pipe *pipe));
+
+/*  Compares the load of the current pipe with a randomly chosen pipe on the
+    same priority level and makes the less loaded one current. */
+void nn_priolist_pick_two (struct nn_priolist *self,
+    int (*load) (struct nn_pipe *pipe));
+
 /*  Returns current priority. Used for statistics only  */
 int nn_priolist_get_priority (struct nn_priolist *self);
 
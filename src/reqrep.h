@@ -36,6 +36,10 @@ extern "C" {
 #define NN_REP (NN_PROTO_REQREP * 16 + 1)
 
 #define NN_REQ_RESEND_IVL 1
+#define NN_REQ_RESEND_ADAPTIVE 2
+#define NN_REQ_RTT 3
+
+#define NN_REP_CONTEXT 1
 
 typedef union nn_req_handle {
     int i;
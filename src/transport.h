@@ -151,6 +151,7 @@ struct nn_ep_options
     int sndprio;
     int rcvprio;
     int ipv4only;
+    int rcvquantum;
 };
 
 /*  The member of this structure are used internally by the core. Never use
@@ -166,6 +167,30 @@ struct nn_pipebase {
     struct nn_fsm_event in;
     struct nn_fsm_event out;
     struct nn_ep_options options;
+
+    /*  Load indicators, see nn_pipe_outstanding and nn_pipe_backlog.
+        'send_stamp' is the time the send in progress started at. */
+    uint64_t sent;
+    uint64_t received;
+    int outstanding;
+    int backlog;
+    uint64_t backlog_stamp;
+    uint64_t send_stamp;
+
+    /*  Statistics reported by nn_get_statistics. 'queued' is the number of
+        inbound messages buffered by the transport, for transports that
+        buffer more than one message (e.g. inproc) to keep it up to date. */
+    int eid;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    size_t queued;
+
+    /*  Time when the last inbound message was fully received. It is used as
+        the start of its delivery latency unless the sender stamped it. */
+    uint64_t in_stamp;
+
+    /*  Member of the list of the socket's pipes. */
+    struct nn_list_item item;
 };
 
 /*  Initialise the pipe.  */
@@ -195,6 +220,9 @@ void nn_pipebase_getopt (struct nn_pipebase *self, int level, int option,
     or 0 otherwise. */
 int nn_pipebase_ispeer (struct nn_pipebase *self, int socktype);
 
+/*  Returns the socket the pipe belongs to, as returned by nn_socket. */
+int nn_pipebase_socket (struct nn_pipebase *self);
+
 /******************************************************************************/
 /*  The transport class.                                                      */
 /******************************************************************************/
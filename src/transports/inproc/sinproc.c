@@ -160,6 +160,7 @@ static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg)
         nn_chunkref_size (&msg->sphdr),
         nn_chunkref_data (&msg->body),
         nn_chunkref_size (&msg->body));
+    nmsg.stamp = msg->stamp;
     nn_msg_term (msg);
 
     /*  Expose the message to the peer. */
@@ -207,6 +208,7 @@ static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg)
         }
     }
 
+    sinproc->pipebase.queued = sinproc->msgqueue.count;
     if (!nn_msgqueue_empty (&sinproc->msgqueue))
        nn_pipebase_received (&sinproc->pipebase);
 
@@ -436,6 +438,7 @@ static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
                 }
                 errnum_assert (rc == 0, -rc);
                 nn_msg_init (&sinproc->peer->msg, 0);
+                sinproc->pipebase.queued = sinproc->msgqueue.count;
 
                 /*  Notify the user that there's a message to receive. */
                 if (empty)
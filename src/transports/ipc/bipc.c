@@ -25,6 +25,8 @@
 #include "bipc.h"
 #include "aipc.h"
 
+#include "../../ipc.h"
+
 #include "../../aio/fsm.h"
 #include "../../aio/usock.h"
 
@@ -45,6 +47,8 @@
 
 #define NN_BIPC_BACKLOG 10
 
+CT_ASSERT (NN_BIPC_MAX_ACCEPT_BATCH <= NN_USOCK_ACCEPT_BATCH);
+
 #define NN_BIPC_STATE_IDLE 1
 #define NN_BIPC_STATE_ACTIVE 2
 #define NN_BIPC_STATE_STOPPING_AIPC 3
@@ -65,6 +69,9 @@ struct nn_bipc {
     /*  The underlying listening IPC socket. */
     struct nn_usock usock;
 
+    /*  Number of connections the listening socket accepts in one go. */
+    int acceptbatch;
+
     /*  The connection being accepted at the moment. */
     struct nn_aipc *aipc;
 
@@ -92,11 +99,14 @@ int nn_bipc_create (struct nn_ep *ep)
 {
     struct nn_bipc *self;
     int rc;
+    size_t sz;
 
     /*  Allocate the new endpoint object. */
     self = nn_alloc (sizeof (struct nn_bipc), "bipc");
     alloc_assert (self);
-
+    sz = sizeof (self->acceptbatch);
+    nn_ep_getopt (ep, NN_IPC, NN_IPC_ACCEPT_BATCH, &self->acceptbatch, &sz);
+    nn_assert (sz == sizeof (self->acceptbatch));
 
     /*  Initialise the structure. */
     self->ep = ep;
@@ -331,6 +341,7 @@ static int nn_bipc_listen (struct nn_bipc *self)
         nn_usock_stop (&self->usock);
         return rc;
     }
+    nn_usock_accept_batch (&self->usock, self->acceptbatch);
     nn_bipc_start_accepting (self);
 
     return 0;
@@ -28,6 +28,9 @@
 
 /*  State machine managing bound IPC socket. */
 
+/*  Maximum value of NN_IPC_ACCEPT_BATCH. */
+#define NN_BIPC_MAX_ACCEPT_BATCH 16
+
 int nn_bipc_create (struct nn_ep *);
 
 #endif
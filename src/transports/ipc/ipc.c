@@ -50,6 +50,7 @@ struct nn_ipc_optset {
 
     int outbuffersz;
     int inbuffersz;
+    int acceptbatch;
 };
 
 static void nn_ipc_optset_destroy (struct nn_optset *self);
@@ -100,6 +101,7 @@ static struct nn_optset *nn_ipc_optset ()
     optset->sec_attr = NULL;
     optset->outbuffersz = 4096;
     optset->inbuffersz = 4096;
+    optset->acceptbatch = 1;
 
     return &optset->base;   
 }
@@ -132,6 +134,12 @@ static int nn_ipc_optset_setopt (struct nn_optset *self, int option,
     case NN_IPC_INBUFSZ:
         optset->inbuffersz = *(int *)optval;
         return 0;
+    case NN_IPC_ACCEPT_BATCH:
+        if (nn_slow (*(int *)optval < 1 ||
+              *(int *)optval > NN_BIPC_MAX_ACCEPT_BATCH))
+            return -EINVAL;
+        optset->acceptbatch = *(int *)optval;
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -157,6 +165,10 @@ static int nn_ipc_optset_getopt (struct nn_optset *self, int option,
         *(int *)optval = optset->inbuffersz;
         *optvallen = sizeof (int);
         return 0;
+    case NN_IPC_ACCEPT_BATCH:
+        *(int *)optval = optset->acceptbatch;
+        *optvallen = sizeof (int);
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
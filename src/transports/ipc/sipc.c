@@ -28,6 +28,7 @@
 #include "../../utils/fast.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
+#include "../../utils/trace.h"
 
 /*  Types of messages passed via IPC transport. */
 #define NN_SIPC_MSG_NORMAL 1
@@ -320,6 +321,9 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                 /*  The message is now fully sent. */
                 nn_assert (sipc->outstate == NN_SIPC_OUTSTATE_SENDING);
                 sipc->outstate = NN_SIPC_OUTSTATE_IDLE;
+                nn_tracepoint (NN_TRACE_USOCK_SENT,
+                    nn_pipebase_socket (&sipc->pipebase), &sipc->pipebase,
+                    nn_chunkref_size (&sipc->outmsg.body), sipc->outmsg.stamp);
                 nn_msg_term (&sipc->outmsg);
                 nn_msg_init (&sipc->outmsg, 0);
                 nn_pipebase_sent (&sipc->pipebase);
@@ -353,6 +357,9 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                     if (!size) {
                         sipc->instate = NN_SIPC_INSTATE_HASMSG;
                         nn_pipebase_received (&sipc->pipebase);
+                        nn_tracepoint (NN_TRACE_USOCK_RECEIVED,
+                            nn_pipebase_socket (&sipc->pipebase),
+                            &sipc->pipebase, 0, sipc->pipebase.in_stamp);
                         return;
                     }
 
@@ -370,6 +377,10 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                         can receive it. */
                     sipc->instate = NN_SIPC_INSTATE_HASMSG;
                     nn_pipebase_received (&sipc->pipebase);
+                    nn_tracepoint (NN_TRACE_USOCK_RECEIVED,
+                        nn_pipebase_socket (&sipc->pipebase), &sipc->pipebase,
+                        nn_chunkref_size (&sipc->inmsg.body),
+                        sipc->pipebase.in_stamp);
 
                     return;
 
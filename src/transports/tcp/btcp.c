@@ -24,6 +24,8 @@
 #include "btcp.h"
 #include "atcp.h"
 
+#include "../../tcp.h"
+
 #include "../utils/port.h"
 #include "../utils/iface.h"
 
@@ -45,12 +47,15 @@
 #else
 #include <unistd.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
 #endif
 
 /*  The backlog is set relatively high so that there are not too many failed
     connection attemps during re-connection storms. */
 #define NN_BTCP_BACKLOG 100
 
+CT_ASSERT (NN_BTCP_MAX_ACCEPT_BATCH <= NN_USOCK_ACCEPT_BATCH);
+
 #define NN_BTCP_STATE_IDLE 1
 #define NN_BTCP_STATE_ACTIVE 2
 #define NN_BTCP_STATE_STOPPING_ATCP 3
@@ -63,6 +68,14 @@
 
 #define NN_BTCP_TYPE_LISTEN_ERR 1
 
+struct nn_btcp_listener {
+
+    /*  The underlying listening TCP socket. */
+    struct nn_usock usock;
+
+    /*  The connection being accepted at the moment. */
+    struct nn_atcp *atcp;
+};
 
 struct nn_btcp {
 
@@ -73,11 +86,15 @@ struct nn_btcp {
 
     struct nn_ep *ep;
 
-    /*  The underlying listening TCP socket. */
-    struct nn_usock usock;
+    /*  Listening sockets. If there's more than one, they share the port
+        using SO_REUSEPORT and the kernel spreads incoming connections among
+        them. Each one is handled by a different worker thread, as far as
+        the worker pool allows. */
+    struct nn_btcp_listener *listeners;
+    int nlisteners;
 
-    /*  The connection being accepted at the moment. */
-    struct nn_atcp *atcp;
+    /*  Number of connections each listening socket accepts in one go. */
+    int acceptbatch;
 
     /*  List of accepted connections. */
     struct nn_list atcps;
@@ -97,7 +114,8 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
 static void nn_btcp_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static int nn_btcp_listen (struct nn_btcp *self);
-static void nn_btcp_start_accepting (struct nn_btcp *self);
+static void nn_btcp_start_accepting (struct nn_btcp *self,
+    struct nn_btcp_listener *listener);
 
 int nn_btcp_create (struct nn_ep *ep)
 {
@@ -110,6 +128,11 @@ int nn_btcp_create (struct nn_ep *ep)
     size_t sslen;
     int ipv4only;
     size_t ipv4onlylen;
+    int nlisteners;
+    size_t nlistenerslen;
+    int acceptbatch;
+    size_t acceptbatchlen;
+    int i;
 
     /*  Allocate the new endpoint object. */
     self = nn_alloc (sizeof (struct nn_btcp), "btcp");
@@ -145,18 +168,41 @@ int nn_btcp_create (struct nn_ep *ep)
         return -ENODEV;
     }
 
+    /*  Number of listening sockets to open. Sharing a port among several
+        sockets requires SO_REUSEPORT. */
+    nlistenerslen = sizeof (nlisteners);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_LISTENERS, &nlisteners, &nlistenerslen);
+    nn_assert (nlistenerslen == sizeof (nlisteners));
+#if !defined SO_REUSEPORT
+    nlisteners = 1;
+#endif
+    acceptbatchlen = sizeof (acceptbatch);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_ACCEPT_BATCH, &acceptbatch,
+        &acceptbatchlen);
+    nn_assert (acceptbatchlen == sizeof (acceptbatch));
+
     /*  Initialise the structure. */
     nn_fsm_init_root (&self->fsm, nn_btcp_handler, nn_btcp_shutdown,
         nn_ep_getctx (ep));
     nn_fsm_event_init (&self->listen_error);
     self->state = NN_BTCP_STATE_IDLE;
-    self->atcp = NULL;
+    self->listeners = nn_alloc (sizeof (struct nn_btcp_listener) * nlisteners,
+        "btcp listeners");
+    alloc_assert (self->listeners);
+    self->nlisteners = nlisteners;
+    self->acceptbatch = acceptbatch;
     nn_list_init (&self->atcps);
 
     /*  Start the state machine. */
     nn_fsm_start (&self->fsm);
 
-    nn_usock_init (&self->usock, NN_BTCP_SRC_USOCK, &self->fsm);
+    /*  The usocks are initialised back to back so that each of them picks
+        a different worker thread from the pool. */
+    for (i = 0; i != nlisteners; ++i) {
+        nn_usock_init (&self->listeners [i].usock, NN_BTCP_SRC_USOCK,
+            &self->fsm);
+        self->listeners [i].atcp = NULL;
+    }
 
     rc = nn_btcp_listen (self);
     if (rc != 0) {
@@ -178,11 +224,15 @@ static void nn_btcp_stop (void *self)
 static void nn_btcp_destroy (void *self)
 {
     struct nn_btcp *btcp = self;
+    int i;
 
     nn_assert_state (btcp, NN_BTCP_STATE_IDLE);
     nn_list_term (&btcp->atcps);
-    nn_assert (btcp->atcp == NULL);
-    nn_usock_term (&btcp->usock);
+    for (i = 0; i != btcp->nlisteners; ++i) {
+        nn_assert (btcp->listeners [i].atcp == NULL);
+        nn_usock_term (&btcp->listeners [i].usock);
+    }
+    nn_free (btcp->listeners);
     nn_fsm_term (&btcp->fsm);
 
     nn_free (btcp);
@@ -194,30 +244,37 @@ static void nn_btcp_shutdown (struct nn_fsm *self, int src, int type,
     struct nn_btcp *btcp;
     struct nn_list_item *it;
     struct nn_atcp *atcp;
+    struct nn_btcp_listener *listener;
+    int i;
 
     btcp = nn_cont (self, struct nn_btcp, fsm);
 
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
-        if (btcp->atcp) {
-            nn_atcp_stop (btcp->atcp);
-            btcp->state = NN_BTCP_STATE_STOPPING_ATCP;
-        }
-        else {
-            btcp->state = NN_BTCP_STATE_STOPPING_USOCK;
-        }
+        for (i = 0; i != btcp->nlisteners; ++i)
+            if (btcp->listeners [i].atcp)
+                nn_atcp_stop (btcp->listeners [i].atcp);
+        btcp->state = NN_BTCP_STATE_STOPPING_ATCP;
     }
     if (nn_slow (btcp->state == NN_BTCP_STATE_STOPPING_ATCP)) {
-        if (!nn_atcp_isidle (btcp->atcp))
-            return;
-        nn_atcp_term (btcp->atcp);
-        nn_free (btcp->atcp);
-        btcp->atcp = NULL;
-        nn_usock_stop (&btcp->usock);
+        for (i = 0; i != btcp->nlisteners; ++i)
+            if (btcp->listeners [i].atcp &&
+                  !nn_atcp_isidle (btcp->listeners [i].atcp))
+                return;
+        for (i = 0; i != btcp->nlisteners; ++i) {
+            listener = &btcp->listeners [i];
+            if (listener->atcp) {
+                nn_atcp_term (listener->atcp);
+                nn_free (listener->atcp);
+                listener->atcp = NULL;
+            }
+            nn_usock_stop (&listener->usock);
+        }
         btcp->state = NN_BTCP_STATE_STOPPING_USOCK;
     }
     if (nn_slow (btcp->state == NN_BTCP_STATE_STOPPING_USOCK)) {
-       if (!nn_usock_isidle (&btcp->usock))
-            return;
+        for (i = 0; i != btcp->nlisteners; ++i)
+            if (!nn_usock_isidle (&btcp->listeners [i].usock))
+                return;
         for (it = nn_list_begin (&btcp->atcps);
               it != nn_list_end (&btcp->atcps);
               it = nn_list_next (&btcp->atcps, it)) {
@@ -255,6 +312,7 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
 {
     struct nn_btcp *btcp;
     struct nn_atcp *atcp;
+    int i;
 
     btcp = nn_cont (self, struct nn_btcp, fsm);
 
@@ -276,6 +334,7 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
     case NN_BTCP_STATE_ACTIVE:
         if (src == NN_BTCP_SRC_BTCP) {   
             nn_assert (type == NN_BTCP_TYPE_LISTEN_ERR);
+            nn_free (btcp->listeners);
             nn_free (btcp);
             return;
         }
@@ -291,11 +350,14 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
         atcp = (struct nn_atcp*) srcptr;
         switch (type) {
         case NN_ATCP_ACCEPTED:
-            nn_assert (btcp->atcp == atcp) ;
+            for (i = 0; i != btcp->nlisteners; ++i)
+                if (btcp->listeners [i].atcp == atcp)
+                    break;
+            nn_assert (i < btcp->nlisteners);
             nn_list_insert (&btcp->atcps, &atcp->item,
                 nn_list_end (&btcp->atcps));
-            btcp->atcp = NULL;
-            nn_btcp_start_accepting (btcp);
+            btcp->listeners [i].atcp = NULL;
+            nn_btcp_start_accepting (btcp, &btcp->listeners [i]);
             return;
         case NN_ATCP_ERROR:
             nn_atcp_stop (atcp);
@@ -328,6 +390,8 @@ static int nn_btcp_listen (struct nn_btcp *self)
     const char *end;
     const char *pos;
     uint16_t port;
+    int i;
+    int opt;
 
     /*  First, resolve the IP address. */
     addr = nn_ep_getaddr (self->ep);
@@ -370,40 +434,63 @@ static int nn_btcp_listen (struct nn_btcp *self)
     }
 
     /*  Start listening for incoming connections. */
-    rc = nn_usock_start (&self->usock, ss.ss_family, SOCK_STREAM, 0);
-    if (rc < 0) {
-        return rc;
-    }
+    for (i = 0; i != self->nlisteners; ++i) {
+        rc = nn_usock_start (&self->listeners [i].usock, ss.ss_family,
+            SOCK_STREAM, 0);
+        if (rc < 0)
+            goto error;
+
+#if defined SO_REUSEPORT
+        if (self->nlisteners > 1) {
+            opt = 1;
+            rc = nn_usock_setsockopt (&self->listeners [i].usock, SOL_SOCKET,
+                SO_REUSEPORT, &opt, sizeof (opt));
+            if (rc < 0) {
+                nn_usock_stop (&self->listeners [i].usock);
+                goto error;
+            }
+        }
+#endif
 
-    rc = nn_usock_bind (&self->usock, (struct sockaddr*) &ss, (size_t) sslen);
-    if (rc < 0) {
-       nn_usock_stop (&self->usock);
-       return rc;
-    }
+        rc = nn_usock_bind (&self->listeners [i].usock,
+            (struct sockaddr*) &ss, (size_t) sslen);
+        if (rc < 0) {
+            nn_usock_stop (&self->listeners [i].usock);
+            goto error;
+        }
 
-    rc = nn_usock_listen (&self->usock, NN_BTCP_BACKLOG);
-    if (rc < 0) {
-        nn_usock_stop (&self->usock);
-        return rc;
+        rc = nn_usock_listen (&self->listeners [i].usock, NN_BTCP_BACKLOG);
+        if (rc < 0) {
+            nn_usock_stop (&self->listeners [i].usock);
+            goto error;
+        }
+        nn_usock_accept_batch (&self->listeners [i].usock, self->acceptbatch);
     }
-    nn_btcp_start_accepting(self);
+    for (i = 0; i != self->nlisteners; ++i)
+        nn_btcp_start_accepting (self, &self->listeners [i]);
 
     return 0;
+
+error:
+    while (i > 0)
+        nn_usock_stop (&self->listeners [--i].usock);
+    return rc;
 }
 
 /******************************************************************************/
 /*  State machine actions.                                                    */
 /******************************************************************************/
 
-static void nn_btcp_start_accepting (struct nn_btcp *self)
+static void nn_btcp_start_accepting (struct nn_btcp *self,
+    struct nn_btcp_listener *listener)
 {
-    nn_assert (self->atcp == NULL);
+    nn_assert (listener->atcp == NULL);
 
     /*  Allocate new atcp state machine. */
-    self->atcp = nn_alloc (sizeof (struct nn_atcp), "atcp");
-    alloc_assert (self->atcp);
-    nn_atcp_init (self->atcp, NN_BTCP_SRC_ATCP, self->ep, &self->fsm);
+    listener->atcp = nn_alloc (sizeof (struct nn_atcp), "atcp");
+    alloc_assert (listener->atcp);
+    nn_atcp_init (listener->atcp, NN_BTCP_SRC_ATCP, self->ep, &self->fsm);
 
     /*  Start waiting for a new incoming connection. */
-    nn_atcp_start (self->atcp, &self->usock);
+    nn_atcp_start (listener->atcp, &listener->usock);
 }
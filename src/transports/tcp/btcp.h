@@ -28,6 +28,12 @@
 
 /*  State machine managing bound TCP socket. */
 
+/*  Maximum number of listening sockets per endpoint, see NN_TCP_LISTENERS. */
+#define NN_BTCP_MAX_LISTENERS 64
+
+/*  Maximum value of NN_TCP_ACCEPT_BATCH. */
+#define NN_BTCP_MAX_ACCEPT_BATCH 16
+
 int nn_btcp_create (struct nn_ep *);
 
 #endif
@@ -28,6 +28,7 @@
 #include "../../utils/fast.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
+#include "../../utils/trace.h"
 
 /*  States of the object as a whole. */
 #define NN_STCP_STATE_IDLE 1
@@ -314,6 +315,9 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                 /*  The message is now fully sent. */
                 nn_assert (stcp->outstate == NN_STCP_OUTSTATE_SENDING);
                 stcp->outstate = NN_STCP_OUTSTATE_IDLE;
+                nn_tracepoint (NN_TRACE_USOCK_SENT,
+                    nn_pipebase_socket (&stcp->pipebase), &stcp->pipebase,
+                    nn_chunkref_size (&stcp->outmsg.body), stcp->outmsg.stamp);
                 nn_msg_term (&stcp->outmsg);
                 nn_msg_init (&stcp->outmsg, 0);
                 nn_pipebase_sent (&stcp->pipebase);
@@ -346,6 +350,9 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                     if (!size) {
                         stcp->instate = NN_STCP_INSTATE_HASMSG;
                         nn_pipebase_received (&stcp->pipebase);
+                        nn_tracepoint (NN_TRACE_USOCK_RECEIVED,
+                            nn_pipebase_socket (&stcp->pipebase),
+                            &stcp->pipebase, 0, stcp->pipebase.in_stamp);
                         return;
                     }
 
@@ -363,6 +370,10 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                         can receive it. */
                     stcp->instate = NN_STCP_INSTATE_HASMSG;
                     nn_pipebase_received (&stcp->pipebase);
+                    nn_tracepoint (NN_TRACE_USOCK_RECEIVED,
+                        nn_pipebase_socket (&stcp->pipebase), &stcp->pipebase,
+                        nn_chunkref_size (&stcp->inmsg.body),
+                        stcp->pipebase.in_stamp);
 
                     return;
 
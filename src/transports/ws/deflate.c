@@ -0,0 +1,539 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "deflate.h"
+
+#include "../../utils/err.h"
+#include "../../utils/fast.h"
+#include "../../utils/attr.h"
+#include "../../utils/chunk.h"
+#include "../../utils/strncasecmp.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*  Parameters of a single extension offer or response as per RFC 7692
+    section 7.1. Window sizes are 0 if not present and -1 if present
+    without a value. */
+struct nn_ws_deflate_ext {
+    int server_no_context_takeover;
+    int client_no_context_takeover;
+    int server_max_window_bits;
+    int client_max_window_bits;
+};
+
+/*  Smallest window allowed by RFC 7692. zlib silently uses 9 bits instead,
+    so offers that insist on 8 bits are declined. */
+#define NN_WS_DEFLATE_MIN_WINDOW_BITS 8
+
+/*  Returns 1 if 'c' may be a part of a token as per RFC 7230 3.2.6. */
+static int nn_ws_deflate_istchar (char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+        (c >= 'A' && c <= 'Z') || (c && strchr ("!#$%&'*+-.^_`|~", c));
+}
+
+static void nn_ws_deflate_skipws (const char **pos, const char *end)
+{
+    while (*pos != end && (**pos == ' ' || **pos == '\t'))
+        ++*pos;
+}
+
+/*  Parses a token, possibly in quotes, and returns its length. */
+static size_t nn_ws_deflate_token (const char **pos, const char *end,
+    const char **token)
+{
+    const char *start;
+    int quoted;
+
+    nn_ws_deflate_skipws (pos, end);
+    quoted = *pos != end && **pos == '"';
+    if (quoted)
+        ++*pos;
+    start = *pos;
+    while (*pos != end && nn_ws_deflate_istchar (**pos))
+        ++*pos;
+    *token = start;
+    if (quoted) {
+        if (*pos == end || **pos != '"')
+            return 0;
+        ++*pos;
+        return *pos - start - 1;
+    }
+    return *pos - start;
+}
+
+static int nn_ws_deflate_istoken (const char *token, size_t len,
+    const char *expected)
+{
+    return len == strlen (expected) &&
+        nn_strncasecmp (token, expected, len) == 0;
+}
+
+/*  Parses one element of the comma-separated list of extensions. Returns 1
+    if it's a well-formed permessage-deflate element, 0 if it's some other
+    extension or if its parameters are not valid and -1 if the header can't
+    be parsed any further. */
+static int nn_ws_deflate_parse (const char **pos, const char *end,
+    struct nn_ws_deflate_ext *ext)
+{
+    const char *token;
+    const char *value;
+    size_t len;
+    size_t value_len;
+    int *bits;
+    int valid;
+
+    memset (ext, 0, sizeof (*ext));
+
+    len = nn_ws_deflate_token (pos, end, &token);
+    if (len == 0)
+        return -1;
+    valid = nn_ws_deflate_istoken (token, len, NN_WS_DEFLATE_TOKEN);
+
+    nn_ws_deflate_skipws (pos, end);
+    while (*pos != end && **pos == ';') {
+        ++*pos;
+        len = nn_ws_deflate_token (pos, end, &token);
+        if (len == 0)
+            return -1;
+        value = NULL;
+        value_len = 0;
+        nn_ws_deflate_skipws (pos, end);
+        if (*pos != end && **pos == '=') {
+            ++*pos;
+            value_len = nn_ws_deflate_token (pos, end, &value);
+            if (value_len == 0)
+                return -1;
+            nn_ws_deflate_skipws (pos, end);
+        }
+
+        /*  Each parameter may be present once only. Unknown parameters make
+            the whole element unacceptable (RFC 7692 section 5). */
+        if (nn_ws_deflate_istoken (token, len,
+              "server_no_context_takeover")) {
+            valid &= !value && !ext->server_no_context_takeover;
+            ext->server_no_context_takeover = 1;
+            continue;
+        }
+        if (nn_ws_deflate_istoken (token, len,
+              "client_no_context_takeover")) {
+            valid &= !value && !ext->client_no_context_takeover;
+            ext->client_no_context_takeover = 1;
+            continue;
+        }
+        if (nn_ws_deflate_istoken (token, len, "server_max_window_bits"))
+            bits = &ext->server_max_window_bits;
+        else if (nn_ws_deflate_istoken (token, len, "client_max_window_bits"))
+            bits = &ext->client_max_window_bits;
+        else {
+            valid = 0;
+            continue;
+        }
+        if (*bits != 0)
+            valid = 0;
+        if (!value) {
+            *bits = -1;
+            continue;
+        }
+        if (value_len == 1 && value [0] >= '8' && value [0] <= '9')
+            *bits = value [0] - '0';
+        else if (value_len == 2 && value [0] == '1' &&
+              value [1] >= '0' && value [1] <= '5')
+            *bits = 10 + value [1] - '0';
+        else
+            valid = 0;
+    }
+
+    if (*pos != end) {
+        if (**pos != ',')
+            return -1;
+        ++*pos;
+    }
+
+    return valid;
+}
+
+int nn_ws_deflate_supported (void)
+{
+#if defined NN_HAVE_ZLIB
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void nn_ws_deflate_offer (char *buf, size_t bufsz, int no_context_takeover)
+{
+    /*  Asking the server not to keep the context is a part of the offer;
+        announcing that the client doesn't keep its own is a courtesy. */
+    snprintf (buf, bufsz, "%s%s", NN_WS_DEFLATE_TOKEN, no_context_takeover ?
+        "; client_no_context_takeover; server_no_context_takeover" : "");
+}
+
+int nn_ws_deflate_accept (const char *offers, size_t len,
+    int no_context_takeover, struct nn_ws_deflate_params *params,
+    char *buf, size_t bufsz)
+{
+    const char *pos;
+    const char *end;
+    struct nn_ws_deflate_ext ext;
+    int rc;
+
+    pos = offers;
+    end = offers + len;
+    while (pos != end) {
+        rc = nn_ws_deflate_parse (&pos, end, &ext);
+        if (rc < 0)
+            break;
+        if (rc == 0)
+            continue;
+
+        /*  The server's window size, if limited, needs a value. */
+        if (ext.server_max_window_bits < 0 ||
+              (ext.server_max_window_bits > 0 &&
+              ext.server_max_window_bits <= NN_WS_DEFLATE_MIN_WINDOW_BITS))
+            continue;
+
+        params->enabled = 1;
+        params->no_context_takeover = no_context_takeover ||
+            ext.server_no_context_takeover;
+        params->window_bits = ext.server_max_window_bits ?
+            ext.server_max_window_bits : NN_WS_DEFLATE_WINDOW_BITS;
+
+        snprintf (buf, bufsz, "%s%s%s", NN_WS_DEFLATE_TOKEN,
+            params->no_context_takeover ?
+            "; server_no_context_takeover" : "",
+            no_context_takeover ? "; client_no_context_takeover" : "");
+        if (ext.server_max_window_bits) {
+            len = strlen (buf);
+            snprintf (buf + len, bufsz - len, "; server_max_window_bits=%d",
+                ext.server_max_window_bits);
+        }
+        return 0;
+    }
+
+    return -ENOENT;
+}
+
+int nn_ws_deflate_confirm (const char *response, size_t len,
+    int no_context_takeover, struct nn_ws_deflate_params *params)
+{
+    const char *pos;
+    const char *end;
+    struct nn_ws_deflate_ext ext;
+
+    /*  Exactly the single extension that was offered must be accepted.
+        Since the client did not offer client_max_window_bits, the server
+        is not allowed to respond with it. */
+    pos = response;
+    end = response + len;
+    if (nn_ws_deflate_parse (&pos, end, &ext) != 1 || pos != end)
+        return -EPROTO;
+    if (ext.client_max_window_bits != 0 || ext.server_max_window_bits < 0)
+        return -EPROTO;
+    if (no_context_takeover && !ext.server_no_context_takeover)
+        return -EPROTO;
+
+    params->enabled = 1;
+    params->no_context_takeover = no_context_takeover ||
+        ext.client_no_context_takeover;
+    params->window_bits = NN_WS_DEFLATE_WINDOW_BITS;
+
+    return 0;
+}
+
+#if defined NN_HAVE_ZLIB
+
+/*  Compressed messages end with an empty stored block produced by flushing
+    the compressor. It is removed by the sender and added back by the
+    receiver as per RFC 7692 section 7.2. */
+static const uint8_t nn_ws_deflate_tail [] = {0x00, 0x00, 0xff, 0xff};
+
+/*  zlib counts octets in 32-bit integers, so longer buffers are processed
+    in steps. */
+#define NN_WS_DEFLATE_STEP 0x40000000
+
+/*  Initial guess of the size of the decompressed data. */
+#define NN_WS_DEFLATE_RATIO 4
+#define NN_WS_DEFLATE_MIN_BUFFER 256
+
+/*  Runs the data through the compressor or the decompressor, appending the
+    output to the chunk and growing it as needed. */
+static int nn_ws_deflate_run (z_stream *strm, int compress,
+    const void *data, size_t len, int flush, void **chunk, size_t *size,
+    size_t maxsize)
+{
+    int rc;
+    size_t capacity;
+    size_t in;
+    size_t out;
+    uint8_t spare;
+
+    strm->next_in = (Bytef*) data;
+    while (1) {
+
+        /*  Grow the output buffer if it's full. */
+        capacity = nn_chunk_size (*chunk);
+        if (*size == capacity && capacity < maxsize) {
+            capacity = capacity > maxsize / 2 ? maxsize : capacity * 2;
+            rc = nn_chunk_realloc (capacity, chunk);
+            if (nn_slow (rc < 0))
+                return rc;
+        }
+
+        /*  When the buffer is full and can't grow any more, the output is
+            directed to a spare octet. If anything at all gets there, the
+            message is too large. */
+        in = len < NN_WS_DEFLATE_STEP ? len : NN_WS_DEFLATE_STEP;
+        if (*size == capacity) {
+            out = 1;
+            strm->next_out = &spare;
+        }
+        else {
+            out = capacity - *size < NN_WS_DEFLATE_STEP ?
+                capacity - *size : NN_WS_DEFLATE_STEP;
+            strm->next_out = (Bytef*) *chunk + *size;
+        }
+        strm->avail_in = (uInt) in;
+        strm->avail_out = (uInt) out;
+        rc = compress ? deflate (strm, len == in ? flush : Z_NO_FLUSH) :
+            inflate (strm, Z_SYNC_FLUSH);
+        len -= in - strm->avail_in;
+        if (*size == capacity) {
+            if (strm->avail_out == 0)
+                return -EMSGSIZE;
+        }
+        else
+            *size += out - strm->avail_out;
+
+        switch (rc) {
+        case Z_OK:
+        case Z_BUF_ERROR:
+            break;
+        case Z_STREAM_END:
+            /*  The peer has closed the deflate stream by a final block.
+                Anything that follows starts a new one. */
+            nn_assert (!compress);
+            rc = inflateReset (strm);
+            nn_assert (rc == Z_OK);
+            break;
+        case Z_MEM_ERROR:
+            return -ENOMEM;
+        default:
+            return -EPROTO;
+        }
+
+        /*  Once all the input is consumed, the output is complete unless
+            there wasn't enough space to hold it. */
+        if (len == 0 && strm->avail_out != 0)
+            return 0;
+    }
+}
+
+void nn_ws_deflate_init (struct nn_ws_deflate *self)
+{
+    self->active = 0;
+    self->no_context_takeover = 0;
+}
+
+void nn_ws_deflate_term (struct nn_ws_deflate *self)
+{
+    nn_ws_deflate_stop (self);
+}
+
+int nn_ws_deflate_start (struct nn_ws_deflate *self,
+    const struct nn_ws_deflate_params *params, int level)
+{
+    int rc;
+
+    nn_assert (!self->active);
+    nn_assert (params->enabled);
+
+    /*  Negative window size selects raw deflate data with no zlib header
+        and trailer. */
+    memset (&self->tx, 0, sizeof (self->tx));
+    rc = deflateInit2 (&self->tx, level, Z_DEFLATED, -params->window_bits,
+        8, Z_DEFAULT_STRATEGY);
+    if (nn_slow (rc != Z_OK))
+        return rc == Z_MEM_ERROR ? -ENOMEM : -EINVAL;
+    memset (&self->rx, 0, sizeof (self->rx));
+    rc = inflateInit2 (&self->rx, -NN_WS_DEFLATE_WINDOW_BITS);
+    if (nn_slow (rc != Z_OK)) {
+        deflateEnd (&self->tx);
+        return -ENOMEM;
+    }
+
+    self->no_context_takeover = params->no_context_takeover;
+    self->active = 1;
+
+    return 0;
+}
+
+void nn_ws_deflate_stop (struct nn_ws_deflate *self)
+{
+    if (!self->active)
+        return;
+    deflateEnd (&self->tx);
+    inflateEnd (&self->rx);
+    self->active = 0;
+}
+
+int nn_ws_deflate_isactive (struct nn_ws_deflate *self)
+{
+    return self->active;
+}
+
+int nn_ws_deflate_compress (struct nn_ws_deflate *self,
+    struct nn_chunkref *hdr, struct nn_chunkref *body,
+    struct nn_chunkref *out)
+{
+    int rc;
+    void *chunk;
+    size_t size;
+
+    nn_assert (self->active);
+
+    /*  Start with a buffer half the size of the message, which is plenty
+        for the kind of data that is worth compressing. */
+    rc = nn_chunk_alloc ((nn_chunkref_size (hdr) + nn_chunkref_size (body)) /
+        2 + NN_WS_DEFLATE_MIN_BUFFER, 0, &chunk);
+    if (nn_slow (rc < 0))
+        return rc;
+    size = 0;
+
+    rc = nn_ws_deflate_run (&self->tx, 1, nn_chunkref_data (hdr),
+        nn_chunkref_size (hdr), Z_NO_FLUSH, &chunk, &size, SIZE_MAX);
+    if (nn_fast (rc == 0))
+        rc = nn_ws_deflate_run (&self->tx, 1, nn_chunkref_data (body),
+            nn_chunkref_size (body), Z_SYNC_FLUSH, &chunk, &size, SIZE_MAX);
+    if (nn_slow (rc < 0)) {
+        nn_chunk_free (chunk);
+        return rc;
+    }
+
+    /*  Strip the tail of the flush. */
+    nn_assert (size >= sizeof (nn_ws_deflate_tail) &&
+        memcmp ((uint8_t*) chunk + size - sizeof (nn_ws_deflate_tail),
+        nn_ws_deflate_tail, sizeof (nn_ws_deflate_tail)) == 0);
+    size -= sizeof (nn_ws_deflate_tail);
+
+    if (self->no_context_takeover) {
+        rc = deflateReset (&self->tx);
+        nn_assert (rc == Z_OK);
+    }
+
+    rc = nn_chunk_realloc (size, &chunk);
+    nn_assert (rc == 0);
+    nn_chunkref_init_chunk (out, chunk);
+
+    return 0;
+}
+
+int nn_ws_deflate_decompress (struct nn_ws_deflate *self,
+    const void *data, size_t len, int last, void **chunk, size_t *size,
+    size_t maxsize)
+{
+    int rc;
+    size_t capacity;
+
+    nn_assert (self->active);
+
+    if (!*chunk) {
+        capacity = len < SIZE_MAX / NN_WS_DEFLATE_RATIO ?
+            len * NN_WS_DEFLATE_RATIO : SIZE_MAX;
+        if (capacity < NN_WS_DEFLATE_MIN_BUFFER)
+            capacity = NN_WS_DEFLATE_MIN_BUFFER;
+        if (capacity > maxsize)
+            capacity = maxsize;
+        rc = nn_chunk_alloc (capacity, 0, chunk);
+        if (nn_slow (rc < 0)) {
+            *chunk = NULL;
+            return rc;
+        }
+        *size = 0;
+    }
+
+    rc = nn_ws_deflate_run (&self->rx, 0, data, len, Z_SYNC_FLUSH,
+        chunk, size, maxsize);
+    if (nn_fast (rc == 0) && last)
+        rc = nn_ws_deflate_run (&self->rx, 0, nn_ws_deflate_tail,
+            sizeof (nn_ws_deflate_tail), Z_SYNC_FLUSH, chunk, size, maxsize);
+    if (nn_slow (rc < 0)) {
+        nn_chunk_free (*chunk);
+        *chunk = NULL;
+        return rc;
+    }
+
+    if (last) {
+        rc = nn_chunk_realloc (*size, chunk);
+        nn_assert (rc == 0);
+    }
+
+    return 0;
+}
+
+#else
+
+void nn_ws_deflate_init (struct nn_ws_deflate *self)
+{
+    self->active = 0;
+    self->no_context_takeover = 0;
+}
+
+void nn_ws_deflate_term (NN_UNUSED struct nn_ws_deflate *self)
+{
+}
+
+int nn_ws_deflate_start (NN_UNUSED struct nn_ws_deflate *self,
+    NN_UNUSED const struct nn_ws_deflate_params *params, NN_UNUSED int level)
+{
+    return -ENOTSUP;
+}
+
+void nn_ws_deflate_stop (NN_UNUSED struct nn_ws_deflate *self)
+{
+}
+
+int nn_ws_deflate_isactive (NN_UNUSED struct nn_ws_deflate *self)
+{
+    return 0;
+}
+
+int nn_ws_deflate_compress (NN_UNUSED struct nn_ws_deflate *self,
+    NN_UNUSED struct nn_chunkref *hdr, NN_UNUSED struct nn_chunkref *body,
+    NN_UNUSED struct nn_chunkref *out)
+{
+    nn_assert (0);
+    return -ENOTSUP;
+}
+
+int nn_ws_deflate_decompress (NN_UNUSED struct nn_ws_deflate *self,
+    NN_UNUSED const void *data, NN_UNUSED size_t len, NN_UNUSED int last,
+    NN_UNUSED void **chunk, NN_UNUSED size_t *size, NN_UNUSED size_t maxsize)
+{
+    nn_assert (0);
+    return -ENOTSUP;
+}
+
+#endif
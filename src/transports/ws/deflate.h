@@ -0,0 +1,123 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_WS_DEFLATE_INCLUDED
+#define NN_WS_DEFLATE_INCLUDED
+
+#include "../../utils/chunkref.h"
+
+#include <stddef.h>
+
+#if defined NN_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/*  The permessage-deflate extension as per RFC 7692. */
+
+/*  Extension token used in the Sec-WebSocket-Extensions header. */
+#define NN_WS_DEFLATE_TOKEN "permessage-deflate"
+
+/*  Size of the LZ77 sliding window when not negotiated otherwise. */
+#define NN_WS_DEFLATE_WINDOW_BITS 15
+
+/*  Longest value of the Sec-WebSocket-Extensions header produced here. */
+#define NN_WS_DEFLATE_HEADER_MAX_LEN 128
+
+/*  Parameters agreed on during the opening handshake. */
+struct nn_ws_deflate_params {
+
+    /*  Non-zero if the extension is in use on the connection. */
+    int enabled;
+
+    /*  Non-zero if the local compressor has to forget its history after
+        each message. */
+    int no_context_takeover;
+
+    /*  Base-2 logarithm of the LZ77 window used by the local compressor. */
+    int window_bits;
+};
+
+struct nn_ws_deflate {
+
+    /*  Non-zero once the compression contexts are allocated. */
+    int active;
+
+    /*  Whether the compressor is reset after each message. */
+    int no_context_takeover;
+
+#if defined NN_HAVE_ZLIB
+    /*  Contexts for outbound and inbound messages. The inbound context
+        always keeps its history, which works whatever the peer does. */
+    z_stream tx;
+    z_stream rx;
+#endif
+};
+
+/*  Returns 1 if the library was built with support for the extension. */
+int nn_ws_deflate_supported (void);
+
+/*  Fills in the extension offer sent by the client. */
+void nn_ws_deflate_offer (char *buf, size_t bufsz, int no_context_takeover);
+
+/*  Goes through the offers in the Sec-WebSocket-Extensions header sent by the
+    client and accepts the first acceptable one. On success fills in the
+    parameters and the value of the header to respond with and returns 0.
+    Returns -ENOENT if there was no acceptable offer. */
+int nn_ws_deflate_accept (const char *offers, size_t len,
+    int no_context_takeover, struct nn_ws_deflate_params *params,
+    char *buf, size_t bufsz);
+
+/*  Checks the Sec-WebSocket-Extensions header sent by the server in response
+    to our offer. Returns 0 and fills in the parameters if the response is
+    valid, -EPROTO otherwise. */
+int nn_ws_deflate_confirm (const char *response, size_t len,
+    int no_context_takeover, struct nn_ws_deflate_params *params);
+
+void nn_ws_deflate_init (struct nn_ws_deflate *self);
+void nn_ws_deflate_term (struct nn_ws_deflate *self);
+
+/*  Allocates compression contexts once the extension is negotiated. */
+int nn_ws_deflate_start (struct nn_ws_deflate *self,
+    const struct nn_ws_deflate_params *params, int level);
+
+/*  Deallocates the compression contexts, if any. */
+void nn_ws_deflate_stop (struct nn_ws_deflate *self);
+
+int nn_ws_deflate_isactive (struct nn_ws_deflate *self);
+
+/*  Compresses message consisting of 'hdr' followed by 'body'. The result is
+    stored in 'out', which must not be initialised beforehand. */
+int nn_ws_deflate_compress (struct nn_ws_deflate *self,
+    struct nn_chunkref *hdr, struct nn_chunkref *body,
+    struct nn_chunkref *out);
+
+/*  Decompresses the next fragment of a message. The output is appended to
+    the chunk at '*chunk' (allocated on the first call if NULL) and '*size'
+    is updated accordingly. 'last' has to be set for the final fragment, at
+    which point the chunk is trimmed to the actual size. Returns -EMSGSIZE if
+    the message would exceed 'maxsize' and -EPROTO if the data are corrupted.
+    In case of error the chunk is deallocated. */
+int nn_ws_deflate_decompress (struct nn_ws_deflate *self,
+    const void *data, size_t len, int last, void **chunk, size_t *size,
+    size_t maxsize);
+
+#endif
@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "mask.h"
+
+#include <string.h>
+
+#if defined __AVX2__
+#include <immintrin.h>
+#elif defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NN_WS_MASK_SSE2
+#endif
+
+size_t nn_ws_mask (uint8_t *data, size_t len, const uint8_t *mask,
+    size_t pos)
+{
+    uint8_t rot [NN_WS_MASK_SIZE];
+    uint32_t m32;
+    uint64_t m64;
+    uint64_t w;
+    size_t i;
+
+    pos %= NN_WS_MASK_SIZE;
+
+    /*  Process leading bytes one by one till the data are word-aligned. */
+    while (len && ((uintptr_t) data & (sizeof (uint64_t) - 1))) {
+        *data++ ^= mask [pos];
+        pos = (pos + 1) % NN_WS_MASK_SIZE;
+        --len;
+    }
+
+    /*  Rotate the mask so that it starts at the current position. From now
+        on it stays aligned with every 4-byte boundary of the data. */
+    for (i = 0; i != NN_WS_MASK_SIZE; ++i)
+        rot [i] = mask [(pos + i) % NN_WS_MASK_SIZE];
+    memcpy (&m32, rot, sizeof (m32));
+    m64 = ((uint64_t) m32 << 32) | m32;
+
+#if defined __AVX2__
+    {
+        __m256i m256 = _mm256_set1_epi32 ((int) m32);
+        for (; len >= 32; data += 32, len -= 32)
+            _mm256_storeu_si256 ((__m256i*) data, _mm256_xor_si256 (
+                _mm256_loadu_si256 ((const __m256i*) data), m256));
+    }
+#elif defined NN_WS_MASK_SSE2
+    {
+        __m128i m128 = _mm_set1_epi32 ((int) m32);
+        for (; len >= 16; data += 16, len -= 16)
+            _mm_storeu_si128 ((__m128i*) data, _mm_xor_si128 (
+                _mm_loadu_si128 ((const __m128i*) data), m128));
+    }
+#endif
+
+    /*  Word-wide loop. Also handles whatever the vector loop left over. */
+    for (; len >= sizeof (w); data += sizeof (w), len -= sizeof (w)) {
+        memcpy (&w, data, sizeof (w));
+        w ^= m64;
+        memcpy (data, &w, sizeof (w));
+    }
+
+    /*  Trailing bytes. */
+    for (i = 0; i != len; ++i)
+        data [i] ^= rot [i % NN_WS_MASK_SIZE];
+
+    return (pos + len) % NN_WS_MASK_SIZE;
+}
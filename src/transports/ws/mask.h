@@ -0,0 +1,38 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_WS_MASK_INCLUDED
+#define NN_WS_MASK_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Size of the WebSocket masking key as per RFC 6455 5.3. */
+#define NN_WS_MASK_SIZE 4
+
+/*  XORs 'len' bytes of 'data' with the 4-byte 'mask', starting at the byte
+    'pos' of the mask. Returns the mask position to continue at, so that
+    a payload split into several buffers can be masked piece by piece. */
+size_t nn_ws_mask (uint8_t *data, size_t len, const uint8_t *mask,
+    size_t pos);
+
+#endif
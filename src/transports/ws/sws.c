@@ -23,6 +23,8 @@
 */
 
 #include "sws.h"
+#include "mask.h"
+#include "utf8.h"
 #include "../../ws.h"
 #include "../../nn.h"
 
@@ -33,6 +35,9 @@
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
 #include "../../utils/random.h"
+#include "../../utils/trace.h"
+
+#include <stdint.h>
 
 /*  States of the object as a whole. */
 #define NN_SWS_STATE_IDLE 1
@@ -95,10 +100,6 @@
 #define NN_SWS_CLOSE_ERR_EXTENSION 1010
 #define NN_SWS_CLOSE_ERR_SERVER 1011
 
-/*  UTF-8 validation. */
-#define NN_SWS_UTF8_INVALID -2
-#define NN_SWS_UTF8_FRAGMENT -1
-
 /*  Stream is a special type of pipe. Implementation of the virtual pipe API. */
 static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg);
@@ -127,10 +128,19 @@ static void nn_sws_mask_payload (uint8_t *payload, size_t payload_len,
 /*  Validates incoming text chunks for UTF-8 compliance as per RFC 3629. */
 static void nn_sws_validate_utf8_chunk (struct nn_sws *self);
 
+/*  Processes a newly received frame of a TEXT or BINARY message. */
+static void nn_sws_recv_data (struct nn_sws *self);
+
+/*  Decompresses a fully received message as per RFC 7692. */
+static void nn_sws_inflate_msg (struct nn_sws *self);
+
 /*  Ensures that Close frames received from peer conform to
     RFC 6455 section 7. */
 static void nn_sws_acknowledge_close_handshake (struct nn_sws *self);
 
+/*  Notifies the owner that a whole message or control frame arrived. */
+static void nn_sws_received (struct nn_sws *self);
+
 void nn_sws_init (struct nn_sws *self, int src,
     struct nn_ep *ep, struct nn_fsm *owner)
 {
@@ -150,9 +160,10 @@ void nn_sws_init (struct nn_sws *self, int src,
 
     self->continuing = 0;
 
-    memset (self->utf8_code_pt_fragment, 0,
-        NN_SWS_UTF8_MAX_CODEPOINT_LEN);
-    self->utf8_code_pt_fragment_len = 0;
+    self->utf8_state = NN_WS_UTF8_ACCEPT;
+
+    nn_ws_deflate_init (&self->deflate);
+    self->deflate_min_size = 0;
 
     self->pings_sent = 0;
     self->pongs_sent = 0;
@@ -167,6 +178,7 @@ void nn_sws_term (struct nn_sws *self)
     nn_assert_state (self, NN_SWS_STATE_IDLE);
 
     nn_fsm_event_term (&self->done);
+    nn_ws_deflate_term (&self->deflate);
     nn_msg_term (&self->outmsg);
     nn_msg_array_term (&self->inmsg_array);
     nn_pipebase_term (&self->pipebase);
@@ -240,109 +252,17 @@ void nn_msg_array_term (struct nn_list *msg_array)
     nn_list_term (msg_array);
 }
 
-/*  Given a buffer location, this function determines whether the leading
-    octets form a valid UTF-8 code point. */
-static int nn_utf8_code_point (const uint8_t *buffer, size_t len)
-{
-    /*  The lack of information is considered neither valid nor invalid. */
-    if (!buffer || !len)
-        return NN_SWS_UTF8_FRAGMENT;
-
-    /*  RFC 3629 section 4 UTF8-1. */
-    if (buffer [0] <= 0x7F)
-        return 1;
-
-    /*  0xC2, or 11000001, is the smallest conceivable multi-octet code
-        point that is not an illegal overlong encoding. */
-    if (buffer [0] < 0xC2)
-        return NN_SWS_UTF8_INVALID;
-
-    /*  Largest 2-octet code point starts with 0xDF (11011111). */
-    if (buffer [0] <= 0xDF) {
-        if (len < 2)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Ensure continuation byte in form of 10xxxxxx */
-        else if ((buffer [1] & 0xC0) != 0x80)
-            return NN_SWS_UTF8_INVALID;
-        else
-            return 2;
-    }
-
-    /*  RFC 3629 section 4 UTF8-3, where 0xEF is 11101111. */
-    if (buffer [0] <= 0xEF) {
-        /*  Fragment. */
-        if (len < 2)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Illegal overlong sequence detection. */
-        else if (buffer [0] == 0xE0 && (buffer [1] < 0xA0 || buffer [1] == 0x80))
-            return NN_SWS_UTF8_INVALID;
-        /*  Illegal UTF-16 surrogate pair half U+D800 through U+DFFF. */
-        else if (buffer [0] == 0xED && buffer [1] >= 0xA0)
-            return NN_SWS_UTF8_INVALID;
-        /*  Fragment. */
-        else if (len < 3)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Ensure continuation bytes 2 and 3 in form of 10xxxxxx */
-        else if ((buffer [1] & 0xC0) != 0x80 || (buffer [2] & 0xC0) != 0x80)
-            return NN_SWS_UTF8_INVALID;
-        else
-            return 3;
-    }
-
-    /*  RFC 3629 section 4 UTF8-4, where 0xF4 is 11110100. Why
-        not 11110111 to follow the pattern? Because UTF-8 encoding
-        stops at 0x10FFFF as per RFC 3629. */
-    if (buffer [0] <= 0xF4) {
-        /*  Fragment. */
-        if (len < 2)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Illegal overlong sequence detection. */
-        else if (buffer [0] == 0xF0 && buffer [1] < 0x90)
-            return NN_SWS_UTF8_INVALID;
-        /*  Illegal code point greater than U+10FFFF. */
-        else if (buffer [0] == 0xF4 && buffer [1] >= 0x90)
-            return NN_SWS_UTF8_INVALID;
-        /*  Fragment. */
-        else if (len < 4)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Ensure continuation bytes 2, 3, and 4 in form of 10xxxxxx */
-        else if ((buffer [1] & 0xC0) != 0x80 ||
-            (buffer [2] & 0xC0) != 0x80 ||
-            (buffer [3] & 0xC0) != 0x80)
-            return NN_SWS_UTF8_INVALID;
-        else
-            return 4;
-    }
-
-    /*  UTF-8 encoding stops at U+10FFFF and only defines up to 4-octet
-        code point sequences. */
-    if (buffer [0] >= 0xF5)
-        return NN_SWS_UTF8_INVALID;
-
-    /*  Algorithm error; a case above should have been satisfied. */
-    nn_assert (0);
-}
-
 static void nn_sws_mask_payload (uint8_t *payload, size_t payload_len,
     const uint8_t *mask, size_t mask_len, int *mask_start_pos)
 {
-    unsigned i;
-
-    if (mask_start_pos) {
-        for (i = 0; i < payload_len; i++) {
-            payload [i] ^= mask [(i + *mask_start_pos) % mask_len];
-        }
+    size_t pos;
 
-        *mask_start_pos = (i + *mask_start_pos) % mask_len;
+    nn_assert (mask_len == NN_WS_MASK_SIZE);
 
-        return;
-    }
-    else {
-        for (i = 0; i < payload_len; i++) {
-            payload [i] ^= mask [i % mask_len];
-        }
-        return;
-    }
+    pos = nn_ws_mask (payload, payload_len, mask,
+        mask_start_pos ? (size_t) *mask_start_pos : 0);
+    if (mask_start_pos)
+        *mask_start_pos = (int) pos;
 }
 
 static int nn_sws_recv_hdr (struct nn_sws *self)
@@ -373,7 +293,10 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
     size_t hdr_len;
     struct nn_cmsghdr *cmsg;
     struct nn_msghdr msghdr;
+    struct nn_chunkref body;
     uint8_t rand_mask [NN_SWS_FRAME_SIZE_MASK];
+    uint8_t opcode;
+    int rc;
 
     sws = nn_cont (self, struct nn_sws, pipebase);
 
@@ -417,6 +340,23 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
     nn_msg_size = nn_chunkref_size (&sws->outmsg.sphdr) +
         nn_chunkref_size (&sws->outmsg.body);
 
+    /*  Compress large enough data messages as per RFC 7692 section 6.1.
+        Control frames are never compressed. */
+    opcode = sws->outhdr [0] & NN_SWS_FRAME_BITMASK_OPCODE;
+    if (nn_ws_deflate_isactive (&sws->deflate) &&
+          nn_msg_size >= sws->deflate_min_size &&
+          (opcode == NN_WS_OPCODE_TEXT || opcode == NN_WS_OPCODE_BINARY)) {
+        rc = nn_ws_deflate_compress (&sws->deflate, &sws->outmsg.sphdr,
+            &sws->outmsg.body, &body);
+        errnum_assert (rc == 0, -rc);
+        nn_chunkref_term (&sws->outmsg.sphdr);
+        nn_chunkref_init (&sws->outmsg.sphdr, 0);
+        nn_chunkref_term (&sws->outmsg.body);
+        nn_chunkref_mv (&sws->outmsg.body, &body);
+        nn_msg_size = nn_chunkref_size (&sws->outmsg.body);
+        sws->outhdr [0] |= NN_SWS_FRAME_BITMASK_RSV1;
+    }
+
     /*  Framing WebSocket payload size in network byte order (big endian). */
     if (nn_msg_size <= NN_SWS_PAYLOAD_MAX_LENGTH) {
         sws->outhdr [1] |= (uint8_t) nn_msg_size;
@@ -442,7 +382,11 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
         memcpy (&sws->outhdr [hdr_len], rand_mask, NN_SWS_FRAME_SIZE_MASK);
         hdr_len += NN_SWS_FRAME_SIZE_MASK;
 
-        /*  Mask payload, beginning with header and moving to body. */
+        /*  Mask payload, beginning with header and moving to body. The
+            message may share its data with copies sent to other peers,
+            so it has to be made private before it is masked in place. */
+        nn_chunkref_unshare (&sws->outmsg.sphdr);
+        nn_chunkref_unshare (&sws->outmsg.body);
         mask_pos = 0;
 
         nn_sws_mask_payload (nn_chunkref_data (&sws->outmsg.sphdr),
@@ -503,6 +447,9 @@ static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg)
         nn_assert (opcode_hdr & NN_SWS_FRAME_BITMASK_FIN);
         opcode_hdr &= ~NN_SWS_FRAME_BITMASK_FIN;
 
+        /*  Compression is transparent to the user. */
+        opcode_hdr &= ~NN_SWS_FRAME_BITMASK_RSV1;
+
         /*  The library is expected to have failed any connections with other
             opcodes; these are the only two opcodes that can be chunked. */
         opcode = opcode_hdr & NN_SWS_FRAME_BITMASK_OPCODE;
@@ -580,116 +527,156 @@ static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg)
 
 static void nn_sws_validate_utf8_chunk (struct nn_sws *self)
 {
-    uint8_t *pos;
-    int code_point_len;
-    size_t len;
-
-    len = self->inmsg_current_chunk_len;
-    pos = self->inmsg_current_chunk_buf;
-
     /*  For chunked transfers, it's possible that a previous chunk was cut
-        intra-code point. That partially-validated code point is reassembled
-        with the beginning of the current chunk and checked. */
-    if (self->utf8_code_pt_fragment_len) {
-
-        nn_assert (self->utf8_code_pt_fragment_len <
-            NN_SWS_UTF8_MAX_CODEPOINT_LEN);
-
-        /*  Keep adding octets from fresh buffer to previous code point
-            fragment to check for validity. */
-        while (len > 0) {
-            self->utf8_code_pt_fragment [self->utf8_code_pt_fragment_len] = *pos;
-            self->utf8_code_pt_fragment_len++;
-            pos++;
-            len--;
-
-            code_point_len = nn_utf8_code_point (self->utf8_code_pt_fragment,
-                self->utf8_code_pt_fragment_len);
-
-            if (code_point_len > 0) {
-                /*  Valid code point found; continue validating. */
-                break;
-            }
-            else if (code_point_len == NN_SWS_UTF8_INVALID) {
-                nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
-                    "Invalid UTF-8 code point split on previous frame.");
-                return;
-            }
-            else if (code_point_len == NN_SWS_UTF8_FRAGMENT) {
-                if (self->is_final_frame) {
-                    nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
-                        "Truncated UTF-8 payload with invalid code point.");
-                    return;
-                }
-                else {
-                    /*  This chunk is well-formed; now recv the next chunk. */
-                    nn_sws_recv_hdr (self);
-                    return;
-                }
-            }
-        }
+        intra-code point. Validation of such a code point continues from
+        the state the previous chunk was left in. */
+    self->utf8_state = nn_ws_utf8_validate (self->utf8_state,
+        self->inmsg_current_chunk_buf, self->inmsg_current_chunk_len);
+
+    if (self->utf8_state == NN_WS_UTF8_REJECT) {
+        self->utf8_state = NN_WS_UTF8_ACCEPT;
+        nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
+            "Invalid UTF-8 code point in payload.");
+        return;
     }
 
-    if (self->utf8_code_pt_fragment_len >= NN_SWS_UTF8_MAX_CODEPOINT_LEN)
-        nn_assert (0);
-
-    while (len > 0) {
-        code_point_len = nn_utf8_code_point (pos, len);
-
-        if (code_point_len > 0) {
-            /*  Valid code point found; continue validating. */
-            nn_assert (len >= (size_t) code_point_len);
-            len -= code_point_len;
-            pos += code_point_len;
-            continue;
-        }
-        else if (code_point_len == NN_SWS_UTF8_INVALID) {
-            self->utf8_code_pt_fragment_len = 0;
-            memset (self->utf8_code_pt_fragment, 0,
-                NN_SWS_UTF8_MAX_CODEPOINT_LEN);
+    if (self->utf8_state != NN_WS_UTF8_ACCEPT) {
+        if (self->is_final_frame) {
             nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
-                "Invalid UTF-8 code point in payload.");
-            return;
+                "Truncated UTF-8 payload with invalid code point.");
         }
-        else if (code_point_len == NN_SWS_UTF8_FRAGMENT) {
-            nn_assert (len < NN_SWS_UTF8_MAX_CODEPOINT_LEN);
-            self->utf8_code_pt_fragment_len = len;
-            memcpy (self->utf8_code_pt_fragment, pos, len);
-            if (self->is_final_frame) {
-                nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
-                    "Truncated UTF-8 payload with invalid code point.");
-            }
-            else {
-                /*  Previous frame ended in the middle of a code point;
-                    receive more. */
-                nn_sws_recv_hdr (self);
-            }
-            return;
+        else {
+            /*  This frame ended in the middle of a code point; receive
+                more. */
+            nn_sws_recv_hdr (self);
         }
+        return;
     }
 
     /*  Entire buffer is well-formed. */
-    nn_assert (len == 0);
+    if (self->is_final_frame) {
+        self->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
+        nn_sws_received (self);
+    }
+    else {
+        nn_sws_recv_hdr (self);
+    }
 
-    self->utf8_code_pt_fragment_len = 0;
-    memset (self->utf8_code_pt_fragment, 0, NN_SWS_UTF8_MAX_CODEPOINT_LEN);
+    return;
+}
+
+static void nn_sws_recv_data (struct nn_sws *self)
+{
+    /*  Compressed messages are validated once decompressed. */
+    if (self->inmsg_hdr & NN_SWS_FRAME_BITMASK_RSV1) {
+        if (self->is_final_frame)
+            nn_sws_inflate_msg (self);
+        else
+            nn_sws_recv_hdr (self);
+        return;
+    }
+
+    /*  Must check original opcode to see if this fragment needs UTF-8
+        validation. */
+    if ((self->inmsg_hdr & NN_SWS_FRAME_BITMASK_OPCODE) ==
+          NN_WS_OPCODE_TEXT) {
+        nn_sws_validate_utf8_chunk (self);
+        return;
+    }
 
     if (self->is_final_frame) {
         self->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
-        nn_pipebase_received (&self->pipebase);
+        nn_sws_received (self);
     }
     else {
         nn_sws_recv_hdr (self);
     }
+}
 
-    return;
+static void nn_sws_inflate_msg (struct nn_sws *self)
+{
+    struct nn_list_item *it;
+    struct msg_chunk *ch;
+    void *chunk;
+    size_t size;
+    size_t maxsize;
+    int opt;
+    size_t opt_sz;
+    int rc;
+
+    /*  NN_RCVMAXSIZE applies to the decompressed message. */
+    opt_sz = sizeof (opt);
+    nn_pipebase_getopt (&self->pipebase, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+        &opt, &opt_sz);
+    maxsize = opt < 0 ? SIZE_MAX : (size_t) opt;
+
+    chunk = NULL;
+    size = 0;
+    rc = 0;
+    for (it = nn_list_begin (&self->inmsg_array);
+          rc == 0 && it != nn_list_end (&self->inmsg_array);
+          it = nn_list_next (&self->inmsg_array, it)) {
+        ch = nn_cont (it, struct msg_chunk, item);
+        rc = nn_ws_deflate_decompress (&self->deflate,
+            nn_chunkref_data (&ch->chunk), nn_chunkref_size (&ch->chunk), 0,
+            &chunk, &size, maxsize);
+    }
+    if (rc == 0)
+        rc = nn_ws_deflate_decompress (&self->deflate, NULL, 0, 1,
+            &chunk, &size, maxsize);
+    if (rc == -EMSGSIZE) {
+        nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_TOOBIG,
+            "Message larger than application allows.");
+        return;
+    }
+    if (nn_slow (rc < 0)) {
+        nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
+            "Invalid compressed payload.");
+        return;
+    }
+
+    /*  Replace the compressed fragments by the decompressed message. */
+    while (!nn_list_empty (&self->inmsg_array)) {
+        it = nn_list_begin (&self->inmsg_array);
+        nn_msg_chunk_term (nn_cont (it, struct msg_chunk, item),
+            &self->inmsg_array);
+    }
+    ch = nn_alloc (sizeof (struct msg_chunk), "msg_chunk");
+    alloc_assert (ch);
+    nn_chunkref_init_chunk (&ch->chunk, chunk);
+    nn_list_item_init (&ch->item);
+    nn_list_insert (&self->inmsg_array, &ch->item,
+        nn_list_end (&self->inmsg_array));
+    self->inmsg_chunks = 1;
+    self->inmsg_total_size = size;
+
+    if ((self->inmsg_hdr & NN_SWS_FRAME_BITMASK_OPCODE) ==
+          NN_WS_OPCODE_TEXT &&
+          nn_ws_utf8_validate (NN_WS_UTF8_ACCEPT, chunk, size) !=
+          NN_WS_UTF8_ACCEPT) {
+        nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
+            "Invalid UTF-8 code point in payload.");
+        return;
+    }
+
+    self->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
+    nn_sws_received (self);
+}
+
+static void nn_sws_received (struct nn_sws *self)
+{
+    nn_pipebase_received (&self->pipebase);
+    nn_tracepoint (NN_TRACE_USOCK_RECEIVED,
+        nn_pipebase_socket (&self->pipebase), &self->pipebase,
+        self->instate == NN_SWS_INSTATE_RECVD_CONTROL ?
+        self->inmsg_current_chunk_len : self->inmsg_total_size,
+        self->pipebase.in_stamp);
 }
 
 static void nn_sws_acknowledge_close_handshake (struct nn_sws *self)
 {
     uint8_t *pos;
     uint16_t close_code;
-    int code_point_len;
     size_t len;
 
     len = self->inmsg_current_chunk_len;
@@ -709,27 +696,14 @@ static void nn_sws_acknowledge_close_handshake (struct nn_sws *self)
 
     /*  As per RFC 6455 7.1.6, the Close Reason following the Close Code
         must be well-formed UTF-8. */
-    while (len > 0) {
-        code_point_len = nn_utf8_code_point (pos, len);
-
-        if (code_point_len > 0) {
-            /*  Valid code point found; continue validating. */
-            nn_assert (len >= (size_t) code_point_len);
-            len -= code_point_len;
-            pos += code_point_len;
-            continue;
-        }
-        else {
-            /*  RFC 6455 7.1.6 */
-            nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_PROTO,
-                "Invalid UTF-8 sent as Close Reason.");
-            return;
-        }
+    if (nn_ws_utf8_validate (NN_WS_UTF8_ACCEPT, pos, len) !=
+          NN_WS_UTF8_ACCEPT) {
+        /*  RFC 6455 7.1.6 */
+        nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_PROTO,
+            "Invalid UTF-8 sent as Close Reason.");
+        return;
     }
 
-    /*  Entire Close Reason is well-formed UTF-8 (or empty) */
-    nn_assert (len == 0);
-
     close_code = nn_gets (self->inmsg_current_chunk_buf);
 
     if (close_code == NN_SWS_CLOSE_NORMAL ||
@@ -856,6 +830,7 @@ static void nn_sws_shutdown (struct nn_fsm *self, int src, int type,
             sws->usock = NULL;
             sws->usock_owner.src = -1;
             sws->usock_owner.fsm = NULL;
+            nn_ws_deflate_stop (&sws->deflate);
             sws->state = NN_SWS_STATE_IDLE;
             nn_fsm_stopped (&sws->fsm, NN_SWS_RETURN_STOPPED);
             return;
@@ -942,6 +917,23 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_WS_HANDSHAKE_STOPPED:
 
+                 /*  Allocate compression contexts if negotiated. */
+                 if (sws->handshaker.deflate_params.enabled) {
+                    nn_pipebase_getopt (&sws->pipebase, NN_WS,
+                        NN_WS_DEFLATE_LEVEL, &opt, &opt_sz);
+                    rc = nn_ws_deflate_start (&sws->deflate,
+                        &sws->handshaker.deflate_params, opt);
+                    if (nn_slow (rc < 0)) {
+                        sws->state = NN_SWS_STATE_DONE;
+                        nn_fsm_raise (&sws->fsm, &sws->done,
+                            NN_SWS_RETURN_ERROR);
+                        return;
+                    }
+                    nn_pipebase_getopt (&sws->pipebase, NN_WS,
+                        NN_WS_DEFLATE_MIN_SIZE, &opt, &opt_sz);
+                    sws->deflate_min_size = (size_t) opt;
+                 }
+
                  /*  Start the pipe. */
                  rc = nn_pipebase_start (&sws->pipebase);
                  if (nn_slow (rc < 0)) {
@@ -980,6 +972,9 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                 /*  The message is now fully sent. */
                 nn_assert (sws->outstate == NN_SWS_OUTSTATE_SENDING);
                 sws->outstate = NN_SWS_OUTSTATE_IDLE;
+                nn_tracepoint (NN_TRACE_USOCK_SENT,
+                    nn_pipebase_socket (&sws->pipebase), &sws->pipebase,
+                    nn_chunkref_size (&sws->outmsg.body), sws->outmsg.stamp);
                 nn_msg_term (&sws->outmsg);
                 nn_msg_init (&sws->outmsg, 0);
                 nn_pipebase_sent (&sws->pipebase);
@@ -991,8 +986,11 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                 case NN_SWS_INSTATE_RECV_HDR:
 
                     /*  Require RSV1, RSV2, and RSV3 bits to be unset for
-                        x-nanomsg protocol as per RFC 6455 section 5.2. */
-                    if (sws->inhdr [0] & NN_SWS_FRAME_BITMASK_RSV1 ||
+                        x-nanomsg protocol as per RFC 6455 section 5.2,
+                        except for RSV1 marking compressed messages if
+                        permessage-deflate is in use (RFC 7692 section 6). */
+                    if ((sws->inhdr [0] & NN_SWS_FRAME_BITMASK_RSV1 &&
+                          !nn_ws_deflate_isactive (&sws->deflate)) ||
                         sws->inhdr [0] & NN_SWS_FRAME_BITMASK_RSV2 ||
                         sws->inhdr [0] & NN_SWS_FRAME_BITMASK_RSV3) {
                         nn_sws_fail_conn (sws, NN_SWS_CLOSE_ERR_PROTO,
@@ -1041,6 +1039,16 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                     sws->payload_ctl = sws->inhdr [1] &
                         NN_SWS_FRAME_BITMASK_LENGTH;
 
+                    /*  Only the first frame of a message can be marked as
+                        compressed, as per RFC 7692 section 6.1. */
+                    if (sws->inhdr [0] & NN_SWS_FRAME_BITMASK_RSV1 &&
+                        sws->opcode != NN_WS_OPCODE_TEXT &&
+                        sws->opcode != NN_WS_OPCODE_BINARY) {
+                        nn_sws_fail_conn (sws, NN_SWS_CLOSE_ERR_PROTO,
+                            "RSV1 is only allowed on first frame of message.");
+                        return;
+                    }
+
                     /*  Prevent unexpected continuation frame. */
                     if (!sws->continuing &&
                         sws->opcode == NN_WS_OPCODE_FRAGMENT) {
@@ -1092,22 +1100,12 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                                 sanity-check that this endpoint is a client. */
                             nn_assert (sws->mode == NN_WS_CLIENT);
 
+                            /*  Special case when there is no payload,
+                                mask, or additional frames. */
                             sws->inmsg_current_chunk_len = 0;
-
-                            if (sws->continuing) {
-                                /*  This frame was empty, but continue
-                                    next frame in fragmented sequence. */
-                                nn_sws_recv_hdr (sws);
-                                return;
-                            }
-                            else {
-                                /*  Special case when there is no payload,
-                                    mask, or additional frames. */
-                                sws->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
-                                nn_pipebase_received (&sws->pipebase);
-                                return;
-                            }
-                            }
+                            nn_sws_recv_data (sws);
+                            return;
+                        }
                         /*  Continue to receive extended header+payload. */
                         break;
 
@@ -1121,21 +1119,11 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                                 sanity-check that this endpoint is a client. */
                             nn_assert (sws->mode == NN_WS_CLIENT);
 
+                            /*  Special case when there is no payload,
+                                mask, or additional frames. */
                             sws->inmsg_current_chunk_len = 0;
-
-                            if (sws->continuing) {
-                                /*  This frame was empty, but continue
-                                    next frame in fragmented sequence. */
-                                nn_sws_recv_hdr (sws);
-                                return;
-                            }
-                            else {
-                                /*  Special case when there is no payload,
-                                    mask, or additional frames. */
-                                sws->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
-                                nn_pipebase_received (&sws->pipebase);
-                                return;
-                            }
+                            nn_sws_recv_data (sws);
+                            return;
                         }
                         /*  Continue to receive extended header+payload. */
                         break;
@@ -1165,7 +1153,7 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                                 mask, or additional frames. */
                             sws->inmsg_current_chunk_len = 0;
                             sws->instate = NN_SWS_INSTATE_RECVD_CONTROL;
-                            nn_pipebase_received (&sws->pipebase);
+                            nn_sws_received (sws);
                             return;
                         }
                         /*  Continue to receive extended header+payload. */
@@ -1196,7 +1184,7 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                                 mask, or additional frames. */
                             sws->inmsg_current_chunk_len = 0;
                             sws->instate = NN_SWS_INSTATE_RECVD_CONTROL;
-                            nn_pipebase_received (&sws->pipebase);
+                            nn_sws_received (sws);
                             return;
                         }
                         /*  Continue to receive extended header+payload. */
@@ -1351,19 +1339,15 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
 
                     /*  Handle zero-length message bodies. */
                     if (sws->inmsg_current_chunk_len == 0) {
-                        if (sws->is_final_frame) {
-                            if (sws->opcode == NN_WS_OPCODE_CLOSE) {
-                                nn_sws_acknowledge_close_handshake (sws);
-                            }
-                            else {
-                                sws->instate = (sws->is_control_frame ?
-                                    NN_SWS_INSTATE_RECVD_CONTROL :
-                                    NN_SWS_INSTATE_RECVD_CHUNKED);
-                                nn_pipebase_received (&sws->pipebase);
-                            }
+                        if (!sws->is_control_frame) {
+                            nn_sws_recv_data (sws);
+                        }
+                        else if (sws->opcode == NN_WS_OPCODE_CLOSE) {
+                            nn_sws_acknowledge_close_handshake (sws);
                         }
                         else {
-                            nn_sws_recv_hdr (sws);
+                            sws->instate = NN_SWS_INSTATE_RECVD_CONTROL;
+                            nn_sws_received (sws);
                         }
                         return;
                     }
@@ -1413,43 +1397,19 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                     switch (sws->opcode) {
 
                     case NN_WS_OPCODE_TEXT:
-                        nn_sws_validate_utf8_chunk (sws);
-                        return;
-
                     case NN_WS_OPCODE_BINARY:
-                        if (sws->is_final_frame) {
-                            sws->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
-                            nn_pipebase_received (&sws->pipebase);
-                        }
-                        else {
-                            nn_sws_recv_hdr (sws);
-                        }
-                        return;
-
                     case NN_WS_OPCODE_FRAGMENT:
-                        /*  Must check original opcode to see if this fragment
-                            needs UTF-8 validation. */
-                        if ((sws->inmsg_hdr & NN_SWS_FRAME_BITMASK_OPCODE) ==
-                            NN_WS_OPCODE_TEXT) {
-                            nn_sws_validate_utf8_chunk (sws);
-                        }
-                        else if (sws->is_final_frame) {
-                            sws->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
-                            nn_pipebase_received (&sws->pipebase);
-                        }
-                        else {
-                            nn_sws_recv_hdr (sws);
-                        }
+                        nn_sws_recv_data (sws);
                         return;
 
                     case NN_WS_OPCODE_PING:
                         sws->instate = NN_SWS_INSTATE_RECVD_CONTROL;
-                        nn_pipebase_received (&sws->pipebase);
+                        nn_sws_received (sws);
                         return;
 
                     case NN_WS_OPCODE_PONG:
                         sws->instate = NN_SWS_INSTATE_RECVD_CONTROL;
-                        nn_pipebase_received (&sws->pipebase);
+                        nn_sws_received (sws);
                         return;
 
                     case NN_WS_OPCODE_CLOSE:
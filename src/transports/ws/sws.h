@@ -31,6 +31,7 @@
 #include "../../aio/usock.h"
 
 #include "ws_handshake.h"
+#include "deflate.h"
 
 #include "../../utils/msg.h"
 #include "../../utils/list.h"
@@ -57,9 +58,6 @@
 #define NN_SWS_FRAME_BITMASK_RSV3 0x10
 #define NN_SWS_FRAME_BITMASK_OPCODE 0x0F
 
-/*  UTF-8 validation. */
-#define NN_SWS_UTF8_MAX_CODEPOINT_LEN 4
-
 /*  The longest possible header frame length. As per RFC 6455 5.2:
     first 2 bytes of initial framing + up to 8 bytes of additional
     extended payload length header + 4 byte mask = 14bytes
@@ -129,12 +127,15 @@ struct nn_sws {
         connection. */
     int continuing;
 
-    /*  When validating continuation frames of UTF-8, it may be necessary
-        to buffer tail-end of the previous frame in order to continue
-        validation in the case that frames are chopped on intra-code point
-        boundaries. */
-    uint8_t utf8_code_pt_fragment [NN_SWS_UTF8_MAX_CODEPOINT_LEN];
-    size_t utf8_code_pt_fragment_len;
+    /*  State of UTF-8 validation of the current text message. It carries
+        over to the next frame in the case that frames are chopped on
+        intra-code point boundaries. */
+    int utf8_state;
+
+    /*  Compression contexts, if permessage-deflate was negotiated, and
+        the size from which outbound messages get compressed. */
+    struct nn_ws_deflate deflate;
+    size_t deflate_min_size;
 
     /*  Statistics on control frames. */
     int pings_sent;
@@ -0,0 +1,363 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "utf8.h"
+
+#include "../../utils/fast.h"
+
+#include <string.h>
+
+/*  NN_WS_UTF8_SSSE3 enables the lookup kernel below. Where the compiler
+    doesn't target SSSE3 by default but can build single functions for it,
+    the kernel is compiled for SSSE3 anyway and used only if the CPU turns
+    out to support it. */
+#if defined __SSSE3__ || defined __AVX2__
+#include <tmmintrin.h>
+#define NN_WS_UTF8_SSE2
+#define NN_WS_UTF8_SSSE3
+#define NN_WS_UTF8_TARGET
+#define nn_ws_utf8_has_ssse3() 1
+#elif (defined __x86_64__ || defined __i386__) && (defined __clang__ || \
+    __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <tmmintrin.h>
+#if defined __SSE2__
+#define NN_WS_UTF8_SSE2
+#endif
+#define NN_WS_UTF8_SSSE3
+#define NN_WS_UTF8_TARGET __attribute__ ((target ("ssse3")))
+#define nn_ws_utf8_has_ssse3() __builtin_cpu_supports ("ssse3")
+#elif defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NN_WS_UTF8_SSE2
+#endif
+
+/*  Multi-octet code points are checked by a finite state machine. Each
+    state is a multiple of 6, so that the transitions for a given octet can
+    be packed into a single 64-bit row: the next state is the 6-bit field
+    found at the offset equal to the current state. This way the only
+    operations depending on the previous octet are a shift and a mask. */
+
+/*  One more continuation octet is needed. */
+#define S_CONT1 12
+/*  Two more continuation octets are needed. */
+#define S_CONT2 18
+/*  After 0xE0; 0xA0-0xBF must follow to avoid an overlong encoding. */
+#define S_E0 24
+/*  After 0xED; 0x80-0x9F must follow to avoid UTF-16 surrogates. */
+#define S_ED 30
+/*  Three more continuation octets are needed. */
+#define S_CONT3 36
+/*  After 0xF0; 0x90-0xBF must follow to avoid an overlong encoding. */
+#define S_F0 42
+/*  After 0xF4; 0x80-0x8F must follow to stay below U+110000. */
+#define S_F4 48
+
+#define A NN_WS_UTF8_ACCEPT
+#define R NN_WS_UTF8_REJECT
+
+/*  Packs the next states for when the current state is, in this order,
+    A, R, S_CONT1, S_CONT2, S_E0, S_ED, S_CONT3, S_F0 and S_F4. */
+#define NN_WS_UTF8_ROW(a, r, c1, c2, e0, ed, c3, f0, f4) \
+    (((uint64_t) (a) << A) | ((uint64_t) (r) << R) | \
+    ((uint64_t) (c1) << S_CONT1) | ((uint64_t) (c2) << S_CONT2) | \
+    ((uint64_t) (e0) << S_E0) | ((uint64_t) (ed) << S_ED) | \
+    ((uint64_t) (c3) << S_CONT3) | ((uint64_t) (f0) << S_F0) | \
+    ((uint64_t) (f4) << S_F4))
+
+/*  Octets are split into classes as required by RFC 3629 section 4. Octets
+    of the same class cause the same transitions. */
+#define NN_WS_UTF8_CLASSES 12
+
+static const uint64_t nn_ws_utf8_row [NN_WS_UTF8_CLASSES] = {
+    /*  0x00-0x7F, UTF8-1. */
+    NN_WS_UTF8_ROW (A, R, R, R, R, R, R, R, R),
+    /*  0x80-0x8F, 0x90-0x9F and 0xA0-0xBF, continuation octets. */
+    NN_WS_UTF8_ROW (R, R, A, S_CONT1, R, S_CONT1, S_CONT2, R, S_CONT2),
+    NN_WS_UTF8_ROW (R, R, A, S_CONT1, R, S_CONT1, S_CONT2, S_CONT2, R),
+    NN_WS_UTF8_ROW (R, R, A, S_CONT1, S_CONT1, R, S_CONT2, S_CONT2, R),
+    /*  0xC0, 0xC1 and 0xF5-0xFF never appear in UTF-8. */
+    NN_WS_UTF8_ROW (R, R, R, R, R, R, R, R, R),
+    /*  0xC2-0xDF, UTF8-2. */
+    NN_WS_UTF8_ROW (S_CONT1, R, R, R, R, R, R, R, R),
+    /*  0xE0, 0xE1-0xEC and 0xEE-0xEF, 0xED, UTF8-3. */
+    NN_WS_UTF8_ROW (S_E0, R, R, R, R, R, R, R, R),
+    NN_WS_UTF8_ROW (S_CONT2, R, R, R, R, R, R, R, R),
+    NN_WS_UTF8_ROW (S_ED, R, R, R, R, R, R, R, R),
+    /*  0xF0, 0xF1-0xF3, 0xF4, UTF8-4. */
+    NN_WS_UTF8_ROW (S_F0, R, R, R, R, R, R, R, R),
+    NN_WS_UTF8_ROW (S_CONT3, R, R, R, R, R, R, R, R),
+    NN_WS_UTF8_ROW (S_F4, R, R, R, R, R, R, R, R)
+};
+
+#undef A
+#undef R
+
+/*  Maps octets to the classes above. */
+static const uint8_t nn_ws_utf8_class [256] = {
+    /*  0x00-0x7F */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /*  0x80-0xBF */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    /*  0xC0-0xDF */
+    4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    /*  0xE0-0xEF */
+    6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 7,
+    /*  0xF0-0xFF */
+    9, 10, 10, 10, 11, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4
+};
+
+/*  Maximum length of a code point as per RFC 3629. */
+#define NN_WS_UTF8_MAX_LEN 4
+
+/*  ASCII text is checked this many octets at a time. */
+#define NN_WS_UTF8_BLOCK 16
+
+/*  Returns 1 if all NN_WS_UTF8_BLOCK octets at 'data' are ASCII. */
+static int nn_ws_utf8_isascii (const uint8_t *data)
+{
+#if defined NN_WS_UTF8_SSE2
+    return !_mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i*) data));
+#else
+    uint64_t w1;
+    uint64_t w2;
+
+    memcpy (&w1, data, sizeof (w1));
+    memcpy (&w2, data + sizeof (w1), sizeof (w2));
+    return !((w1 | w2) & 0x8080808080808080ULL);
+#endif
+}
+
+#if defined NN_WS_UTF8_SSSE3
+
+/*  Vectorised validation as described in J. Keiser and D. Lemire,
+    "Validating UTF-8 In Less Than One Instruction Per Byte". For each octet,
+    three 16-entry tables are looked up by the high and the low nibble of the
+    previous octet and by the high nibble of the octet itself. Each entry is
+    a set of the errors the nibble can be part of; an error is found when all
+    three lookups agree on it. */
+#define NN_WS_UTF8_TOO_SHORT (1 << 0)
+#define NN_WS_UTF8_TOO_LONG (1 << 1)
+#define NN_WS_UTF8_OVERLONG_3 (1 << 2)
+#define NN_WS_UTF8_TOO_LARGE (1 << 3)
+#define NN_WS_UTF8_SURROGATE (1 << 4)
+#define NN_WS_UTF8_OVERLONG_2 (1 << 5)
+#define NN_WS_UTF8_TOO_LARGE_1000 (1 << 6)
+#define NN_WS_UTF8_OVERLONG_4 (1 << 6)
+#define NN_WS_UTF8_TWO_CONTS (1 << 7)
+#define NN_WS_UTF8_CARRY (NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_TOO_LONG | \
+    NN_WS_UTF8_TWO_CONTS)
+
+/*  Validates 'nblocks' blocks of NN_WS_UTF8_BLOCK octets. The data must start
+    at a code point boundary. A code point cut by the end of the data is not
+    considered an error. Returns 0 if the data are valid, -1 otherwise. */
+NN_WS_UTF8_TARGET static int nn_ws_utf8_simd (const uint8_t *data,
+    size_t nblocks)
+{
+    const __m128i byte1_high = _mm_setr_epi8 (
+        /*  0_______: ASCII. */
+        NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG,
+        NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG,
+        NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG,
+        NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG,
+        /*  10______: continuation. */
+        (char) NN_WS_UTF8_TWO_CONTS, (char) NN_WS_UTF8_TWO_CONTS,
+        (char) NN_WS_UTF8_TWO_CONTS, (char) NN_WS_UTF8_TWO_CONTS,
+        /*  1100____ and 1101____: lead of 2 octets. */
+        NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_OVERLONG_2,
+        NN_WS_UTF8_TOO_SHORT,
+        /*  1110____: lead of 3 octets. */
+        NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_OVERLONG_3 | NN_WS_UTF8_SURROGATE,
+        /*  1111____: lead of 4 or more octets. */
+        NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000 | NN_WS_UTF8_OVERLONG_4);
+    const __m128i byte1_low = _mm_setr_epi8 (
+        /*  ____0000 */
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_OVERLONG_3 |
+            NN_WS_UTF8_OVERLONG_2 | NN_WS_UTF8_OVERLONG_4),
+        /*  ____0001 */
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_OVERLONG_2),
+        /*  ____001_ */
+        (char) NN_WS_UTF8_CARRY, (char) NN_WS_UTF8_CARRY,
+        /*  ____0100 */
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE),
+        /*  ____0101 to ____1100 */
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000),
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000),
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000),
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000),
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000),
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000),
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000),
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000),
+        /*  ____1101 */
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000 | NN_WS_UTF8_SURROGATE),
+        /*  ____111_ */
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000),
+        (char) (NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE |
+            NN_WS_UTF8_TOO_LARGE_1000));
+    const __m128i byte2_high = _mm_setr_epi8 (
+        /*  0_______: ASCII. */
+        NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT,
+        NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT,
+        NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT,
+        NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT,
+        /*  1000____ */
+        (char) (NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 |
+            NN_WS_UTF8_TWO_CONTS | NN_WS_UTF8_OVERLONG_3 |
+            NN_WS_UTF8_TOO_LARGE_1000 | NN_WS_UTF8_OVERLONG_4),
+        /*  1001____ */
+        (char) (NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 |
+            NN_WS_UTF8_TWO_CONTS | NN_WS_UTF8_OVERLONG_3 |
+            NN_WS_UTF8_TOO_LARGE),
+        /*  101_____ */
+        (char) (NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 |
+            NN_WS_UTF8_TWO_CONTS | NN_WS_UTF8_SURROGATE |
+            NN_WS_UTF8_TOO_LARGE),
+        (char) (NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 |
+            NN_WS_UTF8_TWO_CONTS | NN_WS_UTF8_SURROGATE |
+            NN_WS_UTF8_TOO_LARGE),
+        /*  11______: lead. */
+        NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT,
+        NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT);
+    const __m128i nibble = _mm_set1_epi8 (0x0F);
+    const __m128i third = _mm_set1_epi8 ((char) (0xE0 - 0x80));
+    const __m128i fourth = _mm_set1_epi8 ((char) (0xF0 - 0x80));
+    const __m128i high = _mm_set1_epi8 ((char) 0x80);
+    __m128i in;
+    __m128i prev;
+    __m128i prev1;
+    __m128i special;
+    __m128i must23;
+    __m128i err;
+    size_t i;
+
+    /*  Data start at a code point boundary, as if preceded by ASCII. */
+    prev = _mm_setzero_si128 ();
+    err = _mm_setzero_si128 ();
+
+    for (i = 0; i != nblocks; ++i) {
+        in = _mm_loadu_si128 ((const __m128i*) (data + i * NN_WS_UTF8_BLOCK));
+
+        /*  Errors detectable from two consecutive octets. */
+        prev1 = _mm_alignr_epi8 (in, prev, 15);
+        special = _mm_and_si128 (_mm_and_si128 (
+            _mm_shuffle_epi8 (byte1_high,
+                _mm_and_si128 (_mm_srli_epi16 (prev1, 4), nibble)),
+            _mm_shuffle_epi8 (byte1_low, _mm_and_si128 (prev1, nibble))),
+            _mm_shuffle_epi8 (byte2_high,
+                _mm_and_si128 (_mm_srli_epi16 (in, 4), nibble)));
+
+        /*  The third and fourth octets of long code points must be
+            continuations, while no other continuations may follow
+            a continuation. */
+        must23 = _mm_or_si128 (
+            _mm_subs_epu8 (_mm_alignr_epi8 (in, prev, 14), third),
+            _mm_subs_epu8 (_mm_alignr_epi8 (in, prev, 13), fourth));
+        err = _mm_or_si128 (err,
+            _mm_xor_si128 (_mm_and_si128 (must23, high), special));
+
+        prev = in;
+    }
+
+    return _mm_movemask_epi8 (_mm_cmpeq_epi8 (err,
+        _mm_setzero_si128 ())) == 0xFFFF ? 0 : -1;
+}
+
+#endif
+
+int nn_ws_utf8_validate (int state, const uint8_t *data, size_t len)
+{
+    size_t i;
+    size_t end;
+#if defined NN_WS_UTF8_SSSE3
+    size_t nblocks;
+    size_t n;
+#endif
+
+    i = 0;
+    while (i < len) {
+
+        /*  Between code points skip blocks of ASCII text in bulk. */
+        if (state == NN_WS_UTF8_ACCEPT && len - i >= NN_WS_UTF8_BLOCK) {
+            if (nn_ws_utf8_isascii (data + i)) {
+                i += NN_WS_UTF8_BLOCK;
+                continue;
+            }
+#if defined NN_WS_UTF8_SSSE3
+            if (nn_ws_utf8_has_ssse3 ()) {
+
+                /*  Validate all the remaining whole blocks at once. */
+                nblocks = (len - i) / NN_WS_UTF8_BLOCK;
+                if (nn_slow (nn_ws_utf8_simd (data + i, nblocks) < 0))
+                    return NN_WS_UTF8_REJECT;
+
+                /*  The last code point may continue past the blocks. Step
+                    back to its first octet and let the state machine handle
+                    it together with the remaining octets. */
+                end = i + nblocks * NN_WS_UTF8_BLOCK;
+                for (n = 1; n != NN_WS_UTF8_MAX_LEN && end - n > i &&
+                      (data [end - n] & 0xC0) == 0x80; ++n)
+                    ;
+                i = end - n;
+                for (; i != len; ++i)
+                    state = (int) ((nn_ws_utf8_row [
+                        nn_ws_utf8_class [data [i]]] >> state) & 63);
+                break;
+            }
+#endif
+        }
+
+        /*  Otherwise run the whole block through the state machine. As
+            NN_WS_UTF8_REJECT is final, it's enough to check for it once
+            per block. */
+        end = len - i < NN_WS_UTF8_BLOCK ? len : i + NN_WS_UTF8_BLOCK;
+        for (; i != end; ++i)
+            state = (int) ((nn_ws_utf8_row [nn_ws_utf8_class [data [i]]] >>
+                state) & 63);
+        if (nn_slow (state == NN_WS_UTF8_REJECT))
+            break;
+    }
+
+    return state;
+}
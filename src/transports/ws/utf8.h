@@ -0,0 +1,41 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_WS_UTF8_INCLUDED
+#define NN_WS_UTF8_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  States of the UTF-8 validator. Any other state means that the text seen
+    so far ends in the middle of a code point. */
+#define NN_WS_UTF8_ACCEPT 0
+#define NN_WS_UTF8_REJECT 6
+
+/*  Validates 'len' bytes of UTF-8 text as per RFC 3629. Text split into
+    several buffers is validated by passing the state returned for one buffer
+    to the call for the next one; the first buffer starts with
+    NN_WS_UTF8_ACCEPT. Once NN_WS_UTF8_REJECT is returned, the text is
+    invalid and the state doesn't change anymore. */
+int nn_ws_utf8_validate (int state, const uint8_t *data, size_t len);
+
+#endif
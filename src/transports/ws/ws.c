@@ -26,6 +26,7 @@
 #include "bws.h"
 #include "cws.h"
 #include "sws.h"
+#include "deflate.h"
 
 #include "../../ws.h"
 
@@ -49,6 +50,10 @@
 struct nn_ws_optset {
     struct nn_optset base;
     int msg_type;
+    int deflate;
+    int deflate_level;
+    int deflate_min_size;
+    int deflate_no_context_takeover;
 };
 
 static void nn_ws_optset_destroy (struct nn_optset *self);
@@ -97,6 +102,10 @@ static struct nn_optset *nn_ws_optset ()
 
     /*  Default values for WebSocket options. */
     optset->msg_type = NN_WS_MSG_TYPE_BINARY;
+    optset->deflate = 0;
+    optset->deflate_level = 6;
+    optset->deflate_min_size = 256;
+    optset->deflate_no_context_takeover = 0;
 
     return &optset->base;   
 }
@@ -131,6 +140,24 @@ static int nn_ws_optset_setopt (struct nn_optset *self, int option,
         default:
             return -EINVAL;
         }
+    case NN_WS_DEFLATE:
+        if (val && !nn_ws_deflate_supported ())
+            return -ENOTSUP;
+        optset->deflate = val ? 1 : 0;
+        return 0;
+    case NN_WS_DEFLATE_LEVEL:
+        if (val < 0 || val > 9)
+            return -EINVAL;
+        optset->deflate_level = val;
+        return 0;
+    case NN_WS_DEFLATE_MIN_SIZE:
+        if (val < 0)
+            return -EINVAL;
+        optset->deflate_min_size = val;
+        return 0;
+    case NN_WS_DEFLATE_NO_CONTEXT_TAKEOVER:
+        optset->deflate_no_context_takeover = val ? 1 : 0;
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -140,16 +167,31 @@ static int nn_ws_optset_getopt (struct nn_optset *self, int option,
     void *optval, size_t *optvallen)
 {
     struct nn_ws_optset *optset;
+    int intval;
 
     optset = nn_cont (self, struct nn_ws_optset, base);
 
     switch (option) {
     case NN_WS_MSG_TYPE:
-        memcpy (optval, &optset->msg_type,
-            *optvallen < sizeof (int) ? *optvallen : sizeof (int));
-        *optvallen = sizeof (int);
-        return 0;
+        intval = optset->msg_type;
+        break;
+    case NN_WS_DEFLATE:
+        intval = optset->deflate;
+        break;
+    case NN_WS_DEFLATE_LEVEL:
+        intval = optset->deflate_level;
+        break;
+    case NN_WS_DEFLATE_MIN_SIZE:
+        intval = optset->deflate_min_size;
+        break;
+    case NN_WS_DEFLATE_NO_CONTEXT_TAKEOVER:
+        intval = optset->deflate_no_context_takeover;
+        break;
     default:
         return -ENOPROTOOPT;
     }
+    memcpy (optval, &intval,
+        *optvallen < sizeof (int) ? *optvallen : sizeof (int));
+    *optvallen = sizeof (int);
+    return 0;
 }
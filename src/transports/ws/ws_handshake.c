@@ -28,6 +28,7 @@
 #include "../../aio/timer.h"
 
 #include "../../core/sock.h"
+#include "../../ws.h"
 
 #include "../utils/base64.h"
 
@@ -190,6 +191,8 @@ void nn_ws_handshake_start (struct nn_ws_handshake *self,
     struct nn_usock *usock, struct nn_pipebase *pipebase,
     int mode, const char *resource, const char *host)
 {
+    size_t sz;
+
     /*  It's expected this resource has been allocated during intial connect. */
     if (mode == NN_WS_CLIENT)
         nn_assert (strlen (resource) >= 1);
@@ -211,6 +214,17 @@ void nn_ws_handshake_start (struct nn_ws_handshake *self,
     self->recv_pos = 0;
     self->retries = 0;
 
+    /*  Find out whether to negotiate compression. */
+    sz = sizeof (self->deflate);
+    nn_pipebase_getopt (pipebase, NN_WS, NN_WS_DEFLATE, &self->deflate, &sz);
+    nn_assert (sz == sizeof (self->deflate));
+    sz = sizeof (self->deflate_no_context_takeover);
+    nn_pipebase_getopt (pipebase, NN_WS, NN_WS_DEFLATE_NO_CONTEXT_TAKEOVER,
+        &self->deflate_no_context_takeover, &sz);
+    nn_assert (sz == sizeof (self->deflate_no_context_takeover));
+    memset (&self->deflate_params, 0, sizeof (self->deflate_params));
+    self->deflate_header [0] = '\0';
+
     /*  Calculate the absolute minimum length possible for a valid opening
         handshake. This is an optimization since we must poll for the
         remainder of the opening handshake in small byte chunks. */
@@ -879,6 +893,7 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self)
     self->version = NULL;
     self->protocol = NULL;
     self->uri = NULL;
+    self->extensions = NULL;
 
     self->host_len = 0;
     self->origin_len = 0;
@@ -888,6 +903,7 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self)
     self->version_len = 0;
     self->protocol_len = 0;
     self->uri_len = 0;
+    self->extensions_len = 0;
 
     /*  NB: If we got here, we already have a fully received set of
         HTTP headers.  So there is no point in asking for more if the
@@ -1023,6 +1039,13 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self)
         return NN_WS_HANDSHAKE_INVALID;
     }
 
+    /*  Accept compression if offered, as per RFC 7692 section 5. Offers
+        that can't be accepted are simply ignored. */
+    if (self->deflate && self->extensions)
+        nn_ws_deflate_accept (self->extensions, self->extensions_len,
+            self->deflate_no_context_takeover, &self->deflate_params,
+            self->deflate_header, sizeof (self->deflate_header));
+
     /*  At this point, client meets RFC 6455 compliance for opening handshake.
         Now it's time to check nanomsg-imposed required handshake values. */
     if (self->protocol) {
@@ -1100,6 +1123,7 @@ static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self)
     self->conn = NULL;
     self->version = NULL;
     self->protocol = NULL;
+    self->extensions = NULL;
 
     self->status_code_len = 0;
     self->reason_phrase_len = 0;
@@ -1109,6 +1133,7 @@ static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self)
     self->conn_len = 0;
     self->version_len = 0;
     self->protocol_len = 0;
+    self->extensions_len = 0;
 
     /*  RFC 7230 3.1.2 Status Line: HTTP Version. */
     if (!nn_ws_match_token ("HTTP/1.1\x20", &pos, 0, 0))
@@ -1214,6 +1239,12 @@ static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self)
         self->accept_key_len, 1) != NN_WS_HANDSHAKE_MATCH)
         return NN_WS_HANDSHAKE_INVALID;
 
+    /*  RFC 7692 section 5; the server may only accept what was offered. */
+    if (self->extensions && (!self->deflate ||
+          nn_ws_deflate_confirm (self->extensions, self->extensions_len,
+          self->deflate_no_context_takeover, &self->deflate_params) < 0))
+        return NN_WS_HANDSHAKE_INVALID;
+
     /*  Server response meets RFC 6455 compliance for opening handshake. */
     return NN_WS_HANDSHAKE_VALID;
 }
@@ -1260,6 +1291,11 @@ static void nn_ws_handshake_client_request (struct nn_ws_handshake *self)
     /*  Guarantee that the socket type was found in the map. */
     nn_assert (i < NN_WS_HANDSHAKE_SP_MAP_LEN);
 
+    /*  Offer compression as per RFC 7692 section 5. */
+    if (self->deflate)
+        nn_ws_deflate_offer (self->deflate_header,
+            sizeof (self->deflate_header), self->deflate_no_context_takeover);
+
     sprintf (self->opening_hs,
         "GET %s HTTP/1.1\r\n"
         "Host: %s\r\n"
@@ -1267,9 +1303,13 @@ static void nn_ws_handshake_client_request (struct nn_ws_handshake *self)
         "Connection: Upgrade\r\n"
         "Sec-WebSocket-Key: %s\r\n"
         "Sec-WebSocket-Version: 13\r\n"
-        "Sec-WebSocket-Protocol: %s\r\n\r\n",
+        "Sec-WebSocket-Protocol: %s\r\n"
+        "%s%s%s"
+        "\r\n",
         self->resource, self->remote_host, encoded_key,
-        NN_WS_HANDSHAKE_SP_MAP[i].ws_sp);
+        NN_WS_HANDSHAKE_SP_MAP[i].ws_sp,
+        self->deflate ? "Sec-WebSocket-Extensions: " : "",
+        self->deflate_header, self->deflate ? "\r\n" : "");
 
     open_request.iov_len = strlen (self->opening_hs);
     open_request.iov_base = self->opening_hs;
@@ -1309,8 +1349,13 @@ static void nn_ws_handshake_server_reply (struct nn_ws_handshake *self)
             "Upgrade: websocket\r\n"
             "Connection: Upgrade\r\n"
             "Sec-WebSocket-Accept: %s\r\n"
-            "Sec-WebSocket-Protocol: %s\r\n\r\n",
-            accept_key, protocol);
+            "Sec-WebSocket-Protocol: %s\r\n"
+            "%s%s%s"
+            "\r\n",
+            accept_key, protocol,
+            self->deflate_params.enabled ? "Sec-WebSocket-Extensions: " : "",
+            self->deflate_header,
+            self->deflate_params.enabled ? "\r\n" : "");
 
         nn_free (protocol);
     }
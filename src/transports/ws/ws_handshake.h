@@ -27,6 +27,8 @@
 
 #include "../../transport.h"
 
+#include "deflate.h"
+
 #include "../../aio/fsm.h"
 #include "../../aio/usock.h"
 #include "../../aio/timer.h"
@@ -138,6 +140,17 @@ struct nn_ws_handshake {
     const char *extensions;
     size_t extensions_len;
 
+    /*  Whether this peer is willing to use permessage-deflate and whether it
+        wants both compressors to forget their history after each message. */
+    int deflate;
+    int deflate_no_context_takeover;
+
+    /*  Outcome of permessage-deflate negotiation. */
+    struct nn_ws_deflate_params deflate_params;
+
+    /*  Value of Sec-WebSocket-Extensions header sent by this peer. */
+    char deflate_header [NN_WS_DEFLATE_HEADER_MAX_LEN];
+
     /*  Identifies the response to be sent to client's opening handshake. */
     int response_code;
 
@@ -110,6 +110,22 @@ void nn_chunkref_cp (struct nn_chunkref *dst, struct nn_chunkref *src)
     memcpy (dst, src, sizeof (struct nn_chunkref));
 }
 
+void nn_chunkref_unshare (struct nn_chunkref *self)
+{
+    int rc;
+    struct nn_chunkref_chunk *ch;
+
+    /*  Small messages are stored in the chunkref itself. */
+    if (self->u.ref [0] != 0xff)
+        return;
+
+    /*  Reallocation to the same size copies the chunk only if it is
+        referenced from elsewhere. */
+    ch = (struct nn_chunkref_chunk*) self;
+    rc = nn_chunk_realloc (nn_chunk_size (ch->chunk), &ch->chunk);
+    errnum_assert (rc == 0, -rc);
+}
+
 void *nn_chunkref_data (struct nn_chunkref *self)
 {
     return self->u.ref [0] == 0xff ?
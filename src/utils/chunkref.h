@@ -69,6 +69,10 @@ void nn_chunkref_mv (struct nn_chunkref *dst, struct nn_chunkref *src);
     calling this function. */
 void nn_chunkref_cp (struct nn_chunkref *dst, struct nn_chunkref *src);
 
+/*  Makes sure the data is not shared with any other chunkref, copying it
+    if needed, so that it can be modified in place. */
+void nn_chunkref_unshare (struct nn_chunkref *self);
+
 /*  Returns the pointer to the binary data stored in the chunk. */
 void *nn_chunkref_data (struct nn_chunkref *self);
 
@@ -38,17 +38,26 @@
 #include "attr.h"
 
 uint64_t nn_clock_ms (void)
+{
+    return nn_clock_us () / 1000;
+}
+
+uint64_t nn_clock_us (void)
+{
+    return nn_clock_ns () / 1000;
+}
+
+uint64_t nn_clock_ns (void)
 {
 #if defined NN_HAVE_WINDOWS
 
     LARGE_INTEGER tps;
     LARGE_INTEGER time;
-    double tpms;
 
     QueryPerformanceFrequency (&tps);
     QueryPerformanceCounter (&time);
-    tpms = (double) (tps.QuadPart / 1000);
-    return (uint64_t) (time.QuadPart / tpms);
+    return (uint64_t) (time.QuadPart / tps.QuadPart * 1000000000 +
+        time.QuadPart % tps.QuadPart * 1000000000 / tps.QuadPart);
 
 #elif defined NN_HAVE_OSX
 
@@ -61,11 +70,11 @@ uint64_t nn_clock_ms (void)
 
     ticks = mach_absolute_time ();
     return ticks * nn_clock_timebase_info.numer /
-        nn_clock_timebase_info.denom / 1000000;
+        nn_clock_timebase_info.denom;
 
 #elif defined NN_HAVE_GETHRTIME
 
-    return gethrtime () / 1000000;
+    return gethrtime ();
 
 #elif defined NN_HAVE_CLOCK_MONOTONIC
 
@@ -74,7 +83,7 @@ uint64_t nn_clock_ms (void)
 
     rc = clock_gettime (CLOCK_MONOTONIC, &tv);
     errno_assert (rc == 0);
-    return tv.tv_sec * (uint64_t) 1000 + tv.tv_nsec / 1000000;
+    return tv.tv_sec * (uint64_t) 1000000000 + tv.tv_nsec;
 
 #else
 
@@ -85,7 +94,7 @@ uint64_t nn_clock_ms (void)
         monotonic. Thus, it's used as a last resort mechanism. */
     rc = gettimeofday (&tv, NULL);
     errno_assert (rc == 0);
-    return tv.tv_sec * (uint64_t) 1000 + tv.tv_usec / 1000;
+    return tv.tv_sec * (uint64_t) 1000000000 + tv.tv_usec * 1000;
 
 #endif
 }
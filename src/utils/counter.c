@@ -0,0 +1,91 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "counter.h"
+
+void nn_counter_add (struct nn_counter *self, int64_t n)
+{
+#if defined NN_COUNTER_WINAPI
+    InterlockedExchangeAdd64 ((LONGLONG*) &self->n, n);
+#elif defined NN_COUNTER_SOLARIS
+    atomic_add_64 (&self->n, n);
+#elif defined NN_COUNTER_GCC_BUILTINS && defined __ATOMIC_RELAXED
+    __atomic_fetch_add (&self->n, (uint64_t) n, __ATOMIC_RELAXED);
+#elif defined NN_COUNTER_GCC_BUILTINS
+    __sync_fetch_and_add (&self->n, (uint64_t) n);
+#else
+    self->n += (uint64_t) n;
+#endif
+}
+
+void nn_counter_set (struct nn_counter *self, uint64_t n)
+{
+#if defined NN_COUNTER_WINAPI
+    InterlockedExchange64 ((LONGLONG*) &self->n, (LONGLONG) n);
+#elif defined NN_COUNTER_SOLARIS
+    atomic_swap_64 (&self->n, n);
+#elif defined NN_COUNTER_GCC_BUILTINS && defined __ATOMIC_RELAXED
+    __atomic_store_n (&self->n, n, __ATOMIC_RELAXED);
+#else
+    self->n = n;
+#endif
+}
+
+void nn_counter_max (struct nn_counter *self, uint64_t n)
+{
+    uint64_t old;
+
+    old = nn_counter_get (self);
+    while (old < n) {
+#if defined NN_COUNTER_WINAPI
+        old = (uint64_t) InterlockedCompareExchange64 ((LONGLONG*) &self->n,
+            (LONGLONG) n, (LONGLONG) old);
+#elif defined NN_COUNTER_SOLARIS
+        old = atomic_cas_64 (&self->n, old, n);
+#elif defined NN_COUNTER_GCC_BUILTINS && defined __ATOMIC_RELAXED
+        if (__atomic_compare_exchange_n (&self->n, &old, n, 1,
+              __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+#elif defined NN_COUNTER_GCC_BUILTINS
+        old = __sync_val_compare_and_swap (&self->n, old, n);
+#else
+        self->n = n;
+        break;
+#endif
+    }
+}
+
+uint64_t nn_counter_get (struct nn_counter *self)
+{
+#if defined NN_COUNTER_WINAPI
+    return (uint64_t) InterlockedCompareExchange64 ((LONGLONG*) &self->n, 0, 0);
+#elif defined NN_COUNTER_SOLARIS
+    return atomic_add_64_nv (&self->n, 0);
+#elif defined NN_COUNTER_GCC_BUILTINS && defined __ATOMIC_RELAXED
+    return __atomic_load_n (&self->n, __ATOMIC_RELAXED);
+#elif defined NN_COUNTER_GCC_BUILTINS
+    return __sync_fetch_and_add (&self->n, 0);
+#else
+    return self->n;
+#endif
+}
@@ -0,0 +1,63 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_COUNTER_INCLUDED
+#define NN_COUNTER_INCLUDED
+
+#if defined NN_HAVE_WINDOWS
+#include "win.h"
+#define NN_COUNTER_WINAPI
+#elif NN_HAVE_ATOMIC_SOLARIS
+#include <atomic.h>
+#define NN_COUNTER_SOLARIS
+#elif defined NN_HAVE_GCC_ATOMIC_BUILTINS
+#define NN_COUNTER_GCC_BUILTINS
+#else
+#define NN_COUNTER_PLAIN
+#endif
+
+#include <stdint.h>
+
+/*  64-bit statistics counter. Updates are atomic but impose no ordering on
+    the surrounding memory accesses, so they are cheap enough for the hot
+    path. On platforms without atomic operations the counter degrades to
+    plain arithmetic, where concurrent updates may occasionally get lost.
+    An all-zero counter is a valid counter set to zero. */
+
+struct nn_counter {
+    volatile uint64_t n;
+};
+
+/*  Add 'n' to the counter. Negative values decrement it. */
+void nn_counter_add (struct nn_counter *self, int64_t n);
+
+/*  Overwrite the value of the counter. */
+void nn_counter_set (struct nn_counter *self, uint64_t n);
+
+/*  Raise the counter to 'n' if it is currently lower. */
+void nn_counter_max (struct nn_counter *self, uint64_t n);
+
+/*  Return the current value of the counter. */
+uint64_t nn_counter_get (struct nn_counter *self);
+
+#endif
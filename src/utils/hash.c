@@ -23,117 +23,208 @@
 #include "hash.h"
 #include "fast.h"
 #include "alloc.h"
-#include "cont.h"
 #include "err.h"
+#include "attr.h"
+
+#include <string.h>
 
 #define NN_HASH_INITIAL_SLOTS 32
 
+/*  Number of old slots migrated to the new array on each modification of
+    the table while it is growing. */
+#define NN_HASH_MIGRATE_STEP 8
+
 static uint32_t nn_hash_key (uint32_t key);
+static struct nn_hash_slot *nn_hash_alloc (uint32_t slots);
+static struct nn_hash_slot *nn_hash_find (struct nn_hash_slot *array,
+    uint32_t slots, uint32_t key);
+static void nn_hash_place (struct nn_hash *self, uint32_t key,
+    struct nn_hash_item *item);
+static void nn_hash_migrate (struct nn_hash *self, uint32_t count);
+static void nn_hash_grow (struct nn_hash *self);
 
 void nn_hash_init (struct nn_hash *self)
 {
-    uint32_t i;
-
     self->slots = NN_HASH_INITIAL_SLOTS;
     self->items = 0;
-    self->array = nn_alloc (sizeof (struct nn_list) * NN_HASH_INITIAL_SLOTS,
-        "hash map");
-    alloc_assert (self->array);
-    for (i = 0; i != NN_HASH_INITIAL_SLOTS; ++i)
-        nn_list_init (&self->array [i]);
+    self->array = nn_hash_alloc (NN_HASH_INITIAL_SLOTS);
+    self->oldslots = 0;
+    self->migrated = 0;
+    self->oldarray = NULL;
 }
 
 void nn_hash_term (struct nn_hash *self)
 {
-    uint32_t i;
-
-    for (i = 0; i != self->slots; ++i)
-        nn_list_term (&self->array [i]);
+    if (self->oldarray)
+        nn_free (self->oldarray);
     nn_free (self->array);
 }
 
-static void nn_hash_rehash (struct nn_hash *self)
+static struct nn_hash_slot *nn_hash_alloc (uint32_t slots)
+{
+    struct nn_hash_slot *array;
+
+    array = nn_alloc (sizeof (struct nn_hash_slot) * slots, "hash map");
+    alloc_assert (array);
+    memset (array, 0, sizeof (struct nn_hash_slot) * slots);
+
+    return array;
+}
+
+static struct nn_hash_slot *nn_hash_find (struct nn_hash_slot *array,
+    uint32_t slots, uint32_t key)
 {
     uint32_t i;
-    uint32_t oldslots;
-    struct nn_list *oldarray;
-    struct nn_hash_item *hitm;
-    uint32_t newslot;
-
-    /*  Allocate new double-sized array of slots. */
-    oldslots = self->slots;
-    oldarray = self->array;
-    self->slots *= 2;
-    self->array = nn_alloc (sizeof (struct nn_list) * self->slots, "hash map");
-    alloc_assert (self->array);
-    for (i = 0; i != self->slots; ++i)
-        nn_list_init (&self->array [i]);
-
-    /*  Move the items from old slot array to new slot array. */
-    for (i = 0; i != oldslots; ++i) {
-        while (!nn_list_empty (&oldarray [i])) {
-            hitm = nn_cont (nn_list_begin (&oldarray [i]),
-                    struct nn_hash_item, list);
-            nn_list_erase (&oldarray [i], &hitm->list);
-            newslot = nn_hash_key (hitm->key) % self->slots;
-            nn_list_insert (&self->array [newslot], &hitm->list,
-                    nn_list_end (&self->array [newslot]));
+    uint32_t dist;
+
+    i = nn_hash_key (key) & (slots - 1);
+    for (dist = 1; ; ++dist) {
+
+        /*  With Robin Hood probing the key can't be further from its ideal
+            slot than the item we are looking at. */
+        if (array [i].dist < dist)
+            return NULL;
+        if (array [i].key == key && array [i].item)
+            return &array [i];
+        i = (i + 1) & (slots - 1);
+    }
+}
+
+static void nn_hash_place (struct nn_hash *self, uint32_t key,
+    struct nn_hash_item *item)
+{
+    uint32_t i;
+    struct nn_hash_slot slot;
+    struct nn_hash_slot tmp;
+
+    slot.key = key;
+    slot.dist = 1;
+    slot.item = item;
+    i = nn_hash_key (key) & (self->slots - 1);
+    while (1) {
+        if (self->array [i].dist == 0) {
+            self->array [i] = slot;
+            return;
         }
 
-        nn_list_term (&oldarray [i]);
+        /*  Take the slot from the item that is closer to its ideal slot
+            than the one being placed and continue with that one. */
+        if (self->array [i].dist < slot.dist) {
+            tmp = self->array [i];
+            self->array [i] = slot;
+            slot = tmp;
+        }
+        ++slot.dist;
+        i = (i + 1) & (self->slots - 1);
     }
+}
+
+static void nn_hash_migrate (struct nn_hash *self, uint32_t count)
+{
+    struct nn_hash_slot *slot;
 
-    /*  Deallocate the old array of slots. */
-    nn_free (oldarray);
+    while (count-- && self->migrated != self->oldslots) {
+        slot = &self->oldarray [self->migrated];
+
+        /*  The slot is left in the old array as a tombstone so that
+            lookups of not yet migrated items still probe past it. */
+        if (slot->item) {
+            nn_hash_place (self, slot->key, slot->item);
+            slot->item = NULL;
+        }
+        ++self->migrated;
+    }
+
+    if (self->migrated == self->oldslots) {
+        nn_free (self->oldarray);
+        self->oldarray = NULL;
+        self->oldslots = 0;
+        self->migrated = 0;
+    }
+}
+
+static void nn_hash_grow (struct nn_hash *self)
+{
+    /*  Finish previous migration, if any. It's very unlikely to be still
+        in progress as the new array is twice the size of the old one. */
+    if (nn_slow (self->oldarray != NULL))
+        nn_hash_migrate (self, self->oldslots);
+
+    /*  Allocate new double-sized array of slots. The items will be moved
+        to it gradually. */
+    self->oldslots = self->slots;
+    self->oldarray = self->array;
+    self->migrated = 0;
+    self->slots *= 2;
+    self->array = nn_hash_alloc (self->slots);
 }
 
 void nn_hash_insert (struct nn_hash *self, uint32_t key,
     struct nn_hash_item *item)
 {
-    struct nn_list_item *it;
-    uint32_t i;
-
-    i = nn_hash_key (key) % self->slots;
-
-    for (it = nn_list_begin (&self->array [i]);
-          it != nn_list_end (&self->array [i]);
-          it = nn_list_next (&self->array [i], it))
-        nn_assert (nn_cont (it, struct nn_hash_item, list)->key != key);
+    nn_assert (nn_hash_get (self, key) == NULL);
 
     item->key = key;
-    nn_list_insert (&self->array [i], &item->list,
-        nn_list_end (&self->array [i]));
     ++self->items;
 
-    /*  If the hash is getting full, double the amount of slots and
-        re-hash all the items. */
-    if (nn_slow (self->items * 2 > self->slots && self->slots < 0x80000000))
-        nn_hash_rehash(self);
+    /*  If the hash is getting full, double the amount of slots. */
+    if (nn_slow (self->items * 4 > self->slots * 3 &&
+          self->slots < 0x80000000))
+        nn_hash_grow (self);
+
+    nn_hash_place (self, key, item);
+
+    if (self->oldarray)
+        nn_hash_migrate (self, NN_HASH_MIGRATE_STEP);
 }
 
 void nn_hash_erase (struct nn_hash *self, struct nn_hash_item *item)
 {
-    uint32_t slot;
+    struct nn_hash_slot *slot;
+    uint32_t i;
+    uint32_t next;
+
+    slot = nn_hash_find (self->array, self->slots, item->key);
+    if (slot) {
+        nn_assert (slot->item == item);
+
+        /*  Shift subsequent items of the cluster one slot back so that
+            no tombstones are needed in the current array. */
+        i = slot - self->array;
+        while (1) {
+            next = (i + 1) & (self->slots - 1);
+            if (self->array [next].dist <= 1)
+                break;
+            self->array [i] = self->array [next];
+            --self->array [i].dist;
+            i = next;
+        }
+        memset (&self->array [i], 0, sizeof (struct nn_hash_slot));
+    }
+    else {
+        nn_assert (self->oldarray);
+        slot = nn_hash_find (self->oldarray, self->oldslots, item->key);
+        nn_assert (slot && slot->item == item);
+        slot->item = NULL;
+    }
+    --self->items;
 
-    slot = nn_hash_key (item->key) % self->slots;
-    nn_list_erase (&self->array [slot], &item->list);
-	--self->items;
+    if (self->oldarray)
+        nn_hash_migrate (self, NN_HASH_MIGRATE_STEP);
 }
 
 struct nn_hash_item *nn_hash_get (struct nn_hash *self, uint32_t key)
 {
-    uint32_t slot;
-    struct nn_list_item *it;
-    struct nn_hash_item *item;
-
-    slot = nn_hash_key (key) % self->slots;
-
-    for (it = nn_list_begin (&self->array [slot]);
-          it != nn_list_end (&self->array [slot]);
-          it = nn_list_next (&self->array [slot], it)) {
-        item = nn_cont (it, struct nn_hash_item, list);
-        if (item->key == key)
-            return item;
+    struct nn_hash_slot *slot;
+
+    slot = nn_hash_find (self->array, self->slots, key);
+    if (nn_fast (slot != NULL))
+        return slot->item;
+
+    if (self->oldarray) {
+        slot = nn_hash_find (self->oldarray, self->oldslots, key);
+        if (slot)
+            return slot->item;
     }
 
     return NULL;
@@ -154,11 +245,9 @@ uint32_t nn_hash_key (uint32_t key)
 
 void nn_hash_item_init (struct nn_hash_item *self)
 {
-    nn_list_item_init (&self->list);
+    self->key = 0xffff;
 }
 
-void nn_hash_item_term (struct nn_hash_item *self)
+void nn_hash_item_term (NN_UNUSED struct nn_hash_item *self)
 {
-    nn_list_item_term (&self->list);
 }
-
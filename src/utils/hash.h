@@ -23,23 +23,46 @@
 #ifndef NN_HASH_INCLUDED
 #define NN_HASH_INCLUDED
 
-#include "list.h"
-
 #include <stddef.h>
 #include <stdint.h>
 
+/*  Open-addressing hash table using Robin Hood probing. Keys are stored
+    inline in the slot array so that lookups don't have to dereference
+    the items. When the table grows, items are migrated from the old slot
+    array to the new one a few slots at a time on each modification, so
+    there's no single operation that has to rehash the whole table. */
+
 /*  Use for initialising a hash item statically. */
-#define NN_HASH_ITEM_INITIALIZER {0xffff, NN_LIST_ITEM_INITILIZER}
+#define NN_HASH_ITEM_INITIALIZER {0xffff}
 
 struct nn_hash_item {
     uint32_t key;
-    struct nn_list_item list;
+};
+
+struct nn_hash_slot {
+
+    /*  Key of the item stored in the slot. */
+    uint32_t key;
+
+    /*  Distance from the ideal slot for the key, plus one. Zero means that
+        the slot is empty. */
+    uint32_t dist;
+
+    /*  The item itself. NULL in a non-empty slot of the old array means
+        that the item was already migrated or erased. */
+    struct nn_hash_item *item;
 };
 
 struct nn_hash {
     uint32_t slots;
     uint32_t items;
-    struct nn_list *array;
+    struct nn_hash_slot *array;
+
+    /*  Slot array being migrated from while the table is growing. NULL if
+        there's no migration in progress. */
+    uint32_t oldslots;
+    uint32_t migrated;
+    struct nn_hash_slot *oldarray;
 };
 
 /*  Initialise the hash table. */
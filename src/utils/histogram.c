@@ -0,0 +1,83 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "histogram.h"
+#include "err.h"
+
+void nn_histogram_record (struct nn_histogram *self, uint64_t value)
+{
+    nn_counter_add (&self->buckets [nn_histogram_bucket (value)], 1);
+    nn_counter_add (&self->count, 1);
+    nn_counter_add (&self->sum, (int64_t) value);
+    nn_counter_max (&self->max, value);
+}
+
+void nn_histogram_read (struct nn_histogram *self, uint64_t *buckets)
+{
+    int i;
+
+    for (i = 0; i != NN_HISTOGRAM_BUCKETS; ++i)
+        buckets [i] = nn_counter_get (&self->buckets [i]);
+}
+
+int nn_histogram_bucket (uint64_t value)
+{
+    int msb;
+    int bucket;
+
+    if (value < NN_HISTOGRAM_SUBBUCKETS)
+        return (int) value;
+
+    /*  Find the most significant bit. The bits right below it select
+        the sub-bucket. */
+#if defined __GNUC__
+    msb = 63 - __builtin_clzll (value);
+#else
+    msb = 0;
+    while (value >> (msb + 1))
+        ++msb;
+#endif
+    bucket = (msb - NN_HISTOGRAM_SUBBUCKET_BITS + 1) * NN_HISTOGRAM_SUBBUCKETS +
+        (int) ((value >> (msb - NN_HISTOGRAM_SUBBUCKET_BITS)) &
+        (NN_HISTOGRAM_SUBBUCKETS - 1));
+    if (bucket >= NN_HISTOGRAM_BUCKETS)
+        return NN_HISTOGRAM_BUCKETS - 1;
+    return bucket;
+}
+
+uint64_t nn_histogram_bucket_max (int bucket)
+{
+    int shift;
+    uint64_t sub;
+
+    nn_assert (bucket >= 0 && bucket < NN_HISTOGRAM_BUCKETS);
+
+    if (bucket < NN_HISTOGRAM_SUBBUCKETS)
+        return (uint64_t) bucket;
+    if (bucket == NN_HISTOGRAM_BUCKETS - 1)
+        return UINT64_MAX;
+
+    shift = bucket / NN_HISTOGRAM_SUBBUCKETS - 1;
+    sub = NN_HISTOGRAM_SUBBUCKETS + bucket % NN_HISTOGRAM_SUBBUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
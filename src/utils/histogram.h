@@ -0,0 +1,62 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_HISTOGRAM_INCLUDED
+#define NN_HISTOGRAM_INCLUDED
+
+#include "../nn.h"
+
+#include "counter.h"
+
+#include <stdint.h>
+
+/*  Log-linear histogram in the style of HdrHistogram. Each power of two is
+    split into NN_HISTOGRAM_SUBBUCKETS linear sub-buckets, which bounds the
+    relative error of any recorded value by 1/NN_HISTOGRAM_SUBBUCKETS.
+    Values below NN_HISTOGRAM_SUBBUCKETS are recorded exactly; values too
+    large for the last bucket are recorded in it. Recording is lock-free. */
+
+#define NN_HISTOGRAM_SUBBUCKET_BITS 3
+#define NN_HISTOGRAM_SUBBUCKETS (1 << NN_HISTOGRAM_SUBBUCKET_BITS)
+#define NN_HISTOGRAM_BUCKETS NN_STAT_LATENCY_BUCKETS
+
+struct nn_histogram {
+    struct nn_counter count;
+    struct nn_counter sum;
+    struct nn_counter max;
+    struct nn_counter buckets [NN_HISTOGRAM_BUCKETS];
+};
+
+/*  Records a single value. */
+void nn_histogram_record (struct nn_histogram *self, uint64_t value);
+
+/*  Copies the buckets into a plain array of NN_HISTOGRAM_BUCKETS items. */
+void nn_histogram_read (struct nn_histogram *self, uint64_t *buckets);
+
+/*  Returns index of the bucket the value falls into. */
+int nn_histogram_bucket (uint64_t value);
+
+/*  Returns the highest value that falls into the specified bucket. */
+uint64_t nn_histogram_bucket_max (int bucket);
+
+#endif
@@ -29,6 +29,7 @@ void nn_msg_init (struct nn_msg *self, size_t size)
     nn_chunkref_init (&self->sphdr, 0);
     nn_chunkref_init (&self->hdrs, 0);
     nn_chunkref_init (&self->body, size);
+    self->stamp = 0;
 }
 
 void nn_msg_init_chunk (struct nn_msg *self, void *chunk)
@@ -36,6 +37,7 @@ void nn_msg_init_chunk (struct nn_msg *self, void *chunk)
     nn_chunkref_init (&self->sphdr, 0);
     nn_chunkref_init (&self->hdrs, 0);
     nn_chunkref_init_chunk (&self->body, chunk);
+    self->stamp = 0;
 }
 
 void nn_msg_term (struct nn_msg *self)
@@ -50,6 +52,7 @@ void nn_msg_mv (struct nn_msg *dst, struct nn_msg *src)
     nn_chunkref_mv (&dst->sphdr, &src->sphdr);
     nn_chunkref_mv (&dst->hdrs, &src->hdrs);
     nn_chunkref_mv (&dst->body, &src->body);
+    dst->stamp = src->stamp;
 }
 
 void nn_msg_cp (struct nn_msg *dst, struct nn_msg *src)
@@ -57,6 +60,7 @@ void nn_msg_cp (struct nn_msg *dst, struct nn_msg *src)
     nn_chunkref_cp (&dst->sphdr, &src->sphdr);
     nn_chunkref_cp (&dst->hdrs, &src->hdrs);
     nn_chunkref_cp (&dst->body, &src->body);
+    dst->stamp = src->stamp;
 }
 
 void nn_msg_bulkcopy_start (struct nn_msg *self, uint32_t copies)
@@ -71,6 +75,7 @@ void nn_msg_bulkcopy_cp (struct nn_msg *dst, struct nn_msg *src)
     nn_chunkref_bulkcopy_cp (&dst->sphdr, &src->sphdr);
     nn_chunkref_bulkcopy_cp (&dst->hdrs, &src->hdrs);
     nn_chunkref_bulkcopy_cp (&dst->body, &src->body);
+    dst->stamp = src->stamp;
 }
 
 void nn_msg_replace_body (struct nn_msg *self, struct nn_chunkref new_body) 
@@ -26,6 +26,7 @@
 #include "chunkref.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
 struct nn_msg {
 
@@ -40,6 +41,11 @@ struct nn_msg {
 
     /*  Contains application level message payload. */
     struct nn_chunkref body;
+
+    /*  Time, in microseconds, when the message entered the library, either
+        by being sent by the user or by arriving from the network. Zero if
+        not known. Used to measure the send-to-delivery latency. */
+    uint64_t stamp;
 };
 
 /*  Initialises a message with body 'size' bytes long and empty header. */
@@ -0,0 +1,136 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "trace.h"
+#include "clock.h"
+#include "attr.h"
+
+#if defined NN_HAVE_WINDOWS
+#include "win.h"
+#elif NN_HAVE_ATOMIC_SOLARIS
+#include <atomic.h>
+#endif
+
+#include <errno.h>
+
+struct nn_trace_hook nn_trace_hooks [NN_TRACE_POINTS];
+
+/*  The hook function is stored with release semantics after its argument
+    and flags, and loaded with acquire semantics before them, so whoever
+    sees the function also sees what it is to be called with. */
+
+static nn_trace_fn nn_trace_load (nn_trace_fn *fn)
+{
+#if defined NN_HAVE_WINDOWS
+    return (nn_trace_fn) InterlockedCompareExchangePointer (
+        (PVOID volatile*) fn, NULL, NULL);
+#elif NN_HAVE_ATOMIC_SOLARIS
+    nn_trace_fn res;
+
+    res = *(nn_trace_fn volatile*) fn;
+    membar_consumer ();
+    return res;
+#elif defined NN_HAVE_GCC_ATOMIC_BUILTINS && defined __ATOMIC_ACQUIRE
+    return __atomic_load_n (fn, __ATOMIC_ACQUIRE);
+#elif defined NN_HAVE_GCC_ATOMIC_BUILTINS
+    nn_trace_fn res;
+
+    res = *(nn_trace_fn volatile*) fn;
+    __sync_synchronize ();
+    return res;
+#else
+    return *(nn_trace_fn volatile*) fn;
+#endif
+}
+
+#if !defined NN_DISABLE_TRACE
+static void nn_trace_store (nn_trace_fn *fn, nn_trace_fn val)
+{
+#if defined NN_HAVE_WINDOWS
+    InterlockedExchangePointer ((PVOID volatile*) fn, (PVOID) val);
+#elif NN_HAVE_ATOMIC_SOLARIS
+    membar_producer ();
+    *(nn_trace_fn volatile*) fn = val;
+#elif defined NN_HAVE_GCC_ATOMIC_BUILTINS && defined __ATOMIC_RELEASE
+    __atomic_store_n (fn, val, __ATOMIC_RELEASE);
+#elif defined NN_HAVE_GCC_ATOMIC_BUILTINS
+    __sync_synchronize ();
+    *(nn_trace_fn volatile*) fn = val;
+#else
+    *(nn_trace_fn volatile*) fn = val;
+#endif
+}
+#endif
+
+void nn_trace_fire (int point, int sock, const void *object, size_t size,
+    uint64_t stamp)
+{
+    struct nn_trace_hook *hook;
+    struct nn_trace_event event;
+    nn_trace_fn fn;
+
+    /*  The hook may be removed concurrently. */
+    hook = &nn_trace_hooks [point];
+    fn = nn_trace_load (&hook->fn);
+    if (nn_slow (fn == NULL))
+        return;
+
+    event.point = point;
+    event.socket = sock;
+    event.object = object;
+    event.size = size;
+    event.stamp = stamp;
+    event.time = hook->flags & NN_TRACE_TIMESTAMP ? nn_clock_us () : 0;
+    fn (&event, hook->arg);
+}
+
+#if defined NN_DISABLE_TRACE
+int nn_trace_hook (NN_UNUSED int point, NN_UNUSED nn_trace_fn fn,
+    NN_UNUSED void *arg, NN_UNUSED int flags)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+#else
+int nn_trace_hook (int point, nn_trace_fn fn, void *arg, int flags)
+{
+    struct nn_trace_hook *hook;
+
+    if (nn_slow (point < NN_TRACE_SOCK_SEND || point >= NN_TRACE_POINTS ||
+          (flags & ~NN_TRACE_TIMESTAMP) != 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /*  Clear the function first so that tracepoints hit in the meantime skip
+        the hook, and publish the new one last. A tracepoint that loaded the
+        old function just before may still pass it the new argument, so
+        replacing a hook is best done while the sockets are idle. */
+    hook = &nn_trace_hooks [point];
+    nn_trace_store (&hook->fn, NULL);
+    hook->arg = arg;
+    hook->flags = flags;
+    nn_trace_store (&hook->fn, fn);
+    return 0;
+}
+#endif
@@ -0,0 +1,63 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_TRACE_INCLUDED
+#define NN_TRACE_INCLUDED
+
+#include "../nn.h"
+
+#include "fast.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Message tracepoints. When no hook is installed for a tracepoint, it costs
+    a single well-predicted branch. Building with NN_DISABLE_TRACE removes
+    the tracepoints altogether. */
+
+#define NN_TRACE_POINTS (NN_TRACE_SOCK_RECV + 1)
+
+struct nn_trace_hook {
+    nn_trace_fn fn;
+    void *arg;
+    int flags;
+};
+
+extern struct nn_trace_hook nn_trace_hooks [NN_TRACE_POINTS];
+
+#if defined NN_DISABLE_TRACE
+#define nn_tracepoint(point, sock, object, size, stamp) \
+    do {} while (0)
+#else
+#define nn_tracepoint(point, sock, object, size, stamp) \
+    do {\
+        if (nn_slow (nn_trace_hooks [point].fn != NULL))\
+            nn_trace_fire ((point), (sock), (object), (size), (stamp));\
+    } while (0)
+#endif
+
+/*  Invokes the hook installed for the tracepoint. */
+void nn_trace_fire (int point, int sock, const void *object, size_t size,
+    uint64_t stamp);
+
+#endif
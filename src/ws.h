@@ -37,6 +37,10 @@ extern "C" {
     NN_WS_MSG_TYPE_BINARY messages are supported fully by this implementation.
     Attempting to set other message types is undefined.  */
 #define NN_WS_MSG_TYPE 1
+#define NN_WS_DEFLATE 2
+#define NN_WS_DEFLATE_LEVEL 3
+#define NN_WS_DEFLATE_MIN_SIZE 4
+#define NN_WS_DEFLATE_NO_CONTEXT_TAKEOVER 5
 
 /*  WebSocket opcode constants as per RFC 6455 5.2  */
 #define NN_WS_MSG_TYPE_TEXT 0x01
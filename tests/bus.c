@@ -26,6 +26,74 @@
 
 #define SOCKET_ADDRESS_A "inproc://a"
 #define SOCKET_ADDRESS_B "inproc://b"
+#define SOCKET_ADDRESS_C "inproc://c"
+#define SOCKET_ADDRESS_D "inproc://d"
+
+/*  Forwards a single message on a raw BUS socket. */
+static void forward (int s)
+{
+    int rc;
+    void *body;
+    void *control;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+
+    iov.iov_base = &body;
+    iov.iov_len = NN_MSG;
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = &control;
+    hdr.msg_controllen = NN_MSG;
+    rc = nn_recvmsg (s, &hdr, 0);
+    errno_assert (rc >= 0);
+    rc = nn_sendmsg (s, &hdr, 0);
+    errno_assert (rc >= 0);
+}
+
+/*  Sends a message on a raw BUS socket as if it was forwarded on behalf
+    of the node with the specified origin ID. */
+static void inject (int s, uint32_t origin, uint32_t seq, const char *body)
+{
+    int rc;
+    size_t spsz;
+    uint8_t *data;
+    struct nn_cmsghdr *cmsg;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    uint8_t ctrl [NN_CMSG_SPACE (sizeof (size_t) + 16)];
+
+    memset (ctrl, 0, sizeof (ctrl));
+    cmsg = (struct nn_cmsghdr*) ctrl;
+    cmsg->cmsg_len = sizeof (ctrl);
+    cmsg->cmsg_level = PROTO_SP;
+    cmsg->cmsg_type = SP_HDR;
+    data = NN_CMSG_DATA (cmsg);
+    spsz = 16;
+    memcpy (data, &spsz, sizeof (spsz));
+
+    /*  No pipe to exclude, followed by the origin and the sequence number
+        in network byte order. */
+    data += sizeof (size_t) + 8;
+    data [0] = (uint8_t) (origin >> 24);
+    data [1] = (uint8_t) (origin >> 16);
+    data [2] = (uint8_t) (origin >> 8);
+    data [3] = (uint8_t) origin;
+    data [4] = (uint8_t) (seq >> 24);
+    data [5] = (uint8_t) (seq >> 16);
+    data [6] = (uint8_t) (seq >> 8);
+    data [7] = (uint8_t) seq;
+
+    iov.iov_base = (void*) body;
+    iov.iov_len = strlen (body);
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctrl;
+    hdr.msg_controllen = sizeof (ctrl);
+    rc = nn_sendmsg (s, &hdr, 0);
+    errno_assert (rc == (int) strlen (body));
+}
 
 int main ()
 {
@@ -33,6 +101,10 @@ int main ()
     int bus1;
     int bus2;
     int bus3;
+    int raw1;
+    int raw2;
+    int opt;
+    int i;
     char buf [3];
 
     /*  Create a simple bus topology consisting of 3 nodes. */
@@ -77,6 +149,82 @@ int main ()
     test_close (bus2);
     test_close (bus1);
 
+    /*  Duplicate suppression. Diamond topology where the message from bus1
+        reaches bus2 via both raw1 and raw2. */
+    opt = 1;
+    bus1 = test_socket (AF_SP, NN_BUS);
+    test_setsockopt (bus1, NN_BUS, NN_BUS_DEDUP, &opt, sizeof (opt));
+    bus2 = test_socket (AF_SP, NN_BUS);
+    test_setsockopt (bus2, NN_BUS, NN_BUS_DEDUP, &opt, sizeof (opt));
+    raw1 = test_socket (AF_SP_RAW, NN_BUS);
+    test_setsockopt (raw1, NN_BUS, NN_BUS_DEDUP, &opt, sizeof (opt));
+    raw2 = test_socket (AF_SP_RAW, NN_BUS);
+    test_setsockopt (raw2, NN_BUS, NN_BUS_DEDUP, &opt, sizeof (opt));
+    test_bind (raw1, SOCKET_ADDRESS_A);
+    test_bind (raw1, SOCKET_ADDRESS_B);
+    test_bind (raw2, SOCKET_ADDRESS_C);
+    test_bind (raw2, SOCKET_ADDRESS_D);
+    test_connect (bus1, SOCKET_ADDRESS_A);
+    test_connect (bus1, SOCKET_ADDRESS_C);
+    test_connect (bus2, SOCKET_ADDRESS_B);
+    test_connect (bus2, SOCKET_ADDRESS_D);
+    nn_sleep (10);
+
+    test_send (bus1, "ABC");
+    forward (raw1);
+    forward (raw2);
+    test_recv (bus2, "ABC");
+    opt = 100;
+    test_setsockopt (bus2, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    rc = nn_recv (bus2, buf, sizeof (buf), 0);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+
+    /*  Messages from bus2 are delivered to bus1 once as well. */
+    test_send (bus2, "DEF");
+    test_send (bus2, "GHI");
+    forward (raw1);
+    forward (raw1);
+    forward (raw2);
+    forward (raw2);
+    test_recv (bus1, "DEF");
+    test_recv (bus1, "GHI");
+    test_setsockopt (bus1, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    rc = nn_recv (bus1, buf, sizeof (buf), 0);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+
+    test_close (raw2);
+    test_close (raw1);
+    test_close (bus2);
+    test_close (bus1);
+
+    /*  Duplicates are suppressed for many origins at once. */
+    opt = 1;
+    raw1 = test_socket (AF_SP_RAW, NN_BUS);
+    test_setsockopt (raw1, NN_BUS, NN_BUS_DEDUP, &opt, sizeof (opt));
+    bus1 = test_socket (AF_SP, NN_BUS);
+    test_setsockopt (bus1, NN_BUS, NN_BUS_DEDUP, &opt, sizeof (opt));
+    test_bind (raw1, SOCKET_ADDRESS_A);
+    test_connect (bus1, SOCKET_ADDRESS_A);
+    nn_sleep (10);
+
+    for (i = 0; i != 128; ++i)
+        inject (raw1, 1000 + i, 1, "ABC");
+    for (i = 0; i != 128; ++i)
+        test_recv (bus1, "ABC");
+    for (i = 0; i != 128; ++i) {
+        inject (raw1, 1000 + i, 1, "ABC");
+        inject (raw1, 1000 + i, 2, "DEF");
+    }
+    for (i = 0; i != 128; ++i)
+        test_recv (bus1, "DEF");
+    opt = 100;
+    test_setsockopt (bus1, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    rc = nn_recv (bus1, buf, sizeof (buf), 0);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+
+    test_close (bus1);
+    test_close (raw1);
+
     return 0;
 }
 
@@ -37,6 +37,10 @@
 #define SOCKET_ADDRESS_D "inproc://d"
 #define SOCKET_ADDRESS_E "inproc://e"
 
+/*  Sockets of the uni-directional device. */
+static int devc;
+static int devd;
+
 void device1 (NN_UNUSED void *arg)
 {
     int rc;
@@ -61,8 +65,6 @@ void device1 (NN_UNUSED void *arg)
 void device2 (NN_UNUSED void *arg)
 {
     int rc;
-    int devc;
-    int devd;
 
     /*  Intialise the device sockets. */
     devc = test_socket (AF_SP_RAW, NN_PULL);
@@ -145,6 +147,14 @@ int main ()
     test_send (endc, "XYZ");
     test_recv (endd, "XYZ");
 
+    /*  Check the forwarding statistics of the device. They are updated
+        after the message is passed on, so give the device a moment. */
+    nn_sleep (100);
+    nn_assert (nn_get_statistic (devc, NN_STAT_MESSAGES_FORWARDED) == 1);
+    nn_assert (nn_get_statistic (devc, NN_STAT_BYTES_FORWARDED) == 3);
+    nn_assert (nn_get_statistic (devd, NN_STAT_MESSAGES_FORWARDED) == 0);
+    nn_assert (nn_get_statistic (devd, NN_STAT_MESSAGES_SENT) == 1);
+
     /*  Clean up. */
     test_close (endd);
     test_close (endc);
@@ -0,0 +1,137 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/bus.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+#include "../src/inproc.h"
+
+#include "testutil.h"
+#include "../src/utils/attr.h"
+#include "../src/utils/thread.c"
+
+/*  Tests running several devices from a single thread. */
+
+#define SOCKET_ADDRESS_A "inproc://a"
+#define SOCKET_ADDRESS_B "inproc://b"
+#define SOCKET_ADDRESS_C "inproc://c"
+#define SOCKET_ADDRESS_D "inproc://d"
+#define SOCKET_ADDRESS_E "inproc://e"
+
+/*  Bi-directional, uni-directional and loopback device. */
+static int devs [6];
+
+void group (NN_UNUSED void *arg)
+{
+    int rc;
+
+    rc = nn_device_group (devs, 3);
+    nn_assert (rc < 0 && nn_errno () == EBADF);
+}
+
+int main ()
+{
+    int rc;
+    int enda;
+    int endb;
+    int endc;
+    int endd;
+    int ende1;
+    int ende2;
+    int bad [2];
+    int i;
+    struct nn_thread thread;
+
+    /*  Intialise the device sockets. */
+    devs [0] = test_socket (AF_SP_RAW, NN_PAIR);
+    test_bind (devs [0], SOCKET_ADDRESS_A);
+    devs [1] = test_socket (AF_SP_RAW, NN_PAIR);
+    test_bind (devs [1], SOCKET_ADDRESS_B);
+    devs [2] = test_socket (AF_SP_RAW, NN_PULL);
+    test_bind (devs [2], SOCKET_ADDRESS_C);
+    devs [3] = test_socket (AF_SP_RAW, NN_PUSH);
+    test_bind (devs [3], SOCKET_ADDRESS_D);
+    devs [4] = test_socket (AF_SP_RAW, NN_BUS);
+    test_bind (devs [4], SOCKET_ADDRESS_E);
+    devs [5] = -1;
+
+    /*  Invalid devices are refused before anything starts. */
+    rc = nn_device_group (devs, 0);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    bad [0] = devs [0];
+    bad [1] = devs [2];
+    rc = nn_device_group (bad, 1);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+
+    /*  Start the devices. */
+    nn_thread_init (&thread, group, NULL);
+
+    enda = test_socket (AF_SP, NN_PAIR);
+    test_connect (enda, SOCKET_ADDRESS_A);
+    endb = test_socket (AF_SP, NN_PAIR);
+    test_connect (endb, SOCKET_ADDRESS_B);
+    endc = test_socket (AF_SP, NN_PUSH);
+    test_connect (endc, SOCKET_ADDRESS_C);
+    endd = test_socket (AF_SP, NN_PULL);
+    test_connect (endd, SOCKET_ADDRESS_D);
+    ende1 = test_socket (AF_SP, NN_BUS);
+    test_connect (ende1, SOCKET_ADDRESS_E);
+    ende2 = test_socket (AF_SP, NN_BUS);
+    test_connect (ende2, SOCKET_ADDRESS_E);
+
+    /*  BUS is unreliable so wait a bit for connections to be established. */
+    nn_sleep (100);
+
+    /*  Pass messages through all the devices. */
+    for (i = 0; i != 100; ++i) {
+        test_send (enda, "ABC");
+        test_send (endb, "DEF");
+        test_send (endc, "GHI");
+        test_send (ende1, "JKL");
+        test_recv (endb, "ABC");
+        test_recv (enda, "DEF");
+        test_recv (endd, "GHI");
+        test_recv (ende2, "JKL");
+    }
+
+    /*  Stop the bi-directional device. The others keep going. */
+    test_close (devs [0]);
+    test_send (endc, "MNO");
+    test_recv (endd, "MNO");
+    test_send (ende2, "PQR");
+    test_recv (ende1, "PQR");
+
+    /*  Clean up. */
+    test_close (ende2);
+    test_close (ende1);
+    test_close (endd);
+    test_close (endc);
+    test_close (endb);
+    test_close (enda);
+
+    /*  Shut down the remaining devices. */
+    nn_term ();
+    nn_thread_term (&thread);
+
+    return 0;
+}
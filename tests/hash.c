@@ -47,6 +47,27 @@ int main ()
     /*  Find one element and check whether it is the correct one. */
     nn_assert (nn_hash_get (&hash, 5000) == item5000);
 
+    /*  Remove every other element while the table is still being resized
+        and check that the remaining ones can still be found. */
+    for (k = 1; k < 10000; k += 2) {
+        item = nn_hash_get (&hash, k);
+        nn_assert (item && item->key == k);
+        nn_hash_erase (&hash, item);
+        nn_free (item);
+    }
+    nn_assert (nn_hash_get (&hash, 5001) == NULL);
+    for (k = 0; k < 10000; k += 2) {
+        item = nn_hash_get (&hash, k);
+        nn_assert (item && item->key == k);
+    }
+    for (k = 1; k < 10000; k += 2) {
+        item = nn_alloc (sizeof (struct nn_hash_item), "item");
+        nn_assert (item);
+        nn_hash_item_init (item);
+        nn_hash_insert (&hash, k, item);
+    }
+    nn_assert (nn_hash_get (&hash, 5000) == item5000);
+
     /*  Remove all the elements from the hash table and terminate it. */
     for (k = 0; k != 10000; ++k) {
         item = nn_hash_get (&hash, k);
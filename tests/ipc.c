@@ -24,6 +24,7 @@
 #include "../src/nn.h"
 #include "../src/pair.h"
 #include "../src/pubsub.h"
+#include "../src/pipeline.h"
 #include "../src/ipc.h"
 
 #include "testutil.h"
@@ -39,6 +40,7 @@ int main ()
     int sc;
     int i;
     int s1, s2;
+    int spush [8];
     void * dummy_buf;
     int rc;
     int opt;
@@ -158,6 +160,35 @@ int main ()
     errno_assert (nn_errno () == EINVAL);
     test_close (sb);
 
+    /*  Test accepting connections in batches. */
+    sb = test_socket (AF_SP, NN_PULL);
+    rc = nn_getsockopt (sb, NN_IPC, NN_IPC_ACCEPT_BATCH, &opt, &opt_sz);
+    errno_assert (rc == 0);
+    nn_assert (opt_sz == sizeof (opt) && opt == 1);
+    opt = 0;
+    rc = nn_setsockopt (sb, NN_IPC, NN_IPC_ACCEPT_BATCH, &opt, opt_sz);
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EINVAL);
+    opt = 17;
+    rc = nn_setsockopt (sb, NN_IPC, NN_IPC_ACCEPT_BATCH, &opt, opt_sz);
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EINVAL);
+    opt = 4;
+    test_setsockopt (sb, NN_IPC, NN_IPC_ACCEPT_BATCH, &opt, opt_sz);
+    test_bind (sb, SOCKET_ADDRESS);
+    for (i = 0; i != 8; ++i) {
+        spush [i] = test_socket (AF_SP, NN_PUSH);
+        test_connect (spush [i], SOCKET_ADDRESS);
+    }
+    nn_sleep (100);
+    for (i = 0; i != 8; ++i)
+        test_send (spush [i], "ABC");
+    for (i = 0; i != 8; ++i)
+        test_recv (sb, "ABC");
+    for (i = 0; i != 8; ++i)
+        test_close (spush [i]);
+    test_close (sb);
+
     /*  Test closing a socket that is waiting to connect. */
     sc = test_socket (AF_SP, NN_PAIR);
     test_connect (sc, SOCKET_ADDRESS);
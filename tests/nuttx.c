@@ -0,0 +1,321 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn_nuttx.c"
+
+#include "testutil.h"
+#include "../src/utils/mutex.c"
+
+/*  Test the nn_nuttx request/reply wrappers. */
+
+#define NUTTX_REQUESTS 200
+
+struct nuttx_replies {
+    struct nn_mutex sync;
+    int count;
+    int errors;
+    char seen [NUTTX_REQUESTS];
+};
+
+static int nuttx_echo (NN_UNUSED const void *cookie, const int code,
+    nn_trans_data_t *data)
+{
+    /*  Keep the workers busy long enough for the replies to overlap. */
+    nn_sleep (1);
+    data->out = nn_trans_alloc (data->in_size);
+    nn_assert (data->out);
+    memcpy (data->out, data->in, data->in_size);
+    data->out_size = data->in_size;
+    data->out_msg = true;
+    return code;
+}
+
+static void nuttx_reply (void *cookie, int ret, const void *out,
+    size_t out_len)
+{
+    struct nuttx_replies *replies;
+    int i;
+
+    replies = cookie;
+    nn_mutex_lock (&replies->sync);
+    if (ret < 0 || out_len != sizeof (i)) {
+        ++replies->errors;
+    }
+    else {
+        memcpy (&i, out, sizeof (i));
+        if (i != ret || i < 0 || i >= NUTTX_REQUESTS || replies->seen [i])
+            ++replies->errors;
+        else
+            replies->seen [i] = 1;
+    }
+    ++replies->count;
+    nn_mutex_unlock (&replies->sync);
+}
+
+/*  Sends NUTTX_REQUESTS asynchronous requests to a server with several
+    workers and checks that each of them gets its reply. */
+static void test_workers (const char *name, int workers, int op_ordered)
+{
+    void *server;
+    void *client;
+    nn_server_attr_t attr;
+    struct nuttx_replies replies;
+    int count;
+    int rc;
+    int i;
+
+    memset (&attr, 0, sizeof (attr));
+    attr.workers = workers;
+    attr.op_ordered = op_ordered;
+    server = nn_server_create_ex (name, &attr);
+    nn_assert (server);
+    nn_server_set_transaction_cb (server, nuttx_echo, NULL);
+    client = nn_client_connect (name);
+    nn_assert (client);
+
+    memset (&replies, 0, sizeof (replies));
+    nn_mutex_init (&replies.sync);
+    for (i = 0; i != NUTTX_REQUESTS; ++i) {
+        rc = nn_client_transaction_async (client, i, &i, sizeof (i),
+            nuttx_reply, &replies);
+        nn_assert (rc == 0);
+    }
+
+    for (i = 0; i != 500; ++i) {
+        nn_mutex_lock (&replies.sync);
+        count = replies.count;
+        nn_mutex_unlock (&replies.sync);
+        if (count == NUTTX_REQUESTS)
+            break;
+        nn_sleep (10);
+    }
+    nn_assert (count == NUTTX_REQUESTS);
+    nn_assert (replies.errors == 0);
+
+    nn_client_disconnect (client);
+    nn_server_release (server);
+    nn_mutex_term (&replies.sync);
+}
+
+/*  Releases the server with requests still queued and running. Those get
+    cancelled when the client disconnects. */
+static void test_release (const char *name, int op_ordered)
+{
+    void *server;
+    void *client;
+    nn_server_attr_t attr;
+    struct nuttx_replies replies;
+    int rc;
+    int i;
+
+    memset (&attr, 0, sizeof (attr));
+    attr.workers = 4;
+    attr.op_ordered = op_ordered;
+    server = nn_server_create_ex (name, &attr);
+    nn_assert (server);
+    nn_server_set_transaction_cb (server, nuttx_echo, NULL);
+    client = nn_client_connect (name);
+    nn_assert (client);
+
+    memset (&replies, 0, sizeof (replies));
+    nn_mutex_init (&replies.sync);
+    for (i = 0; i != NUTTX_REQUESTS; ++i) {
+        rc = nn_client_transaction_async (client, i, &i, sizeof (i),
+            nuttx_reply, &replies);
+        nn_assert (rc == 0);
+    }
+    nn_sleep (10);
+
+    nn_server_release (server);
+    nn_client_disconnect (client);
+    nn_assert (replies.count == NUTTX_REQUESTS);
+    nn_mutex_term (&replies.sync);
+}
+
+struct nuttx_disconnect {
+    struct nn_mutex sync;
+    void *client;
+    int count;
+};
+
+static void nuttx_disconnect_reply (void *cookie, NN_UNUSED int ret,
+    NN_UNUSED const void *out, NN_UNUSED size_t out_len)
+{
+    struct nuttx_disconnect *state;
+
+    state = cookie;
+    nn_mutex_lock (&state->sync);
+    if (state->client) {
+        nn_client_disconnect (state->client);
+        state->client = NULL;
+    }
+    ++state->count;
+    nn_mutex_unlock (&state->sync);
+}
+
+/*  Disconnects the client from within the callback of the first reply.
+    The remaining requests get cancelled. */
+static void test_disconnect_in_cb (const char *name)
+{
+    void *server;
+    void *client;
+    struct nuttx_disconnect state;
+    int count;
+    int rc;
+    int i;
+
+    server = nn_server_create (name);
+    nn_assert (server);
+    nn_server_set_transaction_cb (server, nuttx_echo, NULL);
+    client = nn_client_connect (name);
+    nn_assert (client);
+
+    nn_mutex_init (&state.sync);
+    state.client = client;
+    state.count = 0;
+    for (i = 0; i != 10; ++i) {
+        rc = nn_client_transaction_async (client, i, &i, sizeof (i),
+            nuttx_disconnect_reply, &state);
+        nn_assert (rc == 0);
+    }
+
+    for (i = 0; i != 500; ++i) {
+        nn_mutex_lock (&state.sync);
+        count = state.count;
+        nn_mutex_unlock (&state.sync);
+        if (count == 10)
+            break;
+        nn_sleep (10);
+    }
+    nn_assert (count == 10);
+    nn_assert (state.client == NULL);
+
+    nn_server_release (server);
+    nn_mutex_term (&state.sync);
+}
+
+struct nuttx_topics {
+    struct nn_mutex sync;
+    const char *prefix;
+    char last [32];
+};
+
+static int nuttx_topic (const void *cookie, const void *topic,
+    const size_t topic_len, const void *content, const size_t content_len)
+{
+    struct nuttx_topics *topics;
+
+    topics = (struct nuttx_topics*) cookie;
+    nn_mutex_lock (&topics->sync);
+    nn_assert (topic_len >= strlen (topics->prefix));
+    nn_assert (memcmp (topic, topics->prefix, strlen (topics->prefix)) == 0);
+    nn_assert (topic_len + 1 + content_len < sizeof (topics->last));
+    memcpy (topics->last, topic, topic_len);
+    topics->last [topic_len] = '/';
+    memcpy (topics->last + topic_len + 1, content, content_len);
+    topics->last [topic_len + 1 + content_len] = 0;
+    nn_mutex_unlock (&topics->sync);
+    return 0;
+}
+
+/*  Publishes a message and waits for the subscriber to get it. Each retry
+    publishes it anew, as messages sent before the subscriber connected are
+    lost. */
+static void nuttx_topic_roundtrip (void *pub, struct nuttx_topics *topics,
+    const char *topic, const char *content)
+{
+    char expected [32];
+    int done;
+    int rc;
+    int i;
+
+    sprintf (expected, "%s/%s", topic, content);
+    for (i = 0; i != 500; ++i) {
+        rc = nn_pub_topic_msg (pub, topic, strlen (topic), content,
+            strlen (content));
+        nn_assert (rc == 0);
+        nn_sleep (10);
+        nn_mutex_lock (&topics->sync);
+        done = strcmp (topics->last, expected) == 0;
+        nn_mutex_unlock (&topics->sync);
+        if (done)
+            return;
+    }
+    nn_assert (0);
+}
+
+/*  A subscription matches the topic of a message only, never the content
+    that follows it on the wire. The listener checks every message it gets
+    against the registered prefix. */
+static void test_topic_prefix (const char *name)
+{
+    void *pub;
+    void *sub;
+    struct nuttx_topics topics;
+    int rc;
+
+    memset (&topics, 0, sizeof (topics));
+    nn_mutex_init (&topics.sync);
+    topics.prefix = "media.player";
+    pub = nn_pub_create (name);
+    nn_assert (pub);
+    sub = nn_sub_connect (name, nuttx_topic, &topics);
+    nn_assert (sub);
+    rc = nn_sub_register_topic (sub, "media.player", 12);
+    nn_assert (rc == 0);
+
+    nuttx_topic_roundtrip (pub, &topics, "media.player1", "ABC");
+    rc = nn_pub_topic_msg (pub, "media", 5, ".player1", 8);
+    nn_assert (rc == 0);
+    nuttx_topic_roundtrip (pub, &topics, "media.player2", "DEF");
+
+    /*  Unregistering a topic stops its delivery. */
+    nn_mutex_lock (&topics.sync);
+    topics.prefix = "media.player2";
+    nn_mutex_unlock (&topics.sync);
+    rc = nn_sub_register_topic (sub, "media.player2", 13);
+    nn_assert (rc == 0);
+    rc = nn_sub_unregister_topic (sub, "media.player", 12);
+    nn_assert (rc == 0);
+    rc = nn_pub_topic_msg (pub, "media.player1", 13, "GHI", 3);
+    nn_assert (rc == 0);
+    nuttx_topic_roundtrip (pub, &topics, "media.player2", "JKL");
+
+    nn_sub_disconnect (sub);
+    rc = nn_pub_release (pub);
+    nn_assert (rc == 0);
+    nn_mutex_term (&topics.sync);
+}
+
+int main ()
+{
+    test_workers ("nuttx_workers", 4, 0);
+    test_workers ("nuttx_ordered", 4, 1);
+    test_workers ("nuttx_single", 1, 0);
+    test_release ("nuttx_release", 0);
+    test_release ("nuttx_release_ordered", 1);
+    test_disconnect_in_cb ("nuttx_disconnect");
+    test_topic_prefix ("nuttx_topics");
+
+    return 0;
+}
@@ -27,12 +27,79 @@
 
 #define SOCKET_ADDRESS "inproc://a"
 
+/*  Number of messages waiting to be received over all the pipes of the
+    socket. */
+static int queued (int s)
+{
+    int rc;
+    int i;
+    int npipes;
+    int total;
+    struct nn_pipe_statistics pipes [4];
+
+    npipes = 4;
+    rc = nn_get_statistics (s, NULL, pipes, &npipes);
+    errno_assert (rc == 0);
+    nn_assert (npipes <= 4);
+    total = 0;
+    for (i = 0; i != npipes; ++i)
+        total += (int) pipes [i].queued;
+    return total;
+}
+
+/*  Waits until the socket is connected to count peers. */
+static void wait_pipes (int s, int count)
+{
+    int rc;
+    int i;
+    int npipes;
+
+    for (i = 0; i != 100; ++i) {
+        npipes = 0;
+        rc = nn_get_statistics (s, NULL, NULL, &npipes);
+        errno_assert (rc == 0);
+        if (npipes == count)
+            return;
+        nn_sleep (10);
+    }
+    nn_assert (0);
+}
+
+/*  Smallest and largest send backlog among the pipes of the socket. */
+static void backlog (int s, uint64_t *lo, uint64_t *hi)
+{
+    int rc;
+    int i;
+    int npipes;
+    struct nn_pipe_statistics pipes [4];
+
+    npipes = 4;
+    rc = nn_get_statistics (s, NULL, pipes, &npipes);
+    errno_assert (rc == 0);
+    nn_assert (npipes >= 1 && npipes <= 4);
+    *lo = *hi = pipes [0].backlog;
+    for (i = 1; i != npipes; ++i) {
+        if (pipes [i].backlog < *lo)
+            *lo = pipes [i].backlog;
+        if (pipes [i].backlog > *hi)
+            *hi = pipes [i].backlog;
+    }
+}
+
 int main ()
 {
     int push1;
     int push2;
     int pull1;
     int pull2;
+    int i;
+    int rc;
+    int opt;
+    int small;
+    int big;
+    uint64_t lo;
+    uint64_t hi;
+    char buf [4096];
 
     /*  Test fan-out. */
 
@@ -76,6 +143,92 @@ int main ()
     test_close (push1);
     test_close (push2);
 
+    /*  Test deficit round-robin. The peer sending small messages gets all of
+        them through while the peer sending large messages repays its
+        deficit. */
+
+    pull1 = test_socket (AF_SP, NN_PULL);
+    opt = 256;
+    test_setsockopt (pull1, NN_SOL_SOCKET, NN_RCVQUANTUM, &opt, sizeof (opt));
+    test_bind (pull1, SOCKET_ADDRESS);
+    push1 = test_socket (AF_SP, NN_PUSH);
+    test_connect (push1, SOCKET_ADDRESS);
+    push2 = test_socket (AF_SP, NN_PUSH);
+    test_connect (push2, SOCKET_ADDRESS);
+
+    memset (buf, 'X', sizeof (buf));
+    for (i = 0; i != 4; ++i) {
+        rc = nn_send (push1, buf, sizeof (buf), 0);
+        errno_assert (rc == sizeof (buf));
+    }
+    for (i = 0; i != 8; ++i)
+        test_send (push2, "ABC");
+
+    /*  Start receiving only once all the messages wait in pull1. */
+    for (i = 0; i != 100 && queued (pull1) != 12; ++i)
+        nn_sleep (10);
+    nn_assert (queued (pull1) == 12);
+
+    small = 0;
+    big = 0;
+    for (i = 0; i != 12; ++i) {
+        rc = nn_recv (pull1, buf, sizeof (buf), 0);
+        errno_assert (rc >= 0);
+        if (rc == 3)
+            ++small;
+        else {
+            nn_assert (rc == sizeof (buf));
+            ++big;
+            /*  No second large message before the small ones are done. */
+            nn_assert (big == 1 || small == 8);
+        }
+    }
+    nn_assert (small == 8 && big == 4);
+
+    test_close (pull1);
+    test_close (push1);
+    test_close (push2);
+
+    /*  Test power-of-two-choices load balancing. Once pull1 took long to
+        accept a message, the messages go to pull2 while pull1 is idle. */
+
+    push1 = test_socket (AF_SP, NN_PUSH);
+    test_bind (push1, SOCKET_ADDRESS);
+    pull1 = test_socket (AF_SP, NN_PULL);
+    opt = 1;
+    test_setsockopt (pull1, NN_SOL_SOCKET, NN_RCVBUF, &opt, sizeof (opt));
+    test_connect (pull1, SOCKET_ADDRESS);
+    pull2 = test_socket (AF_SP, NN_PULL);
+    test_connect (pull2, SOCKET_ADDRESS);
+    wait_pipes (push1, 2);
+
+    /*  An inproc peer with room in its queue takes the message over before
+        nn_send returns. With round-robin, "C" gets stuck as pull1 is full.
+        pull1 doesn't read for 100 ms, which is the time it then took to
+        accept "C". pull2 accepted "B" right away. */
+    test_send (push1, "A");
+    test_send (push1, "B");
+    test_send (push1, "C");
+    nn_sleep (100);
+    test_recv (pull1, "A");
+    test_recv (pull1, "C");
+    test_recv (pull2, "B");
+    backlog (push1, &lo, &hi);
+    nn_assert (hi >= 10000 && lo < hi / 10);
+
+    opt = NN_LB_POWER_OF_TWO;
+    test_setsockopt (push1, NN_SOL_SOCKET, NN_LB_STRATEGY, &opt, sizeof (opt));
+    for (i = 0; i != 10; ++i)
+        test_send (push1, "DEF");
+    for (i = 0; i != 10; ++i)
+        test_recv (pull2, "DEF");
+    rc = nn_recv (pull1, buf, sizeof (buf), NN_DONTWAIT);
+    nn_assert (rc < 0 && nn_errno () == EAGAIN);
+
+    test_close (pull2);
+    test_close (pull1);
+    test_close (push1);
+
     return 0;
 }
 
@@ -0,0 +1,143 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+
+#include "testutil.h"
+
+#include <string.h>
+
+/*  Test profiling of the worker threads. */
+
+static struct nn_profile_fsm *find_fsm (struct nn_profile_fsm *fsms,
+    int nfsms, const char *name)
+{
+    int i;
+
+    for (i = 0; i != nfsms; ++i)
+        if (strcmp (fsms [i].name, name) == 0)
+            return &fsms [i];
+    return NULL;
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int sb;
+    int sc;
+    int i;
+    int nworkers;
+    int nfsms;
+    uint64_t events;
+    struct nn_profile_worker workers [64];
+    struct nn_profile_fsm fsms [64];
+    struct nn_profile_fsm *fsm;
+    char socket_address [128];
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+            get_test_port (argc, argv));
+
+    nworkers = -1;
+    nfsms = 0;
+    rc = nn_get_profile (workers, &nworkers, fsms, &nfsms);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+
+    /*  No worker threads are running before the first socket is open. */
+    nworkers = 64;
+    nfsms = 64;
+    rc = nn_get_profile (workers, &nworkers, fsms, &nfsms);
+    errno_assert (rc == 0);
+    nn_assert (nworkers == 0);
+
+    rc = nn_profile (1);
+    errno_assert (rc == 0);
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, socket_address);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, socket_address);
+
+    for (i = 0; i != 10; ++i) {
+        test_send (sc, "ABC");
+        test_recv (sb, "ABC");
+    }
+
+    nworkers = 64;
+    nfsms = 64;
+    rc = nn_get_profile (workers, &nworkers, fsms, &nfsms);
+    errno_assert (rc == 0);
+    nn_assert (nworkers >= 1);
+    nn_assert (nfsms >= 1 && nfsms <= 64);
+    nn_assert (workers [0].iterations > 0);
+    nn_assert (workers [0].wait > 0);
+    nn_assert (workers [0].busy > 0);
+
+    /*  The state machines are named after their handlers. */
+    fsm = find_fsm (fsms, nfsms, "usock");
+    nn_assert (fsm && fsm->events >= 20 && fsm->time > 0);
+    fsm = find_fsm (fsms, nfsms, "stcp");
+    nn_assert (fsm && fsm->events >= 20);
+    nn_assert (find_fsm (fsms, nfsms, "btcp") != NULL);
+    nn_assert (find_fsm (fsms, nfsms, "nn_stcp_handler") == NULL);
+    events = fsm->events;
+
+    /*  A short array gets the number of entries available. */
+    i = nfsms;
+    nworkers = 0;
+    nfsms = 0;
+    rc = nn_get_profile (NULL, &nworkers, NULL, &nfsms);
+    errno_assert (rc == 0);
+    nn_assert (nworkers >= 1 && nfsms == i);
+
+    /*  Nothing is accounted while profiling is off. */
+    rc = nn_profile (0);
+    errno_assert (rc == 0);
+    for (i = 0; i != 10; ++i) {
+        test_send (sc, "DEF");
+        test_recv (sb, "DEF");
+    }
+    nworkers = 64;
+    nfsms = 64;
+    rc = nn_get_profile (workers, &nworkers, fsms, &nfsms);
+    errno_assert (rc == 0);
+    fsm = find_fsm (fsms, nfsms, "stcp");
+    nn_assert (fsm && fsm->events == events);
+
+    /*  Switching profiling back on starts from scratch. */
+    rc = nn_profile (1);
+    errno_assert (rc == 0);
+    nworkers = 64;
+    nfsms = 64;
+    rc = nn_get_profile (workers, &nworkers, fsms, &nfsms);
+    errno_assert (rc == 0);
+    fsm = find_fsm (fsms, nfsms, "stcp");
+    nn_assert (fsm && fsm->events < events);
+    rc = nn_profile (0);
+    errno_assert (rc == 0);
+
+    test_close (sc);
+    test_close (sb);
+
+    return 0;
+}
@@ -27,6 +27,59 @@
 
 #define SOCKET_ADDRESS "inproc://test"
 
+/*  Sends count raw requests, each carrying its own letter, and echoes them
+    back from the raw REP socket before the requester reads any reply. */
+static void burst (int req, int rep, int count)
+{
+    int rc;
+    int i;
+    char raw [5];
+    void *body;
+    void *ctx;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+
+    for (i = 0; i != count; ++i) {
+
+        /*  Bottom of the backtrace followed by the payload. */
+        raw [0] = (char) 0x80;
+        raw [1] = raw [2] = raw [3] = 1;
+        raw [4] = (char) ('A' + i);
+        rc = nn_send (req, raw, sizeof (raw), 0);
+        errno_assert (rc == sizeof (raw));
+
+        iov.iov_base = &body;
+        iov.iov_len = NN_MSG;
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = &ctx;
+        hdr.msg_controllen = NN_MSG;
+        rc = nn_recvmsg (rep, &hdr, 0);
+        errno_assert (rc == 1);
+        rc = nn_sendmsg (rep, &hdr, 0);
+        errno_assert (rc == 1);
+    }
+}
+
+/*  Sum of requests still awaiting reply over all the pipes of the socket. */
+static int outstanding (int s)
+{
+    int rc;
+    int i;
+    int npipes;
+    int total;
+    struct nn_pipe_statistics pipes [4];
+
+    npipes = 4;
+    rc = nn_get_statistics (s, NULL, pipes, &npipes);
+    errno_assert (rc == 0);
+    nn_assert (npipes <= 4);
+    total = 0;
+    for (i = 0; i != npipes; ++i)
+        total += (int) pipes [i].outstanding;
+    return total;
+}
+
 int main ()
 {
     int rc;
@@ -37,6 +90,15 @@ int main ()
     int resend_ivl;
     char buf [7];
     int timeo;
+    int opt;
+    int i;
+    size_t optsz;
+    void *body1;
+    void *body2;
+    void *ctx1;
+    void *ctx2;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
 
     /*  Test req/rep with full socket types. */
     rep1 = test_socket (AF_SP, NN_REP);
@@ -173,6 +235,198 @@ int main ()
     test_close (req1);
     test_close (rep1);
 
+    /*  Test least-outstanding-requests load balancing. A request that is
+        not answered yet keeps rep1 busy so the next one goes to rep2. The
+        request is counted against a pipe only until it is answered, re-sent
+        or cancelled. */
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    rep2 = test_socket (AF_SP, NN_REP);
+    test_connect (rep2, SOCKET_ADDRESS);
+    opt = NN_LB_LEAST_OUTSTANDING;
+    test_setsockopt (req1, NN_SOL_SOCKET, NN_LB_STRATEGY, &opt, sizeof (opt));
+    opt = 0;
+    optsz = sizeof (opt);
+    rc = nn_getsockopt (req1, NN_SOL_SOCKET, NN_LB_STRATEGY, &opt, &optsz);
+    errno_assert (rc == 0);
+    nn_assert (opt == NN_LB_LEAST_OUTSTANDING);
+
+    test_send (req1, "A");
+    test_recv (rep1, "A");
+    nn_assert (outstanding (req1) == 1);
+
+    /*  Cancelling "A" releases rep1 only after "B" was sent elsewhere. */
+    test_send (req1, "B");
+    test_recv (rep2, "B");
+    nn_assert (outstanding (req1) == 1);
+    test_send (rep2, "B");
+    test_recv (req1, "B");
+    nn_assert (outstanding (req1) == 0);
+
+    /*  Late reply to the cancelled request doesn't skew the counts. */
+    test_send (rep1, "A");
+    test_send (req1, "C");
+    test_recv (rep1, "C");
+    test_send (rep1, "C");
+    test_recv (req1, "C");
+    nn_assert (outstanding (req1) == 0);
+
+    /*  Re-sent request goes to the peer that is not holding it. */
+    resend_ivl = 100;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_RESEND_IVL,
+        &resend_ivl, sizeof (resend_ivl));
+    errno_assert (rc == 0);
+    test_send (req1, "D");
+    test_recv (rep2, "D");
+    test_recv (rep1, "D");
+    nn_assert (outstanding (req1) == 1);
+    test_send (rep1, "D");
+    test_recv (req1, "D");
+    nn_assert (outstanding (req1) == 0);
+
+    test_close (rep2);
+    test_close (rep1);
+    test_close (req1);
+
+    /*  Test adaptive re-sending. Once the round-trip is measured, the request
+        is re-sent much sooner than the fixed interval would allow. */
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_bind (rep1, SOCKET_ADDRESS);
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_connect (req1, SOCKET_ADDRESS);
+    resend_ivl = 5000;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_RESEND_IVL,
+        &resend_ivl, sizeof (resend_ivl));
+    errno_assert (rc == 0);
+    opt = 1;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_RESEND_ADAPTIVE,
+        &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    timeo = 2000;
+    rc = nn_setsockopt (rep1, NN_SOL_SOCKET, NN_RCVTIMEO,
+       &timeo, sizeof (timeo));
+    errno_assert (rc == 0);
+
+    test_send (req1, "ABC");
+    test_recv (rep1, "ABC");
+    test_send (rep1, "ABC");
+    test_recv (req1, "ABC");
+    opt = -1;
+    optsz = sizeof (opt);
+    rc = nn_getsockopt (req1, NN_REQ, NN_REQ_RTT, &opt, &optsz);
+    errno_assert (rc == 0);
+    nn_assert (optsz == sizeof (opt) && opt >= 0 && opt < timeo);
+
+    test_send (req1, "DEF");
+    test_recv (rep1, "DEF");
+    /*  The following waits for request to be resent  */
+    test_recv (rep1, "DEF");
+
+    test_close (req1);
+    test_close (rep1);
+
+    /*  Test processing several requests concurrently in context mode. */
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_bind (rep1, SOCKET_ADDRESS);
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_connect (req1, SOCKET_ADDRESS);
+    req2 = test_socket (AF_SP, NN_REQ);
+    test_connect (req2, SOCKET_ADDRESS);
+
+    opt = 1;
+    rc = nn_setsockopt (rep1, NN_REP, NN_REP_CONTEXT, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    opt = 0;
+    optsz = sizeof (opt);
+    rc = nn_getsockopt (rep1, NN_REP, NN_REP_CONTEXT, &opt, &optsz);
+    errno_assert (rc == 0);
+    nn_assert (optsz == sizeof (opt) && opt == 1);
+
+    /*  Reply without a context is not possible. */
+    rc = nn_send (rep1, "ABC", 3, 0);
+    nn_assert (rc == -1 && nn_errno () == EFSM);
+
+    test_send (req1, "ABC");
+    test_send (req2, "DEF");
+
+    iov.iov_base = &body1;
+    iov.iov_len = NN_MSG;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = &ctx1;
+    hdr.msg_controllen = NN_MSG;
+    rc = nn_recvmsg (rep1, &hdr, 0);
+    errno_assert (rc == 3);
+    iov.iov_base = &body2;
+    hdr.msg_control = &ctx2;
+    rc = nn_recvmsg (rep1, &hdr, 0);
+    errno_assert (rc == 3);
+
+    /*  Reply in reverse order, echoing the requests back. */
+    rc = nn_sendmsg (rep1, &hdr, 0);
+    errno_assert (rc == 3);
+    iov.iov_base = &body1;
+    hdr.msg_control = &ctx1;
+    rc = nn_sendmsg (rep1, &hdr, 0);
+    errno_assert (rc == 3);
+
+    test_recv (req1, "ABC");
+    test_recv (req2, "DEF");
+
+    test_close (req2);
+    test_close (req1);
+    test_close (rep1);
+
+    /*  A raw REP socket keeps the replies for a peer that is still busy with
+        the previous ones and sends them in order once the peer reads. */
+    rep1 = test_socket (AF_SP_RAW, NN_REP);
+    test_bind (rep1, SOCKET_ADDRESS);
+    req1 = test_socket (AF_SP_RAW, NN_REQ);
+    opt = 1;
+    test_setsockopt (req1, NN_SOL_SOCKET, NN_RCVBUF, &opt, sizeof (opt));
+    test_connect (req1, SOCKET_ADDRESS);
+
+    burst (req1, rep1, 8);
+    buf [1] = 0;
+    for (i = 0; i != 8; ++i) {
+        buf [0] = (char) ('A' + i);
+        test_recv (req1, buf);
+    }
+
+    test_close (req1);
+    test_close (rep1);
+
+    /*  Once the waiting replies, backtraces included, would take more than
+        NN_SNDBUF bytes, further replies are dropped. Two replies are in
+        flight before the pipe gets busy. Each of the others takes five bytes,
+        so three of them fit into the queue. */
+    rep1 = test_socket (AF_SP_RAW, NN_REP);
+    opt = 16;
+    test_setsockopt (rep1, NN_SOL_SOCKET, NN_SNDBUF, &opt, sizeof (opt));
+    test_bind (rep1, SOCKET_ADDRESS);
+    req1 = test_socket (AF_SP_RAW, NN_REQ);
+    opt = 1;
+    test_setsockopt (req1, NN_SOL_SOCKET, NN_RCVBUF, &opt, sizeof (opt));
+    opt = 100;
+    test_setsockopt (req1, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_connect (req1, SOCKET_ADDRESS);
+
+    burst (req1, rep1, 8);
+    for (i = 0; i != 8; ++i) {
+        rc = nn_recv (req1, buf, sizeof (buf), 0);
+        if (rc < 0) {
+            errno_assert (nn_errno () == ETIMEDOUT);
+            break;
+        }
+        nn_assert (rc == 1 && buf [0] == 'A' + i);
+    }
+    nn_assert (i == 5);
+
+    test_close (req1);
+    test_close (rep1);
+
     return 0;
 }
 
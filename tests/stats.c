@@ -23,9 +23,101 @@
 
 #include "../src/nn.h"
 #include "../src/reqrep.h"
+#include "../src/pair.h"
 
 #include "testutil.h"
 
+#define SOCKET_ADDRESS_INPROC "inproc://stats"
+
+static void test_bulk (void)
+{
+    int rc;
+    int i;
+    int sb;
+    int sc;
+    int npipes;
+    uint64_t total;
+    struct nn_statistics stats;
+    struct nn_pipe_statistics pipes [2];
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS_INPROC);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS_INPROC);
+
+    /*  Only the number of pipes is asked for. */
+    npipes = 0;
+    rc = nn_get_statistics (sb, NULL, NULL, &npipes);
+    errno_assert (rc == 0);
+    nn_assert (npipes == 1);
+
+    /*  Messages waiting to be received show up as the queue depth. */
+    test_send (sc, "ABC");
+    test_send (sc, "DEFG");
+    test_send (sc, "HI");
+    nn_sleep (100);
+    npipes = 2;
+    rc = nn_get_statistics (sb, &stats, pipes, &npipes);
+    errno_assert (rc == 0);
+    nn_assert (npipes == 1);
+    nn_assert (pipes [0].queued == 3);
+    nn_assert (pipes [0].messages_received == 0);
+    nn_assert (stats.latency_count == 0);
+    nn_assert (nn_stat_latency (&stats, 50.0) == 0);
+
+    test_recv (sb, "ABC");
+    test_recv (sb, "DEFG");
+    test_recv (sb, "HI");
+    test_send (sb, "OK");
+    test_recv (sc, "OK");
+
+    npipes = 2;
+    rc = nn_get_statistics (sb, &stats, pipes, &npipes);
+    errno_assert (rc == 0);
+    nn_assert (npipes == 1);
+    nn_assert (pipes [0].endpoint == 1);
+    nn_assert (pipes [0].messages_sent == 1);
+    nn_assert (pipes [0].messages_received == 3);
+    nn_assert (pipes [0].bytes_sent == 2);
+    nn_assert (pipes [0].bytes_received == 9);
+    nn_assert (pipes [0].queued == 0);
+    nn_assert (stats.messages_sent == 1);
+    nn_assert (stats.messages_received == 3);
+    nn_assert (stats.bytes_received == 9);
+    nn_assert (stats.current_connections == 1);
+
+    /*  Each received message went into the latency histogram. */
+    nn_assert (stats.latency_count == 3);
+    total = 0;
+    for (i = 0; i != NN_STAT_LATENCY_BUCKETS; ++i)
+        total += stats.latency [i];
+    nn_assert (total == 3);
+    nn_assert (stats.latency_sum >= stats.latency_max);
+    nn_assert (nn_stat_latency (&stats, 0.0) <= nn_stat_latency (&stats, 99.0));
+    nn_assert (nn_stat_latency (&stats, 99.0) <= stats.latency_max);
+    nn_assert (nn_stat_latency (&stats, 100.0) == stats.latency_max);
+
+    /*  The bulk API agrees with the single-value one. */
+    nn_assert (nn_get_statistic (sc, NN_STAT_MESSAGES_SENT) == 3);
+    rc = nn_get_statistics (sc, &stats, NULL, NULL);
+    errno_assert (rc == 0);
+    nn_assert (stats.messages_sent == 3);
+    nn_assert (stats.bytes_sent == 9);
+    nn_assert (stats.latency_count == 1);
+
+    npipes = -1;
+    rc = nn_get_statistics (sc, &stats, pipes, &npipes);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+
+    test_close (sc);
+    nn_sleep (100);
+    npipes = 2;
+    rc = nn_get_statistics (sb, NULL, pipes, &npipes);
+    errno_assert (rc == 0);
+    nn_assert (npipes == 0);
+    test_close (sb);
+}
+
 int main (int argc, const char *argv[])
 {
     int rep1;
@@ -94,6 +186,8 @@ int main (int argc, const char *argv[])
 
     test_close (rep1);
 
+    test_bulk ();
+
     return 0;
 }
 
@@ -24,9 +24,67 @@
 #include "../src/nn.h"
 #include "../src/survey.h"
 
+#include <string.h>
+
 #include "testutil.h"
+#include "../src/utils/attr.h"
+#include "../src/utils/stopwatch.c"
+#include "../src/utils/thread.c"
 
 #define SOCKET_ADDRESS "inproc://test"
+#define SOCKET_ADDRESS_F "inproc://test_f"
+#define SOCKET_ADDRESS_G "inproc://test_g"
+
+/*  Forwards surveys from SOCKET_ADDRESS_F to SOCKET_ADDRESS_G and responses
+    back until the library is terminated. */
+static void device (NN_UNUSED void *arg)
+{
+    int rc;
+    int devf;
+    int devg;
+
+    devf = test_socket (AF_SP_RAW, NN_RESPONDENT);
+    test_bind (devf, SOCKET_ADDRESS_F);
+    devg = test_socket (AF_SP_RAW, NN_SURVEYOR);
+    test_bind (devg, SOCKET_ADDRESS_G);
+
+    rc = nn_device (devf, devg);
+    nn_assert (rc < 0 && nn_errno () == EBADF);
+
+    test_close (devg);
+    test_close (devf);
+}
+
+/*  Receives a response and returns ID of the survey it belongs to. */
+static int recv_response (int s, const char *data)
+{
+    int rc;
+    char buf [16];
+    char control [64];
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    unsigned char *id;
+
+    iov.iov_base = buf;
+    iov.iov_len = sizeof (buf);
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof (control);
+    rc = nn_recvmsg (s, &hdr, 0);
+    errno_assert (rc >= 0);
+    nn_assert (rc == (int) strlen (data) && memcmp (buf, data, rc) == 0);
+
+    cmsg = NN_CMSG_FIRSTHDR (&hdr);
+    nn_assert (cmsg && cmsg->cmsg_level == PROTO_SP &&
+        cmsg->cmsg_type == SP_HDR);
+    nn_assert (*(size_t*) NN_CMSG_DATA (cmsg) == 4);
+    id = NN_CMSG_DATA (cmsg) + sizeof (size_t);
+    return (int) (((uint32_t) id [0] << 24) | ((uint32_t) id [1] << 16) |
+        ((uint32_t) id [2] << 8) | id [3]);
+}
 
 int main ()
 {
@@ -36,7 +94,15 @@ int main ()
     int respondent2;
     int respondent3;
     int deadline;
+    int quorum;
+    int maxsurveys;
+    int id1;
+    int id2;
+    size_t sz;
     char buf [7];
+    struct nn_stopwatch stopwatch;
+    struct nn_thread thread;
+    uint64_t elapsed;
 
     /*  Test a simple survey with three respondents. */
     surveyor = test_socket (AF_SP, NN_SURVEYOR);
@@ -95,6 +161,165 @@ int main ()
     test_close (respondent2);
     test_close (respondent3);
 
+    /*  Test that the survey completes as soon as all the respondents
+        answered. */
+    surveyor = test_socket (AF_SP, NN_SURVEYOR);
+    deadline = 10000;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_DEADLINE,
+        &deadline, sizeof (deadline));
+    quorum = NN_SURVEYOR_QUORUM_ALL;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_QUORUM,
+        &quorum, sizeof (quorum));
+    test_bind (surveyor, SOCKET_ADDRESS);
+    respondent1 = test_socket (AF_SP, NN_RESPONDENT);
+    test_connect (respondent1, SOCKET_ADDRESS);
+    respondent2 = test_socket (AF_SP, NN_RESPONDENT);
+    test_connect (respondent2, SOCKET_ADDRESS);
+
+    nn_stopwatch_init (&stopwatch);
+    test_send (surveyor, "ABC");
+    test_recv (respondent1, "ABC");
+    test_send (respondent1, "DEF");
+    test_recv (respondent2, "ABC");
+    test_send (respondent2, "DEF");
+    test_recv (surveyor, "DEF");
+    test_recv (surveyor, "DEF");
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == ETIMEDOUT);
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == EFSM);
+    elapsed = nn_stopwatch_term (&stopwatch);
+    nn_assert (elapsed < 5000000);
+
+    /*  Test the quorum. */
+    quorum = 1;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_QUORUM,
+        &quorum, sizeof (quorum));
+    nn_stopwatch_init (&stopwatch);
+    test_send (surveyor, "ABC");
+    test_recv (respondent1, "ABC");
+    test_send (respondent1, "DEF");
+    test_recv (surveyor, "DEF");
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == ETIMEDOUT);
+    elapsed = nn_stopwatch_term (&stopwatch);
+    nn_assert (elapsed < 5000000);
+
+    test_close (surveyor);
+    test_close (respondent1);
+    test_close (respondent2);
+
+    /*  Test concurrent surveys. */
+    surveyor = test_socket (AF_SP, NN_SURVEYOR);
+    maxsurveys = 4;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_MAXSURVEYS,
+        &maxsurveys, sizeof (maxsurveys));
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_DEADLINE,
+        &deadline, sizeof (deadline));
+    quorum = NN_SURVEYOR_QUORUM_ALL;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_QUORUM,
+        &quorum, sizeof (quorum));
+    test_bind (surveyor, SOCKET_ADDRESS);
+    respondent1 = test_socket (AF_SP, NN_RESPONDENT);
+    test_connect (respondent1, SOCKET_ADDRESS);
+    respondent2 = test_socket (AF_SP, NN_RESPONDENT);
+    test_connect (respondent2, SOCKET_ADDRESS);
+
+    nn_stopwatch_init (&stopwatch);
+    test_send (surveyor, "ABC");
+    sz = sizeof (id1);
+    rc = nn_getsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_SURVEYID,
+        &id1, &sz);
+    errno_assert (rc == 0);
+    test_send (surveyor, "DEF");
+    sz = sizeof (id2);
+    rc = nn_getsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_SURVEYID,
+        &id2, &sz);
+    errno_assert (rc == 0);
+    nn_assert (id1 != id2);
+    nn_assert (id1 < 0 && id2 < 0);
+
+    /*  The respondents answer both surveys. The first survey isn't
+        cancelled by the second one. */
+    test_recv (respondent1, "ABC");
+    test_send (respondent1, "A1");
+    test_recv (respondent1, "DEF");
+    test_send (respondent1, "D1");
+    nn_assert (recv_response (surveyor, "A1") == id1);
+    nn_assert (recv_response (surveyor, "D1") == id2);
+    test_recv (respondent2, "ABC");
+    test_send (respondent2, "A2");
+    nn_assert (recv_response (surveyor, "A2") == id1);
+
+    /*  The first survey is complete now, so its stale responses are
+        dropped. The second one is still waiting for a response. */
+    test_recv (respondent2, "DEF");
+    test_send (respondent2, "D2");
+    nn_assert (recv_response (surveyor, "D2") == id2);
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == ETIMEDOUT);
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == EFSM);
+    elapsed = nn_stopwatch_term (&stopwatch);
+    nn_assert (elapsed < 5000000);
+
+    /*  Surveys expire independently. */
+    deadline = 100;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_DEADLINE,
+        &deadline, sizeof (deadline));
+    test_send (surveyor, "GHI");
+    deadline = 1000;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_DEADLINE,
+        &deadline, sizeof (deadline));
+    test_send (surveyor, "JKL");
+    sz = sizeof (id2);
+    rc = nn_getsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_SURVEYID,
+        &id2, &sz);
+    errno_assert (rc == 0);
+    nn_sleep (200);
+    test_recv (respondent1, "GHI");
+    test_send (respondent1, "G1");
+    test_recv (respondent1, "JKL");
+    test_send (respondent1, "J1");
+    nn_assert (recv_response (surveyor, "J1") == id2);
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == ETIMEDOUT);
+
+    test_close (surveyor);
+    test_close (respondent1);
+    test_close (respondent2);
+
+    /*  By default the survey lasts until the deadline, so all the responses
+        get through a device although the surveyor has a single pipe. */
+    nn_thread_init (&thread, device, NULL);
+    nn_sleep (100);
+    surveyor = test_socket (AF_SP, NN_SURVEYOR);
+    deadline = 500;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_DEADLINE,
+        &deadline, sizeof (deadline));
+    test_connect (surveyor, SOCKET_ADDRESS_F);
+    respondent1 = test_socket (AF_SP, NN_RESPONDENT);
+    test_connect (respondent1, SOCKET_ADDRESS_G);
+    respondent2 = test_socket (AF_SP, NN_RESPONDENT);
+    test_connect (respondent2, SOCKET_ADDRESS_G);
+    nn_sleep (100);
+
+    test_send (surveyor, "ABC");
+    test_recv (respondent1, "ABC");
+    test_send (respondent1, "DEF");
+    test_recv (surveyor, "DEF");
+    test_recv (respondent2, "ABC");
+    test_send (respondent2, "DEF");
+    test_recv (surveyor, "DEF");
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == ETIMEDOUT);
+
+    test_close (surveyor);
+    test_close (respondent1);
+    test_close (respondent2);
+    nn_term ();
+    nn_thread_term (&thread);
+
     return 0;
 }
 
@@ -25,6 +25,7 @@
 #include "../src/nn.h"
 #include "../src/pair.h"
 #include "../src/pubsub.h"
+#include "../src/pipeline.h"
 #include "../src/tcp.h"
 
 #include "testutil.h"
@@ -41,6 +42,7 @@ int main (int argc, const char *argv[])
     int opt;
     size_t sz;
     int s1, s2;
+    int spush [8];
     void * dummy_buf;
     char addr[128];
     char socket_address[128];
@@ -214,6 +216,39 @@ int main (int argc, const char *argv[])
     errno_assert (nn_errno () == EINVAL);
     test_close (sb);
 
+    /*  Test several listeners sharing the port, accepting connections in
+        batches. */
+    sb = test_socket (AF_SP, NN_PULL);
+    opt = 0;
+    rc = nn_setsockopt (sb, NN_TCP, NN_TCP_LISTENERS, &opt, sizeof (opt));
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EINVAL);
+    opt = 4;
+    test_setsockopt (sb, NN_TCP, NN_TCP_LISTENERS, &opt, sizeof (opt));
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sb, NN_TCP, NN_TCP_ACCEPT_BATCH, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt) && opt == 1);
+    opt = 17;
+    rc = nn_setsockopt (sb, NN_TCP, NN_TCP_ACCEPT_BATCH, &opt, sizeof (opt));
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EINVAL);
+    opt = 4;
+    test_setsockopt (sb, NN_TCP, NN_TCP_ACCEPT_BATCH, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    for (i = 0; i != 8; ++i) {
+        spush [i] = test_socket (AF_SP, NN_PUSH);
+        test_connect (spush [i], socket_address);
+    }
+    nn_sleep (100);
+    for (i = 0; i != 8; ++i)
+        test_send (spush [i], "ABC");
+    for (i = 0; i != 8; ++i)
+        test_recv (sb, "ABC");
+    for (i = 0; i != 8; ++i)
+        test_close (spush [i]);
+    test_close (sb);
+
     /*  Test closing a socket that is waiting to connect. */
     sc = test_socket (AF_SP, NN_PAIR);
     test_connect (sc, socket_address);
@@ -0,0 +1,184 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+
+#include "testutil.h"
+#include "../src/utils/mutex.c"
+
+#include <string.h>
+
+/*  Test the message tracepoints. */
+
+#define SOCKET_ADDRESS_INPROC "inproc://trace"
+
+struct trace_log {
+    struct nn_mutex sync;
+    int count [NN_TRACE_SOCK_RECV + 1];
+    struct nn_trace_event last [NN_TRACE_SOCK_RECV + 1];
+};
+
+static void trace_hook (const struct nn_trace_event *event, void *arg)
+{
+    struct trace_log *log;
+
+    log = arg;
+    nn_mutex_lock (&log->sync);
+    ++log->count [event->point];
+    memcpy (&log->last [event->point], event, sizeof (*event));
+    nn_mutex_unlock (&log->sync);
+}
+
+static void trace_all (struct trace_log *log, int flags)
+{
+    int point;
+    int rc;
+
+    for (point = NN_TRACE_SOCK_SEND; point <= NN_TRACE_SOCK_RECV; ++point) {
+        rc = nn_trace_hook (point, trace_hook, log, flags);
+        errno_assert (rc == 0);
+    }
+}
+
+static void trace_none (void)
+{
+    int point;
+    int rc;
+
+    for (point = NN_TRACE_SOCK_SEND; point <= NN_TRACE_SOCK_RECV; ++point) {
+        rc = nn_trace_hook (point, NULL, NULL, 0);
+        errno_assert (rc == 0);
+    }
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int sb;
+    int sc;
+    struct trace_log log;
+    struct nn_trace_event *ev;
+    char socket_address [128];
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+            get_test_port (argc, argv));
+
+    /*  Nothing to test if the library was built without tracepoints. */
+    rc = nn_trace_hook (NN_TRACE_SOCK_SEND, NULL, NULL, 0);
+    if (rc == -1 && nn_errno () == ENOTSUP)
+        return 0;
+    errno_assert (rc == 0);
+
+    rc = nn_trace_hook (0, trace_hook, NULL, 0);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    rc = nn_trace_hook (NN_TRACE_SOCK_RECV + 1, trace_hook, NULL, 0);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    rc = nn_trace_hook (NN_TRACE_SOCK_SEND, trace_hook, NULL, 0x100);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+
+    memset (&log, 0, sizeof (log));
+    nn_mutex_init (&log.sync);
+
+    /*  Over inproc the message stamp identifies the message end to end. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS_INPROC);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS_INPROC);
+
+    trace_all (&log, 0);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    trace_none ();
+
+    nn_assert (log.count [NN_TRACE_SOCK_SEND] == 1);
+    nn_assert (log.count [NN_TRACE_PIPE_SEND] == 1);
+    nn_assert (log.count [NN_TRACE_SOCK_RECV] == 1);
+    nn_assert (log.count [NN_TRACE_USOCK_SENT] == 0);
+    nn_assert (log.count [NN_TRACE_USOCK_RECEIVED] == 0);
+    ev = &log.last [NN_TRACE_SOCK_SEND];
+    nn_assert (ev->socket == sc && ev->object == NULL && ev->size == 3);
+    nn_assert (ev->stamp != 0 && ev->time == 0);
+    ev = &log.last [NN_TRACE_PIPE_SEND];
+    nn_assert (ev->socket == sc && ev->object != NULL && ev->size == 3);
+    ev = &log.last [NN_TRACE_SOCK_RECV];
+    nn_assert (ev->socket == sb && ev->size == 3);
+    nn_assert (ev->stamp == log.last [NN_TRACE_SOCK_SEND].stamp);
+
+    /*  Hooks that are not installed don't fire. */
+    test_send (sc, "DEF");
+    test_recv (sb, "DEF");
+    nn_assert (log.count [NN_TRACE_SOCK_SEND] == 1);
+
+    test_close (sc);
+    test_close (sb);
+
+    /*  Over TCP the bytes hit the wire and come out on the other side. */
+    memset (log.count, 0, sizeof (log.count));
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, socket_address);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, socket_address);
+    nn_sleep (100);
+
+    trace_all (&log, NN_TRACE_TIMESTAMP);
+    test_send (sc, "GHIJ");
+    test_recv (sb, "GHIJ");
+    nn_sleep (100);
+    trace_none ();
+
+    nn_mutex_lock (&log.sync);
+    nn_assert (log.count [NN_TRACE_SOCK_SEND] == 1);
+    nn_assert (log.count [NN_TRACE_PIPE_SEND] == 1);
+    nn_assert (log.count [NN_TRACE_USOCK_SENT] == 1);
+    nn_assert (log.count [NN_TRACE_USOCK_RECEIVED] == 1);
+    nn_assert (log.count [NN_TRACE_SOCK_RECV] == 1);
+    ev = &log.last [NN_TRACE_USOCK_SENT];
+    nn_assert (ev->socket == sc && ev->size == 4);
+    nn_assert (ev->object == log.last [NN_TRACE_PIPE_SEND].object);
+    nn_assert (ev->stamp == log.last [NN_TRACE_SOCK_SEND].stamp);
+    ev = &log.last [NN_TRACE_USOCK_RECEIVED];
+    nn_assert (ev->socket == sb && ev->object != NULL && ev->size == 4);
+    nn_assert (ev->stamp != 0);
+    nn_assert (ev->stamp == log.last [NN_TRACE_SOCK_RECV].stamp);
+
+    /*  The timestamps follow the message through the stack. The receiving
+        worker may see the data before the sending thread gets to report
+        that it was sent, so the two sides are only compared to the socket
+        level. */
+    nn_assert (log.last [NN_TRACE_SOCK_SEND].time != 0);
+    nn_assert (log.last [NN_TRACE_SOCK_SEND].time <=
+        log.last [NN_TRACE_PIPE_SEND].time);
+    nn_assert (log.last [NN_TRACE_PIPE_SEND].time <=
+        log.last [NN_TRACE_USOCK_SENT].time);
+    nn_assert (log.last [NN_TRACE_SOCK_SEND].time <=
+        log.last [NN_TRACE_USOCK_RECEIVED].time);
+    nn_assert (log.last [NN_TRACE_USOCK_RECEIVED].time <=
+        log.last [NN_TRACE_SOCK_RECV].time);
+    nn_mutex_unlock (&log.sync);
+
+    test_close (sc);
+    test_close (sb);
+    nn_mutex_term (&log.sync);
+
+    return 0;
+}
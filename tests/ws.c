@@ -25,6 +25,7 @@
 
 #include "../src/nn.h"
 #include "../src/pair.h"
+#include "../src/bus.h"
 #include "../src/ws.h"
 
 #include "testutil.h"
@@ -73,6 +74,37 @@ void test_text ()
     return;
 }
 
+/*  test_shared() verifies that a message sent to several peers at once is
+    delivered intact to each of them, although each copy is masked with
+    a different key. */
+void test_shared ()
+{
+    int sb;
+    int sc;
+    int opt;
+    char msg [64];
+
+    sb = test_socket (AF_SP, NN_BUS);
+    sc = test_socket (AF_SP, NN_BUS);
+    opt = 500;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+    test_connect (sc, socket_address);
+    nn_sleep (100);
+
+    /*  Long enough not to be stored inline in the message. */
+    memset (msg, 'A', sizeof (msg) - 1);
+    msg [sizeof (msg) - 1] = 0;
+    test_send (sc, msg);
+    test_recv (sb, msg);
+    test_recv (sb, msg);
+
+    test_close (sc);
+    test_close (sb);
+}
+
 int main (int argc, const char *argv[])
 {
     int rc;
@@ -240,6 +272,8 @@ int main (int argc, const char *argv[])
 
     test_text ();
 
+    test_shared ();
+
     /*  Test closing a socket that is waiting to connect. */
     sc = test_socket (AF_SP, NN_PAIR);
     test_connect (sc, socket_address);
@@ -0,0 +1,421 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/ws.h"
+
+#include "testutil.h"
+
+#if !defined NN_HAVE_WINDOWS
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "../src/transports/ws/deflate.c"
+#include "../src/utils/chunk.c"
+#include "../src/utils/chunkref.c"
+#include "../src/utils/atomic.c"
+#include "../src/utils/alloc.c"
+#include "../src/utils/wire.c"
+#include "../src/utils/strncasecmp.c"
+
+/*  Tests of the permessage-deflate extension of WebSocket transport. */
+
+#define TEST_MSG_SIZE 10000
+
+static char socket_address [128];
+
+static int test_accept (const char *offers, int no_context_takeover,
+    struct nn_ws_deflate_params *params, char *buf)
+{
+    return nn_ws_deflate_accept (offers, strlen (offers), no_context_takeover,
+        params, buf, NN_WS_DEFLATE_HEADER_MAX_LEN);
+}
+
+static int test_confirm (const char *response, int no_context_takeover,
+    struct nn_ws_deflate_params *params)
+{
+    return nn_ws_deflate_confirm (response, strlen (response),
+        no_context_takeover, params);
+}
+
+static void test_negotiation (void)
+{
+    struct nn_ws_deflate_params params;
+    char buf [NN_WS_DEFLATE_HEADER_MAX_LEN];
+    int rc;
+
+    /*  Other extensions are skipped. */
+    memset (&params, 0, sizeof (params));
+    rc = test_accept ("x-webkit-deflate-frame, "
+        "permessage-deflate; client_max_window_bits", 0, &params, buf);
+    nn_assert (rc == 0);
+    nn_assert (params.enabled);
+    nn_assert (!params.no_context_takeover);
+    nn_assert (params.window_bits == 15);
+    nn_assert (strcmp (buf, "permessage-deflate") == 0);
+
+    /*  Offers that can't be honoured are declined. */
+    memset (&params, 0, sizeof (params));
+    rc = test_accept ("permessage-deflate; server_max_window_bits=8, "
+        "permessage-deflate; server_max_window_bits=\"10\"; "
+        "server_no_context_takeover", 0, &params, buf);
+    nn_assert (rc == 0);
+    nn_assert (params.no_context_takeover);
+    nn_assert (params.window_bits == 10);
+    nn_assert (strcmp (buf, "permessage-deflate; server_no_context_takeover; "
+        "server_max_window_bits=10") == 0);
+
+    rc = test_accept ("permessage-deflate; foo", 0, &params, buf);
+    nn_assert (rc == -ENOENT);
+    rc = test_accept ("permessage-deflate; "
+        "server_no_context_takeover; server_no_context_takeover", 0,
+        &params, buf);
+    nn_assert (rc == -ENOENT);
+
+    /*  Server's local preference is announced. */
+    memset (&params, 0, sizeof (params));
+    rc = test_accept ("permessage-deflate", 1, &params, buf);
+    nn_assert (rc == 0);
+    nn_assert (params.no_context_takeover);
+    nn_assert (strcmp (buf, "permessage-deflate; server_no_context_takeover; "
+        "client_no_context_takeover") == 0);
+
+    /*  Client checks the response against its offer. */
+    nn_ws_deflate_offer (buf, sizeof (buf), 1);
+    nn_assert (strcmp (buf, "permessage-deflate; client_no_context_takeover; "
+        "server_no_context_takeover") == 0);
+    memset (&params, 0, sizeof (params));
+    rc = test_confirm ("permessage-deflate; "
+        "client_no_context_takeover", 0, &params);
+    nn_assert (rc == 0);
+    nn_assert (params.enabled);
+    nn_assert (params.no_context_takeover);
+    rc = test_confirm ("permessage-deflate", 1, &params);
+    nn_assert (rc == -EPROTO);
+    rc = test_confirm ("permessage-deflate; "
+        "client_max_window_bits=10", 0, &params);
+    nn_assert (rc == -EPROTO);
+    rc = test_confirm ("permessage-deflate, permessage-deflate", 0,
+        &params);
+    nn_assert (rc == -EPROTO);
+}
+
+static void test_codec (int no_context_takeover)
+{
+    struct nn_ws_deflate_params params;
+    struct nn_ws_deflate tx;
+    struct nn_ws_deflate rx;
+    struct nn_chunkref hdr;
+    struct nn_chunkref body;
+    struct nn_chunkref out;
+    struct nn_chunkref empty;
+    void *chunk;
+    size_t size;
+    size_t half;
+    size_t first;
+    int rc;
+    int i;
+
+    params.enabled = 1;
+    params.no_context_takeover = no_context_takeover;
+    params.window_bits = 15;
+    nn_ws_deflate_init (&tx);
+    nn_ws_deflate_init (&rx);
+    rc = nn_ws_deflate_start (&tx, &params, 6);
+    errnum_assert (rc == 0, -rc);
+    rc = nn_ws_deflate_start (&rx, &params, 6);
+    errnum_assert (rc == 0, -rc);
+
+    nn_chunkref_init (&hdr, 4);
+    memcpy (nn_chunkref_data (&hdr), "\x80\x00\x00\x01", 4);
+    nn_chunkref_init (&body, TEST_MSG_SIZE);
+    for (i = 0; i != TEST_MSG_SIZE; ++i)
+        ((char*) nn_chunkref_data (&body)) [i] = "{\"temp\": 21.5}, " [i % 16];
+
+    first = 0;
+    for (i = 0; i != 3; ++i) {
+        rc = nn_ws_deflate_compress (&tx, &hdr, &body, &out);
+        errnum_assert (rc == 0, -rc);
+        nn_assert (nn_chunkref_size (&out) < TEST_MSG_SIZE / 10);
+
+        /*  With context takeover, repeated messages get even smaller. */
+        if (i == 0)
+            first = nn_chunkref_size (&out);
+        else if (no_context_takeover)
+            nn_assert (nn_chunkref_size (&out) == first);
+        else
+            nn_assert (nn_chunkref_size (&out) < first);
+
+        /*  Decompress the message delivered in two fragments. */
+        chunk = NULL;
+        half = nn_chunkref_size (&out) / 2;
+        rc = nn_ws_deflate_decompress (&rx, nn_chunkref_data (&out), half, 0,
+            &chunk, &size, SIZE_MAX);
+        errnum_assert (rc == 0, -rc);
+        rc = nn_ws_deflate_decompress (&rx,
+            (uint8_t*) nn_chunkref_data (&out) + half,
+            nn_chunkref_size (&out) - half, 1, &chunk, &size, SIZE_MAX);
+        errnum_assert (rc == 0, -rc);
+        nn_assert (size == TEST_MSG_SIZE + 4);
+        nn_assert (nn_chunk_size (chunk) == size);
+        nn_assert (memcmp (chunk, nn_chunkref_data (&hdr), 4) == 0);
+        nn_assert (memcmp ((uint8_t*) chunk + 4, nn_chunkref_data (&body),
+            TEST_MSG_SIZE) == 0);
+        nn_chunk_free (chunk);
+        nn_chunkref_term (&out);
+    }
+
+    /*  Message of exactly the maximum size is accepted. */
+    rc = nn_ws_deflate_compress (&tx, &hdr, &body, &out);
+    errnum_assert (rc == 0, -rc);
+    chunk = NULL;
+    rc = nn_ws_deflate_decompress (&rx, nn_chunkref_data (&out),
+        nn_chunkref_size (&out), 1, &chunk, &size, TEST_MSG_SIZE + 4);
+    errnum_assert (rc == 0, -rc);
+    nn_assert (size == TEST_MSG_SIZE + 4);
+    nn_chunk_free (chunk);
+    nn_chunkref_term (&out);
+
+    /*  Empty message fits any limit. */
+    nn_chunkref_init (&empty, 0);
+    rc = nn_ws_deflate_compress (&tx, &empty, &empty, &out);
+    errnum_assert (rc == 0, -rc);
+    chunk = NULL;
+    rc = nn_ws_deflate_decompress (&rx, nn_chunkref_data (&out),
+        nn_chunkref_size (&out), 1, &chunk, &size, 0);
+    errnum_assert (rc == 0, -rc);
+    nn_assert (size == 0);
+    nn_chunk_free (chunk);
+    nn_chunkref_term (&out);
+    nn_chunkref_term (&empty);
+
+    /*  Decompressed size is limited. */
+    rc = nn_ws_deflate_compress (&tx, &hdr, &body, &out);
+    errnum_assert (rc == 0, -rc);
+    chunk = NULL;
+    rc = nn_ws_deflate_decompress (&rx, nn_chunkref_data (&out),
+        nn_chunkref_size (&out), 1, &chunk, &size, TEST_MSG_SIZE + 3);
+    nn_assert (rc == -EMSGSIZE);
+    nn_assert (chunk == NULL);
+    nn_chunkref_term (&out);
+    nn_ws_deflate_stop (&rx);
+    rc = nn_ws_deflate_start (&rx, &params, 6);
+    errnum_assert (rc == 0, -rc);
+
+    /*  Corrupted data are detected. */
+    rc = nn_ws_deflate_decompress (&rx, "\xff\xff\xff\xff", 4, 1,
+        &chunk, &size, SIZE_MAX);
+    nn_assert (rc == -EPROTO);
+    nn_assert (chunk == NULL);
+
+    nn_chunkref_term (&body);
+    nn_chunkref_term (&hdr);
+    nn_ws_deflate_term (&rx);
+    nn_ws_deflate_term (&tx);
+}
+
+static void test_transfer (int sb_deflate, int sc_deflate, int msg_type)
+{
+    int sb;
+    int sc;
+    int opt;
+    int i;
+    char *msg;
+
+    msg = malloc (TEST_MSG_SIZE + 1);
+    alloc_assert (msg);
+    for (i = 0; i != TEST_MSG_SIZE; ++i)
+        msg [i] = "{\"temp\": 21.5}, " [i % 16];
+    msg [TEST_MSG_SIZE] = 0;
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_setsockopt (sb, NN_WS, NN_WS_DEFLATE, &sb_deflate,
+        sizeof (sb_deflate));
+    test_setsockopt (sc, NN_WS, NN_WS_DEFLATE, &sc_deflate,
+        sizeof (sc_deflate));
+    test_setsockopt (sb, NN_WS, NN_WS_MSG_TYPE, &msg_type, sizeof (msg_type));
+    test_setsockopt (sc, NN_WS, NN_WS_MSG_TYPE, &msg_type, sizeof (msg_type));
+    opt = 1;
+    test_setsockopt (sc, NN_WS, NN_WS_DEFLATE_NO_CONTEXT_TAKEOVER, &opt,
+        sizeof (opt));
+    opt = 1000;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+
+    /*  Both messages above and below the threshold get through. */
+    for (i = 0; i != 3; ++i) {
+        test_send (sc, msg);
+        test_recv (sb, msg);
+        test_send (sb, msg);
+        test_recv (sc, msg);
+        test_send (sc, "ABC");
+        test_recv (sb, "ABC");
+        test_send (sb, "DEF");
+        test_recv (sc, "DEF");
+    }
+
+    test_close (sc);
+    test_close (sb);
+    free (msg);
+}
+
+#if !defined NN_HAVE_WINDOWS
+
+/*  Checks the frames on the wire using a hand-made WebSocket client. */
+static void test_wire (int port)
+{
+    int sb;
+    int fd;
+    int rc;
+    int i;
+    size_t len;
+    struct sockaddr_in addr;
+    char buf [1024];
+    char *msg;
+
+    msg = malloc (TEST_MSG_SIZE + 1);
+    alloc_assert (msg);
+    for (i = 0; i != TEST_MSG_SIZE; ++i)
+        msg [i] = "{\"temp\": 21.5}, " [i % 16];
+    msg [TEST_MSG_SIZE] = 0;
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    i = 1;
+    test_setsockopt (sb, NN_WS, NN_WS_DEFLATE, &i, sizeof (i));
+    test_bind (sb, socket_address);
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons ((uint16_t) port);
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    rc = connect (fd, (struct sockaddr*) &addr, sizeof (addr));
+    errno_assert (rc == 0);
+
+    len = (size_t) sprintf (buf,
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Protocol: pair.sp.nanomsg.org\r\n"
+        "Sec-WebSocket-Extensions: permessage-deflate\r\n"
+        "\r\n");
+    rc = (int) send (fd, buf, len, 0);
+    errno_assert (rc == (int) len);
+
+    /*  Read the response up to the empty line. */
+    len = 0;
+    while (len < 4 || memcmp (buf + len - 4, "\r\n\r\n", 4) != 0) {
+        nn_assert (len < sizeof (buf) - 1);
+        rc = (int) recv (fd, buf + len, 1, 0);
+        errno_assert (rc == 1);
+        ++len;
+    }
+    buf [len] = 0;
+    nn_assert (strstr (buf, " 101 ") != NULL);
+    nn_assert (strstr (buf, "permessage-deflate") != NULL);
+
+    /*  The message is sent in a single compressed frame, i.e. with RSV1 set,
+        that is much shorter than the message itself. */
+    test_send (sb, msg);
+    rc = (int) recv (fd, buf, 2, MSG_WAITALL);
+    errno_assert (rc == 2);
+    nn_assert ((buf [0] & 0xf0) == 0xc0);
+    nn_assert ((buf [1] & 0x7f) < 126);
+
+    close (fd);
+    test_close (sb);
+    free (msg);
+}
+
+#endif
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int s;
+    int opt;
+    size_t sz;
+
+    test_addr_from (socket_address, "ws", "127.0.0.1",
+        get_test_port (argc, argv));
+
+    s = test_socket (AF_SP, NN_PAIR);
+
+    /*  Check default values and ranges of the options. */
+    sz = sizeof (opt);
+    rc = nn_getsockopt (s, NN_WS, NN_WS_DEFLATE, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt) && opt == 0);
+    rc = nn_getsockopt (s, NN_WS, NN_WS_DEFLATE_LEVEL, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 6);
+    rc = nn_getsockopt (s, NN_WS, NN_WS_DEFLATE_MIN_SIZE, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 256);
+    rc = nn_getsockopt (s, NN_WS, NN_WS_DEFLATE_NO_CONTEXT_TAKEOVER,
+        &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 0);
+    opt = 10;
+    rc = nn_setsockopt (s, NN_WS, NN_WS_DEFLATE_LEVEL, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = -1;
+    rc = nn_setsockopt (s, NN_WS, NN_WS_DEFLATE_MIN_SIZE, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1;
+    rc = nn_setsockopt (s, NN_WS, NN_WS_DEFLATE, &opt, sizeof (opt));
+    if (rc < 0 && nn_errno () == ENOTSUP) {
+        /*  Built without zlib; there's nothing more to test. */
+        test_close (s);
+        return 0;
+    }
+    errno_assert (rc == 0);
+    test_close (s);
+
+    test_negotiation ();
+    test_codec (0);
+    test_codec (1);
+
+    /*  Compression is used only if both peers want it. */
+    test_transfer (1, 1, NN_WS_MSG_TYPE_BINARY);
+    test_transfer (1, 1, NN_WS_MSG_TYPE_TEXT);
+    test_transfer (0, 1, NN_WS_MSG_TYPE_TEXT);
+    test_transfer (1, 0, NN_WS_MSG_TYPE_BINARY);
+
+#if !defined NN_HAVE_WINDOWS
+    test_wire (get_test_port (argc, argv));
+#endif
+
+    return 0;
+}
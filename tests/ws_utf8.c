@@ -0,0 +1,185 @@
+/*
+    Copyright (c) 2026 nanomsg contributors
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/utils/err.c"
+#include "../src/transports/ws/utf8.c"
+
+/*  Checks nn_ws_utf8_validate against the scalar state machine run one
+    octet at a time, including text split across calls and code points
+    straddling the boundaries of the 16-octet blocks. */
+
+struct sequence {
+    const char *data;
+    /*  1 if valid, -1 if invalid, 0 if cut in the middle of a code point. */
+    int valid;
+};
+
+static const struct sequence sequences [] = {
+    {"a", 1},
+    {"\xc2\x80", 1},
+    {"\xdf\xbf", 1},
+    {"\xe0\xa0\x80", 1},
+    {"\xe1\x80\x80", 1},
+    {"\xec\xbf\xbf", 1},
+    {"\xed\x9f\xbf", 1},
+    {"\xee\x80\x80", 1},
+    {"\xef\xbf\xbf", 1},
+    {"\xf0\x90\x80\x80", 1},
+    {"\xf3\xbf\xbf\xbf", 1},
+    {"\xf4\x8f\xbf\xbf", 1},
+    {"\xce\xba\xe1\xbd\xb9\xcf\x83\xce\xbc\xce\xb5", 1},
+    {"\x80", -1},
+    {"\xbf", -1},
+    {"\xc0\x80", -1},
+    {"\xc1\xbf", -1},
+    {"\xc2\x41", -1},
+    {"\xc2\xc2\x80", -1},
+    {"\xe0\x9f\xbf", -1},
+    {"\xed\xa0\x80", -1},
+    {"\xed\xbf\xbf", -1},
+    {"\xe1\x80\x41", -1},
+    {"\xf0\x8f\xbf\xbf", -1},
+    {"\xf4\x90\x80\x80", -1},
+    {"\xf1\x80\x80\x41", -1},
+    {"\xf5\x80\x80\x80", -1},
+    {"\xf8\x88\x80\x80\x80", -1},
+    {"\xff", -1},
+    {"\xc2\x80\x80", -1},
+    {"\xe1\x80\x80\x80", -1},
+    {"\xc2", 0},
+    {"\xe0\xa0", 0},
+    {"\xf0", 0},
+    {"\xf0\x90", 0},
+    {"\xf4\x8f\xbf", 0}
+};
+
+/*  Reference validator. */
+static int dfa (int state, const uint8_t *data, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i != len; ++i)
+        state = (int) ((nn_ws_utf8_row [nn_ws_utf8_class [data [i]]] >>
+            state) & 63);
+    return state;
+}
+
+/*  Validates the text in one go, split in two at every offset and one octet
+    at a time, and checks all the results against the reference. Returns
+    the state at the end of the text. */
+static int check (const uint8_t *data, size_t len)
+{
+    int expected;
+    int state;
+    size_t i;
+
+    expected = dfa (NN_WS_UTF8_ACCEPT, data, len);
+    nn_assert (nn_ws_utf8_validate (NN_WS_UTF8_ACCEPT, data, len) ==
+        expected);
+
+    for (i = 0; i <= len; ++i) {
+        state = nn_ws_utf8_validate (NN_WS_UTF8_ACCEPT, data, i);
+        nn_assert (state == dfa (NN_WS_UTF8_ACCEPT, data, i));
+        state = nn_ws_utf8_validate (state, data + i, len - i);
+        nn_assert (state == expected);
+    }
+
+    state = NN_WS_UTF8_ACCEPT;
+    for (i = 0; i != len; ++i)
+        state = nn_ws_utf8_validate (state, data + i, 1);
+    nn_assert (state == expected);
+
+    return expected;
+}
+
+/*  Deterministic pseudo-random numbers. */
+static uint32_t seed = 1;
+
+static uint32_t rnd (void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+int main ()
+{
+    uint8_t buf [128];
+    size_t len;
+    size_t seqlen;
+    size_t prefix;
+    size_t suffix;
+    size_t i;
+    size_t j;
+    int state;
+
+    /*  Put each sequence at every offset of a block, followed by ASCII text
+        or by more of the same, so that it's seen both at the end of the
+        text and in the middle of whole blocks. */
+    for (i = 0; i != sizeof (sequences) / sizeof (sequences [0]); ++i) {
+        seqlen = strlen (sequences [i].data);
+        for (prefix = 0; prefix != 34; ++prefix) {
+            for (suffix = 0; suffix < 34; suffix += 11) {
+                memset (buf, 'x', prefix);
+                memcpy (buf + prefix, sequences [i].data, seqlen);
+                memset (buf + prefix + seqlen, 'y', suffix);
+                state = check (buf, prefix + seqlen + suffix);
+                if (sequences [i].valid > 0)
+                    nn_assert (state == NN_WS_UTF8_ACCEPT);
+                else if (sequences [i].valid < 0 || suffix)
+                    nn_assert (state == NN_WS_UTF8_REJECT);
+                else
+                    nn_assert (state != NN_WS_UTF8_ACCEPT &&
+                        state != NN_WS_UTF8_REJECT);
+            }
+
+            /*  Repeat the sequence until the buffer is full. */
+            memset (buf, 'x', prefix);
+            for (len = prefix; len + seqlen <= sizeof (buf); len += seqlen)
+                memcpy (buf + len, sequences [i].data, seqlen);
+            state = check (buf, len);
+            if (sequences [i].valid > 0)
+                nn_assert (state == NN_WS_UTF8_ACCEPT);
+            else
+                nn_assert (state == NN_WS_UTF8_REJECT);
+        }
+    }
+
+    /*  Random text made of the valid sequences, sometimes with one octet
+        overwritten. */
+    for (i = 0; i != 2000; ++i) {
+        len = 0;
+        while (1) {
+            j = rnd () % 13;
+            seqlen = strlen (sequences [j].data);
+            if (len + seqlen > sizeof (buf))
+                break;
+            memcpy (buf + len, sequences [j].data, seqlen);
+            len += seqlen;
+        }
+        len = rnd () % (len + 1);
+        if (len && rnd () % 2)
+            buf [rnd () % len] = (uint8_t) rnd ();
+        check (buf, len);
+    }
+
+    return 0;
+}
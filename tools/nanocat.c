@@ -55,6 +55,7 @@ enum echo_format {
 typedef struct nn_options {
     /* Global options */
     int verbose;
+    int stats;
 
     /* Socket options */
     int socket_type;
@@ -143,6 +144,11 @@ struct nn_option nn_options[] = {
      NN_OPT_DECREMENT, offsetof (nn_options_t, verbose), NULL,
      NN_NO_PROVIDES, NN_NO_CONFLICTS, NN_NO_REQUIRES,
      "Generic", NULL, "Decrease verbosity of the nanocat"},
+    {"stats", 0, NULL,
+     NN_OPT_INCREMENT, offsetof (nn_options_t, stats), NULL,
+     NN_NO_PROVIDES, NN_NO_CONFLICTS, NN_NO_REQUIRES,
+     "Generic", NULL, "Profile the worker threads and print it along with "
+                      "socket statistics to stderr on exit"},
     {"help", 'h', NULL,
      NN_OPT_HELP, 0, NULL,
      NN_NO_PROVIDES, NN_NO_CONFLICTS, NN_NO_REQUIRES,
@@ -595,11 +601,62 @@ void nn_resp_loop (nn_options_t *options, int sock)
     }
 }
 
+void nn_print_stats (int sock)
+{
+    int rc;
+    int i;
+    int n;
+    struct nn_statistics stats;
+    struct nn_pipe_statistics pipes [16];
+    struct nn_profile_worker workers [16];
+    struct nn_profile_fsm fsms [64];
+    int nworkers;
+    int nfsms;
+
+    n = sizeof (pipes) / sizeof (pipes [0]);
+    rc = nn_get_statistics (sock, &stats, pipes, &n);
+    nn_assert_errno (rc == 0, "Can't get statistics");
+    fprintf (stderr, "messages sent %llu (%llu bytes), "
+        "received %llu (%llu bytes)\n",
+        (unsigned long long) stats.messages_sent,
+        (unsigned long long) stats.bytes_sent,
+        (unsigned long long) stats.messages_received,
+        (unsigned long long) stats.bytes_received);
+    if (stats.latency_count)
+        fprintf (stderr, "latency p50 %llu us, p99 %llu us, max %llu us\n",
+            (unsigned long long) nn_stat_latency (&stats, 50.0),
+            (unsigned long long) nn_stat_latency (&stats, 99.0),
+            (unsigned long long) stats.latency_max);
+    for (i = 0; i < n && i < (int) (sizeof (pipes) / sizeof (pipes [0]));
+          ++i)
+        fprintf (stderr, "  endpoint %d: sent %llu, received %llu, "
+            "queued %llu\n", pipes [i].endpoint,
+            (unsigned long long) pipes [i].messages_sent,
+            (unsigned long long) pipes [i].messages_received,
+            (unsigned long long) pipes [i].queued);
+
+    nworkers = sizeof (workers) / sizeof (workers [0]);
+    nfsms = sizeof (fsms) / sizeof (fsms [0]);
+    rc = nn_get_profile (workers, &nworkers, fsms, &nfsms);
+    nn_assert_errno (rc == 0, "Can't get profile");
+    for (i = 0; i < nworkers && i < (int) (sizeof (workers) /
+          sizeof (workers [0])); ++i)
+        fprintf (stderr, "worker %d: %llu iterations, "
+            "wait %.3f ms, busy %.3f ms\n", i,
+            (unsigned long long) workers [i].iterations,
+            workers [i].wait / 1e6, workers [i].busy / 1e6);
+    for (i = 0; i < nfsms && i < (int) (sizeof (fsms) / sizeof (fsms [0]));
+          ++i)
+        fprintf (stderr, "  %-16s %10llu events %12.3f ms\n", fsms [i].name,
+            (unsigned long long) fsms [i].events, fsms [i].time / 1e6);
+}
+
 int main (int argc, char **argv)
 {
     int sock;
     nn_options_t options = {
         /* verbose           */ 0,
+        /* stats             */ 0,
         /* socket_type       */ 0,
         /* bind_addresses    */ {NULL, NULL, 0, 0},
         /* connect_addresses */ {NULL, NULL, 0, 0},
@@ -614,6 +671,8 @@ int main (int argc, char **argv)
     };
 
     nn_parse_options (&nn_cli, &options, argc, argv);
+    if (options.stats)
+        nn_profile (1);
     sock = nn_create_socket (&options);
     nn_connect_socket (&options, sock);
     nn_sleep((int)(options.send_delay*1000));
@@ -648,6 +707,8 @@ int main (int argc, char **argv)
         break;
     }
 
+    if (options.stats)
+        nn_print_stats (sock);
     nn_close (sock);
     nn_free_options(&nn_cli, &options);
     return 0;